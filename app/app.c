@@ -0,0 +1,960 @@
+/**
+ * @file app.c
+ * @brief Shared monitoring logic for the bare-metal and FreeRTOS builds
+ *
+ * Holds the application state and every processing step of the monitoring
+ * pipeline (sensor acquisition, threshold evaluation, display rendering and
+ * MQTT publication). The entry points only decide *when* each step runs:
+ * main.c from a timer-driven super-loop, main_freertos.c from dedicated tasks.
+ */
+
+// Standard C libraries
+#include <stdio.h>          // Standard I/O operations
+#include <string.h>         // String manipulation functions
+#include <math.h>           // Mathematical functions (NAN, etc.)
+
+// Pico SDK core libraries
+#include "pico/stdlib.h"    // Pico standard library (GPIO, time, etc.)
+#include "hardware/i2c.h"   // Hardware I2C interface
+#include "hardware/gpio.h"  // Hardware GPIO control
+#include "pico/cyw43_arch.h" // WiFi chip (CYW43) architecture support
+
+// Application-specific modules
+#include "app.h"            // Application state and shared steps
+#include "app_config.h"     // Pinout, credentials, intervals and thresholds
+#include "rh_sensor.h"      // Temperature/humidity sensors (AHT10/AHT20/SHT4x)
+#include "bh1750.h"         // BH1750 light intensity sensor driver
+#include "i2c_bus.h"        // Hardware / PIO I2C buses
+#include "scd4x.h"          // SCD4x CO2 sensor (periodic mode)
+#include "adc_probes.h"     // pH / EC / reservoir level probes (ADC + DMA)
+#include "pulse_counter.h"  // Flow meter / pump tachometer (PIO + DMA)
+#include "ds18b20.h"        // Water temperature probes (PIO 1-Wire)
+#include "dosing_pump.h"    // Peristaltic dosing pumps (PIO steppers)
+#include "power_manager.h"  // Supply monitoring and duty cycling
+#include "uplink.h"         // Batched store-and-forward uplink
+#include "influx_udp.h"     // Line protocol over UDP to InfluxDB
+#include "coap_server.h"    // CoAP telemetry with Observe
+#include "display.h"        // SSD1306 OLED display interface
+#include "mqtt_server.h"    // MQTT communication manager
+#include "mem_pool.h"       // Static message buffers
+#include "flash_log.h"      // Persistent history in flash
+#include "climate_control.h" // Actuator loop statistics (telemetry)
+#include "light_scheduler.h" // Daily light integral progress (telemetry)
+#include "wall_clock.h"     // SNTP wall clock
+#include "fleet_stagger.h"  // Per-board publish phase
+#include "link_monitor.h"   // Wi-Fi link class (MQTT screen)
+
+/**
+ * @brief Button debouncing mechanism
+ * Prevents false triggering from mechanical switch bounce
+ */
+typedef struct {
+    uint pin;              // GPIO pin number for this button
+    bool last_state;       // Previous button state for edge detection
+} DebounceButton;
+
+/**
+ * @brief Environmental sensors sharing one I2C bus
+ * Group 0 is the primary set on i2c0, the others are shelves on PIO buses
+ */
+typedef struct {
+    I2cBus bus;            // Hardware or PIO bus of the group
+    RhSensor rh;           // Temperature/humidity (model detected at boot)
+    Bh1750 light;          // Light intensity
+    I2cBusStats reported;  // Counters at the previous benchmark report
+} SensorGroup;
+
+#define SENSOR_GROUP_COUNT (1 + SHELF_COUNT)
+
+/* ========== GLOBAL STATE VARIABLES ========== */
+
+// Primary application state - contains all system operational data
+AppState app_state;
+
+// Button instances for user interface navigation
+static DebounceButton btn_a, btn_b, btn_c;
+
+// Sensor groups, one bus each (index 0: primary group on i2c0)
+static SensorGroup sensor_groups[SENSOR_GROUP_COUNT];
+static const uint shelf_sda_pins[SHELF_COUNT] = { SHELF_1_SDA_PIN, SHELF_2_SDA_PIN };
+static const char *const shelf_bus_names[SHELF_COUNT] = { "pio-1", "pio-2" };
+static absolute_time_t bus_stats_time;
+
+// CO2 sensor on the primary group's bus
+static Scd4x co2_sensor;
+
+// Next time a local dosing rule may fire (solution mixing after a rule dose)
+static absolute_time_t dosing_rules_ready_at;
+static uint32_t dosing_rule_doses;
+
+/* ========== BUTTON INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Initialize GPIO button with debouncing configuration
+ *
+ * Configures a GPIO pin as an input with internal pull-up resistor
+ * and initializes the debouncing mechanism for reliable button detection.
+ *
+ * @param btn Pointer to button structure to initialize
+ * @param pin GPIO pin number to configure for button input
+ */
+static void button_init(DebounceButton* btn, uint pin) {
+    btn->pin = pin;                    // Store pin number for future reference
+    gpio_init(pin);                    // Initialize GPIO pin for use
+    gpio_pull_up(pin);                 // Enable internal pull-up resistor (button grounds when pressed)
+    gpio_set_dir(pin, false);          // Configure as input (GPIO_IN = false)
+    btn->last_state = gpio_get(pin);   // Initialize debouncing with current pin state
+}
+
+/**
+ * @brief Detect button press with debouncing mechanism
+ *
+ * Implements edge detection to identify button press events (high-to-low transition)
+ * while filtering out mechanical bounce that could cause false triggers.
+ *
+ * @param btn Pointer to button structure containing state information
+ * @return true if button was pressed (falling edge detected), false otherwise
+ */
+static bool button_pressed(DebounceButton* btn) {
+    bool current_state = gpio_get(btn->pin);                        // Read current GPIO state
+    bool pressed = (btn->last_state == 1 && current_state == 0);    // Detect falling edge (press event)
+    btn->last_state = current_state;                                // Update state for next comparison
+    return pressed;
+}
+
+/**
+ * @brief Handle menu navigation buttons
+ *
+ * Buttons A and B cycle through the display menus. Button C requests a WiFi
+ * reconnection, which is left to the caller because it must run in the
+ * network context (main loop or network task).
+ *
+ * Any press keeps the OLED lit for a while when the power policy has turned
+ * it off; a menu button pressed on a dark display only wakes it.
+ *
+ * @return true if the WiFi reconnection button was pressed
+ */
+bool app_process_buttons(void) {
+    bool dark = power_display_mode() == DISPLAY_POWER_OFF;
+    bool prev = button_pressed(&btn_a);
+    bool next = button_pressed(&btn_b);
+    bool reconnect = button_pressed(&btn_c);
+
+    if (prev || next || reconnect) {
+        power_manager_note_activity();
+    }
+    if (dark) {
+        return reconnect;
+    }
+
+    if (prev) {
+        app_state.current_menu = (MenuId)((app_state.current_menu + MENU_COUNT - 1) % MENU_COUNT);
+        printf("Menu alterado para: %d\n", app_state.current_menu);
+    }
+
+    if (next) {
+        app_state.current_menu = (MenuId)((app_state.current_menu + 1) % MENU_COUNT);
+        printf("Menu alterado para: %d\n", app_state.current_menu);
+    }
+
+    return reconnect;
+}
+
+/* ========== NETWORK CONNECTIVITY FUNCTIONS ========== */
+
+/**
+ * @brief Establish WiFi connection and initialize MQTT client
+ *
+ * Configures the CYW43 wireless chip for station mode, attempts connection
+ * to the configured access point, retrieves network information, and
+ * initializes the MQTT communication subsystem.
+ *
+ * @return true if WiFi connection successful and MQTT initialized, false on failure
+ */
+bool wifi_connect(void) {
+    // Configure WiFi chip for client (station) mode
+    cyw43_arch_enable_sta_mode();
+
+    printf("Conectando ao WiFi '%s'...\n", WIFI_SSID);
+
+    // Attempt WiFi connection with 30-second timeout
+    if (cyw43_arch_wifi_connect_timeout_ms(WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK, 30000)) {
+        printf("Falha ao conectar ao WiFi\n");
+        return false;
+    }
+
+    printf("WiFi conectado!\n");
+
+    // Extract assigned IP address from network interface
+    struct netif *netif = &cyw43_state.netif[CYW43_ITF_STA];
+    snprintf(app_state.wifi.ip_address, sizeof(app_state.wifi.ip_address),
+             "%s", ip4addr_ntoa(netif_ip4_addr(netif)));
+
+    // Update application state with connection details
+    strncpy(app_state.wifi.ssid, WIFI_SSID, sizeof(app_state.wifi.ssid) - 1);
+    app_state.wifi.connected = true;
+
+    // Initialize MQTT communication subsystem after successful WiFi connection,
+    // after a random wait so a rack restored together does not connect together
+    sleep_ms(fleet_stagger_random_ms(FLEET_CONNECT_SPREAD_MS));
+    mqtt_conect_init();
+    printf("Cliente MQTT inicializado\n");
+
+    // Wall clock for the photoperiod and history timestamps
+    wall_clock_start_sntp();
+
+    // Observable telemetry for CoAP consumers
+    coap_server_start();
+
+    return true;
+}
+
+/* ========== ENVIRONMENTAL MONITORING FUNCTIONS ========== */
+
+/**
+ * @brief Evaluate sensor readings against configured thresholds
+ *
+ * Analyzes current environmental sensor data to determine if any values
+ * exceed acceptable operational limits. Updates alert flags and provides
+ * visual indication via onboard LED when critical conditions are detected.
+ *
+ * @param sensors Sensor readings to evaluate
+ * @param alerts Alert flags to update
+ */
+void check_critical_values(const SensorData *sensors, AlertStatus *alerts) {
+    // Reset all alert flags for fresh evaluation
+    alerts->temp_critical = false;
+    alerts->humidity_critical = false;
+    alerts->lux_critical = false;
+    alerts->ph_critical = false;
+    alerts->ec_critical = false;
+    alerts->level_critical = false;
+    alerts->water_temp_critical = false;
+    alerts->flow_critical = false;
+    alerts->pump_critical = false;
+    alerts->co2_critical = false;
+
+    // Evaluate temperature and humidity if the RH sensor is operational
+    if (sensors->aht_ok) {
+        // Check temperature against acceptable range
+        if (sensors->temperature < TEMP_MIN || sensors->temperature > TEMP_MAX) {
+            alerts->temp_critical = true;
+        }
+        // Check humidity against maximum threshold
+        if (sensors->humidity > HUMIDITY_MAX) {
+            alerts->humidity_critical = true;
+        }
+    }
+
+    // Evaluate light intensity if BH1750 sensor is operational
+    if (sensors->lux_ok) {
+        // Check light level against minimum threshold
+        if (sensors->lux < LUX_MIN) {
+            alerts->lux_critical = true;
+        }
+    }
+
+    // Evaluate the nutrient solution if the probe sampler is running
+    if (sensors->probes_ok) {
+        alerts->ph_critical = sensors->ph < PH_MIN || sensors->ph > PH_MAX;
+        alerts->ec_critical = sensors->ec < EC_MIN || sensors->ec > EC_MAX;
+        alerts->level_critical = sensors->water_level < WATER_LEVEL_MIN;
+    }
+    if (sensors->water_temp_ok) {
+        alerts->water_temp_critical = sensors->water_temperature < WATER_TEMP_MIN ||
+                                      sensors->water_temperature > WATER_TEMP_MAX;
+    }
+
+    // Evaluate nutrient circulation (a stalled input reads 0)
+    if (sensors->pulses_ok) {
+        alerts->flow_critical = sensors->flow_lpm < FLOW_MIN_LPM;
+        alerts->pump_critical = sensors->pump_rpm < PUMP_MIN_RPM;
+    }
+
+    if (sensors->co2_ok) {
+        alerts->co2_critical = sensors->co2_ppm < CO2_MIN || sensors->co2_ppm > CO2_MAX;
+    }
+
+    // Shelves share the primary group's thresholds
+    for (int i = 0; i < SHELF_COUNT; i++) {
+        const ShelfReading *shelf = &sensors->shelves[i];
+        if (shelf->aht_ok) {
+            alerts->temp_critical |= shelf->temperature < TEMP_MIN || shelf->temperature > TEMP_MAX;
+            alerts->humidity_critical |= shelf->humidity > HUMIDITY_MAX;
+        }
+        if (shelf->lux_ok) {
+            alerts->lux_critical |= shelf->lux < LUX_MIN;
+        }
+    }
+
+    // Consolidate alert status - true if any individual alert is active
+    alerts->any_critical = alerts->temp_critical || alerts->humidity_critical || alerts->lux_critical ||
+                           alerts->ph_critical || alerts->ec_critical || alerts->level_critical ||
+                           alerts->water_temp_critical ||
+                           alerts->flow_critical || alerts->pump_critical || alerts->co2_critical;
+
+    // Provide visual indication of critical conditions via onboard LED
+    if (alerts->any_critical) {
+        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);    // Turn on LED
+        sleep_ms(100);                                     // Brief illumination period
+        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);    // Turn off LED
+    }
+}
+
+/**
+ * @brief Print the list of active critical alerts to the console
+ *
+ * @param alerts Alert flags produced by check_critical_values()
+ */
+void print_critical_alerts(const AlertStatus *alerts) {
+    if (!alerts->any_critical) {
+        return;
+    }
+
+    printf("⚠️  ALERTA CRÍTICO DETECTADO! ⚠️\n");
+    if (alerts->temp_critical) {
+        printf("- Temperatura fora do limite (%.1f°C - %.1f°C)\n", TEMP_MIN, TEMP_MAX);
+    }
+    if (alerts->humidity_critical) {
+        printf("- Umidade muito alta (> %.1f%%)\n", HUMIDITY_MAX);
+    }
+    if (alerts->lux_critical) {
+        printf("- Luminosidade muito baixa (< %.1f lux)\n", LUX_MIN);
+    }
+    if (alerts->ph_critical) {
+        printf("- pH da solução fora do limite (%.1f - %.1f)\n", PH_MIN, PH_MAX);
+    }
+    if (alerts->ec_critical) {
+        printf("- Condutividade fora do limite (%.1f - %.1f mS/cm)\n", EC_MIN, EC_MAX);
+    }
+    if (alerts->level_critical) {
+        printf("- Nível do reservatório baixo (< %.0f%%)\n", WATER_LEVEL_MIN);
+    }
+    if (alerts->water_temp_critical) {
+        printf("- Temperatura da solução fora do limite (%.1f°C - %.1f°C)\n", WATER_TEMP_MIN, WATER_TEMP_MAX);
+    }
+    if (alerts->flow_critical) {
+        printf("- Vazão da solução baixa ou parada (< %.1f L/min)\n", FLOW_MIN_LPM);
+    }
+    if (alerts->pump_critical) {
+        printf("- Bomba lenta ou parada (< %.0f RPM)\n", PUMP_MIN_RPM);
+    }
+    if (alerts->co2_critical) {
+        printf("- CO2 fora do limite (%.0f - %.0f ppm)\n", CO2_MIN, CO2_MAX);
+    }
+}
+
+/* ========== NUTRIENT DOSING ========== */
+
+/**
+ * @brief Local dosing rules: nutrient when EC is low, pH down when pH is high
+ *
+ * One rule dose at a time, then DOSING_MIX_MS for the solution to mix
+ * before the probes are trusted again. Nothing is dosed without plausible
+ * probe readings (probes_ok), while the reservoir is low or while the
+ * circulation is stopped (no mixing).
+ *
+ * @param sensors Readings of the latest acquisition
+ */
+void apply_dosing_rules(const SensorData *sensors) {
+    if (!sensors->probes_ok || sensors->water_level < WATER_LEVEL_MIN ||
+        (sensors->pulses_ok && sensors->flow_lpm < FLOW_MIN_LPM)) {
+        return;
+    }
+    if (!time_reached(dosing_rules_ready_at) ||
+        dosing_pump_busy(DOSING_PUMP_NUTRIENT) || dosing_pump_busy(DOSING_PUMP_PH_DOWN)) {
+        return;
+    }
+
+    bool dosed = false;
+    if (sensors->ec < EC_MIN) {
+        dosed = dosing_pump_request(DOSING_PUMP_NUTRIENT, DOSING_NUTRIENT_DOSE_ML, DOSE_SOURCE_RULE,
+                                    ++dosing_rule_doses);
+    } else if (sensors->ph > PH_MAX) {
+        dosed = dosing_pump_request(DOSING_PUMP_PH_DOWN, DOSING_PH_DOSE_ML, DOSE_SOURCE_RULE,
+                                    ++dosing_rule_doses);
+    }
+    if (dosed) {
+        dosing_rules_ready_at = make_timeout_time_ms(DOSING_MIX_MS);
+    }
+}
+
+/**
+ * @brief Report finished doses on the console and on pico_w/dosing/events
+ *
+ * Call from the network context.
+ */
+void publish_dosing_events(void) {
+    DoseEvent ev;
+    while (dosing_pump_get_event(&ev)) {
+        printf("Dosagem %s #%lu (%s): %.2f de %.2f mL em %lums%s\n",
+               dosing_pump_name(ev.pump), (unsigned long)ev.id, dosing_source_name(ev.source),
+               ev.delivered_ml, ev.requested_ml, (unsigned long)ev.duration_ms,
+               ev.cancelled ? " (cancelada)" : "");
+        mqtt_publish_dosing_event(wifi_check(), mqtt_check(), &ev);
+    }
+}
+
+/* ========== MQTT COMMUNICATION FUNCTIONS ========== */
+
+/**
+ * @brief Publish current sensor readings to MQTT broker
+ *
+ * Formats environmental sensor data into JSON payload and publishes
+ * to the designated MQTT topic for remote monitoring. Only executes
+ * if WiFi connectivity is established.
+ *
+ * @param sensors Sensor readings to publish
+ */
+void mqtt_publish_sensor_data_func(const SensorData *sensors) {
+#if MQTT_V5_ENABLED && !MQTT_SN_ENABLED
+    // Samples go out per session from mqtt_fanout_sample(), each at its own rate
+    (void)sensors;
+#else
+    // Verify WiFi connectivity before attempting MQTT publication
+    if (!app_state.wifi.connected) {
+        return;
+    }
+
+    // Publish sensor data using high-level MQTT interface
+    mqtt_get_and_publish(wifi_check(), mqtt_check(), sensors);
+
+    printf("Dados dos sensores publicados via MQTT\n");
+#endif
+}
+
+/**
+ * @brief Publish control loop timing and actuator duty to MQTT broker
+ *
+ * Each publication closes the statistics window, so averages and maxima
+ * cover the interval since the previous telemetry message.
+ */
+void mqtt_publish_control_func(void) {
+    if (!app_state.wifi.connected) {
+        return;
+    }
+
+    ControlStats ctl;
+    climate_control_get_stats(&ctl, true);
+
+    char *json = mem_pool_alloc(&msg_pool);
+    if (json == NULL) {
+        printf("Pool de mensagens esgotado - telemetria de controle descartada\n");
+        return;
+    }
+
+    int len = snprintf(json, MSG_BUF_SIZE,
+        "{\"ciclos\":%lu,\"ciclos_perdidos\":%lu,\"jitter_medio_us\":%lu,"
+        "\"jitter_max_us\":%lu,\"exec_max_us\":%lu,\"failsafe\":%s",
+        (unsigned long)ctl.ticks, (unsigned long)ctl.overruns,
+        (unsigned long)ctl.jitter_avg_us, (unsigned long)ctl.jitter_max_us,
+        (unsigned long)ctl.exec_max_us, ctl.failsafe ? "true" : "false");
+    for (int i = 0; i < ACTUATOR_COUNT && len < MSG_BUF_SIZE; i++) {
+        len += snprintf(json + len, MSG_BUF_SIZE - len,
+            ",\"%s\":{\"duty\":%.1f,\"duty_medio\":%.1f}",
+            climate_control_actuator_name(i), ctl.duty[i] / 10.0f, ctl.duty_avg[i] / 10.0f);
+    }
+
+    LightStatus light;
+    light_scheduler_get_status(&light);
+    if (len < MSG_BUF_SIZE) {
+        len += snprintf(json + len, MSG_BUF_SIZE - len,
+            ",\"dli\":{\"relogio\":%s,\"fotoperiodo\":%s,\"acumulado_mol\":%.3f,"
+            "\"alvo_mol\":%.3f,\"ppfd_ambiente\":%.2f}",
+            light.clock_valid ? "true" : "false", light.photoperiod ? "true" : "false",
+            light.dli_mmol / 1000.0f, light.target_mmol / 1000.0f,
+            light.ambient_ppfd_c100 / 100.0f);
+    }
+    if (len < MSG_BUF_SIZE - 1) {
+        json[len++] = '}';
+        json[len] = '\0';
+    }
+
+    mqtt_get_and_publish_control(wifi_check(), mqtt_check(), json);
+    mem_pool_free(&msg_pool, json);
+}
+
+/**
+ * @brief Print the control loop statistics (benchmark report, window kept)
+ */
+void print_control_stats(void) {
+    ControlStats ctl;
+    climate_control_get_stats(&ctl, false);
+
+    printf("[controle] ciclos=%lu perdidos=%lu jitter_medio=%luus jitter_max=%luus exec_max=%luus%s\n",
+           (unsigned long)ctl.ticks, (unsigned long)ctl.overruns,
+           (unsigned long)ctl.jitter_avg_us, (unsigned long)ctl.jitter_max_us,
+           (unsigned long)ctl.exec_max_us, ctl.failsafe ? " FAILSAFE" : "");
+    for (int i = 0; i < ACTUATOR_COUNT; i++) {
+        printf("[controle] %s: %.1f%% (media %.1f%%)\n", climate_control_actuator_name(i),
+               ctl.duty[i] / 10.0f, ctl.duty_avg[i] / 10.0f);
+    }
+
+    LightStatus light;
+    light_scheduler_get_status(&light);
+    if (light.clock_valid) {
+        printf("[controle] DLI: %.2f/%.2f mol/m2 (%s)\n", light.dli_mmol / 1000.0f,
+               light.target_mmol / 1000.0f, light.photoperiod ? "fotoperiodo" : "escuro");
+    } else {
+        printf("[controle] DLI: aguardando relogio (SNTP)\n");
+    }
+}
+
+/**
+ * @brief Print the traffic of every sensor bus since the previous report
+ *
+ * Throughput counts address and data bytes; occupancy is the share of the
+ * window spent inside transactions (CPU included, the calls block).
+ */
+void print_bus_stats(void) {
+    absolute_time_t now = get_absolute_time();
+    float window_s = absolute_time_diff_us(bus_stats_time, now) / 1e6f;
+    bus_stats_time = now;
+    if (window_s <= 0.0f) {
+        return;
+    }
+
+    for (int g = 0; g < SENSOR_GROUP_COUNT; g++) {
+        SensorGroup *group = &sensor_groups[g];
+        if (group->bus.name == NULL) {
+            continue; // Bus not initialized
+        }
+        I2cBusStats stats;
+        i2c_bus_get_stats(&group->bus, &stats);
+        uint32_t transactions = stats.transactions - group->reported.transactions;
+        uint32_t bytes = stats.bytes - group->reported.bytes;
+        uint32_t errors = stats.errors - group->reported.errors;
+        uint32_t busy_us = stats.busy_us - group->reported.busy_us;
+        group->reported = stats;
+
+        printf("[i2c] %s: %lu transacoes, %.0f B/s, ocupacao %.2f%%, %lu erros\n",
+               group->bus.name, (unsigned long)transactions, bytes / window_s,
+               busy_us / (window_s * 1e4f), (unsigned long)errors);
+    }
+}
+
+/**
+ * @brief Publish environmental alerts to MQTT broker
+ *
+ * Generates and transmits alert notifications when sensor readings
+ * exceed configured thresholds. Alert data is formatted as JSON
+ * and published to dedicated alert topic.
+ *
+ * @param alerts Alert flags to publish
+ */
+void mqtt_publish_alerts_func(const AlertStatus *alerts) {
+    // Verify WiFi connectivity before attempting MQTT publication
+    if (!app_state.wifi.connected) {
+        return;
+    }
+
+    if (alerts->any_critical) {
+        char *alert_json = mem_pool_alloc(&msg_pool);
+        if (alert_json == NULL) {
+            printf("Pool de mensagens esgotado - alerta descartado\n");
+            return;
+        }
+        snprintf(alert_json, MSG_BUF_SIZE,
+                "{\"alerta\":\"critico\", \"temperatura_critica\":%s, \"umidade_critica\":%s, \"luz_critica\":%s, "
+                "\"ph_critico\":%s, \"ec_critica\":%s, \"nivel_critico\":%s, "
+                "\"temperatura_agua_critica\":%s, \"vazao_critica\":%s, \"bomba_critica\":%s, "
+                "\"co2_critico\":%s}",
+                alerts->temp_critical ? "true" : "false",
+                alerts->humidity_critical ? "true" : "false",
+                alerts->lux_critical ? "true" : "false",
+                alerts->ph_critical ? "true" : "false",
+                alerts->ec_critical ? "true" : "false",
+                alerts->level_critical ? "true" : "false",
+                alerts->water_temp_critical ? "true" : "false",
+                alerts->flow_critical ? "true" : "false",
+                alerts->pump_critical ? "true" : "false",
+                alerts->co2_critical ? "true" : "false");
+
+        mqtt_get_and_publish2(wifi_check(), mqtt_check(), alert_json);
+        mem_pool_free(&msg_pool, alert_json);
+        printf("Alertas críticos publicados via MQTT\n");
+    }
+}
+
+// Função para ler todos os sensores
+void read_sensors(SensorData *sensors) {
+    SensorRaw raw;
+    read_sensors_raw(sensors, &raw);
+}
+
+// Função para ler os sensores mantendo também os códigos brutos
+void read_sensors_raw(SensorData *sensors, SensorRaw *raw) {
+    // Every group converts at once on its own bus: one wait, for the slowest sensor
+    bool triggered[SENSOR_GROUP_COUNT];
+    uint32_t conversion_us = SCD4X_QUERY_MIN_US;
+    for (int g = 0; g < SENSOR_GROUP_COUNT; g++) {
+        RhSensor *rh = &sensor_groups[g].rh;
+        triggered[g] = rh_sensor_trigger(rh);
+        if (triggered[g] && rh_sensor_conversion_us(rh) > conversion_us) {
+            conversion_us = rh_sensor_conversion_us(rh);
+        }
+    }
+    scd4x_begin_poll(&co2_sensor); // Its 1ms execution time runs inside the same wait
+    sleep_us(conversion_us);
+
+    RhSensor *primary = &sensor_groups[0].rh;
+    raw->temperature = raw->humidity = 0;
+    sensors->aht_ok = triggered[0] && rh_sensor_fetch_raw(primary, &raw->temperature, &raw->humidity);
+    if (sensors->aht_ok) {
+        rh_sensor_convert(primary, raw->temperature, raw->humidity, &sensors->temperature, &sensors->humidity);
+    }
+
+    // CO2: measured by the sensor itself, only collected here when a result is ready
+    Scd4xReading co2;
+    scd4x_end_poll(&co2_sensor, sensors->aht_ok ? sensors->temperature : NAN);
+    scd4x_get(&co2_sensor, &co2);
+    sensors->co2_ok = co2.valid;
+    sensors->co2_ppm = co2.co2_ppm;
+
+    sensors->lux_ok = bh1750_read_raw(&sensor_groups[0].light, &raw->lux);
+    sensors->lux = bh1750_convert(raw->lux);
+
+    for (int i = 0; i < SHELF_COUNT; i++) {
+        SensorGroup *group = &sensor_groups[1 + i];
+        ShelfReading *shelf = &sensors->shelves[i];
+        uint32_t raw_temp, raw_humidity;
+        shelf->aht_ok = triggered[1 + i] && rh_sensor_fetch_raw(&group->rh, &raw_temp, &raw_humidity);
+        if (shelf->aht_ok) {
+            rh_sensor_convert(&group->rh, raw_temp, raw_humidity, &shelf->temperature, &shelf->humidity);
+        }
+        shelf->lux_ok = bh1750_read_lux(&group->light, &shelf->lux);
+    }
+
+    // Water temperature: converted and read in the background, mean of the fresh probes
+    Ds18b20Probe probes[DS18B20_MAX_PROBES];
+    int probe_count = ds18b20_read(probes, DS18B20_MAX_PROBES);
+    float water_sum = 0.0f;
+    int water_valid = 0;
+    for (int i = 0; i < probe_count; i++) {
+        if (probes[i].valid) {
+            water_sum += probes[i].temperature;
+            water_valid++;
+        }
+    }
+    sensors->water_temp_ok = water_valid > 0;
+    sensors->water_temperature = sensors->water_temp_ok ? water_sum / water_valid : NAN;
+
+    // Probes are sampled continuously in the background: this only takes the latest average.
+    // A running sampler is not a connected probe: all three must read plausibly
+    uint16_t codes[ADC_PROBE_COUNT];
+    bool sampling = adc_probes_read_raw(codes);
+    sensors->probes_ok = ADC_PROBES_ENABLED && sampling &&
+                         adc_probes_plausible(ADC_PROBE_PH, codes[ADC_PROBE_PH]) &&
+                         adc_probes_plausible(ADC_PROBE_EC, codes[ADC_PROBE_EC]) &&
+                         adc_probes_plausible(ADC_PROBE_LEVEL, codes[ADC_PROBE_LEVEL]);
+    raw->ph = codes[ADC_PROBE_PH];
+    raw->ec = codes[ADC_PROBE_EC];
+    raw->water_level = codes[ADC_PROBE_LEVEL];
+    sensors->ph = adc_probes_convert(ADC_PROBE_PH, raw->ph);
+    sensors->ec = adc_probes_convert(ADC_PROBE_EC, raw->ec);
+    if (sensors->water_temp_ok) {
+        // Conductivity rises ~2%/°C: report it at the 25°C reference
+        sensors->ec /= 1.0f + EC_TEMP_COEFF * (sensors->water_temperature - 25.0f);
+    }
+    sensors->water_level = adc_probes_convert(ADC_PROBE_LEVEL, raw->water_level);
+    sensors->chip_temperature = adc_probes_convert(ADC_PROBE_CHIP_TEMP, codes[ADC_PROBE_CHIP_TEMP]);
+
+    // Pulse totals are kept by hardware: this closes the rate window. A counter that never
+    // saw a pulse since boot is taken as absent, not as a stopped line (0 L/min)
+    PulseReading flow, pump;
+    sensors->pulses_ok = pulse_counter_read(PULSE_FLOW, &flow) && pulse_counter_read(PULSE_PUMP, &pump) &&
+                         flow.seen && pump.seen;
+    if (sensors->pulses_ok) {
+        sensors->flow_lpm = flow.rate_hz * 60.0f / FLOW_PULSES_PER_LITER;
+        sensors->flow_total_l = flow.count / FLOW_PULSES_PER_LITER;
+        sensors->pump_rpm = pump.rate_hz * 60.0f / PUMP_PULSES_PER_REV;
+    }
+}
+
+// Função para exibir as leituras no console
+void print_sensor_readings(const SensorData *sensors) {
+    if (sensors->aht_ok) {
+        printf("Temperatura: %.2f°C | Umidade: %.2f%%\n", sensors->temperature, sensors->humidity);
+    }
+
+    if (sensors->lux_ok) {
+        printf("Luminosidade: %.2f lux\n", sensors->lux);
+    }
+
+    if (sensors->co2_ok) {
+        printf("CO2: %.0f ppm\n", sensors->co2_ppm);
+    }
+
+    for (int i = 0; i < SHELF_COUNT; i++) {
+        const ShelfReading *shelf = &sensors->shelves[i];
+        if (shelf->aht_ok || shelf->lux_ok) {
+            printf("Prateleira %d: %.2f°C | %.2f%% | %.2f lux\n", i + 1,
+                   shelf->aht_ok ? shelf->temperature : NAN, shelf->aht_ok ? shelf->humidity : NAN,
+                   shelf->lux_ok ? shelf->lux : NAN);
+        }
+    }
+
+    if (sensors->probes_ok) {
+        printf("pH: %.2f | EC: %.2f mS/cm | Nível: %.0f%% | Chip: %.1f°C\n",
+               sensors->ph, sensors->ec, sensors->water_level, sensors->chip_temperature);
+    }
+
+    if (sensors->water_temp_ok) {
+        printf("Temperatura da solução: %.2f°C\n", sensors->water_temperature);
+    }
+
+    if (sensors->pulses_ok) {
+        printf("Vazão: %.2f L/min (%.1f L) | Bomba: %.0f RPM\n",
+               sensors->flow_lpm, sensors->flow_total_l, sensors->pump_rpm);
+    }
+
+    PowerStatus power;
+    power_manager_get_status(&power);
+    if (power.source == POWER_SOURCE_BATTERY) {
+        printf("Energia: bateria %.2f V (%u%%) | Autonomia: %ldh%02ld%s | Modo: %s\n",
+               power.vsys_mv / 1000.0f, power.battery_pct, (long)(power.runtime_min / 60),
+               (long)(power.runtime_min % 60), power.runtime_measured ? "" : " (estimada)",
+               power_level_name(power.level));
+    } else {
+        printf("Energia: %s %.2f V\n", power_source_name(power.source), power.vsys_mv / 1000.0f);
+    }
+}
+
+// Função para enviar dados via TCP (simulando envio para celular)
+void send_data_to_phone(const SensorData *sensors, const AlertStatus *alerts) {
+    if (!app_state.wifi.connected) return;
+
+    // Criar JSON com os dados (buffer do pool de mensagens)
+    char *json_data = mem_pool_alloc(&msg_pool);
+    if (json_data == NULL) {
+        printf("Pool de mensagens esgotado - JSON descartado\n");
+        return;
+    }
+    snprintf(json_data, MSG_BUF_SIZE,
+        "{"
+        "\"temperatura\":%.2f,"
+        "\"umidade\":%.2f,"
+        "\"luminosidade\":%.2f,"
+        "\"ph\":%.2f,"
+        "\"ec\":%.2f,"
+        "\"nivel\":%.1f,"
+        "\"temperatura_agua\":%.2f,"
+        "\"vazao\":%.2f,"
+        "\"bomba_rpm\":%.0f,"
+        "\"co2\":%.0f,"
+        "\"alertas\":{"
+            "\"temperatura\":%s,"
+            "\"umidade\":%s,"
+            "\"luminosidade\":%s,"
+            "\"ph\":%s,"
+            "\"ec\":%s,"
+            "\"nivel\":%s,"
+            "\"temperatura_agua\":%s,"
+            "\"vazao\":%s,"
+            "\"bomba\":%s,"
+            "\"co2\":%s"
+        "}"
+        "}",
+        sensors->aht_ok ? sensors->temperature : NAN,
+        sensors->aht_ok ? sensors->humidity : NAN,
+        sensors->lux_ok ? sensors->lux : NAN,
+        sensors->probes_ok ? sensors->ph : NAN,
+        sensors->probes_ok ? sensors->ec : NAN,
+        sensors->probes_ok ? sensors->water_level : NAN,
+        sensors->water_temperature,
+        sensors->pulses_ok ? sensors->flow_lpm : NAN,
+        sensors->pulses_ok ? sensors->pump_rpm : NAN,
+        sensors->co2_ok ? sensors->co2_ppm : NAN,
+        alerts->temp_critical ? "true" : "false",
+        alerts->humidity_critical ? "true" : "false",
+        alerts->lux_critical ? "true" : "false",
+        alerts->ph_critical ? "true" : "false",
+        alerts->ec_critical ? "true" : "false",
+        alerts->level_critical ? "true" : "false",
+        alerts->water_temp_critical ? "true" : "false",
+        alerts->flow_critical ? "true" : "false",
+        alerts->pump_critical ? "true" : "false",
+        alerts->co2_critical ? "true" : "false"
+    );
+
+    printf("Dados JSON: %s\n", json_data);
+    mem_pool_free(&msg_pool, json_data);
+
+    // Aqui você pode implementar um servidor TCP ou HTTP para enviar os dados
+    // Por enquanto, apenas exibimos no console
+}
+
+// Função para renderizar diferentes telas no display
+void update_display(const SensorData *sensors, const AlertStatus *alerts) {
+    // Brilho reduzido ou tela apagada conforme o nível da bateria
+    DisplayPower mode = power_display_mode();
+    display_set_power(mode != DISPLAY_POWER_OFF, mode == DISPLAY_POWER_DIM ? POWER_DISPLAY_DIM_CONTRAST : 0xFF);
+    if (mode == DISPLAY_POWER_OFF) {
+        return; // Nada a desenhar: sem tráfego I2C com a tela apagada
+    }
+
+    switch (app_state.current_menu) {
+        case MENU_MEASUREMENTS: {
+            float temp = sensors->aht_ok ? sensors->temperature : NAN;
+            float hum = sensors->aht_ok ? sensors->humidity : NAN;
+            float lux = sensors->lux_ok ? sensors->lux : NAN;
+
+            display_update(temp, hum, sensors->co2_ppm, sensors->co2_ok, lux, sensors->lux_ok);
+            break;
+        }
+        case MENU_WIFI: {
+            WifiStatus* wifi = &app_state.wifi;
+            display_render_wifi_status(wifi->ssid, wifi->connected, false);
+            break;
+        }
+        case MENU_ALERTS: {
+            // Aqui você pode criar uma função específica para mostrar alertas
+            // Por enquanto, usamos a função de WiFi como placeholder
+            display_render_wifi_status("ALERTAS", alerts->any_critical, false);
+            break;
+        }
+        case MENU_MQTT: {
+            uint32_t interval_ms = link_publish_interval_ms(power_publish_interval_ms(MQTT_PUBLISH_INTERVAL_MS));
+            display_render_mqtt_status(mqtt_check(), link_class_name(link_monitor_class()), link_monitor_rssi(),
+                                       interval_ms / 1000);
+            break;
+        }
+        case MENU_NUTRIENTS: {
+            display_render_nutrients(sensors->ph, sensors->ec, sensors->water_level, sensors->probes_ok,
+                                     sensors->flow_lpm, sensors->pulses_ok, sensors->water_temperature);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+/* ========== INITIALIZATION ========== */
+
+/**
+ * @brief Initialize buses, buttons, sensors, display and application state
+ *
+ * Does not touch the CYW43 chip: the bare-metal build initializes it before
+ * this call, the FreeRTOS build from inside the network task.
+ */
+void app_hardware_init(void) {
+    mem_pools_init();
+    wall_clock_init();
+    fleet_stagger_init();
+    flash_log_init();
+    climate_control_init(); // Actuators off until the loop starts on core 1
+
+    // Configuração I2C Port A para sensores
+    i2c_bus_init_hw(&sensor_groups[0].bus, "i2c0", I2C_PORT_A, I2C_SDA_PIN_A, I2C_SCL_PIN_A, I2C_BAUD_A);
+
+    // Barramentos PIO das prateleiras (SCL = SDA + 1)
+    for (int i = 0; i < SHELF_COUNT; i++) {
+        if (!i2c_bus_init_pio(&sensor_groups[1 + i].bus, shelf_bus_names[i], shelf_sda_pins[i], SHELF_I2C_BAUD)) {
+            printf("Prateleira %d: sem recursos PIO para o I2C\n", i + 1);
+        }
+    }
+
+    // Configuração I2C Port B para display
+    i2c_init(I2C_PORT_B, 400 * 1000);
+    gpio_set_function(I2C_SDA_PIN_B, GPIO_FUNC_I2C);
+    gpio_set_function(I2C_SCL_PIN_B, GPIO_FUNC_I2C);
+    gpio_pull_up(I2C_SDA_PIN_B);
+    gpio_pull_up(I2C_SCL_PIN_B);
+
+    // Inicializar botões
+    button_init(&btn_a, BTN_A_PIN);
+    button_init(&btn_b, BTN_B_PIN);
+    button_init(&btn_c, BTN_C_PIN);
+
+    // Inicializar periféricos
+    display_init(I2C_PORT_B, I2C_OLED_ADDR);
+    for (int g = 0; g < SENSOR_GROUP_COUNT; g++) {
+        SensorGroup *group = &sensor_groups[g];
+        rh_sensor_init(&group->rh, &group->bus, SHT4X_REPEATABILITY);
+        bool light_found = bh1750_init(&group->light, &group->bus);
+        if (g > 0) {
+            printf("Prateleira %d (%s): temperatura/umidade %s, BH1750 %s\n", g, group->bus.name,
+                   rh_sensor_name(&group->rh), light_found ? "ok" : "ausente");
+        }
+    }
+    bool co2_found = scd4x_init(&co2_sensor, &sensor_groups[0].bus);
+    for (int g = 0; g < SENSOR_GROUP_COUNT; g++) {
+        i2c_bus_get_stats(&sensor_groups[g].bus, &sensor_groups[g].reported);
+    }
+    bus_stats_time = get_absolute_time();
+    adc_probes_init();
+#if PULSE_COUNTER_ENABLED
+    pulse_counter_init();
+#endif
+    int water_probes = ds18b20_init();
+    bool dosing_ok = dosing_pump_init();
+    mqtt_dosing_init();
+#if FLEET_SLOT_ASSIGNMENT && !MQTT_SN_ENABLED
+    mqtt_fleet_init(); // MQTT-SN only carries the pre-defined topics
+#endif
+
+    uplink_init();
+#if UPLINK_MQTT_ENABLED
+    uplink_add_transport(&mqtt_batch_transport);
+#endif
+#if INFLUX_UDP_ENABLED
+    influx_udp_init();
+    uplink_add_transport(&influx_udp_transport);
+    mqtt_uplink_init();
+#endif
+
+    printf("Sensores inicializados:\n");
+    printf("- Temperatura/Umidade: %s\n", rh_sensor_name(&sensor_groups[0].rh));
+    printf("- BH1750 (Luminosidade)\n");
+    printf("- SCD4x (CO2): %s\n", co2_found ? "ok" : "ausente");
+    printf("- Sondas pH/EC/Nível (ADC): %s\n", ADC_PROBES_ENABLED ? "ok" : "desativadas");
+    printf("- Vazão e rotação da bomba (PIO): %s\n", PULSE_COUNTER_ENABLED ? "ok" : "desativadas");
+    printf("- Temperatura da solução: %d sonda(s) DS18B20 (1-Wire)\n", water_probes);
+    printf("- Bombas dosadoras (PIO): %s\n", dosing_ok ? "ok" : "falha");
+    printf("- Display OLED\n");
+
+    // Inicializar estado da aplicação
+    app_state.current_menu = MENU_MEASUREMENTS;
+    app_state.wifi.connected = false;
+    app_state.last_sensor_read = make_timeout_time_ms(0);
+    app_state.last_display_update = make_timeout_time_ms(0);
+    app_state.last_mqtt_publish = 0;
+    app_state.last_mqtt_alert_check = 0;
+}
+
+/**
+ * @brief Append a sampled state to the flash history
+ *
+ * Uses the wall-clock time of the acquisition once SNTP has synchronized,
+ * seconds since boot before that (flagged in the record).
+ *
+ * @param sensors Readings to store
+ * @param alerts Alert evaluation of the same readings
+ * @param timestamp Acquisition time
+ */
+void log_history(const SensorData *sensors, const AlertStatus *alerts, absolute_time_t timestamp) {
+    uint32_t unix_s;
+    if (wall_clock_at(timestamp, &unix_s)) {
+        flash_log_append(sensors, alerts, unix_s, true);
+    } else {
+        flash_log_append(sensors, alerts, to_ms_since_boot(timestamp) / 1000, false);
+    }
+}
+
+/**
+ * @brief Print the button and menu help banner
+ */
+void app_print_banner(void) {
+    printf("\n=== Sistema Iniciado ===\n");
+    printf("Botões:\n");
+    printf("- Botão A (GPIO %d): Menu Anterior\n", BTN_A_PIN);
+    printf("- Botão B (GPIO %d): Próximo Menu\n", BTN_B_PIN);
+    printf("- Botão C (GPIO %d): Reconectar WiFi\n", BTN_C_PIN);
+    printf("\nMenus disponíveis:\n");
+    printf("0: Medições dos Sensores\n");
+    printf("1: Status WiFi\n");
+    printf("2: Alertas Críticos\n");
+    printf("3: Status MQTT\n");
+    printf("4: Solução Nutritiva (pH/EC/Nível)\n");
+    printf("========================\n\n");
+}
@@ -0,0 +1,367 @@
+/**
+ * @file climate_control.c
+ * @brief Closed-loop climate control (fan, mister, grow light) on core 1
+ *
+ * A hardware alarm owned by core 1 fires every CONTROL_PERIOD_MS; its
+ * interrupt handler reads the latest sampled state through the lock-free
+ * snapshot, runs the control laws in fixed point and writes the actuators.
+ * Nothing here waits on core 0, the network stack or a task, so WiFi/MQTT
+ * activity cannot delay an actuation. Flash history writes are the one
+ * exception: they park both cores for a page program (~1 ms) and, every
+ * 256 records, a sector erase (tens of ms); that shows up in jitter_max.
+ *
+ * Control laws:
+ * - fan: PI on temperature (reverse acting) with a dehumidification floor
+ *   while humidity is above HUMIDITY_MAX (with hysteresis);
+ * - mister: on/off with hysteresis, limited burst length and rest time;
+ * - grow light: photoperiod + daily light integral scheduler
+ *   (light_scheduler.c) once the wall clock is synchronized, PI on measured
+ *   light level before that.
+ *
+ * Every actuator has a duty range, a slew limit per period and a failsafe
+ * duty applied when its readings are invalid or older than CONTROL_STALE_MS.
+ */
+
+#include "climate_control.h"
+#include "app.h"
+#include "app_config.h"
+#include "state_snapshot.h"
+#include "light_scheduler.h"
+#include "hardware/pwm.h"
+#include "hardware/timer.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+#include "pico/critical_section.h"
+#include "pico/flash.h"
+
+/* ========== FIXED-POINT HELPERS ========== */
+
+#define DUTY_MAX 1000                          // Outputs are expressed in ‰
+#define Q16(x) ((int32_t)((x) * 65536.0f))     // Gain to Q16.16
+#define C100(x) ((int32_t)((x) * 100.0f))      // Engineering value to centi-units
+
+/**
+ * @brief PI(D) controller on centi-unit measurements, output in ‰
+ */
+typedef struct {
+    int32_t kp;              // Q16: ‰ per centi-unit of error
+    int32_t ki;              // Q16: ‰ per centi-unit of error per period
+    int32_t kd;              // Q16: ‰ per centi-unit change per period
+    bool reverse;            // true: output rises when measurement exceeds setpoint
+    int64_t integral;        // Q16 integral term, clamped to the output range
+    int32_t prev_measurement;
+} PidController;
+
+/**
+ * @brief Per-actuator safety envelope
+ */
+typedef struct {
+    uint16_t min_duty;       // Lowest duty allowed while running normally
+    uint16_t max_duty;       // Highest duty ever written
+    uint16_t max_step;       // Largest change per control period (slew limit)
+    uint16_t failsafe_duty;  // Duty held while readings are missing or stale
+} ActuatorLimits;
+
+/* ========== ACTUATOR CONFIGURATION ========== */
+
+static const ActuatorLimits limits[ACTUATOR_COUNT] = {
+    [ACTUATOR_FAN]        = {.min_duty = 150, .max_duty = 1000, .max_step = 100, .failsafe_duty = 500},
+    [ACTUATOR_MISTER]     = {.min_duty = 0,   .max_duty = 1000, .max_step = 1000, .failsafe_duty = 0},
+    [ACTUATOR_GROW_LIGHT] = {.min_duty = 0,   .max_duty = 900,  .max_step = 5,   .failsafe_duty = 500},
+};
+
+static const char *const actuator_names[ACTUATOR_COUNT] = {
+    [ACTUATOR_FAN] = "ventilador",
+    [ACTUATOR_MISTER] = "nebulizador",
+    [ACTUATOR_GROW_LIGHT] = "iluminacao",
+};
+
+/* ========== PRIVATE VARIABLES ========== */
+
+static PidController fan_pid = {.kp = Q16(FAN_KP), .ki = Q16(FAN_KI), .kd = 0, .reverse = true};
+static PidController light_pid = {.kp = Q16(LIGHT_KP), .ki = Q16(LIGHT_KI), .kd = 0, .reverse = false};
+
+static uint16_t duty[ACTUATOR_COUNT];    // Current outputs (‰)
+static bool dehumidifying;               // Fan humidity floor latched
+static bool mister_on;
+static uint64_t mister_changed_us;       // Last mister switch time
+
+static int alarm_num = -1;               // Hardware alarm owned by core 1
+static uint64_t next_target_us;          // Deadline of the next activation
+
+static critical_section_t stats_lock;    // Written on core 1 (IRQ), read on core 0
+static ControlStats stats;
+static uint64_t jitter_sum_us;
+static uint64_t duty_sum[ACTUATOR_COUNT];
+static uint pwm_wrap_fan;
+static uint pwm_wrap_light;
+
+/* ========== CONTROL LAWS ========== */
+
+static int32_t clamp32(int32_t value, int32_t lo, int32_t hi) {
+    return value < lo ? lo : (value > hi ? hi : value);
+}
+
+/**
+ * @brief One controller step with integral clamping (anti-windup)
+ */
+static int32_t pid_update(PidController *pid, int32_t setpoint, int32_t measurement,
+                          int32_t out_min, int32_t out_max) {
+    int32_t error = pid->reverse ? measurement - setpoint : setpoint - measurement;
+    int32_t delta = pid->reverse ? measurement - pid->prev_measurement
+                                 : pid->prev_measurement - measurement;
+    pid->prev_measurement = measurement;
+
+    pid->integral += (int64_t)pid->ki * error;
+    if (pid->integral < ((int64_t)out_min << 16)) pid->integral = (int64_t)out_min << 16;
+    if (pid->integral > ((int64_t)out_max << 16)) pid->integral = (int64_t)out_max << 16;
+
+    int64_t output = (int64_t)pid->kp * error + pid->integral + (int64_t)pid->kd * delta;
+    return clamp32((int32_t)(output >> 16), out_min, out_max);
+}
+
+/**
+ * @brief Restart a controller from the current output (bumpless transfer)
+ */
+static void pid_track(PidController *pid, int32_t measurement, uint16_t output) {
+    pid->integral = (int64_t)output << 16;
+    pid->prev_measurement = measurement;
+}
+
+/**
+ * @brief Apply range and slew limits, then drive the hardware
+ */
+static void actuator_write(ActuatorId id, int32_t request) {
+    const ActuatorLimits *lim = &limits[id];
+    int32_t target = clamp32(request, 0, lim->max_duty);
+    if (target > 0 && target < lim->min_duty) {
+        target = lim->min_duty;   // Below min_duty a fan stalls: run at min or stop
+    }
+
+    int32_t step = clamp32(target - duty[id], -(int32_t)lim->max_step, lim->max_step);
+    duty[id] = (uint16_t)(duty[id] + step);
+
+    switch (id) {
+        case ACTUATOR_FAN:
+            pwm_set_gpio_level(FAN_PWM_PIN, (uint16_t)((duty[id] * (pwm_wrap_fan + 1)) / DUTY_MAX));
+            break;
+        case ACTUATOR_MISTER:
+            gpio_put(MISTER_PIN, duty[id] >= DUTY_MAX / 2);
+            break;
+        case ACTUATOR_GROW_LIGHT:
+            pwm_set_gpio_level(GROW_LIGHT_PWM_PIN, (uint16_t)((duty[id] * (pwm_wrap_light + 1)) / DUTY_MAX));
+            break;
+        default:
+            break;
+    }
+}
+
+static int32_t fan_law(const SensorData *sensors) {
+    int32_t temperature = C100(sensors->temperature);
+    int32_t humidity = C100(sensors->humidity);
+
+    if (humidity > C100(HUMIDITY_MAX)) {
+        dehumidifying = true;
+    } else if (humidity < C100(HUMIDITY_MAX - HUMIDITY_HYSTERESIS)) {
+        dehumidifying = false;
+    }
+
+    int32_t request = pid_update(&fan_pid, C100(TEMP_SETPOINT), temperature, 0, DUTY_MAX);
+    if (dehumidifying && request < FAN_DEHUMIDIFY_DUTY) {
+        request = FAN_DEHUMIDIFY_DUTY;
+    }
+    return request;
+}
+
+static int32_t mister_law(const SensorData *sensors, uint64_t now_us) {
+    uint64_t elapsed_ms = (now_us - mister_changed_us) / 1000;
+    bool next = mister_on;
+
+    if (mister_on) {
+        if (sensors->humidity >= MIST_OFF_ABOVE || elapsed_ms >= MIST_MAX_ON_MS || dehumidifying) {
+            next = false;
+        }
+    } else if (sensors->humidity < MIST_ON_BELOW && elapsed_ms >= MIST_MIN_OFF_MS && !dehumidifying) {
+        next = true;
+    }
+
+    if (next != mister_on) {
+        mister_on = next;
+        mister_changed_us = now_us;
+    }
+    return mister_on ? DUTY_MAX : 0;
+}
+
+static int32_t light_law(const SensorData *sensors) {
+    int32_t request = light_scheduler_update(sensors, duty[ACTUATOR_GROW_LIGHT], CONTROL_PERIOD_MS);
+    if (request >= 0) {
+        pid_track(&light_pid, C100(sensors->lux), duty[ACTUATOR_GROW_LIGHT]);
+        return request;
+    }
+
+    // No wall clock yet: hold the lux setpoint until SNTP synchronizes
+    return pid_update(&light_pid, C100(LIGHT_LUX_SETPOINT), C100(sensors->lux), 0, DUTY_MAX);
+}
+
+/**
+ * @brief One control period: read the snapshot, evaluate laws, write outputs
+ *
+ * @return true if any actuator is in failsafe
+ */
+static bool control_step(uint64_t now_us) {
+    StateSnapshot snap;
+    bool fresh = state_snapshot_read(&snap) && snap.generation > 0 &&
+                 now_us - to_us_since_boot(snap.timestamp) < (uint64_t)CONTROL_STALE_MS * 1000;
+    bool climate_ok = fresh && snap.sensors.aht_ok;
+    bool light_ok = fresh && snap.sensors.lux_ok;
+
+    if (climate_ok) {
+        actuator_write(ACTUATOR_FAN, fan_law(&snap.sensors));
+        actuator_write(ACTUATOR_MISTER, mister_law(&snap.sensors, now_us));
+    } else {
+        actuator_write(ACTUATOR_FAN, limits[ACTUATOR_FAN].failsafe_duty);
+        if (mister_on) {
+            mister_on = false;
+            mister_changed_us = now_us;
+        }
+        actuator_write(ACTUATOR_MISTER, limits[ACTUATOR_MISTER].failsafe_duty);
+        pid_track(&fan_pid, C100(snap.sensors.temperature), duty[ACTUATOR_FAN]);
+    }
+
+    if (light_ok) {
+        actuator_write(ACTUATOR_GROW_LIGHT, light_law(&snap.sensors));
+    } else {
+        // Without light readings keep the photoperiod, at the failsafe level
+        bool dark = light_scheduler_photoperiod() == 0;
+        actuator_write(ACTUATOR_GROW_LIGHT, dark ? 0 : limits[ACTUATOR_GROW_LIGHT].failsafe_duty);
+        pid_track(&light_pid, C100(snap.sensors.lux), duty[ACTUATOR_GROW_LIGHT]);
+    }
+
+    return !climate_ok || !light_ok;
+}
+
+/* ========== TIMER INTERRUPT (CORE 1) ========== */
+
+static void control_alarm_callback(uint alarm) {
+    uint64_t start_us = time_us_64();
+    uint32_t jitter_us = (uint32_t)(start_us - next_target_us);
+
+    bool failsafe = control_step(start_us);
+
+    // Fixed-rate schedule: next deadline derives from the previous one, not from now
+    uint32_t skipped = 0;
+    do {
+        next_target_us += (uint64_t)CONTROL_PERIOD_MS * 1000;
+        skipped++;
+    } while (hardware_alarm_set_target(alarm, from_us_since_boot(next_target_us)));
+
+    uint32_t exec_us = (uint32_t)(time_us_64() - start_us);
+
+    critical_section_enter_blocking(&stats_lock);
+    stats.ticks++;
+    stats.overruns += skipped - 1;
+    jitter_sum_us += jitter_us;
+    if (jitter_us > stats.jitter_max_us) stats.jitter_max_us = jitter_us;
+    if (exec_us > stats.exec_max_us) stats.exec_max_us = exec_us;
+    for (int i = 0; i < ACTUATOR_COUNT; i++) {
+        stats.duty[i] = duty[i];
+        duty_sum[i] += duty[i];
+    }
+    stats.failsafe = failsafe;
+    critical_section_exit(&stats_lock);
+}
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Configure actuator outputs in their failsafe-off state (core 0, early)
+ */
+void climate_control_init(void) {
+    critical_section_init(&stats_lock);
+    light_scheduler_init();
+
+    // Fan: 25kHz PWM (4-wire fan specification)
+    gpio_set_function(FAN_PWM_PIN, GPIO_FUNC_PWM);
+    pwm_config fan_cfg = pwm_get_default_config();
+    pwm_wrap_fan = clock_get_hz(clk_sys) / 25000 - 1;
+    pwm_config_set_wrap(&fan_cfg, pwm_wrap_fan);
+    pwm_init(pwm_gpio_to_slice_num(FAN_PWM_PIN), &fan_cfg, true);
+    pwm_set_gpio_level(FAN_PWM_PIN, 0);
+
+    // Grow light: 1kHz PWM (LED driver dimming input)
+    gpio_set_function(GROW_LIGHT_PWM_PIN, GPIO_FUNC_PWM);
+    pwm_config light_cfg = pwm_get_default_config();
+    pwm_config_set_clkdiv(&light_cfg, 4.0f);
+    pwm_wrap_light = clock_get_hz(clk_sys) / 4 / 1000 - 1;
+    pwm_config_set_wrap(&light_cfg, pwm_wrap_light);
+    pwm_init(pwm_gpio_to_slice_num(GROW_LIGHT_PWM_PIN), &light_cfg, true);
+    pwm_set_gpio_level(GROW_LIGHT_PWM_PIN, 0);
+
+    // Mister: plain output, off
+    gpio_init(MISTER_PIN);
+    gpio_set_dir(MISTER_PIN, GPIO_OUT);
+    gpio_put(MISTER_PIN, 0);
+
+    // Allow the first burst immediately
+    mister_changed_us = time_us_64() - (uint64_t)MIST_MIN_OFF_MS * 1000;
+}
+
+/**
+ * @brief Claim a hardware alarm and start the loop; must run on core 1
+ *
+ * The alarm interrupt is enabled on the calling core, which is what pins the
+ * control loop to core 1 in both builds.
+ */
+void climate_control_start(void) {
+    alarm_num = hardware_alarm_claim_unused(true);
+    hardware_alarm_set_callback(alarm_num, control_alarm_callback);
+
+    next_target_us = time_us_64() + (uint64_t)CONTROL_PERIOD_MS * 1000;
+    hardware_alarm_set_target(alarm_num, from_us_since_boot(next_target_us));
+}
+
+/**
+ * @brief Core 1 entry point of the bare-metal build
+ */
+void climate_control_core1_entry(void) {
+    flash_safe_execute_core_init(); // Let flash_log park this core during writes
+    climate_control_start();
+
+    while (true) {
+        __wfi(); // Everything runs from the alarm interrupt
+    }
+}
+
+/**
+ * @brief Copy loop timing and actuator duty statistics
+ *
+ * @param out Destination
+ * @param reset_window Start a new averaging window (telemetry publisher only)
+ */
+void climate_control_get_stats(ControlStats *out, bool reset_window) {
+    critical_section_enter_blocking(&stats_lock);
+    *out = stats;
+    out->jitter_avg_us = stats.ticks ? (uint32_t)(jitter_sum_us / stats.ticks) : 0;
+    for (int i = 0; i < ACTUATOR_COUNT; i++) {
+        out->duty_avg[i] = stats.ticks ? (uint16_t)(duty_sum[i] / stats.ticks) : 0;
+    }
+
+    if (reset_window) {
+        stats.ticks = 0;
+        stats.overruns = 0;
+        stats.jitter_max_us = 0;
+        stats.exec_max_us = 0;
+        jitter_sum_us = 0;
+        for (int i = 0; i < ACTUATOR_COUNT; i++) {
+            duty_sum[i] = 0;
+        }
+    }
+    critical_section_exit(&stats_lock);
+}
+
+/**
+ * @brief Actuator name used in telemetry and console output
+ */
+const char *climate_control_actuator_name(ActuatorId id) {
+    return id < ACTUATOR_COUNT ? actuator_names[id] : "?";
+}
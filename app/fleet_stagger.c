@@ -0,0 +1,204 @@
+/**
+ * @file fleet_stagger.c
+ * @brief Per-board publish phase and randomized (re)connect delays
+ *
+ * Every board runs the same intervals, so after a site-wide power restore
+ * a rack boots within milliseconds and would publish, flush batches and
+ * reconnect in lockstep: one burst per period at the broker and the
+ * access point, idle in between.
+ *
+ * The phase is a fraction of the period (0..2^32), from a hash of the
+ * flash unique ID: the same board always lands at the same point, and
+ * boards spread uniformly. Each periodic job starts at that fraction of
+ * its own period. Once the wall clock is known, phases are counted from
+ * the Unix epoch instead of boot, so they hold across boards that booted
+ * at different times.
+ *
+ * A coordinator can replace the hashed phase with an exact slot (no two
+ * boards colliding) by publishing {"slot":3,"slots":20} to
+ * pico_w/fleet/<board id>/slot, retained; {"slots":0} goes back to the hash.
+ *
+ * Commands that act on one board (dosing, uplink destination) come in on topics under the
+ * board ID as well, so a message meant for one board cannot move the rack.
+ *
+ * Connection attempts (first connection after Wi-Fi, session reconnects)
+ * wait a random delay, so a broker restart does not bring every board back
+ * in the same second.
+ */
+
+#include "fleet_stagger.h"
+#include "app_config.h"
+#include "wall_clock.h"
+#include "pico/rand.h"
+#include "pico/unique_id.h"
+#include <stdio.h>
+
+/* ========== PRIVATE VARIABLES ========== */
+
+static char board_id[2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1];
+static char slot_topic[sizeof("pico_w/fleet//slot") + sizeof(board_id)];
+static char dosing_topic[sizeof("pico_w//dosing/cmd") + sizeof(board_id)];
+static char uplink_topic[sizeof("pico_w//uplink/cmd") + sizeof(board_id)];
+static uint32_t board_phase;                   // From the board ID
+static volatile uint32_t phase;                // In use: board_phase or the assigned slot
+static volatile uint16_t assigned_slot;
+static volatile uint16_t assigned_slots;       // 0 = hashed phase
+static volatile bool changed;
+static uint32_t random_delays;
+
+/* ========== PRIVATE FUNCTIONS ========== */
+
+/**
+ * @brief FNV-1a followed by the murmur3 finalizer
+ *
+ * Unique IDs of one batch differ in a few bytes; the finalizer spreads
+ * that over the high bits, which set the phase. tools/fleet_sim.py uses
+ * the same function.
+ */
+static uint32_t hash_id(const uint8_t *id, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ id[i]) * 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Read the board ID and derive its phase
+ */
+void fleet_stagger_init(void) {
+    pico_unique_board_id_t id;
+    pico_get_unique_board_id(&id);
+    pico_get_unique_board_id_string(board_id, sizeof(board_id));
+    snprintf(slot_topic, sizeof(slot_topic), "pico_w/fleet/%s/slot", board_id);
+    snprintf(dosing_topic, sizeof(dosing_topic), "pico_w/%s/dosing/cmd", board_id);
+    snprintf(uplink_topic, sizeof(uplink_topic), "pico_w/%s/uplink/cmd", board_id);
+
+    board_phase = hash_id(id.id, sizeof(id.id));
+    phase = board_phase;
+}
+
+/**
+ * @brief Flash unique ID as hex (16 characters)
+ */
+const char *fleet_board_id(void) {
+    return board_id;
+}
+
+/**
+ * @brief Topic on which this board receives its slot (static lifetime)
+ */
+const char *fleet_slot_topic(void) {
+    return slot_topic;
+}
+
+/**
+ * @brief Topic on which this board takes dosing commands (static lifetime)
+ */
+const char *fleet_dosing_topic(void) {
+    return dosing_topic;
+}
+
+/**
+ * @brief Topic on which this board takes uplink configuration (static lifetime)
+ */
+const char *fleet_uplink_topic(void) {
+    return uplink_topic;
+}
+
+/**
+ * @brief First deadline of a periodic job, at this board's phase
+ *
+ * Subsequent deadlines keep the phase by adding the period
+ * (delayed_by_ms(deadline, period)).
+ *
+ * @param period_ms Job period
+ * @return Within one period from now (one full period with FLEET_STAGGER_ENABLED 0)
+ */
+absolute_time_t fleet_stagger_deadline(uint32_t period_ms) {
+    absolute_time_t now = get_absolute_time();
+    if (!FLEET_STAGGER_ENABLED || period_ms == 0) {
+        return delayed_by_ms(now, period_ms);
+    }
+
+    uint32_t offset = (uint32_t)(((uint64_t)period_ms * phase) >> 32);
+    uint32_t wait = offset; // Boot-relative: boards restored together boot together
+
+    int64_t unix_us;
+    if (wall_clock_at_us(now, &unix_us)) {
+        uint32_t into_period = (uint32_t)((unix_us / 1000) % period_ms);
+        wait = (offset + period_ms - into_period) % period_ms;
+    }
+    return delayed_by_ms(now, wait);
+}
+
+/**
+ * @brief Uniform random delay in [0, max_ms) (0 with FLEET_STAGGER_ENABLED 0)
+ */
+uint32_t fleet_stagger_random_ms(uint32_t max_ms) {
+    if (!FLEET_STAGGER_ENABLED || max_ms == 0) {
+        return 0;
+    }
+    random_delays++;
+    return get_rand_32() % max_ms;
+}
+
+/**
+ * @brief Reconnect delay averaging @p base_ms, drawn from [base/2, 3*base/2]
+ */
+uint32_t fleet_stagger_backoff_ms(uint32_t base_ms) {
+    if (!FLEET_STAGGER_ENABLED) {
+        return base_ms;
+    }
+    return base_ms / 2 + fleet_stagger_random_ms(base_ms + 1);
+}
+
+/**
+ * @brief Take a slot assigned by the broker (lwIP context)
+ *
+ * @param slot This board's slot, below @p slots
+ * @param slots Slots per period; 0 goes back to the hashed phase
+ * @return false if the slot is out of range
+ */
+bool fleet_stagger_set_slot(uint32_t slot, uint32_t slots) {
+    if (slots > UINT16_MAX || (slots > 0 && slot >= slots)) {
+        return false;
+    }
+    assigned_slot = (uint16_t)slot;
+    assigned_slots = (uint16_t)slots;
+    phase = slots > 0 ? (uint32_t)(((uint64_t)slot << 32) / slots) : board_phase;
+    changed = true;
+    return true;
+}
+
+/**
+ * @brief Whether the phase changed since the last call
+ *
+ * The caller then re-arms its periodic jobs with fleet_stagger_deadline().
+ */
+bool fleet_stagger_take_change(void) {
+    if (!changed) {
+        return false;
+    }
+    changed = false;
+    return true;
+}
+
+void fleet_stagger_print_stats(void) {
+    uint32_t offset = (uint32_t)(((uint64_t)MQTT_PUBLISH_INTERVAL_MS * phase) >> 32);
+    if (assigned_slots > 0) {
+        printf("[fleet] placa %s: slot %u/%u, publicação em +%lu ms de cada %u ms, %lu atrasos sorteados\n",
+               board_id, assigned_slot, assigned_slots, (unsigned long)offset, MQTT_PUBLISH_INTERVAL_MS,
+               (unsigned long)random_delays);
+    } else {
+        printf("[fleet] placa %s: fase pelo ID, publicação em +%lu ms de cada %u ms, %lu atrasos sorteados\n",
+               board_id, (unsigned long)offset, MQTT_PUBLISH_INTERVAL_MS, (unsigned long)random_delays);
+    }
+}
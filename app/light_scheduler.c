@@ -0,0 +1,136 @@
+/**
+ * @file light_scheduler.c
+ * @brief Photoperiod and daily light integral (DLI) grow-light scheduler
+ *
+ * Replaces fixed on/off timers. Light reaching the shelf is integrated all
+ * day from the BH1750 (converted to PPFD). During the photoperiod the LEDs
+ * only add what the ambient light is not expected to provide. The missing
+ * dose is spread evenly over the time left in the photoperiod, so the LEDs
+ * run at the lowest constant level that still meets the target. Once the
+ * target is reached they stay off for the rest of the day.
+ *
+ * The BH1750 sees LED + ambient light. The ambient part is estimated by
+ * subtracting the LED contribution at the current duty (LIGHT_PPFD_FULL
+ * scaled), then low-pass filtered so duty changes do not feed back as noise.
+ *
+ * Called from the climate control interrupt on core 1 every control period;
+ * all arithmetic is integer (PPFD in 0.01 µmol/m²/s, dose in 0.01 µmol/m²).
+ * Until SNTP synchronizes there is no photoperiod and the caller keeps the
+ * plain lux setpoint loop.
+ */
+
+#include "light_scheduler.h"
+#include "app_config.h"
+#include "wall_clock.h"
+#include "pico/critical_section.h"
+
+/* ========== FIXED-POINT CONSTANTS ========== */
+
+#define DUTY_MAX 1000
+#define LUX_TO_PPFD_Q16 ((int64_t)(LUX_TO_PPFD * 65536.0f))          // PPFD per lux (Q16)
+#define LED_PPFD_FULL_C100 ((int64_t)(LIGHT_PPFD_FULL * 100.0f))      // LED PPFD at 100% (0.01 units)
+#define DLI_TARGET_C100 ((int64_t)(DLI_TARGET * 1e6f) * 100)          // mol -> 0.01 µmol
+#define PHOTOPERIOD_START_S (PHOTOPERIOD_START_H * 3600u)
+#define PHOTOPERIOD_END_S (PHOTOPERIOD_END_H * 3600u)
+#define AMBIENT_FILTER_SHIFT 4                                      // EMA weight 1/16 per period
+
+/* ========== PRIVATE VARIABLES ========== */
+
+static critical_section_t status_lock;   // Updated on core 1 (IRQ), read on core 0
+static LightStatus status;
+
+static uint32_t current_day;             // Local day the dose belongs to
+static int64_t dose_c100;                // Light received today (0.01 µmol/m²)
+static int32_t ambient_c100;             // Filtered ambient PPFD estimate
+
+/* ========== PRIVATE FUNCTIONS ========== */
+
+static bool in_photoperiod(uint32_t second_of_day) {
+    return second_of_day >= PHOTOPERIOD_START_S && second_of_day < PHOTOPERIOD_END_S;
+}
+
+static void publish_status(bool clock_valid, bool photoperiod) {
+    critical_section_enter_blocking(&status_lock);
+    status.clock_valid = clock_valid;
+    status.photoperiod = photoperiod;
+    status.dli_mmol = (uint32_t)(dose_c100 / 100000);
+    status.target_mmol = (uint32_t)(DLI_TARGET_C100 / 100000);
+    status.ambient_ppfd_c100 = ambient_c100 > 0 ? (uint32_t)ambient_c100 : 0;
+    critical_section_exit(&status_lock);
+}
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+void light_scheduler_init(void) {
+    critical_section_init(&status_lock);
+}
+
+/**
+ * @brief Compute the grow-light duty for this control period
+ *
+ * @param sensors Latest readings (lux must be valid)
+ * @param led_duty Duty currently applied to the LEDs (‰)
+ * @param period_ms Time since the previous call
+ * @return Duty request (‰), or -1 if the wall clock is not synchronized
+ */
+int32_t light_scheduler_update(const SensorData *sensors, uint16_t led_duty, uint32_t period_ms) {
+    uint32_t day, second;
+    if (!wall_clock_local(&day, &second)) {
+        publish_status(false, false);
+        return -1;
+    }
+
+    // New local day: start a new dose
+    if (day != current_day) {
+        current_day = day;
+        dose_c100 = 0;
+    }
+
+    // Integrate measured PPFD (ambient + LEDs) over the control period
+    int64_t measured_c100 = ((int64_t)(sensors->lux * 100.0f) * LUX_TO_PPFD_Q16) >> 16;
+    dose_c100 += measured_c100 * period_ms / 1000;
+
+    // Ambient share of the measurement, smoothed
+    int64_t led_c100 = (int64_t)led_duty * LED_PPFD_FULL_C100 / DUTY_MAX;
+    int32_t ambient_now = (int32_t)(measured_c100 > led_c100 ? measured_c100 - led_c100 : 0);
+    ambient_c100 += (ambient_now - ambient_c100) >> AMBIENT_FILTER_SHIFT;
+
+    bool lit = in_photoperiod(second);
+    publish_status(true, lit);
+    if (!lit || dose_c100 >= DLI_TARGET_C100) {
+        return 0;
+    }
+
+    // Even spread of the missing dose over the rest of the photoperiod
+    int64_t remaining_s = PHOTOPERIOD_END_S - second;
+    int64_t required_c100 = (DLI_TARGET_C100 - dose_c100) / remaining_s;
+    int64_t supplemental_c100 = required_c100 - ambient_c100;
+    if (supplemental_c100 <= 0) {
+        return 0;
+    }
+
+    int64_t request = supplemental_c100 * DUTY_MAX / LED_PPFD_FULL_C100;
+    return request > DUTY_MAX ? DUTY_MAX : (int32_t)request;
+}
+
+/**
+ * @brief Photoperiod state for the failsafe path (light sensor unavailable)
+ *
+ * @return 1 inside the photoperiod, 0 outside, -1 if the clock is not synchronized
+ */
+int light_scheduler_photoperiod(void) {
+    uint32_t day, second;
+    if (!wall_clock_local(&day, &second)) {
+        return -1;
+    }
+    return in_photoperiod(second) ? 1 : 0;
+}
+
+/**
+ * @brief Copy the DLI progress for telemetry
+ */
+void light_scheduler_get_status(LightStatus *out) {
+    critical_section_enter_blocking(&status_lock);
+    *out = status;
+    critical_section_exit(&status_lock);
+}
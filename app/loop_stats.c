@@ -0,0 +1,111 @@
+/**
+ * @file loop_stats.c
+ * @brief Loop latency and CPU load benchmark
+ *
+ * Common instrumentation used to compare the bare-metal super-loop with the
+ * FreeRTOS SMP build. Both builds feed the same two quantities:
+ * - lateness: how long after its deadline a periodic job actually started
+ *   (timer check in the super-loop, vTaskDelayUntil() wake-up in a task);
+ * - busy time: CPU time spent doing useful work (handlers in the super-loop,
+ *   everything except the idle tasks under FreeRTOS).
+ * Reports are printed in the same format so the two logs can be diffed.
+ */
+
+#include "loop_stats.h"
+#include "app_config.h"
+#include "pico/critical_section.h"
+#include <stdio.h>
+
+/* ========== PRIVATE VARIABLES ========== */
+
+static critical_section_t stats_lock;    // Lateness may be recorded from both cores
+static uint32_t lateness_count;          // Samples in the current window
+static uint64_t lateness_sum_us;         // Sum of lateness in the window (µs)
+static uint32_t lateness_max_us;         // Worst lateness in the window (µs)
+static uint64_t busy_us;                 // Busy time accumulated in the window (µs)
+static uint64_t window_start_us;         // Start of the current window
+static absolute_time_t next_report;      // Deadline of the next report
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Reset the statistics window
+ */
+void loop_stats_init(void) {
+    critical_section_init(&stats_lock);
+    lateness_count = 0;
+    lateness_sum_us = 0;
+    lateness_max_us = 0;
+    busy_us = 0;
+    window_start_us = time_us_64();
+    next_report = make_timeout_time_ms(BENCH_REPORT_INTERVAL_MS);
+}
+
+/**
+ * @brief Record how late a periodic job started relative to its deadline
+ *
+ * @param lateness_us Start time minus deadline (negative values count as 0)
+ */
+void loop_stats_record_lateness(int64_t lateness_us) {
+    uint32_t late = lateness_us > 0 ? (uint32_t)lateness_us : 0;
+
+    critical_section_enter_blocking(&stats_lock);
+    lateness_count++;
+    lateness_sum_us += late;
+    if (late > lateness_max_us) {
+        lateness_max_us = late;
+    }
+    critical_section_exit(&stats_lock);
+}
+
+/**
+ * @brief Accumulate CPU time spent doing useful work
+ *
+ * @param us Busy time in microseconds
+ */
+void loop_stats_add_busy_us(uint64_t us) {
+    critical_section_enter_blocking(&stats_lock);
+    busy_us += us;
+    critical_section_exit(&stats_lock);
+}
+
+/**
+ * @brief Check whether the report period has elapsed
+ *
+ * @return true when SMAVHIOT_BENCH is enabled and a report is due
+ */
+bool loop_stats_report_due(void) {
+    return SMAVHIOT_BENCH && time_reached(next_report);
+}
+
+/**
+ * @brief Print the current window and start a new one
+ *
+ * CPU load is the busy time divided by the wall time available on all cores
+ * used by the build (1 for the super-loop, 2 for FreeRTOS SMP).
+ *
+ * @param build_name Label identifying the build in the log
+ * @param num_cores Number of cores the busy time was measured over
+ */
+void loop_stats_report(const char *build_name, uint num_cores) {
+    uint64_t now = time_us_64();
+
+    critical_section_enter_blocking(&stats_lock);
+    uint64_t window_us = (now - window_start_us) * num_cores;
+    uint32_t avg_us = lateness_count ? (uint32_t)(lateness_sum_us / lateness_count) : 0;
+    uint32_t max_us = lateness_max_us;
+    uint32_t count = lateness_count;
+    float load = window_us ? (100.0f * (float)busy_us / (float)window_us) : 0.0f;
+
+    lateness_count = 0;
+    lateness_sum_us = 0;
+    lateness_max_us = 0;
+    busy_us = 0;
+    window_start_us = now;
+    critical_section_exit(&stats_lock);
+
+    next_report = make_timeout_time_ms(BENCH_REPORT_INTERVAL_MS);
+
+    printf("[bench] %s: jobs=%lu atraso_medio=%luus atraso_max=%luus cpu=%.1f%%\n",
+           build_name, (unsigned long)count, (unsigned long)avg_us, (unsigned long)max_us, load);
+}
@@ -0,0 +1,172 @@
+/**
+ * @file lzss.c
+ * @brief Low-RAM LZSS compression of uplink batches (heatshrink-style bitstream)
+ *
+ * Batches are already whole in a pool buffer, so the encoder searches the
+ * input in place instead of streaming it through a window copy. Its only
+ * working memory is a hash table of the last position of every 2-byte
+ * prefix and a chain of earlier positions per window slot: 1.5 KB for the
+ * default 512-byte window, static, no heap.
+ *
+ * Output bits, MSB first: 1 + 8-bit literal, or 0 + (distance - 1) in
+ * LZSS_WINDOW_BITS + (length - 1) in LZSS_LOOKAHEAD_BITS. Matches of two
+ * bytes or more are taken (a back-reference costs 15 bits against 18 for
+ * two literals with the default sizes). Line protocol compresses well:
+ * the measurement, tag and field names of every line repeat the previous
+ * line, only the digits change.
+ *
+ * Network context only (not reentrant).
+ */
+
+#include "lzss.h"
+#include "app_config.h"
+#include <stdbool.h>
+#include <string.h>
+
+/* ========== CONFIGURATION ========== */
+
+#define WINDOW_SIZE (1u << LZSS_WINDOW_BITS)
+#define MAX_MATCH (1u << LZSS_LOOKAHEAD_BITS)
+#define MIN_MATCH 2
+#define HASH_SIZE 256
+
+_Static_assert(LZSS_LOOKAHEAD_BITS < LZSS_WINDOW_BITS && LZSS_WINDOW_BITS <= 15, "heatshrink limits");
+
+/* ========== TYPES ========== */
+
+typedef struct {
+    uint8_t *out;
+    size_t cap;
+    size_t len;
+    uint8_t bits;                      // Bits pending in the current byte
+    uint8_t current;
+    bool overflow;
+} BitWriter;
+
+/* ========== PRIVATE VARIABLES ========== */
+
+// Positions are stored + 1, so 0 means "none"
+static uint16_t head[HASH_SIZE];       // Last position of each 2-byte prefix hash
+static uint16_t chain[WINDOW_SIZE];    // Previous position with the same hash, per window slot
+
+/* ========== PRIVATE FUNCTIONS ========== */
+
+static void put_bits(BitWriter *w, uint32_t value, uint8_t count) {
+    while (count-- > 0) {
+        w->current = (uint8_t)((w->current << 1) | ((value >> count) & 1u));
+        if (++w->bits == 8) {
+            if (w->len < w->cap) {
+                w->out[w->len++] = w->current;
+            } else {
+                w->overflow = true;
+            }
+            w->bits = 0;
+            w->current = 0;
+        }
+    }
+}
+
+static uint8_t hash(const uint8_t *p) {
+    return (uint8_t)((p[0] * 33u) ^ p[1]);
+}
+
+static void insert(const uint8_t *in, size_t in_len, size_t pos) {
+    if (pos + 1 < in_len) {
+        uint8_t h = hash(in + pos);
+        chain[pos & (WINDOW_SIZE - 1)] = head[h];
+        head[h] = (uint16_t)(pos + 1);
+    }
+}
+
+/**
+ * @brief Longest earlier match for the bytes at @p pos within the window
+ *
+ * @return Match length (0 if below MIN_MATCH); distance in @p distance
+ */
+static size_t find_match(const uint8_t *in, size_t in_len, size_t pos, size_t *distance) {
+    if (pos + MIN_MATCH > in_len) {
+        return 0;
+    }
+    size_t limit = in_len - pos < MAX_MATCH ? in_len - pos : MAX_MATCH;
+    size_t best = 0;
+    uint16_t candidate = head[hash(in + pos)];
+
+    for (int tries = 0; candidate != 0 && tries < LZSS_MAX_CHAIN; tries++) {
+        size_t start = candidate - 1u;
+        if (pos - start > WINDOW_SIZE) {
+            break;
+        }
+        size_t len = 0;
+        while (len < limit && in[start + len] == in[pos + len]) {
+            len++;
+        }
+        if (len > best) {
+            best = len;
+            *distance = pos - start;
+            if (len == limit) {
+                break;
+            }
+        }
+        uint16_t next = chain[start & (WINDOW_SIZE - 1)];
+        if (next >= candidate) {
+            break; // Slot reused by a later position: the chain ends here
+        }
+        candidate = next;
+    }
+    return best >= MIN_MATCH ? best : 0;
+}
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Compress one batch (header + bitstream)
+ *
+ * @param in Payload to compress (at most 65535 bytes)
+ * @param out Output buffer
+ * @param out_cap Size of @p out
+ * @return Compressed size, or 0 if it does not fit in @p out_cap
+ */
+size_t lzss_compress(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_cap) {
+    if (out_cap < LZSS_HEADER_SIZE || in_len > UINT16_MAX) {
+        return 0;
+    }
+    out[0] = LZSS_MAGIC_0;
+    out[1] = LZSS_MAGIC_1;
+    out[2] = LZSS_WINDOW_BITS;
+    out[3] = LZSS_LOOKAHEAD_BITS;
+    out[4] = (uint8_t)(in_len >> 8);
+    out[5] = (uint8_t)in_len;
+
+    memset(head, 0, sizeof(head));
+    BitWriter w = { .out = out + LZSS_HEADER_SIZE, .cap = out_cap - LZSS_HEADER_SIZE };
+
+    size_t pos = 0;
+    while (pos < in_len && !w.overflow) {
+        size_t distance = 0;
+        size_t len = find_match(in, in_len, pos, &distance);
+        if (len > 0) {
+            put_bits(&w, 0, 1);
+            put_bits(&w, (uint32_t)(distance - 1), LZSS_WINDOW_BITS);
+            put_bits(&w, (uint32_t)(len - 1), LZSS_LOOKAHEAD_BITS);
+        } else {
+            len = 1;
+            put_bits(&w, 1, 1);
+            put_bits(&w, in[pos], 8);
+        }
+        for (size_t i = 0; i < len; i++) {
+            insert(in, in_len, pos + i);
+        }
+        pos += len;
+    }
+    if (w.bits > 0) {
+        put_bits(&w, 0, 8 - w.bits); // Zero padding: too short for another token
+    }
+    return w.overflow ? 0 : LZSS_HEADER_SIZE + w.len;
+}
+
+/**
+ * @brief Static RAM used by the encoder (bytes)
+ */
+size_t lzss_working_memory(void) {
+    return sizeof(head) + sizeof(chain);
+}
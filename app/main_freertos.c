@@ -0,0 +1,476 @@
+/**
+ * @file main_freertos.c
+ * @brief FreeRTOS SMP entry point of the environmental monitoring system
+ *
+ * Same application as main.c, scheduled as independent tasks instead of a
+ * super-loop so a slow job (WiFi join, MQTT, 80 ms AHT conversion) no
+ * longer delays the others.
+ *
+ * Pipeline (queues carry SensorSample pointers from sample_pool, never copies):
+ *
+ *   acquisition --> alerting --+--> display
+ *                              +--> network
+ *                              +--> logging
+ *
+ * The climate control loop is not a task: it runs from a hardware alarm
+ * interrupt owned by core 1 (see climate_control.c), above every task.
+ *
+ * Core 1 runs the sensor path (acquisition, alerting); core 0 runs the CYW43
+ * driver, lwIP and everything that talks to them (network), plus the display
+ * and console logging at low priority.
+ */
+
+// Standard C libraries
+#include <stdio.h>          // Standard I/O operations
+
+// Pico SDK core libraries
+#include "pico/stdlib.h"    // Pico standard library (GPIO, time, etc.)
+#include "pico/cyw43_arch.h" // WiFi chip (CYW43) architecture support
+
+// FreeRTOS kernel
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+// Application-specific modules
+#include "app.h"            // Application state and shared steps
+#include "app_config.h"     // Pinout, credentials, intervals and thresholds
+#include "loop_stats.h"     // Loop latency / CPU load benchmark
+#include "sample_pool.h"    // Zero-copy sample pool
+#include "state_snapshot.h" // Lock-free snapshot of the sampled state
+#include "mem_pool.h"       // Static arena / pools (heap sealed after init)
+#include "usb_stream.h"     // Binary sample streaming over USB CDC
+#include "climate_control.h" // Closed-loop actuator control on core 1
+#include "power_manager.h"  // Supply monitoring and duty cycling
+#include "uplink.h"         // Batched store-and-forward uplink
+#include "coap_server.h"    // CoAP telemetry with Observe
+#include "mqtt_sn_client.h" // MQTT-SN sleeping client (MQTT_SN_ENABLED)
+#include "mqtt_fanout.h"    // Parallel MQTT 5 sessions (MQTT_V5_ENABLED)
+#include "mqtt_outbox.h"    // Priority queue of outgoing MQTT messages
+#include "fleet_stagger.h"  // Per-board publish phase
+#include "link_monitor.h"   // Wi-Fi link classes (telemetry rate, batch size)
+#include "wifi_roam.h"      // Access point roaming (background scans, handover)
+
+/* ========== TASK CONFIGURATION ========== */
+
+// Core affinity masks
+#define CORE0_MASK (1u << 0)
+#define CORE1_MASK (1u << 1)
+
+// Priorities (higher value = higher priority)
+#define ACQUISITION_TASK_PRIORITY (tskIDLE_PRIORITY + 4)
+#define ALERT_TASK_PRIORITY       (tskIDLE_PRIORITY + 3)
+#define NETWORK_TASK_PRIORITY     (tskIDLE_PRIORITY + 3)
+#define DISPLAY_TASK_PRIORITY     (tskIDLE_PRIORITY + 2)
+#define LOG_TASK_PRIORITY         (tskIDLE_PRIORITY + 1)
+
+// Stack depths (words)
+#define ACQUISITION_TASK_STACK 1024
+#define ALERT_TASK_STACK       1024
+#define NETWORK_TASK_STACK     2048
+#define DISPLAY_TASK_STACK     1024
+#define LOG_TASK_STACK         1024
+#define CONTROL_START_STACK    256
+
+// Queue depths (sample pointers)
+#define SAMPLE_QUEUE_LENGTH 4
+
+/* ========== PRIVATE VARIABLES ========== */
+
+static QueueHandle_t acquired_queue;   // acquisition -> alerting
+static QueueHandle_t display_queue;    // alerting -> display
+static QueueHandle_t network_queue;    // alerting -> network
+static QueueHandle_t log_queue;        // alerting -> logging
+
+static TaskHandle_t network_task_handle; // Notified by the display task on button C
+
+/* ========== HELPERS ========== */
+
+/**
+ * @brief Sleep until the next period and record the wake-up lateness
+ *
+ * @param last_wake FreeRTOS tick bookkeeping for vTaskDelayUntil()
+ * @param deadline Absolute deadline of the next activation (advanced by period)
+ * @param period_ms Task period in milliseconds
+ */
+static void wait_next_period(TickType_t *last_wake, absolute_time_t *deadline, uint32_t period_ms) {
+    vTaskDelayUntil(last_wake, pdMS_TO_TICKS(period_ms));
+    loop_stats_record_lateness(absolute_time_diff_us(*deadline, get_absolute_time()));
+    *deadline = delayed_by_ms(*deadline, period_ms);
+}
+
+/**
+ * @brief Forward a sample to a consumer queue without blocking
+ *
+ * The caller must already hold the reference being handed over; it is
+ * dropped here if the consumer queue is full.
+ */
+static void forward_sample(QueueHandle_t queue, SensorSample *sample) {
+    if (xQueueSend(queue, &sample, 0) != pdTRUE) {
+        sample_pool_release(sample);
+    }
+}
+
+/**
+ * @brief Drain a queue and keep only the most recent sample
+ *
+ * @param queue Consumer queue
+ * @param latest Currently held sample (released if a newer one arrives)
+ * @param wait Ticks to block for the first sample
+ * @return Most recent sample held by the caller (may be NULL)
+ */
+static SensorSample *take_latest(QueueHandle_t queue, SensorSample *latest, TickType_t wait) {
+    SensorSample *sample;
+    while (xQueueReceive(queue, &sample, wait) == pdTRUE) {
+        sample_pool_release(latest);
+        latest = sample;
+        wait = 0;
+    }
+    return latest;
+}
+
+/* ========== TASKS ========== */
+
+/**
+ * @brief Acquisition task (core 1): reads the sensors at a fixed rate
+ */
+static void acquisition_task(void *params) {
+    TickType_t last_wake = xTaskGetTickCount();
+    absolute_time_t deadline = delayed_by_ms(get_absolute_time(), SENSOR_READ_INTERVAL_MS);
+
+    while (true) {
+        // Full sensor rate while the host is streaming (see log_task),
+        // stretched by the power policy on battery otherwise
+        wait_next_period(&last_wake, &deadline,
+                         usb_stream_active() ? STREAM_INTERVAL_MS
+                                             : power_sample_interval_ms(SENSOR_READ_INTERVAL_MS));
+
+        SensorSample *sample = sample_pool_acquire();
+        if (sample == NULL) {
+            continue; // Every consumer is behind - skip this cycle (counted by the pool)
+        }
+
+        read_sensors_raw(&sample->sensors, &sample->raw);
+        power_manager_update();
+        sample->timestamp = get_absolute_time();
+        forward_sample(acquired_queue, sample);
+    }
+}
+
+/**
+ * @brief Alerting task (core 1): evaluates thresholds and fans samples out
+ */
+static void alert_task(void *params) {
+    SensorSample *sample;
+
+    while (true) {
+        if (xQueueReceive(acquired_queue, &sample, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        check_critical_values(&sample->sensors, &sample->alerts);
+        apply_dosing_rules(&sample->sensors);
+
+        // Single writer of the shared snapshot; other contexts read it lock-free
+        state_snapshot_publish(&sample->sensors, &sample->alerts, sample->timestamp);
+
+        // One reference per consumer; the acquisition reference goes to the display
+        sample_pool_retain(sample, 2);
+        forward_sample(display_queue, sample);
+        forward_sample(network_queue, sample);
+        forward_sample(log_queue, sample);
+    }
+}
+
+/**
+ * @brief Display task (core 0): OLED refresh and button handling
+ */
+static void display_task(void *params) {
+    TickType_t last_wake = xTaskGetTickCount();
+    absolute_time_t deadline = delayed_by_ms(get_absolute_time(), DISPLAY_UPDATE_INTERVAL_MS);
+    SensorSample *latest = NULL;
+
+    while (true) {
+        wait_next_period(&last_wake, &deadline, DISPLAY_UPDATE_INTERVAL_MS);
+
+        if (app_process_buttons()) {
+            xTaskNotifyGive(network_task_handle);
+        }
+
+        latest = take_latest(display_queue, latest, 0);
+        if (latest != NULL) {
+            update_display(&latest->sensors, &latest->alerts);
+            app_state.last_display_update = get_absolute_time();
+        }
+    }
+}
+
+/**
+ * @brief Logging task (core 0): console output, USB binary stream, flash history
+ * and benchmark reports
+ *
+ * Owns the USB CDC port: it runs on the core servicing USB, which the stream
+ * module requires, and sees every sample, so streaming needs no extra queue.
+ * Flash writes park the other core through flash_safe_execute(), so they stay
+ * in this lowest-priority task.
+ */
+static void log_task(void *params) {
+    SensorSample *sample;
+    uint64_t idle_prev = ulTaskGetIdleRunTimeCounter();
+    uint64_t window_prev = time_us_64();
+    absolute_time_t flash_log_timer = make_timeout_time_ms(FLASH_LOG_INTERVAL_MS);
+
+    while (true) {
+        TickType_t wait = pdMS_TO_TICKS(usb_stream_active() ? STREAM_INTERVAL_MS : 1000);
+        if (xQueueReceive(log_queue, &sample, wait) == pdTRUE) {
+            if (usb_stream_active()) {
+                usb_stream_send_sample(&sample->sensors, &sample->raw, sample->timestamp);
+            } else {
+                printf("\n--- Leitura dos Sensores ---\n");
+                print_sensor_readings(&sample->sensors);
+                print_critical_alerts(&sample->alerts);
+            }
+            sample_pool_release(sample);
+        }
+
+        usb_stream_poll();
+
+        if (time_reached(flash_log_timer)) {
+            StateSnapshot snap;
+            if (state_snapshot_read(&snap) && snap.generation > 0) {
+                log_history(&snap.sensors, &snap.alerts, snap.timestamp);
+            }
+            flash_log_timer = delayed_by_ms(flash_log_timer, FLASH_LOG_INTERVAL_MS);
+        }
+
+        if (loop_stats_report_due()) {
+            // Busy time = wall time on both cores minus time spent in the idle tasks
+            uint64_t idle_now = ulTaskGetIdleRunTimeCounter();
+            uint64_t now = time_us_64();
+            uint64_t available = (now - window_prev) * configNUMBER_OF_CORES;
+            uint64_t idle = idle_now - idle_prev;
+            loop_stats_add_busy_us(available > idle ? available - idle : 0);
+            loop_stats_report("freertos-smp", configNUMBER_OF_CORES);
+            printf("[bench] amostras descartadas (pool cheio): %lu\n",
+                   (unsigned long)sample_pool_exhausted_count());
+            mem_print_stats();
+            print_control_stats();
+            print_bus_stats();
+            uplink_print_stats();
+            coap_server_print_stats();
+            mqtt_outbox_print_stats();
+            fleet_stagger_print_stats();
+            link_monitor_print_stats();
+            wifi_roam_print_stats();
+#if MQTT_SN_ENABLED
+            mqtt_sn_print_stats();
+#elif MQTT_V5_ENABLED
+            mqtt_fanout_print_stats();
+#endif
+            idle_prev = idle_now;
+            window_prev = now;
+        }
+    }
+}
+
+/**
+ * @brief Network task (core 0): WiFi, MQTT and phone JSON
+ *
+ * Also brings up the CYW43 driver: with pico_cyw43_arch_lwip_sys_freertos it
+ * must be initialized from a task once the scheduler runs, so the pipeline
+ * tasks are created here after the chip is ready.
+ */
+static void network_task(void *params);
+
+/**
+ * @brief One-shot task on core 1: enables the control alarm interrupt there
+ */
+static void control_start_task(void *params) {
+    climate_control_start();
+    vTaskDelete(NULL);
+}
+
+static void start_pipeline_tasks(void) {
+    TaskHandle_t handle;
+
+    xTaskCreateAffinitySet(control_start_task, "controle", CONTROL_START_STACK, NULL,
+                           configMAX_PRIORITIES - 1, CORE1_MASK, &handle);
+
+    xTaskCreateAffinitySet(acquisition_task, "aquisicao", ACQUISITION_TASK_STACK, NULL,
+                           ACQUISITION_TASK_PRIORITY, CORE1_MASK, &handle);
+    xTaskCreateAffinitySet(alert_task, "alertas", ALERT_TASK_STACK, NULL,
+                           ALERT_TASK_PRIORITY, CORE1_MASK, &handle);
+    xTaskCreateAffinitySet(display_task, "display", DISPLAY_TASK_STACK, NULL,
+                           DISPLAY_TASK_PRIORITY, CORE0_MASK, &handle);
+    xTaskCreateAffinitySet(log_task, "log", LOG_TASK_STACK, NULL,
+                           LOG_TASK_PRIORITY, CORE0_MASK, &handle);
+}
+
+static void network_task(void *params) {
+    if (cyw43_arch_init()) {
+        printf("Falha ao inicializar WiFi\n");
+    }
+    power_manager_init(); // Reads VBUS through the CYW43, so only after its init
+
+    start_pipeline_tasks();
+
+    printf("Tentando conectar ao WiFi...\n");
+    if (wifi_connect()) {
+        printf("WiFi conectado com sucesso!\n");
+        printf("IP: %s\n", app_state.wifi.ip_address);
+    } else {
+        printf("Continuando sem WiFi...\n");
+    }
+
+    // Fim da inicialização: daqui em diante nenhuma alocação no heap da libc
+    // (as tarefas e filas usam o heap_4 do FreeRTOS, reservado estaticamente)
+    mem_seal();
+
+    absolute_time_t wifi_timer = make_timeout_time_ms(PHONE_SEND_INTERVAL_MS);
+    // Periodic publishes at this board's phase (boards powered up together do not publish together)
+    absolute_time_t mqtt_timer = fleet_stagger_deadline(MQTT_PUBLISH_INTERVAL_MS);
+    absolute_time_t mqtt_alert_timer = fleet_stagger_deadline(MQTT_ALERT_INTERVAL_MS);
+    absolute_time_t uplink_timer = fleet_stagger_deadline(UPLINK_FLUSH_INTERVAL_MS);
+    absolute_time_t coap_deadline = at_the_end_of_time;
+    absolute_time_t sn_deadline = at_the_end_of_time;
+    absolute_time_t outbox_deadline = at_the_end_of_time;
+    absolute_time_t link_deadline = at_the_end_of_time;
+    absolute_time_t roam_deadline = at_the_end_of_time;
+    absolute_time_t fanout_deadline = at_the_end_of_time;
+    absolute_time_t fanout_sampled = nil_time; // Last sample offered to the MQTT sessions
+    SensorSample *latest = NULL;
+
+    while (true) {
+        // Sleep until the earliest network deadline, waking early for new samples
+        absolute_time_t next = wifi_timer;
+        if (absolute_time_diff_us(mqtt_timer, next) > 0) next = mqtt_timer;
+        if (absolute_time_diff_us(mqtt_alert_timer, next) > 0) next = mqtt_alert_timer;
+        if (absolute_time_diff_us(uplink_timer, next) > 0) next = uplink_timer;
+        if (absolute_time_diff_us(coap_deadline, next) > 0) next = coap_deadline;
+        if (absolute_time_diff_us(sn_deadline, next) > 0) next = sn_deadline;
+        if (absolute_time_diff_us(outbox_deadline, next) > 0) next = outbox_deadline;
+        if (absolute_time_diff_us(link_deadline, next) > 0) next = link_deadline;
+        if (absolute_time_diff_us(roam_deadline, next) > 0) next = roam_deadline;
+        if (absolute_time_diff_us(fanout_deadline, next) > 0) next = fanout_deadline;
+        int64_t wait_us = absolute_time_diff_us(get_absolute_time(), next);
+        TickType_t wait = wait_us > 0 ? pdMS_TO_TICKS(wait_us / 1000) : 0;
+
+        latest = take_latest(network_queue, latest, wait);
+        if (latest != NULL) {
+            uplink_record(&latest->sensors, latest->timestamp); // Rate-limited inside
+            coap_server_notify(&latest->sensors, &latest->alerts, latest->timestamp); // New samples only
+            if (absolute_time_diff_us(fanout_sampled, latest->timestamp) != 0) {
+                mqtt_fanout_sample(&latest->sensors, latest->timestamp); // Each MQTT session at its own rate
+                fanout_sampled = latest->timestamp;
+            }
+        }
+        coap_deadline = coap_server_poll();
+
+        // Dose completions (raised by interrupts) go out at the next wake-up
+        publish_dosing_events();
+
+        if (ulTaskNotifyTake(pdTRUE, 0)) {
+            printf("Tentando reconectar WiFi...\n");
+            if (wifi_connect()) {
+                printf("WiFi reconectado!\n");
+            }
+        }
+
+        if (time_reached(wifi_timer)) {
+            loop_stats_record_lateness(absolute_time_diff_us(wifi_timer, get_absolute_time()));
+            if (app_state.wifi.connected && latest != NULL) {
+                printf("\n--- Enviando dados via WiFi ---\n");
+                send_data_to_phone(&latest->sensors, &latest->alerts);
+            }
+            wifi_timer = delayed_by_ms(wifi_timer, power_publish_interval_ms(PHONE_SEND_INTERVAL_MS));
+        }
+
+        // New slot from the broker: realign the publishes
+        if (fleet_stagger_take_change()) {
+            mqtt_timer = fleet_stagger_deadline(link_publish_interval_ms(power_publish_interval_ms(MQTT_PUBLISH_INTERVAL_MS)));
+            mqtt_alert_timer = fleet_stagger_deadline(MQTT_ALERT_INTERVAL_MS);
+            uplink_timer = fleet_stagger_deadline(power_publish_interval_ms(UPLINK_FLUSH_INTERVAL_MS));
+            mqtt_fanout_restagger();
+        }
+
+        // MQTT 5 sessions with their own interval: latest sample, at this board's phase
+        fanout_deadline = mqtt_fanout_poll(latest != NULL ? &latest->sensors : NULL,
+                                           latest != NULL ? latest->timestamp : nil_time);
+
+        if (time_reached(mqtt_timer)) {
+            loop_stats_record_lateness(absolute_time_diff_us(mqtt_timer, get_absolute_time()));
+            if (app_state.wifi.connected && latest != NULL) {
+                printf("\n--- Publicando dados via MQTT ---\n");
+                mqtt_publish_sensor_data_func(&latest->sensors);
+                mqtt_publish_control_func();
+                app_state.last_mqtt_publish = to_ms_since_boot(get_absolute_time());
+            }
+            mqtt_timer = delayed_by_ms(mqtt_timer, link_publish_interval_ms(power_publish_interval_ms(MQTT_PUBLISH_INTERVAL_MS)));
+        }
+
+        if (time_reached(uplink_timer)) {
+            loop_stats_record_lateness(absolute_time_diff_us(uplink_timer, get_absolute_time()));
+            if (app_state.wifi.connected) {
+                uplink_flush();
+            }
+            uplink_timer = delayed_by_ms(uplink_timer, power_publish_interval_ms(UPLINK_FLUSH_INTERVAL_MS));
+        }
+
+        if (time_reached(mqtt_alert_timer)) {
+            loop_stats_record_lateness(absolute_time_diff_us(mqtt_alert_timer, get_absolute_time()));
+            if (app_state.wifi.connected && latest != NULL) {
+                mqtt_publish_alerts_func(&latest->alerts);
+                app_state.last_mqtt_alert_check = to_ms_since_boot(get_absolute_time());
+            }
+            mqtt_alert_timer = delayed_by_ms(mqtt_alert_timer, MQTT_ALERT_INTERVAL_MS);
+        }
+
+#if MQTT_SN_ENABLED
+        // Last, so messages queued above go out before the wait
+        sn_deadline = mqtt_sn_poll(link_publish_interval_ms(power_publish_interval_ms(MQTT_PUBLISH_INTERVAL_MS)));
+#endif
+        // Retry of messages the transports pushed back on (alerts first)
+        outbox_deadline = mqtt_outbox_poll();
+        // Link quality: telemetry interval and batch size follow it
+        link_deadline = link_monitor_poll();
+        // Roaming between access points of the same SSID
+        roam_deadline = wifi_roam_poll();
+    }
+}
+
+/* ========== FREERTOS HOOKS ========== */
+
+void vApplicationMallocFailedHook(void) {
+    panic("FreeRTOS: heap esgotado");
+}
+
+void vApplicationStackOverflowHook(TaskHandle_t task, char *name) {
+    panic("FreeRTOS: estouro de pilha na tarefa %s", name);
+}
+
+/* ========== ENTRY POINT ========== */
+
+int main() {
+    stdio_init_all();
+    sleep_ms(3000);
+    printf("=== Sistema de Monitoramento Ambiental (FreeRTOS SMP) ===\n");
+    printf("Hardware inicializado. Aguarde inicialização dos sensores.\n");
+
+    app_hardware_init();
+    sample_pool_init();
+    state_snapshot_init();
+    loop_stats_init();
+
+    acquired_queue = xQueueCreate(SAMPLE_QUEUE_LENGTH, sizeof(SensorSample *));
+    display_queue = xQueueCreate(SAMPLE_QUEUE_LENGTH, sizeof(SensorSample *));
+    network_queue = xQueueCreate(SAMPLE_QUEUE_LENGTH, sizeof(SensorSample *));
+    log_queue = xQueueCreate(SAMPLE_QUEUE_LENGTH, sizeof(SensorSample *));
+
+    xTaskCreateAffinitySet(network_task, "rede", NETWORK_TASK_STACK, NULL,
+                           NETWORK_TASK_PRIORITY, CORE0_MASK, &network_task_handle);
+
+    app_print_banner();
+    vTaskStartScheduler();
+
+    return 0;
+}
@@ -0,0 +1,239 @@
+/**
+ * @file mem_pool.c
+ * @brief Static memory arena and fixed-size object pools
+ *
+ * Replaces runtime heap use on a device that must run for months: malloc/free
+ * of varying sizes eventually fragments the heap. All memory comes from
+ * storage sized at build time:
+ * - the arena serves one-off allocations made during initialization
+ *   (display framebuffer) and is closed by mem_seal();
+ * - pools serve recurring allocations of a fixed size (message and batch
+ *   buffers); an empty pool returns NULL and counts the event, the caller
+ *   drops the work instead of crashing;
+ * - shared buffers are pool blocks with a reference count, for a payload
+ *   read in place by several consumers (one encoding, many sessions).
+ *
+ * Debug builds (SMAVHIOT_HEAP_GUARD) also trap any libc malloc/free issued
+ * after mem_seal() through newlib's __malloc_lock hook.
+ */
+
+#include "mem_pool.h"
+#include "app_config.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include <reent.h>
+
+/* ========== SHARED POOLS ========== */
+
+MEM_POOL_DEFINE(msg_pool, MSG_BUF_SIZE, MSG_POOL_BLOCKS);
+MEM_POOL_DEFINE(batch_pool, BATCH_BUF_SIZE, BATCH_POOL_BLOCKS);
+
+/* ========== PRIVATE VARIABLES ========== */
+
+#define MEM_MAX_POOLS 8
+
+static uint8_t arena[MEM_ARENA_SIZE] __attribute__((aligned(8))); // Init-time storage
+static size_t arena_used;                                         // Bytes handed out
+static uint32_t arena_refused;                                    // Failed arena requests
+static volatile bool sealed;                                      // Init finished
+static MemPool *pools[MEM_MAX_POOLS];                             // Registered pools (report)
+static uint pool_count;
+
+/* ========== POOL API ========== */
+
+/**
+ * @brief Build the free list of a pool and register it for reporting
+ *
+ * @param pool Pool defined with MEM_POOL_DEFINE()
+ */
+void mem_pool_init(MemPool *pool) {
+    critical_section_init(&pool->lock);
+
+    pool->free_list = NULL;
+    for (int i = pool->block_count - 1; i >= 0; i--) {
+        void **block = (void **)(pool->storage + (size_t)i * pool->block_size);
+        *block = pool->free_list;
+        pool->free_list = block;
+    }
+    pool->in_use = 0;
+    pool->high_water = 0;
+    pool->exhausted = 0;
+
+    if (pool_count < MEM_MAX_POOLS) {
+        pools[pool_count++] = pool;
+    }
+}
+
+/**
+ * @brief Take one block from a pool
+ *
+ * @param pool Source pool
+ * @return Block of pool->block_size bytes, or NULL if the pool is exhausted
+ */
+void *mem_pool_alloc(MemPool *pool) {
+    critical_section_enter_blocking(&pool->lock);
+    void **block = pool->free_list;
+    if (block != NULL) {
+        pool->free_list = *block;
+        pool->in_use++;
+        if (pool->in_use > pool->high_water) {
+            pool->high_water = pool->in_use;
+        }
+    } else {
+        pool->exhausted++;
+    }
+    critical_section_exit(&pool->lock);
+
+    return block;
+}
+
+/**
+ * @brief Return a block to its pool
+ *
+ * @param pool Pool the block was taken from
+ * @param block Block to release (NULL is ignored)
+ */
+void mem_pool_free(MemPool *pool, void *block) {
+    if (block == NULL) {
+        return;
+    }
+
+    critical_section_enter_blocking(&pool->lock);
+    *(void **)block = pool->free_list;
+    pool->free_list = block;
+    pool->in_use--;
+    critical_section_exit(&pool->lock);
+}
+
+/* ========== SHARED BUFFERS ========== */
+
+/**
+ * @brief Take a block from @p pool as a shared buffer with one reference
+ *
+ * @return Buffer with len = 0, or NULL if the pool is exhausted
+ */
+SharedBuf *shared_buf_alloc(MemPool *pool) {
+    SharedBuf *buf = mem_pool_alloc(pool);
+    if (buf != NULL) {
+        buf->pool = pool;
+        buf->refs = 1;
+        buf->len = 0;
+    }
+    return buf;
+}
+
+/**
+ * @brief Payload bytes a shared buffer can hold
+ */
+size_t shared_buf_capacity(const SharedBuf *buf) {
+    return buf->pool->block_size - sizeof(SharedBuf);
+}
+
+/**
+ * @brief Add a reference (the new owner calls shared_buf_release() when done)
+ */
+void shared_buf_ref(SharedBuf *buf) {
+    critical_section_enter_blocking(&buf->pool->lock);
+    buf->refs++;
+    critical_section_exit(&buf->pool->lock);
+}
+
+/**
+ * @brief Drop a reference; the last one returns the block to its pool
+ *
+ * @param buf Buffer (NULL is ignored)
+ */
+void shared_buf_release(SharedBuf *buf) {
+    if (buf == NULL) {
+        return;
+    }
+    MemPool *pool = buf->pool;
+    critical_section_enter_blocking(&pool->lock);
+    bool last = --buf->refs == 0;
+    critical_section_exit(&pool->lock);
+    if (last) {
+        mem_pool_free(pool, buf);
+    }
+}
+
+/**
+ * @brief Initialize the application-wide pools
+ */
+void mem_pools_init(void) {
+    mem_pool_init(&msg_pool);
+    mem_pool_init(&batch_pool);
+}
+
+/* ========== STATIC ARENA ========== */
+
+/**
+ * @brief Allocate permanent storage during initialization
+ *
+ * Memory is never returned. Requests after mem_seal() are refused.
+ *
+ * @param size Bytes requested
+ * @return Word-aligned storage, or NULL if sealed or the arena is full
+ */
+void *mem_arena_alloc(size_t size) {
+    size_t aligned = (size + 7u) & ~7u;
+
+    if (sealed || arena_used + aligned > sizeof(arena)) {
+        arena_refused++;
+        printf("Arena: pedido de %u bytes recusado\n", (unsigned)size);
+        return NULL;
+    }
+
+    void *block = &arena[arena_used];
+    arena_used += aligned;
+    return block;
+}
+
+/**
+ * @brief Close the initialization phase
+ *
+ * From here on only pools may allocate; the arena refuses requests and, in
+ * debug builds, any libc heap call panics.
+ */
+void mem_seal(void) {
+    sealed = true;
+}
+
+/**
+ * @brief Whether mem_seal() has been called
+ */
+bool mem_is_sealed(void) {
+    return sealed;
+}
+
+/**
+ * @brief Print arena and pool usage, including exhaustion counters
+ */
+void mem_print_stats(void) {
+    printf("[mem] arena: %u/%u bytes, %lu recusados\n",
+           (unsigned)arena_used, (unsigned)sizeof(arena), (unsigned long)arena_refused);
+    for (uint i = 0; i < pool_count; i++) {
+        MemPool *pool = pools[i];
+        printf("[mem] %s: %u/%u em uso (pico %u), %lu esgotamentos\n",
+               pool->name, pool->in_use, pool->block_count, pool->high_water,
+               (unsigned long)pool->exhausted);
+    }
+}
+
+/* ========== HEAP GUARD (DEBUG BUILDS) ========== */
+
+#if SMAVHIOT_HEAP_GUARD
+/**
+ * @brief newlib heap lock hook, called by every malloc/calloc/realloc/free
+ *
+ * Overrides newlib's no-op default. Any heap operation once the system is
+ * sealed is a bug: report it immediately instead of fragmenting silently.
+ */
+void __malloc_lock(struct _reent *reent) {
+    if (sealed) {
+        panic("malloc/free apos a inicializacao (heap proibido)");
+    }
+}
+
+void __malloc_unlock(struct _reent *reent) {
+}
+#endif
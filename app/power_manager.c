@@ -0,0 +1,261 @@
+/**
+ * @file power_manager.c
+ * @brief Power source detection, battery state and adaptive duty cycling
+ *
+ * Updated once per acquisition. VBUS comes from the CYW43 (WL_GPIO2); VSYS
+ * from ADC3 through adc_probes_read_vsys_mv(), which deals with the pin
+ * being shared with the CYW43 SPI clock. Without VBUS, a VSYS above any
+ * battery voltage means a DC supply on VSYS; anything lower is the battery.
+ *
+ * The state of charge comes from a single-cell Li-ion discharge curve,
+ * looked up on the low-passed VSYS (WiFi transmit bursts sag it). The level
+ * thresholds have hysteresis so a sagging battery does not flap between
+ * policies. Each level stretches the sampling and publishing intervals and
+ * dims or turns off the OLED; a button press lights it again for a while.
+ *
+ * Runtime is projected from the capacity and a nominal draw until a full
+ * POWER_RUNTIME_WINDOW_MS of discharge has been observed, then from the
+ * measured rate of state-of-charge loss.
+ */
+
+#include "power_manager.h"
+#include "app_config.h"
+#include "adc_probes.h"
+#include "pico/critical_section.h"
+#include "pico/cyw43_arch.h"
+#include "pico/time.h"
+#include <stdio.h>
+
+/* ========== POLICY ========== */
+
+#define VSYS_FILTER_SHIFT 3                   // EMA weight 1/8 per acquisition
+
+/**
+ * @brief What one level changes
+ */
+typedef struct {
+    uint8_t sample_factor;                    // Sensor period multiplier
+    uint8_t publish_factor;                   // MQTT / phone period multiplier
+    DisplayPower display;
+} PowerPolicy;
+
+static const PowerPolicy policies[POWER_LEVEL_COUNT] = {
+    [POWER_LEVEL_NORMAL]   = { 1, 1, DISPLAY_POWER_NORMAL },
+    [POWER_LEVEL_SAVE]     = { 2, 3, DISPLAY_POWER_DIM },
+    [POWER_LEVEL_LOW]      = { 5, 6, DISPLAY_POWER_OFF },
+    [POWER_LEVEL_CRITICAL] = { 15, 30, DISPLAY_POWER_OFF },
+};
+
+// Entering a level below this state of charge (%)
+static const uint8_t level_below_pct[POWER_LEVEL_COUNT] = {
+    [POWER_LEVEL_NORMAL] = 101,
+    [POWER_LEVEL_SAVE] = POWER_SAVE_BELOW_PCT,
+    [POWER_LEVEL_LOW] = POWER_LOW_BELOW_PCT,
+    [POWER_LEVEL_CRITICAL] = POWER_CRITICAL_BELOW_PCT,
+};
+
+/**
+ * @brief Li-ion cell voltage (resting, light load) vs state of charge
+ */
+typedef struct {
+    uint16_t cell_mv;
+    uint8_t pct;
+} SocPoint;
+
+static const SocPoint soc_curve[] = {
+    { 4200, 100 }, { 4060, 90 }, { 3980, 80 }, { 3920, 70 }, { 3870, 60 }, { 3820, 50 },
+    { 3790, 40 }, { 3770, 30 }, { 3740, 20 }, { 3680, 10 }, { 3450, 5 }, { 3300, 0 },
+};
+
+#define SOC_POINTS (sizeof(soc_curve) / sizeof(soc_curve[0]))
+
+/* ========== PRIVATE VARIABLES ========== */
+
+static critical_section_t status_lock;        // Updated by the sampler, read by display/network
+static PowerStatus status;
+
+static uint32_t vsys_q3;                      // Filtered VSYS (mV << VSYS_FILTER_SHIFT)
+static absolute_time_t display_wake_until;
+
+static absolute_time_t window_start;          // Discharge observation window
+static uint8_t window_start_pct;
+static uint32_t drain_pct_per_h_x100;         // Measured discharge rate (0 = not yet)
+
+/* ========== PRIVATE FUNCTIONS ========== */
+
+static uint8_t state_of_charge(uint32_t vsys_mv) {
+    uint32_t cell_mv = vsys_mv + BATTERY_PATH_DROP_MV;
+    if (cell_mv >= soc_curve[0].cell_mv) {
+        return 100;
+    }
+    for (unsigned i = 1; i < SOC_POINTS; i++) {
+        const SocPoint *hi = &soc_curve[i - 1];
+        const SocPoint *lo = &soc_curve[i];
+        if (cell_mv >= lo->cell_mv) {
+            return (uint8_t)(lo->pct + (cell_mv - lo->cell_mv) * (hi->pct - lo->pct) / (hi->cell_mv - lo->cell_mv));
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Level for @p pct, leaving the current one only past the hysteresis band
+ */
+static PowerLevel level_for(uint8_t pct, PowerLevel current) {
+    PowerLevel level = POWER_LEVEL_NORMAL;
+    for (int l = POWER_LEVEL_COUNT - 1; l > POWER_LEVEL_NORMAL; l--) {
+        if (pct < level_below_pct[l]) {
+            level = (PowerLevel)l;
+            break;
+        }
+    }
+    // Recovering: stay until the charge clears the threshold by the hysteresis
+    if (level < current && pct < level_below_pct[current] + POWER_HYSTERESIS_PCT) {
+        return current;
+    }
+    return level;
+}
+
+/**
+ * @brief Track the discharge rate over fixed windows on battery
+ */
+static void update_drain(PowerSource source, uint8_t pct) {
+    if (source != POWER_SOURCE_BATTERY) {
+        window_start = nil_time;
+        drain_pct_per_h_x100 = 0;
+        return;
+    }
+    if (is_nil_time(window_start)) {
+        window_start = get_absolute_time();
+        window_start_pct = pct;
+        return;
+    }
+
+    int64_t elapsed_ms = absolute_time_diff_us(window_start, get_absolute_time()) / 1000;
+    if (elapsed_ms < POWER_RUNTIME_WINDOW_MS) {
+        return;
+    }
+    if (window_start_pct > pct) {
+        uint32_t rate = (uint32_t)((window_start_pct - pct) * 100LL * 3600000 / elapsed_ms);
+        drain_pct_per_h_x100 = drain_pct_per_h_x100 ? (drain_pct_per_h_x100 + rate) / 2 : rate;
+    }
+    window_start = get_absolute_time();
+    window_start_pct = pct;
+}
+
+static int32_t projected_runtime_min(PowerSource source, uint8_t pct, bool *measured) {
+    *measured = drain_pct_per_h_x100 > 0;
+    if (source != POWER_SOURCE_BATTERY) {
+        return -1;
+    }
+    if (*measured) {
+        return (int32_t)((uint32_t)pct * 100 * 60 / drain_pct_per_h_x100);
+    }
+    return (int32_t)((uint32_t)pct * BATTERY_CAPACITY_MAH * 60 / (100u * POWER_NOMINAL_DRAW_MA));
+}
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Take the first measurement (after adc_probes_init() and the CYW43 init)
+ */
+void power_manager_init(void) {
+    critical_section_init(&status_lock);
+    status = (PowerStatus){ .source = POWER_SOURCE_USB, .level = POWER_LEVEL_NORMAL,
+                            .battery_pct = 100, .runtime_min = -1 };
+    display_wake_until = nil_time;
+    window_start = nil_time;
+    power_manager_update();
+}
+
+/**
+ * @brief Measure the supply and apply the policy (once per acquisition)
+ *
+ * Thread context only: both measurements take the CYW43 lock.
+ */
+void power_manager_update(void) {
+    uint32_t vsys_mv = adc_probes_read_vsys_mv();
+    bool vbus = cyw43_arch_gpio_get(CYW43_WL_GPIO_VBUS_PIN);
+
+    if (vsys_q3 == 0) {
+        vsys_q3 = vsys_mv << VSYS_FILTER_SHIFT;
+    } else {
+        vsys_q3 += (int32_t)((vsys_mv << VSYS_FILTER_SHIFT) - vsys_q3) >> VSYS_FILTER_SHIFT;
+    }
+    uint32_t filtered_mv = vsys_q3 >> VSYS_FILTER_SHIFT;
+
+    PowerSource source = vbus ? POWER_SOURCE_USB
+                       : filtered_mv > POWER_EXTERNAL_ABOVE_MV ? POWER_SOURCE_EXTERNAL
+                       : POWER_SOURCE_BATTERY;
+    uint8_t pct = source == POWER_SOURCE_BATTERY ? state_of_charge(filtered_mv) : 100;
+
+    update_drain(source, pct);
+    bool measured;
+    int32_t runtime = projected_runtime_min(source, pct, &measured);
+
+    critical_section_enter_blocking(&status_lock);
+    PowerSource old_source = status.source;
+    PowerLevel old_level = status.level;
+    PowerLevel level = source == POWER_SOURCE_BATTERY ? level_for(pct, old_level) : POWER_LEVEL_NORMAL;
+    status = (PowerStatus){ .source = source, .level = level, .vsys_mv = filtered_mv,
+                            .battery_pct = pct, .runtime_min = runtime, .runtime_measured = measured };
+    critical_section_exit(&status_lock);
+
+    if (source != old_source || level != old_level) {
+        printf("Energia: %s, %.2f V, %u%% -> modo %s\n", power_source_name(source),
+               filtered_mv / 1000.0f, pct, power_level_name(level));
+    }
+}
+
+/**
+ * @brief Copy the latest supply status
+ */
+void power_manager_get_status(PowerStatus *out) {
+    critical_section_enter_blocking(&status_lock);
+    *out = status;
+    critical_section_exit(&status_lock);
+}
+
+/**
+ * @brief User interaction: keep the OLED lit for POWER_DISPLAY_WAKE_MS
+ */
+void power_manager_note_activity(void) {
+    display_wake_until = make_timeout_time_ms(POWER_DISPLAY_WAKE_MS);
+}
+
+/**
+ * @brief Sensor acquisition period for the current level
+ */
+uint32_t power_sample_interval_ms(uint32_t base_ms) {
+    return base_ms * policies[status.level].sample_factor;
+}
+
+/**
+ * @brief Publication period (MQTT data, phone JSON) for the current level
+ */
+uint32_t power_publish_interval_ms(uint32_t base_ms) {
+    return base_ms * policies[status.level].publish_factor;
+}
+
+/**
+ * @brief OLED state for the current level (full brightness after a button press)
+ */
+DisplayPower power_display_mode(void) {
+    if (!is_nil_time(display_wake_until) && !time_reached(display_wake_until)) {
+        return DISPLAY_POWER_NORMAL;
+    }
+    return policies[status.level].display;
+}
+
+const char *power_source_name(PowerSource source) {
+    switch (source) {
+        case POWER_SOURCE_USB: return "usb";
+        case POWER_SOURCE_EXTERNAL: return "externa";
+        default: return "bateria";
+    }
+}
+
+const char *power_level_name(PowerLevel level) {
+    static const char *const names[POWER_LEVEL_COUNT] = { "normal", "economia", "baixa", "critica" };
+    return level < POWER_LEVEL_COUNT ? names[level] : "?";
+}
@@ -0,0 +1,93 @@
+/**
+ * @file sample_pool.c
+ * @brief Static pool of reference-counted sensor samples
+ *
+ * Fixed set of SensorSample objects handed out by pointer so pipeline stages
+ * exchange samples without copying. No heap is used; when every slot is in
+ * use the acquisition is dropped and counted instead of blocking the
+ * producer. Safe to call from both cores.
+ */
+
+#include "sample_pool.h"
+#include "pico/critical_section.h"
+#include <string.h>
+
+/* ========== PRIVATE VARIABLES ========== */
+
+static SensorSample pool[SAMPLE_POOL_SIZE]; // Backing storage for all samples
+static critical_section_t pool_lock;        // Protects reference counts across cores
+static uint32_t next_seq;                   // Sequence number of the next sample
+static uint32_t exhausted;                  // Acquisitions refused for lack of a slot
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Mark every slot as free
+ */
+void sample_pool_init(void) {
+    critical_section_init(&pool_lock);
+    memset(pool, 0, sizeof(pool));
+    next_seq = 0;
+    exhausted = 0;
+}
+
+/**
+ * @brief Take a free sample from the pool
+ *
+ * @return Sample with one reference held by the caller, or NULL if the pool is exhausted
+ */
+SensorSample *sample_pool_acquire(void) {
+    SensorSample *sample = NULL;
+
+    critical_section_enter_blocking(&pool_lock);
+    for (int i = 0; i < SAMPLE_POOL_SIZE; i++) {
+        if (pool[i].refs == 0) {
+            sample = &pool[i];
+            sample->refs = 1;
+            sample->seq = next_seq++;
+            break;
+        }
+    }
+    if (sample == NULL) {
+        exhausted++;
+    }
+    critical_section_exit(&pool_lock);
+
+    return sample;
+}
+
+/**
+ * @brief Add references before handing a sample to more consumers
+ *
+ * @param sample Sample already referenced by the caller
+ * @param count Number of additional references
+ */
+void sample_pool_retain(SensorSample *sample, uint8_t count) {
+    critical_section_enter_blocking(&pool_lock);
+    sample->refs += count;
+    critical_section_exit(&pool_lock);
+}
+
+/**
+ * @brief Drop one reference; the slot returns to the pool on the last one
+ *
+ * @param sample Sample to release (NULL is ignored)
+ */
+void sample_pool_release(SensorSample *sample) {
+    if (sample == NULL) {
+        return;
+    }
+
+    critical_section_enter_blocking(&pool_lock);
+    if (sample->refs > 0) {
+        sample->refs--;
+    }
+    critical_section_exit(&pool_lock);
+}
+
+/**
+ * @brief Number of acquisitions refused because every slot was in use
+ */
+uint32_t sample_pool_exhausted_count(void) {
+    return exhausted;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file state_snapshot.c
+ * @brief Lock-free versioned snapshot of the sampled state (seqlock latch)
+ *
+ * The sampler publishes each new SensorData/AlertStatus generation without
+ * taking a lock; any other context (the other core, lwIP callbacks, HTTP
+ * handlers, interrupt handlers) obtains a consistent copy by retrying while
+ * the sequence counter moves.
+ *
+ * Two copies are kept (the "latch" form of a seqlock): while the writer
+ * updates one copy, the sequence parity steers readers to the other. A reader
+ * that interrupts the writer on the same core therefore always finds a stable
+ * copy and completes without spinning, which a single-copy seqlock cannot
+ * guarantee in interrupt context.
+ *
+ * Only ONE writer may call state_snapshot_publish() (main loop or alerting
+ * task); readers are unlimited.
+ */
+
+#include "state_snapshot.h"
+#include "hardware/sync.h"
+#include <string.h>
+
+/* ========== PRIVATE VARIABLES ========== */
+
+static volatile uint32_t sequence;   // Incremented twice per publication
+static StateSnapshot copies[2];      // copies[seq & 1] is stable for readers
+
+/* ========== PRIVATE HELPERS ========== */
+
+/**
+ * @brief Copy a snapshot word by word through volatile accesses
+ *
+ * Keeps the compiler from caching or merging loads/stores across the
+ * barriers; a torn copy is detected by the sequence check, never used.
+ */
+static void snapshot_copy(StateSnapshot *dst, const StateSnapshot *src) {
+    volatile const uint32_t *s = (volatile const uint32_t *)src;
+    volatile uint32_t *d = (volatile uint32_t *)dst;
+    for (size_t i = 0; i < sizeof(StateSnapshot) / sizeof(uint32_t); i++) {
+        d[i] = s[i];
+    }
+}
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Reset both copies to an empty (generation 0) snapshot
+ */
+void state_snapshot_init(void) {
+    memset(copies, 0, sizeof(copies));
+    sequence = 0;
+    __dmb();
+}
+
+/**
+ * @brief Publish a new generation (single writer only)
+ *
+ * @param sensors Readings of the cycle
+ * @param alerts Alert evaluation of the cycle
+ * @param timestamp Acquisition time of the cycle
+ */
+void state_snapshot_publish(const SensorData *sensors, const AlertStatus *alerts, absolute_time_t timestamp) {
+    StateSnapshot next;
+    memset(&next, 0, sizeof(next));
+    next.sensors = *sensors;
+    next.alerts = *alerts;
+    next.timestamp = timestamp;
+    next.generation = (sequence >> 1) + 1;
+
+    // Odd sequence: readers use copies[1] while copies[0] is rewritten
+    sequence++;
+    __dmb();
+    snapshot_copy(&copies[0], &next);
+    __dmb();
+
+    // Even sequence: readers use copies[0] while copies[1] is rewritten
+    sequence++;
+    __dmb();
+    snapshot_copy(&copies[1], &next);
+    __dmb();
+}
+
+/**
+ * @brief Obtain a consistent copy of the latest generation
+ *
+ * Never blocks the writer. Retries only if a publication completed on the
+ * other core during the copy.
+ *
+ * @param out Destination of the copy
+ * @return true if at least one generation has been published
+ */
+bool state_snapshot_read(StateSnapshot *out) {
+    uint32_t seq;
+
+    do {
+        seq = sequence;
+        __dmb();
+        snapshot_copy(out, &copies[seq & 1]);
+        __dmb();
+    } while (seq != sequence);
+
+    return out->generation != 0;
+}
+
+/**
+ * @brief Latest published generation (cheap change detection for readers)
+ */
+uint32_t state_snapshot_generation(void) {
+    return sequence >> 1;
+}
@@ -0,0 +1,377 @@
+/**
+ * @file uplink.c
+ * @brief Batched, store-and-forward sample uplink (InfluxDB line protocol)
+ *
+ * uplink_record() turns at most one sample per UPLINK_RECORD_INTERVAL_MS
+ * into a fixed-point record in a static ring. uplink_flush() formats the
+ * records straight into a batch_pool buffer, one line per record:
+ *
+ *   smavhiot,device=pico_w temperatura_x100=2350i,umidade_x100=4520i,... 1718036400123456000
+ *
+ * Fields are integers (scale in the field name) and the timestamp is in
+ * nanoseconds. A payload holds as many lines as fit in the transport's
+ * max_payload, and nothing is allocated per sample.
+ *
+ * Transports set to compress get the batch LZSS-compressed (lzss.h)
+ * into a second batch buffer, unless that does not make it smaller:
+ * always, or only while the link monitor reports a degraded link, which
+ * also caps the batch size (uplink_set_link_policy()). Ratio and encoder cycles per byte are logged per batch and
+ * summed per transport.
+ *
+ * Every transport keeps its own position in the ring, so a transport whose
+ * link is down falls behind and catches up later without holding the
+ * others back. When the ring wraps, the oldest records are lost for the
+ * transports that had not sent them yet (counted as dropped).
+ *
+ * Records keep the boot-relative acquisition time and are stamped with
+ * wall-clock time when formatted, so nothing leaves before SNTP has
+ * synchronized once, and samples taken before that still get exact
+ * timestamps.
+ *
+ * Network context only (main loop or network task).
+ */
+
+#include "uplink.h"
+#include "app_config.h"
+#include "lzss.h"
+#include "mem_pool.h"
+#include "power_manager.h"
+#include "wall_clock.h"
+#include "hardware/clocks.h"
+#include <math.h>
+#include <stdio.h>
+
+/* ========== RECORD LAYOUT ========== */
+
+/**
+ * @brief Fields of a record, in line order
+ */
+typedef enum {
+    FIELD_TEMPERATURE = 0,
+    FIELD_HUMIDITY,
+    FIELD_LUX,
+    FIELD_PH,
+    FIELD_EC,
+    FIELD_LEVEL,
+    FIELD_WATER_TEMPERATURE,
+    FIELD_FLOW,
+    FIELD_VOLUME,
+    FIELD_PUMP_RPM,
+    FIELD_CO2,
+    FIELD_VSYS,
+    FIELD_BATTERY,
+    FIELD_COUNT
+} UplinkField;
+
+static const char *const field_names[FIELD_COUNT] = {
+    [FIELD_TEMPERATURE] = "temperatura_x100",        // 0.01 °C
+    [FIELD_HUMIDITY] = "umidade_x100",               // 0.01 %
+    [FIELD_LUX] = "luminosidade_x10",                // 0.1 lux
+    [FIELD_PH] = "ph_x100",
+    [FIELD_EC] = "ec_us",                            // µS/cm
+    [FIELD_LEVEL] = "nivel_x10",                     // 0.1 %
+    [FIELD_WATER_TEMPERATURE] = "temperatura_agua_x100",
+    [FIELD_FLOW] = "vazao_ml_min",
+    [FIELD_VOLUME] = "volume_dl",                    // Since boot, 0.1 L
+    [FIELD_PUMP_RPM] = "bomba_rpm",
+    [FIELD_CO2] = "co2_ppm",
+    [FIELD_VSYS] = "vsys_mv",
+    [FIELD_BATTERY] = "bateria_pct",
+};
+
+/**
+ * @brief One sample, fixed point
+ */
+typedef struct {
+    uint64_t time_us;                  // Acquisition time (µs since boot)
+    uint16_t valid;                    // Bit per field: sensor answered
+    int32_t value[FIELD_COUNT];
+} UplinkRecord;
+
+/**
+ * @brief A registered transport and its position in the ring
+ */
+typedef struct {
+    const UplinkTransport *transport;
+    uint32_t next;                     // Sequence number of the next record to send
+    uint32_t records;                  // Records delivered to the transport
+    uint32_t batches;                  // Payloads delivered
+    uint32_t dropped;                  // Overwritten before they could be sent
+    uint32_t failures;                 // send() refusals (batch kept for a retry)
+    uint32_t compressed;               // Batches sent compressed
+    uint64_t raw_bytes;                // Before compression (compressed batches only)
+    uint64_t wire_bytes;               // After compression
+    uint64_t encode_cycles;            // CPU cycles spent in the encoder
+} UplinkSink;
+
+/* ========== PRIVATE VARIABLES ========== */
+
+static UplinkRecord ring[UPLINK_RING_RECORDS];
+static uint32_t head;                  // Sequence number of the next record written
+
+static UplinkSink sinks[UPLINK_MAX_TRANSPORTS];
+static int sink_count;
+
+static absolute_time_t last_record;
+
+static size_t link_max_payload;        // Batch cap from the link monitor
+static bool link_compress;
+
+/* ========== PRIVATE FUNCTIONS ========== */
+
+static void set_field(UplinkRecord *rec, UplinkField field, bool ok, float value, float scale) {
+    if (ok && !isnan(value)) {
+        rec->value[field] = (int32_t)lroundf(value * scale);
+        rec->valid |= 1u << field;
+    }
+}
+
+/**
+ * @brief Oldest sequence number still held by the ring
+ */
+static uint32_t oldest(void) {
+    return head > UPLINK_RING_RECORDS ? head - UPLINK_RING_RECORDS : 0;
+}
+
+/**
+ * @brief Fill @p rec from one acquisition
+ */
+static void fill_record(UplinkRecord *rec, const SensorData *sensors, absolute_time_t timestamp) {
+    PowerStatus power;
+    power_manager_get_status(&power);
+
+    *rec = (UplinkRecord){ .time_us = to_us_since_boot(timestamp) };
+    set_field(rec, FIELD_TEMPERATURE, sensors->aht_ok, sensors->temperature, 100.0f);
+    set_field(rec, FIELD_HUMIDITY, sensors->aht_ok, sensors->humidity, 100.0f);
+    set_field(rec, FIELD_LUX, sensors->lux_ok, sensors->lux, 10.0f);
+    set_field(rec, FIELD_PH, sensors->probes_ok, sensors->ph, 100.0f);
+    set_field(rec, FIELD_EC, sensors->probes_ok, sensors->ec, 1000.0f);
+    set_field(rec, FIELD_LEVEL, sensors->probes_ok, sensors->water_level, 10.0f);
+    set_field(rec, FIELD_WATER_TEMPERATURE, sensors->water_temp_ok, sensors->water_temperature, 100.0f);
+    set_field(rec, FIELD_FLOW, sensors->pulses_ok, sensors->flow_lpm, 1000.0f);
+    set_field(rec, FIELD_VOLUME, sensors->pulses_ok, sensors->flow_total_l, 10.0f);
+    set_field(rec, FIELD_PUMP_RPM, sensors->pulses_ok, sensors->pump_rpm, 1.0f);
+    set_field(rec, FIELD_CO2, sensors->co2_ok, sensors->co2_ppm, 1.0f);
+    set_field(rec, FIELD_VSYS, power.vsys_mv > 0, (float)power.vsys_mv, 1.0f);
+    set_field(rec, FIELD_BATTERY, power.source == POWER_SOURCE_BATTERY, power.battery_pct, 1.0f);
+}
+
+/**
+ * @brief Append one line for @p rec to @p buf
+ *
+ * @param timed Whether to end the line with @p unix_us (else the server stamps it)
+ * @return Line length, or 0 if it does not fit in @p size
+ */
+static size_t format_line(const UplinkRecord *rec, bool timed, int64_t unix_us, char *buf, size_t size) {
+    int len = snprintf(buf, size, "%s,device=%s", UPLINK_MEASUREMENT, UPLINK_DEVICE_TAG);
+    char sep = ' ';
+    for (int f = 0; f < FIELD_COUNT && len >= 0 && (size_t)len < size; f++) {
+        if (rec->valid & (1u << f)) {
+            len += snprintf(buf + len, size - len, "%c%s=%ldi", sep, field_names[f], (long)rec->value[f]);
+            sep = ',';
+        }
+    }
+    if (len >= 0 && (size_t)len < size) {
+        len += timed ? snprintf(buf + len, size - len, " %lld\n", (long long)unix_us * 1000)
+                     : snprintf(buf + len, size - len, "\n");
+    }
+    return len >= 0 && (size_t)len < size ? (size_t)len : 0;
+}
+
+/**
+ * @brief Hand one batch to the transport, compressed if it asks for it
+ *
+ * Falls back to the plain batch when no second buffer is free or the
+ * compressed form is not smaller.
+ */
+static bool send_batch(UplinkSink *sink, const uint8_t *batch, size_t len, size_t capacity) {
+    const UplinkTransport *t = sink->transport;
+    bool compress = t->compress == UPLINK_COMPRESS_ALWAYS ||
+                    (t->compress == UPLINK_COMPRESS_DEGRADED_LINK && link_compress);
+    uint8_t *packed = compress ? mem_pool_alloc(&batch_pool) : NULL;
+    if (packed == NULL) {
+        return t->send(batch, len);
+    }
+
+    uint64_t start = time_us_64();
+    size_t packed_len = lzss_compress(batch, len, packed, len < capacity ? len : capacity);
+    uint64_t cycles = (time_us_64() - start) * (clock_get_hz(clk_sys) / 1000000);
+
+    bool sent;
+    if (packed_len > 0) {
+        printf("Lote %s: %u -> %u bytes (%.2f:1), %lu ciclos/byte\n", t->name, (unsigned)len,
+               (unsigned)packed_len, (double)len / packed_len, (unsigned long)(cycles / len));
+        sent = t->send(packed, packed_len);
+        if (sent) {
+            sink->compressed++;
+            sink->raw_bytes += len;
+            sink->wire_bytes += packed_len;
+            sink->encode_cycles += cycles;
+        }
+    } else {
+        sent = t->send(batch, len); // Incompressible: plain batch
+    }
+    mem_pool_free(&batch_pool, packed);
+    return sent;
+}
+
+/**
+ * @brief Send what @p sink has pending, one payload at a time
+ *
+ * @param offset_us Unix time minus boot time (µs)
+ */
+static void flush_sink(UplinkSink *sink, int64_t offset_us) {
+    const UplinkTransport *t = sink->transport;
+    size_t capacity = t->max_payload < BATCH_BUF_SIZE ? t->max_payload : BATCH_BUF_SIZE;
+    if (capacity > link_max_payload) {
+        capacity = link_max_payload; // Short frames on a weak link
+    }
+
+    if (sink->next < oldest()) {
+        sink->dropped += oldest() - sink->next;
+        sink->next = oldest();
+    }
+
+    for (int batch = 0; batch < UPLINK_MAX_BATCHES_PER_FLUSH && sink->next != head; batch++) {
+        if (!t->ready()) {
+            return;
+        }
+        char *buf = mem_pool_alloc(&batch_pool);
+        if (buf == NULL) {
+            return; // Both batch buffers busy - next flush
+        }
+
+        size_t len = 0;
+        uint32_t seq = sink->next;
+        while (seq != head) {
+            const UplinkRecord *rec = &ring[seq % UPLINK_RING_RECORDS];
+            size_t line = format_line(rec, true, (int64_t)rec->time_us + offset_us, buf + len, capacity - len);
+            if (line == 0) {
+                break;
+            }
+            len += line;
+            seq++;
+        }
+
+        bool sent = len > 0 && send_batch(sink, (const uint8_t *)buf, len, capacity);
+        mem_pool_free(&batch_pool, buf);
+
+        if (len == 0) {
+            sink->next++; // A single line larger than the payload: never sendable
+            sink->dropped++;
+        } else if (sent) {
+            sink->records += seq - sink->next;
+            sink->batches++;
+            sink->next = seq;
+        } else {
+            sink->failures++;
+            return; // Kept for the next flush
+        }
+    }
+}
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+void uplink_init(void) {
+    head = 0;
+    sink_count = 0;
+    last_record = nil_time;
+    link_max_payload = BATCH_BUF_SIZE;
+    link_compress = false;
+}
+
+/**
+ * @brief Register a transport; it receives records from now on
+ *
+ * @return false if UPLINK_MAX_TRANSPORTS are already registered
+ */
+bool uplink_add_transport(const UplinkTransport *transport) {
+    if (sink_count >= UPLINK_MAX_TRANSPORTS) {
+        return false;
+    }
+    sinks[sink_count++] = (UplinkSink){ .transport = transport, .next = head };
+    return true;
+}
+
+/**
+ * @brief Queue a sample (at most one per UPLINK_RECORD_INTERVAL_MS is kept)
+ *
+ * @param sensors Readings of the cycle
+ * @param timestamp Acquisition time of the cycle
+ */
+void uplink_record(const SensorData *sensors, absolute_time_t timestamp) {
+    if (sink_count == 0) {
+        return;
+    }
+    if (!is_nil_time(last_record) &&
+        absolute_time_diff_us(last_record, timestamp) < (int64_t)UPLINK_RECORD_INTERVAL_MS * 1000) {
+        return;
+    }
+    last_record = timestamp;
+
+    fill_record(&ring[head % UPLINK_RING_RECORDS], sensors, timestamp);
+    head++;
+}
+
+/**
+ * @brief Send pending records on every transport that is ready
+ *
+ * Called every UPLINK_FLUSH_INTERVAL_MS (stretched by the power policy, so
+ * batches grow and radio wake-ups thin out as the battery drains).
+ */
+void uplink_flush(void) {
+    int64_t offset_us;
+    if (!wall_clock_at_us(from_us_since_boot(0), &offset_us)) {
+        return; // No wall clock yet: keep everything
+    }
+    for (int i = 0; i < sink_count; i++) {
+        flush_sink(&sinks[i], offset_us);
+    }
+}
+
+/**
+ * @brief Batch size cap and compression for the current link quality
+ *
+ * Set by the link monitor; applies from the next batch on.
+ *
+ * @param max_payload Payload cap for every transport (bytes)
+ * @param compress Compress on UPLINK_COMPRESS_DEGRADED_LINK transports
+ */
+void uplink_set_link_policy(size_t max_payload, bool compress) {
+    link_max_payload = max_payload;
+    link_compress = compress;
+}
+
+/**
+ * @brief Format one sample as a single line-protocol line, outside the ring
+ *
+ * Used by the MQTT fan-out for sessions that take every acquisition as
+ * line protocol. The timestamp is left out until the wall clock is set.
+ *
+ * @return Line length, or 0 if it does not fit in @p size
+ */
+size_t uplink_format_sample(const SensorData *sensors, absolute_time_t timestamp, char *buf, size_t size) {
+    UplinkRecord rec;
+    fill_record(&rec, sensors, timestamp);
+    int64_t unix_us = 0;
+    bool timed = wall_clock_at_us(timestamp, &unix_us);
+    return format_line(&rec, timed, unix_us, buf, size);
+}
+
+void uplink_print_stats(void) {
+    for (int i = 0; i < sink_count; i++) {
+        const UplinkSink *sink = &sinks[i];
+        printf("[uplink] %s: %lu registros em %lu lotes, %lu pendentes, %lu perdidos, %lu falhas de envio\n",
+               sink->transport->name, (unsigned long)sink->records, (unsigned long)sink->batches,
+               (unsigned long)(head - (sink->next > oldest() ? sink->next : oldest())),
+               (unsigned long)sink->dropped, (unsigned long)sink->failures);
+        if (sink->compressed > 0) {
+            printf("[uplink] %s: %lu lotes comprimidos, %llu -> %llu bytes (%.2f:1), %lu ciclos/byte, "
+                   "%u bytes de RAM no codificador\n",
+                   sink->transport->name, (unsigned long)sink->compressed,
+                   (unsigned long long)sink->raw_bytes, (unsigned long long)sink->wire_bytes,
+                   (double)sink->raw_bytes / sink->wire_bytes,
+                   (unsigned long)(sink->encode_cycles / sink->raw_bytes), (unsigned)lzss_working_memory());
+        }
+    }
+}
@@ -0,0 +1,398 @@
+/**
+ * @file usb_disk.c
+ * @brief Read-only virtual FAT12 volume exposing the flash history over USB MSC
+ *
+ * Nothing is staged in RAM: every sector the host reads (boot sector, FAT,
+ * root directory, file data) is rendered on demand into the 512-byte MSC
+ * transfer buffer. Files:
+ *
+ * - history.csv: one fixed-width row per flash log record, so the byte offset
+ *   requested by the host maps directly to a record number;
+ * - stats.json: runtime state rendered at the moment it is read.
+ *
+ * Layout (512-byte sectors, 4KB clusters, 8192 sectors = 4MB):
+ *
+ *   LBA 0     boot sector
+ *   LBA 1-4   FAT (single copy)
+ *   LBA 5     root directory (16 entries)
+ *   LBA 6-    data: cluster 2 = stats.json, clusters 3.. = history.csv
+ *
+ * Callbacks run from the stdio_usb background IRQ on core 0 and only read
+ * XIP flash and lock-free state, so they never wait on the application.
+ */
+
+#include "usb_disk.h"
+#include "tusb.h"
+#include "app.h"
+#include "app_config.h"
+#include "flash_log.h"
+#include "state_snapshot.h"
+#include <stdio.h>
+#include <string.h>
+
+/* ========== VOLUME GEOMETRY ========== */
+
+#define SECTOR_SIZE 512
+#define SECTORS_PER_CLUSTER 8
+#define CLUSTER_SIZE (SECTOR_SIZE * SECTORS_PER_CLUSTER)
+#define TOTAL_SECTORS 8192
+#define FAT_LBA 1
+#define FAT_SECTORS 4
+#define ROOT_LBA (FAT_LBA + FAT_SECTORS)
+#define ROOT_ENTRIES 16
+#define DATA_LBA (ROOT_LBA + 1)
+#define CLUSTER_COUNT ((TOTAL_SECTORS - DATA_LBA) / SECTORS_PER_CLUSTER)
+
+#define STATS_CLUSTER 2
+#define STATS_SIZE SECTOR_SIZE     // Fixed size, padded with spaces
+#define HISTORY_CLUSTER 3
+
+// history.csv rows: seq,tempo_s,relogio_real,temperatura_c,umidade_pct,lux,aht_ok,lux_ok,alertas
+#define ROW_LEN 52
+static const char HISTORY_HEADER[] =
+    "seq,tempo_s,relogio_real,temperatura_c,umidade_pct,lux,aht_ok,lux_ok,alertas\r\n";
+#define HEADER_LEN (sizeof(HISTORY_HEADER) - 1)
+
+#define HISTORY_MAX_SIZE (HEADER_LEN + (FLASH_LOG_SIZE / sizeof(FlashLogRecord)) * ROW_LEN)
+_Static_assert(CLUSTER_COUNT < 4085, "volume must stay FAT12");
+_Static_assert(HISTORY_CLUSTER + (HISTORY_MAX_SIZE + CLUSTER_SIZE - 1) / CLUSTER_SIZE <= CLUSTER_COUNT + 2,
+               "virtual volume too small for the flash log");
+_Static_assert((CLUSTER_COUNT + 2) * 3 / 2 <= FAT_SECTORS * SECTOR_SIZE, "FAT too small");
+
+// Fixed file date (FAT format): 2025-01-01 00:00
+#define FAT_DATE (((2025 - 1980) << 9) | (1 << 5) | 1)
+
+/* ========== PRIVATE VARIABLES ========== */
+
+// Record range shown by history.csv, frozen at mount
+static uint32_t disk_first_seq;
+static uint32_t disk_records;
+
+static uint8_t sector_buffer[SECTOR_SIZE]; // Rendered sector (partial transfers)
+
+/* ========== PRIVATE FUNCTIONS ========== */
+
+static void put_le16(uint8_t *dst, uint16_t value) {
+    dst[0] = value & 0xFF;
+    dst[1] = value >> 8;
+}
+
+static void put_le32(uint8_t *dst, uint32_t value) {
+    put_le16(dst, value & 0xFFFF);
+    put_le16(dst + 2, value >> 16);
+}
+
+/**
+ * @brief Right-aligned unsigned decimal, space padded
+ */
+static void put_uint(char *dst, uint32_t value, int width) {
+    for (int i = width - 1; i >= 0; i--) {
+        dst[i] = (value != 0 || i == width - 1) ? (char)('0' + value % 10) : ' ';
+        value /= 10;
+    }
+}
+
+/**
+ * @brief Right-aligned fixed-point value with two decimals (value x 100)
+ */
+static void put_fixed2(char *dst, int32_t value_c100, int width) {
+    uint32_t magnitude = value_c100 < 0 ? -value_c100 : value_c100;
+    dst[width - 1] = '0' + magnitude % 10;
+    dst[width - 2] = '0' + (magnitude / 10) % 10;
+    dst[width - 3] = '.';
+    put_uint(dst, magnitude / 100, width - 3);
+
+    if (value_c100 < 0) {
+        int first = 0;
+        while (first < width - 3 && dst[first] == ' ') {
+            first++;
+        }
+        if (first > 0) {
+            dst[first - 1] = '-';
+        }
+    }
+}
+
+static uint32_t history_size(void) {
+    return HEADER_LEN + disk_records * ROW_LEN;
+}
+
+static uint32_t history_clusters(void) {
+    return (history_size() + CLUSTER_SIZE - 1) / CLUSTER_SIZE;
+}
+
+/**
+ * @brief FAT12 entry n: both files are single contiguous chains
+ */
+static uint16_t fat_entry(uint32_t n) {
+    uint32_t history_end = HISTORY_CLUSTER + history_clusters();
+
+    if (n == 0) return 0xFF8;                   // Media descriptor
+    if (n == 1) return 0xFFF;                   // Reserved
+    if (n == STATS_CLUSTER) return 0xFFF;       // stats.json: one cluster
+    if (n >= HISTORY_CLUSTER && n < history_end) {
+        return (n + 1 == history_end) ? 0xFFF : (uint16_t)(n + 1);
+    }
+    return 0x000;                               // Free
+}
+
+static void render_boot_sector(uint8_t *buf) {
+    static const uint8_t jump[3] = {0xEB, 0x3C, 0x90};
+
+    memcpy(&buf[0], jump, 3);
+    memcpy(&buf[3], "MSDOS5.0", 8);
+    put_le16(&buf[11], SECTOR_SIZE);
+    buf[13] = SECTORS_PER_CLUSTER;
+    put_le16(&buf[14], FAT_LBA);        // Reserved sectors
+    buf[16] = 1;                        // Number of FATs
+    put_le16(&buf[17], ROOT_ENTRIES);
+    put_le16(&buf[19], TOTAL_SECTORS);
+    buf[21] = 0xF8;                     // Fixed disk
+    put_le16(&buf[22], FAT_SECTORS);
+    put_le16(&buf[24], 1);              // Sectors per track
+    put_le16(&buf[26], 1);              // Heads
+    buf[36] = 0x80;                     // Drive number
+    buf[38] = 0x29;                     // Extended boot signature
+    put_le32(&buf[39], 0x534D4156);     // Volume serial ("SMAV")
+    memcpy(&buf[43], USB_DISK_LABEL, 11);
+    memcpy(&buf[54], "FAT12   ", 8);
+    buf[510] = 0x55;
+    buf[511] = 0xAA;
+}
+
+static void render_fat_sector(uint32_t index, uint8_t *buf) {
+    // Two 12-bit entries are packed in every 3 bytes
+    for (uint32_t i = 0; i < SECTOR_SIZE; i++) {
+        uint32_t offset = index * SECTOR_SIZE + i;
+        uint16_t even = fat_entry((offset / 3) * 2);
+        uint16_t odd = fat_entry((offset / 3) * 2 + 1);
+
+        switch (offset % 3) {
+            case 0: buf[i] = even & 0xFF; break;
+            case 1: buf[i] = (uint8_t)((even >> 8) | ((odd & 0x0F) << 4)); break;
+            default: buf[i] = (uint8_t)(odd >> 4); break;
+        }
+    }
+}
+
+static void render_dir_entry(uint8_t *entry, const char name[11], uint8_t attr, uint8_t case_flags,
+                             uint16_t cluster, uint32_t size) {
+    memcpy(&entry[0], name, 11);
+    entry[11] = attr;
+    entry[12] = case_flags;             // 0x08/0x10: show base name/extension in lowercase
+    put_le16(&entry[16], FAT_DATE);     // Creation date
+    put_le16(&entry[18], FAT_DATE);     // Access date
+    put_le16(&entry[24], FAT_DATE);     // Write date
+    put_le16(&entry[26], cluster);
+    put_le32(&entry[28], size);
+}
+
+/**
+ * @brief Single long-file-name entry (names up to 13 characters)
+ */
+static void render_lfn_entry(uint8_t *entry, const char *long_name, const char short_name[11]) {
+    static const uint8_t char_offsets[13] = {1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30};
+    size_t len = strlen(long_name);
+
+    uint8_t checksum = 0;
+    for (int i = 0; i < 11; i++) {
+        checksum = (uint8_t)(((checksum & 1) << 7) + (checksum >> 1) + (uint8_t)short_name[i]);
+    }
+
+    entry[0] = 0x41;                    // First and last (only) LFN entry
+    entry[11] = 0x0F;                   // LFN attribute
+    entry[13] = checksum;
+    for (size_t i = 0; i < 13; i++) {
+        uint16_t c = i < len ? (uint8_t)long_name[i] : (i == len ? 0x0000 : 0xFFFF);
+        put_le16(&entry[char_offsets[i]], c);
+    }
+}
+
+static void render_root_dir(uint8_t *buf) {
+    render_dir_entry(&buf[0], USB_DISK_LABEL, 0x08, 0x00, 0, 0);
+    render_lfn_entry(&buf[32], "stats.json", "STATS~1 JSO");
+    render_dir_entry(&buf[64], "STATS~1 JSO", 0x01, 0x00, STATS_CLUSTER, STATS_SIZE);
+    render_dir_entry(&buf[96], "HISTORY CSV", 0x01, 0x18, HISTORY_CLUSTER, history_size());
+}
+
+static void render_stats(uint8_t *buf) {
+    StateSnapshot snap;
+    state_snapshot_read(&snap);
+
+    int len = snprintf((char *)buf, SECTOR_SIZE,
+        "{\n"
+        "  \"uptime_s\": %lu,\n"
+        "  \"historico\": {\"registros\": %lu, \"capacidade\": %lu, "
+        "\"primeiro_seq\": %lu, \"proximo_seq\": %lu, \"intervalo_s\": %u},\n"
+        "  \"ultima_leitura\": {\"temperatura\": %.2f, \"umidade\": %.2f, "
+        "\"luminosidade\": %.2f, \"aht_ok\": %s, \"lux_ok\": %s},\n"
+        "  \"alertas\": {\"temperatura\": %s, \"umidade\": %s, \"luz\": %s},\n"
+        "  \"wifi_conectado\": %s\n"
+        "}",
+        (unsigned long)(to_ms_since_boot(get_absolute_time()) / 1000),
+        (unsigned long)(flash_log_next_seq() - flash_log_first_seq()),
+        (unsigned long)flash_log_capacity(),
+        (unsigned long)flash_log_first_seq(), (unsigned long)flash_log_next_seq(),
+        FLASH_LOG_INTERVAL_MS / 1000,
+        snap.sensors.temperature, snap.sensors.humidity, snap.sensors.lux,
+        snap.sensors.aht_ok ? "true" : "false", snap.sensors.lux_ok ? "true" : "false",
+        snap.alerts.temp_critical ? "true" : "false",
+        snap.alerts.humidity_critical ? "true" : "false",
+        snap.alerts.lux_critical ? "true" : "false",
+        app_state.wifi.connected ? "true" : "false");
+
+    // Fixed file size declared in the directory: pad with spaces
+    if (len < 0 || len > STATS_SIZE - 1) {
+        len = STATS_SIZE - 1;
+    }
+    memset(&buf[len], ' ', STATS_SIZE - 1 - len);
+    buf[STATS_SIZE - 1] = '\n';
+}
+
+static void render_history_row(uint32_t row, char *dst) {
+    uint32_t seq = disk_first_seq + row;
+    FlashLogRecord record;
+
+    memset(dst, ' ', ROW_LEN);
+    // Column separators at fixed positions
+    static const uint8_t commas[] = {10, 21, 23, 31, 38, 44, 46, 48};
+    for (uint i = 0; i < sizeof(commas); i++) {
+        dst[commas[i]] = ',';
+    }
+    dst[ROW_LEN - 2] = '\r';
+    dst[ROW_LEN - 1] = '\n';
+
+    put_uint(&dst[0], seq, 10);
+    if (!flash_log_read(seq, &record)) {
+        return; // Overwritten since the volume was mounted: keep the row blank
+    }
+
+    put_uint(&dst[11], record.time_s, 10);
+    dst[22] = (record.flags & FLASH_LOG_FLAG_WALL_CLOCK) ? '1' : '0';
+    put_fixed2(&dst[24], record.temperature_c100, 7);
+    put_fixed2(&dst[32], record.humidity_c100, 6);
+    put_uint(&dst[39], record.lux, 5);
+    dst[45] = (record.flags & FLASH_LOG_FLAG_AHT_OK) ? '1' : '0';
+    dst[47] = (record.flags & FLASH_LOG_FLAG_LUX_OK) ? '1' : '0';
+    dst[49] = '0' + ((record.flags >> 2) & 0x07); // bit0 temp, bit1 umidade, bit2 luz
+}
+
+/**
+ * @brief Render bytes [offset, offset + SECTOR_SIZE) of history.csv
+ */
+static void render_history(uint32_t offset, uint8_t *buf) {
+    uint32_t end = history_size();
+    uint32_t pos = 0;
+    char row_text[ROW_LEN];
+
+    while (pos < SECTOR_SIZE && offset + pos < end) {
+        uint32_t file_pos = offset + pos;
+        uint32_t chunk;
+
+        if (file_pos < HEADER_LEN) {
+            chunk = HEADER_LEN - file_pos;
+            if (chunk > SECTOR_SIZE - pos) chunk = SECTOR_SIZE - pos;
+            memcpy(&buf[pos], &HISTORY_HEADER[file_pos], chunk);
+        } else {
+            uint32_t row = (file_pos - HEADER_LEN) / ROW_LEN;
+            uint32_t in_row = (file_pos - HEADER_LEN) % ROW_LEN;
+            render_history_row(row, row_text);
+            chunk = ROW_LEN - in_row;
+            if (chunk > SECTOR_SIZE - pos) chunk = SECTOR_SIZE - pos;
+            memcpy(&buf[pos], &row_text[in_row], chunk);
+        }
+        pos += chunk;
+    }
+}
+
+static void render_sector(uint32_t lba, uint8_t *buf) {
+    memset(buf, 0, SECTOR_SIZE);
+
+    if (lba == 0) {
+        render_boot_sector(buf);
+    } else if (lba < ROOT_LBA) {
+        render_fat_sector(lba - FAT_LBA, buf);
+    } else if (lba == ROOT_LBA) {
+        render_root_dir(buf);
+    } else if (lba < TOTAL_SECTORS) {
+        uint32_t cluster = (lba - DATA_LBA) / SECTORS_PER_CLUSTER + 2;
+        uint32_t in_cluster = ((lba - DATA_LBA) % SECTORS_PER_CLUSTER) * SECTOR_SIZE;
+
+        if (cluster == STATS_CLUSTER && in_cluster == 0) {
+            render_stats(buf);
+        } else if (cluster >= HISTORY_CLUSTER) {
+            render_history((cluster - HISTORY_CLUSTER) * CLUSTER_SIZE + in_cluster, buf);
+        }
+    }
+}
+
+/* ========== TINYUSB CALLBACKS ========== */
+
+/**
+ * @brief Device configured by the host: freeze the record range shown
+ */
+void tud_mount_cb(void) {
+    disk_first_seq = flash_log_first_seq();
+    disk_records = flash_log_next_seq() - disk_first_seq;
+}
+
+void tud_msc_inquiry_cb(uint8_t lun, uint8_t vendor_id[8], uint8_t product_id[16], uint8_t product_rev[4]) {
+    memcpy(vendor_id, "EmbTech ", 8);
+    memcpy(product_id, "SMAVHIoT Hist   ", 16);
+    memcpy(product_rev, "0.1 ", 4);
+}
+
+bool tud_msc_test_unit_ready_cb(uint8_t lun) {
+    return true;
+}
+
+void tud_msc_capacity_cb(uint8_t lun, uint32_t *block_count, uint16_t *block_size) {
+    *block_count = TOTAL_SECTORS;
+    *block_size = SECTOR_SIZE;
+}
+
+bool tud_msc_start_stop_cb(uint8_t lun, uint8_t power_condition, bool start, bool load_eject) {
+    return true;
+}
+
+bool tud_msc_is_writable_cb(uint8_t lun) {
+    return false;
+}
+
+int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void *buffer, uint32_t bufsize) {
+    uint8_t *out = buffer;
+    uint32_t done = 0;
+
+    while (done < bufsize) {
+        uint32_t sector = lba + (offset + done) / SECTOR_SIZE;
+        uint32_t in_sector = (offset + done) % SECTOR_SIZE;
+        uint32_t chunk = SECTOR_SIZE - in_sector;
+        if (chunk > bufsize - done) {
+            chunk = bufsize - done;
+        }
+
+        if (in_sector == 0 && chunk == SECTOR_SIZE) {
+            render_sector(sector, &out[done]);
+        } else {
+            render_sector(sector, sector_buffer);
+            memcpy(&out[done], &sector_buffer[in_sector], chunk);
+        }
+        done += chunk;
+    }
+    return (int32_t)bufsize;
+}
+
+int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t *buffer, uint32_t bufsize) {
+    tud_msc_set_sense(lun, SCSI_SENSE_DATA_PROTECT, 0x27, 0x00); // Write protected
+    return -1;
+}
+
+int32_t tud_msc_scsi_cb(uint8_t lun, const uint8_t scsi_cmd[16], void *buffer, uint16_t bufsize) {
+    switch (scsi_cmd[0]) {
+        case SCSI_CMD_PREVENT_ALLOW_MEDIUM_REMOVAL:
+            return 0; // Nothing to lock: the volume is virtual
+        default:
+            tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x20, 0x00); // Invalid command
+            return -1;
+    }
+}
@@ -0,0 +1,150 @@
+/**
+ * @file usb_stream.c
+ * @brief Binary sample streaming over USB CDC (commissioning mode)
+ *
+ * While streaming, the stdio USB driver is disabled so console printf output
+ * cannot interleave with frames. Frames still go through the driver's own
+ * out_chars()/in_chars() (called directly, not through stdio): they hold
+ * stdio_usb's mutex around TinyUSB, and the background IRQ that runs
+ * tud_task() skips its pass while that mutex is taken. TinyUSB's FIFOs are
+ * not re-entrant, so the CDC FIFO must never be touched outside that lock.
+ * Call every function here from core 0 (the core servicing USB).
+ *
+ * Flow control: a frame is only queued when the FIFO has room for all of it.
+ * Otherwise it is dropped and its sequence number is skipped, so the host
+ * sees the gap instead of a torn frame.
+ */
+
+#include "usb_stream.h"
+#include "app_config.h"
+#include "pico/stdio_usb.h"
+#include "pico/stdio/driver.h"
+#include "tusb.h"
+#include <stdio.h>
+#include <stddef.h>
+
+/* ========== PRIVATE VARIABLES ========== */
+
+static bool streaming;       // Binary mode active
+static uint32_t next_seq;    // Sequence number of the next frame
+static uint32_t frames_sent; // Frames queued in the current session
+static uint32_t frames_dropped; // Frames skipped for lack of FIFO space
+
+/* ========== PRIVATE FUNCTIONS ========== */
+
+/**
+ * @brief CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+ */
+static uint16_t crc16_ccitt(const uint8_t *data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    while (len--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void stream_start(void) {
+    printf("Streaming binario USB iniciado\n");
+    stdio_flush();
+    stdio_set_driver_enabled(&stdio_usb, false);
+
+    next_seq = 0;
+    frames_sent = 0;
+    frames_dropped = 0;
+    streaming = true;
+}
+
+static void stream_stop(void) {
+    streaming = false;
+    stdio_set_driver_enabled(&stdio_usb, true);
+
+    printf("Streaming binario USB encerrado: %lu quadros, %lu descartados\n",
+           (unsigned long)frames_sent, (unsigned long)frames_dropped);
+}
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Process host commands and detect a closed port
+ *
+ * Call once per scheduling pass; it never blocks.
+ */
+void usb_stream_poll(void) {
+    char cmd;
+    while (stdio_usb.in_chars(&cmd, 1) == 1) {
+        if (cmd == USB_STREAM_CMD_START && !streaming) {
+            stream_start();
+        } else if (cmd == USB_STREAM_CMD_STOP && streaming) {
+            stream_stop();
+        }
+    }
+
+    // Host closed the port (DTR dropped): return to console mode
+    if (streaming && !tud_cdc_connected()) {
+        stream_stop();
+    }
+}
+
+/**
+ * @brief Whether the host requested binary streaming
+ *
+ * Callers use this to switch acquisition to STREAM_INTERVAL_MS and to skip
+ * console formatting nobody would see.
+ */
+bool usb_stream_active(void) {
+    return streaming;
+}
+
+/**
+ * @brief Encode one acquisition and queue it on the CDC port
+ *
+ * No-op when streaming is off.
+ *
+ * @param sensors Converted readings
+ * @param raw Uncalibrated codes of the same acquisition
+ * @param timestamp Acquisition time
+ */
+void usb_stream_send_sample(const SensorData *sensors, const SensorRaw *raw, absolute_time_t timestamp) {
+    if (!streaming) {
+        return;
+    }
+
+    UsbStreamFrame frame = {
+        .sync = {USB_STREAM_SYNC0, USB_STREAM_SYNC1},
+        .type = USB_STREAM_TYPE_SAMPLE,
+        .length = sizeof(UsbStreamFrame) - offsetof(UsbStreamFrame, seq) - sizeof(frame.crc),
+        .seq = next_seq++,
+        .timestamp_us = to_us_since_boot(timestamp),
+        .raw_temp = raw->temperature,
+        .raw_humidity = raw->humidity,
+        .raw_lux = raw->lux,
+        .flags = (sensors->aht_ok ? USB_STREAM_FLAG_AHT_OK : 0) |
+                 (sensors->lux_ok ? USB_STREAM_FLAG_LUX_OK : 0) |
+                 (sensors->probes_ok ? USB_STREAM_FLAG_PROBES_OK : 0),
+        .temperature = sensors->temperature,
+        .humidity = sensors->humidity,
+        .lux = sensors->lux,
+        .raw_ph = raw->ph,
+        .raw_ec = raw->ec,
+        .raw_level = raw->water_level,
+        .ph = sensors->ph,
+        .ec = sensors->ec,
+        .level = sensors->water_level,
+    };
+    frame.crc = crc16_ccitt(&frame.type, offsetof(UsbStreamFrame, crc) - offsetof(UsbStreamFrame, type));
+
+    // Never queue a partial frame: drop it whole and leave the gap in seq.
+    // Unlocked read, but only the USB task changes it meanwhile, and only
+    // by draining: the room seen here is still there in out_chars()
+    if (tud_cdc_write_available() < sizeof(frame)) {
+        frames_dropped++;
+        return;
+    }
+
+    // Written and flushed under stdio_usb's mutex (no CR/LF translation here)
+    stdio_usb.out_chars((const char *)&frame, sizeof(frame));
+    frames_sent++;
+}
@@ -0,0 +1,124 @@
+/**
+ * @file wall_clock.c
+ * @brief Wall-clock time kept from SNTP on top of the microsecond timer
+ *
+ * lwIP's SNTP client (started once WiFi is up) calls wall_clock_set_unix()
+ * through SNTP_SET_SYSTEM_TIME_US (see lwipopts.h). Only the offset between
+ * Unix time and time_us_64() is stored, so reading the clock costs no I/O
+ * and is safe from any core or interrupt handler (the climate control loop
+ * on core 1 uses it for the photoperiod).
+ */
+
+#include "wall_clock.h"
+#include "app_config.h"
+#include "pico/cyw43_arch.h"
+#include "pico/critical_section.h"
+#include "lwip/apps/sntp.h"
+#include <stdio.h>
+
+/* ========== PRIVATE VARIABLES ========== */
+
+static critical_section_t clock_lock;  // 64-bit offset written by lwIP, read by core 1
+static int64_t unix_offset_us;         // Unix time (µs) minus time_us_64()
+static bool synced;                    // At least one SNTP answer received
+static bool sntp_started;
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+void wall_clock_init(void) {
+    critical_section_init(&clock_lock);
+}
+
+/**
+ * @brief Start periodic SNTP synchronization (once, after the first WiFi join)
+ */
+void wall_clock_start_sntp(void) {
+    if (sntp_started) {
+        return;
+    }
+
+    cyw43_arch_lwip_begin();
+    sntp_setoperatingmode(SNTP_OPMODE_POLL);
+    sntp_setservername(0, NTP_SERVER);
+    sntp_init();
+    cyw43_arch_lwip_end();
+
+    sntp_started = true;
+    printf("SNTP iniciado (%s)\n", NTP_SERVER);
+}
+
+/**
+ * @brief SNTP hook: set the current Unix time (runs in lwIP context)
+ *
+ * @param unix_s Seconds since 1970-01-01 UTC
+ * @param us Microseconds within the second
+ */
+void wall_clock_set_unix(uint32_t unix_s, uint32_t us) {
+    int64_t offset = (int64_t)unix_s * 1000000 + us - (int64_t)time_us_64();
+
+    critical_section_enter_blocking(&clock_lock);
+    unix_offset_us = offset;
+    synced = true;
+    critical_section_exit(&clock_lock);
+}
+
+/**
+ * @brief Unix time corresponding to a local timer timestamp
+ *
+ * @param t Timestamp from get_absolute_time()
+ * @param unix_s Seconds since 1970-01-01 UTC
+ * @return false until SNTP has synchronized once
+ */
+bool wall_clock_at(absolute_time_t t, uint32_t *unix_s) {
+    int64_t unix_us;
+    if (!wall_clock_at_us(t, &unix_us)) {
+        return false;
+    }
+    *unix_s = (uint32_t)(unix_us / 1000000);
+    return true;
+}
+
+/**
+ * @brief Same as wall_clock_at(), with microsecond resolution
+ *
+ * Timestamps taken before the first synchronization convert correctly once
+ * the clock is set, which the store-and-forward uplink relies on.
+ *
+ * @param unix_us Microseconds since 1970-01-01 UTC
+ */
+bool wall_clock_at_us(absolute_time_t t, int64_t *unix_us) {
+    critical_section_enter_blocking(&clock_lock);
+    bool valid = synced;
+    int64_t offset = unix_offset_us;
+    critical_section_exit(&clock_lock);
+
+    if (valid) {
+        *unix_us = (int64_t)to_us_since_boot(t) + offset;
+    }
+    return valid;
+}
+
+/**
+ * @brief Current Unix time
+ */
+bool wall_clock_now(uint32_t *unix_s) {
+    return wall_clock_at(get_absolute_time(), unix_s);
+}
+
+/**
+ * @brief Current local day number and second of the day (TIMEZONE_OFFSET_S)
+ *
+ * @param day Days since 1970-01-01 in local time (changes at local midnight)
+ * @param second_of_day 0..86399
+ */
+bool wall_clock_local(uint32_t *day, uint32_t *second_of_day) {
+    uint32_t unix_s;
+    if (!wall_clock_now(&unix_s)) {
+        return false;
+    }
+
+    uint32_t local = (uint32_t)((int64_t)unix_s + TIMEZONE_OFFSET_S);
+    *day = local / 86400;
+    *second_of_day = local % 86400;
+    return true;
+}
@@ -1,7 +1,7 @@
 #include "ssd1306.h"
 #include "font.h"
+#include "mem_pool.h"
 #include <string.h>
-#include <stdlib.h>
 
 static void ssd1306_send_cmd(ssd1306_t *p, uint8_t cmd) {
     uint8_t buf[2] = {0x00, cmd};
@@ -14,11 +14,11 @@ static void ssd1306_send_cmd_list(ssd1306_t *p, uint8_t *buf, int num) {
 }
 
 static void ssd1306_send_buffer(ssd1306_t *p) {
-    uint8_t *buf = (uint8_t*)malloc(p->bufsize + 1);
+    // The framebuffer is preceded by one reserved byte for the I2C control
+    // byte, so a frame goes out in a single transfer without a copy
+    uint8_t *buf = p->buffer - 1;
     buf[0] = 0x40; // Control byte
-    memcpy(buf + 1, p->buffer, p->bufsize);
     i2c_write_blocking(p->i2c_i, p->address, buf, p->bufsize + 1, false);
-    free(buf);
 }
 
 bool ssd1306_init(ssd1306_t *p, uint16_t width, uint16_t height, uint8_t address, i2c_inst_t *i2c_instance) {
@@ -28,8 +28,10 @@ bool ssd1306_init(ssd1306_t *p, uint16_t width, uint16_t height, uint8_t address
     p->address = address;
     p->i2c_i = i2c_instance;
     p->bufsize = p->pages * p->width;
-    p->buffer = (uint8_t*)malloc(p->bufsize);
-    if (p->buffer == NULL) return false;
+    // Framebuffer lives for the whole run: take it from the static arena
+    uint8_t *buf = (uint8_t*)mem_arena_alloc(p->bufsize + 1);
+    if (buf == NULL) return false;
+    p->buffer = buf + 1;
 
     uint8_t cmds[] = {
         SET_DISP | 0x00, // off
@@ -56,7 +58,8 @@ bool ssd1306_init(ssd1306_t *p, uint16_t width, uint16_t height, uint8_t address
 }
 
 void ssd1306_deinit(ssd1306_t *p) {
-    free(p->buffer);
+    // Arena storage is never returned; just drop the reference
+    p->buffer = NULL;
 }
 
 void ssd1306_show(ssd1306_t *p) {
@@ -0,0 +1,118 @@
+/**
+ * @file usb_descriptors.c
+ * @brief USB descriptors of the CDC + MSC composite device
+ *
+ * Interface 0/1: CDC ACM (console and binary stream, see usb_stream.c)
+ * Interface 2:   MSC, read-only virtual FAT volume (see usb_disk.c)
+ */
+
+#include "tusb.h"
+#include "app_config.h"
+#include "pico/unique_id.h"
+#include <string.h>
+
+/* ========== INTERFACES AND ENDPOINTS ========== */
+
+enum {
+    ITF_NUM_CDC = 0,
+    ITF_NUM_CDC_DATA,
+    ITF_NUM_MSC,
+    ITF_NUM_TOTAL
+};
+
+#define EPNUM_CDC_NOTIF 0x81
+#define EPNUM_CDC_OUT   0x02
+#define EPNUM_CDC_IN    0x82
+#define EPNUM_MSC_OUT   0x03
+#define EPNUM_MSC_IN    0x83
+
+#define CONFIG_TOTAL_LEN (TUD_CONFIG_DESC_LEN + TUD_CDC_DESC_LEN + TUD_MSC_DESC_LEN)
+
+// String descriptor indexes
+enum {
+    STRID_LANGID = 0,
+    STRID_MANUFACTURER,
+    STRID_PRODUCT,
+    STRID_SERIAL,
+    STRID_CDC,
+    STRID_MSC,
+};
+
+/* ========== DEVICE DESCRIPTOR ========== */
+
+static const tusb_desc_device_t device_descriptor = {
+    .bLength = sizeof(tusb_desc_device_t),
+    .bDescriptorType = TUSB_DESC_DEVICE,
+    .bcdUSB = 0x0200,
+
+    // IAD is required for the composite CDC function
+    .bDeviceClass = TUSB_CLASS_MISC,
+    .bDeviceSubClass = MISC_SUBCLASS_COMMON,
+    .bDeviceProtocol = MISC_PROTOCOL_IAD,
+    .bMaxPacketSize0 = CFG_TUD_ENDPOINT0_SIZE,
+
+    .idVendor = USB_VID,
+    .idProduct = USB_PID,
+    .bcdDevice = 0x0100,
+
+    .iManufacturer = STRID_MANUFACTURER,
+    .iProduct = STRID_PRODUCT,
+    .iSerialNumber = STRID_SERIAL,
+    .bNumConfigurations = 1,
+};
+
+static const uint8_t configuration_descriptor[] = {
+    TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, 0x00, 100),
+    TUD_CDC_DESCRIPTOR(ITF_NUM_CDC, STRID_CDC, EPNUM_CDC_NOTIF, 8, EPNUM_CDC_OUT, EPNUM_CDC_IN, 64),
+    TUD_MSC_DESCRIPTOR(ITF_NUM_MSC, STRID_MSC, EPNUM_MSC_OUT, EPNUM_MSC_IN, 64),
+};
+
+static const char *const string_table[] = {
+    [STRID_MANUFACTURER] = "EmbarcaTech",
+    [STRID_PRODUCT] = "SMAVHIoT",
+    [STRID_SERIAL] = NULL, // Board unique ID, filled at runtime
+    [STRID_CDC] = "SMAVHIoT Console",
+    [STRID_MSC] = "SMAVHIoT Historico",
+};
+
+/* ========== TINYUSB CALLBACKS ========== */
+
+const uint8_t *tud_descriptor_device_cb(void) {
+    return (const uint8_t *)&device_descriptor;
+}
+
+const uint8_t *tud_descriptor_configuration_cb(uint8_t index) {
+    return configuration_descriptor;
+}
+
+const uint16_t *tud_descriptor_string_cb(uint8_t index, uint16_t langid) {
+    static uint16_t descriptor[1 + 32];
+    static char serial[2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1];
+    const char *str;
+
+    if (index == STRID_LANGID) {
+        descriptor[1] = 0x0409; // English (US)
+        descriptor[0] = (TUSB_DESC_STRING << 8) | 4;
+        return descriptor;
+    }
+
+    if (index == STRID_SERIAL) {
+        pico_get_unique_board_id_string(serial, sizeof(serial));
+        str = serial;
+    } else if (index < sizeof(string_table) / sizeof(string_table[0]) && string_table[index] != NULL) {
+        str = string_table[index];
+    } else {
+        return NULL;
+    }
+
+    // ASCII to UTF-16LE, truncated to the descriptor buffer
+    size_t len = strlen(str);
+    if (len > 32) {
+        len = 32;
+    }
+    for (size_t i = 0; i < len; i++) {
+        descriptor[1 + i] = (uint8_t)str[i];
+    }
+    descriptor[0] = (uint16_t)((TUSB_DESC_STRING << 8) | (2 * len + 2));
+    return descriptor;
+}
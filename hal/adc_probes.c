@@ -0,0 +1,332 @@
+/**
+ * @file adc_probes.c
+ * @brief Free-running, DMA-oversampled ADC acquisition for the nutrient probes
+ *
+ * The ADC converts ADC0..2 and the internal temperature sensor in round-robin
+ * at ADC_SAMPLE_RATE_HZ per channel. A DMA channel drains the FIFO into a ring
+ * of four blocks; when a block completes, a second DMA channel re-arms the
+ * first immediately, so sampling never depends on interrupt latency.
+ *
+ * The block-complete interrupt decimates the block that was just filled:
+ * each channel's 64 samples are summed (boxcar decimation, +3 bits) and fed
+ * to a first-order low-pass in Q16 ADC counts (+2 more bits of effective
+ * resolution at the default shift). The ring is 64ms deep, so a block that
+ * is overwritten before its interrupt runs (flash erase with interrupts
+ * disabled) is simply skipped instead of corrupting the average. Averaging
+ * also hides the RP2040 ADC DNL spikes (errata RP2040-E11).
+ *
+ * Readings are 16-bit oversampled codes (65536 = ADC_VREF_MV). They convert
+ * to engineering units through a two-point calibration in integer
+ * microvolts; only the final value becomes a float. A running sampler says
+ * nothing about the probes: adc_probes_plausible() rejects a front end
+ * sitting at a rail or a value outside the physical range.
+ *
+ * VSYS (ADC3, GPIO 29) is not in the round-robin: on the Pico W that pin is
+ * also the CYW43 SPI clock. adc_probes_read_vsys_mv() holds the CYW43 lock
+ * (no SPI transfer can start; the driver re-claims the pin for its next
+ * one), pauses the round-robin between two conversions and takes a few
+ * one-shot samples with the FIFO disabled. Round-robin then resumes at the
+ * channel it would have converted next, so ring slot i stays channel i % 4.
+ */
+
+#include "adc_probes.h"
+#include "app_config.h"
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/timer.h"
+#include "pico/critical_section.h"
+#include "pico/cyw43_arch.h"
+#include <stdio.h>
+
+/* ========== ACQUISITION GEOMETRY ========== */
+
+#define ADC_CLOCK_HZ 48000000u
+#define ROUND_ROBIN_MASK 0x17u       // ADC0, ADC1, ADC2, ADC4 (temperature sensor)
+
+#define RING_SAMPLES 1024u
+#define RING_BITS 11                 // log2(ring size in bytes)
+#define BLOCK_SAMPLES 256u           // One DMA transfer = one decimation block
+#define BLOCKS_PER_RING (RING_SAMPLES / BLOCK_SAMPLES)
+#define DECIMATION_SHIFT 6           // log2(BLOCK_SAMPLES / ADC_PROBE_COUNT)
+
+#define ADC_DMA_IRQ DMA_IRQ_1        // DMA_IRQ_0 is left to the CYW43 driver
+#define ADC_DMA_IRQ_INDEX 1
+#define ADC_STALE_US 100000u         // No block for this long = sampler stopped
+
+#ifndef PICO_VSYS_PIN
+#define PICO_VSYS_PIN 29
+#endif
+#define VSYS_ADC_INPUT (PICO_VSYS_PIN - 26)
+#define VSYS_DIVIDER 3               // Pico W: VSYS through 200k/100k
+#define VSYS_SAMPLES 16
+#define VSYS_DISCARD 2               // Conversions thrown away after the pin and input switch
+
+_Static_assert(ADC_PROBE_COUNT == 4, "round-robin mask and ring layout assume 4 channels");
+_Static_assert((BLOCK_SAMPLES >> DECIMATION_SHIFT) == ADC_PROBE_COUNT, "block must hold 64 samples per channel");
+_Static_assert((1u << RING_BITS) == RING_SAMPLES * sizeof(uint16_t), "ring size must match RING_BITS");
+
+/* ========== CALIBRATION ========== */
+
+#define MV_TO_UV(mv) ((int32_t)(mv) * 1000)
+#define TO_MILLI(v) ((int32_t)((v) * 1000.0f))
+
+/**
+ * @brief Two-point linear calibration in microvolts and milli-units
+ */
+typedef struct {
+    int32_t uv1, milli1;     // First calibration point
+    int32_t uv2, milli2;     // Second calibration point
+    int32_t min_milli;       // Physical range of the quantity
+    int32_t max_milli;
+} ProbeCalibration;
+
+static const ProbeCalibration calibration[ADC_PROBE_CHIP_TEMP] = {
+    [ADC_PROBE_PH] = { MV_TO_UV(PH_CAL_MV_1), TO_MILLI(PH_CAL_VALUE_1),
+                       MV_TO_UV(PH_CAL_MV_2), TO_MILLI(PH_CAL_VALUE_2), 0, 14000 },
+    [ADC_PROBE_EC] = { MV_TO_UV(EC_CAL_MV_1), TO_MILLI(EC_CAL_VALUE_1),
+                       MV_TO_UV(EC_CAL_MV_2), TO_MILLI(EC_CAL_VALUE_2), 0, INT32_MAX },
+    [ADC_PROBE_LEVEL] = { MV_TO_UV(LEVEL_CAL_MV_1), TO_MILLI(LEVEL_CAL_VALUE_1),
+                          MV_TO_UV(LEVEL_CAL_MV_2), TO_MILLI(LEVEL_CAL_VALUE_2), 0, 100000 },
+};
+
+// RP2040 datasheet: 0.706V at 27°C, -1.721mV/°C
+#define CHIP_TEMP_UV_27C 706000
+#define CHIP_TEMP_UV_PER_C 1721
+
+/* ========== PRIVATE VARIABLES ========== */
+
+static uint16_t ring[RING_SAMPLES] __attribute__((aligned(RING_SAMPLES * sizeof(uint16_t))));
+static uint32_t block_reload = BLOCK_SAMPLES; // Read by the re-arm channel
+
+static int data_chan = -1;
+static int ctrl_chan = -1;
+
+static critical_section_t filter_lock;
+static uint32_t filtered_q16[ADC_PROBE_COUNT]; // Low-passed ADC counts (Q16)
+static bool primed;                            // Filter seeded with a first block
+static uint32_t last_block_us;                 // Time of the latest decimated block
+
+/* ========== PRIVATE FUNCTIONS ========== */
+
+static int64_t code_to_uv(uint16_t code) {
+    return ((int64_t)code * ADC_VREF_MV * 1000) >> 16;
+}
+
+/**
+ * @brief Calibrated value in milli-units, not clamped to the physical range
+ */
+static int64_t probe_milli(AdcProbe probe, int64_t uv) {
+    const ProbeCalibration *cal = &calibration[probe];
+    return cal->milli1 + (uv - cal->uv1) * (cal->milli2 - cal->milli1) / (cal->uv2 - cal->uv1);
+}
+
+/**
+ * @brief Decimate the block the DMA just finished (DMA_IRQ_1)
+ */
+static void __isr adc_dma_irq_handler(void) {
+    if (!dma_irqn_get_channel_status(ADC_DMA_IRQ_INDEX, data_chan)) {
+        return;
+    }
+    dma_irqn_acknowledge_channel(ADC_DMA_IRQ_INDEX, data_chan);
+
+    // The re-arm channel has already restarted the transfer: the block being
+    // written now is the one holding write_addr, the finished one precedes it
+    uint32_t write_index = (dma_channel_hw_addr(data_chan)->write_addr - (uintptr_t)ring) / sizeof(uint16_t);
+    uint32_t block = (write_index / BLOCK_SAMPLES + BLOCKS_PER_RING - 1) % BLOCKS_PER_RING;
+    const uint16_t *samples = &ring[block * BLOCK_SAMPLES];
+
+    uint32_t sum[ADC_PROBE_COUNT] = {0};
+    for (uint32_t i = 0; i < BLOCK_SAMPLES; i += ADC_PROBE_COUNT) {
+        sum[0] += samples[i];
+        sum[1] += samples[i + 1];
+        sum[2] += samples[i + 2];
+        sum[3] += samples[i + 3];
+    }
+
+    critical_section_enter_blocking(&filter_lock);
+    for (int ch = 0; ch < ADC_PROBE_COUNT; ch++) {
+        uint32_t mean_q16 = sum[ch] << (16 - DECIMATION_SHIFT);
+        if (primed) {
+            int32_t error = (int32_t)(mean_q16 - filtered_q16[ch]);
+            filtered_q16[ch] += error >> ADC_FILTER_SHIFT;
+        } else {
+            filtered_q16[ch] = mean_q16;
+        }
+    }
+    primed = true;
+    last_block_us = time_us_32();
+    critical_section_exit(&filter_lock);
+}
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Start free-running acquisition on the three probe inputs
+ *
+ * @return true if the DMA channels could be claimed and sampling started
+ */
+bool adc_probes_init(void) {
+    critical_section_init(&filter_lock);
+
+    data_chan = dma_claim_unused_channel(false);
+    ctrl_chan = dma_claim_unused_channel(false);
+    if (data_chan < 0 || ctrl_chan < 0) {
+        printf("ADC: sem canais DMA livres\n");
+        return false;
+    }
+
+    adc_init();
+    adc_gpio_init(PH_ADC_PIN);
+    adc_gpio_init(EC_ADC_PIN);
+    adc_gpio_init(LEVEL_ADC_PIN);
+    adc_set_temp_sensor_enabled(true);
+
+    // Round-robin starts at the selected input, so ring slot i is channel i % 4
+    adc_select_input(0);
+    adc_set_round_robin(ROUND_ROBIN_MASK);
+    adc_fifo_setup(true, true, 1, false, false);
+    adc_set_clkdiv((float)(ADC_CLOCK_HZ / (ADC_SAMPLE_RATE_HZ * ADC_PROBE_COUNT)) - 1.0f);
+
+    // Data channel: ADC FIFO -> ring (write address wraps), one block per transfer
+    dma_channel_config data_cfg = dma_channel_get_default_config(data_chan);
+    channel_config_set_transfer_data_size(&data_cfg, DMA_SIZE_16);
+    channel_config_set_read_increment(&data_cfg, false);
+    channel_config_set_write_increment(&data_cfg, true);
+    channel_config_set_ring(&data_cfg, true, RING_BITS);
+    channel_config_set_dreq(&data_cfg, DREQ_ADC);
+    channel_config_set_chain_to(&data_cfg, ctrl_chan);
+
+    // Re-arm channel: reloading the count re-triggers the data channel, which
+    // carries on from its current (wrapped) write address
+    dma_channel_config ctrl_cfg = dma_channel_get_default_config(ctrl_chan);
+    channel_config_set_transfer_data_size(&ctrl_cfg, DMA_SIZE_32);
+    channel_config_set_read_increment(&ctrl_cfg, false);
+    channel_config_set_write_increment(&ctrl_cfg, false);
+    dma_channel_configure(ctrl_chan, &ctrl_cfg,
+                          &dma_hw->ch[data_chan].al1_transfer_count_trig,
+                          &block_reload, 1, false);
+
+    dma_irqn_set_channel_enabled(ADC_DMA_IRQ_INDEX, data_chan, true);
+    irq_add_shared_handler(ADC_DMA_IRQ, adc_dma_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(ADC_DMA_IRQ, true);
+
+    dma_channel_configure(data_chan, &data_cfg, ring, &adc_hw->fifo, BLOCK_SAMPLES, true);
+    adc_run(true);
+    return true;
+}
+
+/**
+ * @brief Latest filtered reading of every channel
+ *
+ * @param codes 16-bit oversampled codes (65536 = ADC_VREF_MV), indexed by AdcProbe
+ * @return false until the first block is decimated or if sampling stopped
+ */
+bool adc_probes_read_raw(uint16_t codes[ADC_PROBE_COUNT]) {
+    if (data_chan < 0) {
+        return false;
+    }
+
+    critical_section_enter_blocking(&filter_lock);
+    bool fresh = primed && (time_us_32() - last_block_us) < ADC_STALE_US;
+    for (int ch = 0; ch < ADC_PROBE_COUNT; ch++) {
+        uint32_t code = filtered_q16[ch] >> 12; // Q16 of 12-bit counts -> 16-bit code
+        codes[ch] = code > UINT16_MAX ? UINT16_MAX : (uint16_t)code;
+    }
+    critical_section_exit(&filter_lock);
+    return fresh;
+}
+
+/**
+ * @brief Convert an oversampled code to engineering units
+ *
+ * @return pH, EC in mS/cm, reservoir level in % or chip temperature in °C
+ */
+float adc_probes_convert(AdcProbe probe, uint16_t code) {
+    int64_t uv = code_to_uv(code);
+
+    if (probe == ADC_PROBE_CHIP_TEMP) {
+        int64_t milli_c = 27000 - (uv - CHIP_TEMP_UV_27C) * 1000 / CHIP_TEMP_UV_PER_C;
+        return milli_c / 1000.0f;
+    }
+
+    const ProbeCalibration *cal = &calibration[probe];
+    int64_t milli = probe_milli(probe, uv);
+    if (milli < cal->min_milli) {
+        milli = cal->min_milli;
+    } else if (milli > cal->max_milli) {
+        milli = cal->max_milli;
+    }
+    return milli / 1000.0f;
+}
+
+/**
+ * @brief Whether a code can come from a connected, working probe
+ *
+ * A missing or shorted front end reads at a rail (within
+ * ADC_PROBE_RAIL_MV of 0 V or ADC_VREF_MV); a value outside the physical
+ * range of the quantity means a broken probe or a wrong calibration.
+ * adc_probes_convert() would clamp both into a believable number.
+ */
+bool adc_probes_plausible(AdcProbe probe, uint16_t code) {
+    if (probe == ADC_PROBE_CHIP_TEMP) {
+        return true;
+    }
+    int64_t uv = code_to_uv(code);
+    if (uv < MV_TO_UV(ADC_PROBE_RAIL_MV) || uv > MV_TO_UV(ADC_VREF_MV - ADC_PROBE_RAIL_MV)) {
+        return false;
+    }
+    const ProbeCalibration *cal = &calibration[probe];
+    int64_t milli = probe_milli(probe, uv);
+    return milli >= cal->min_milli && milli <= cal->max_milli;
+}
+
+/**
+ * @brief Measure VSYS without disturbing the probe sampler or the CYW43 bus
+ *
+ * Takes the CYW43 lock: call from thread context (main loop or a task),
+ * never from an interrupt. Costs ~50us of probe sampling.
+ *
+ * @return VSYS in millivolts
+ */
+uint32_t adc_probes_read_vsys_mv(void) {
+    uint32_t sum = 0;
+
+    cyw43_thread_enter();
+    bool sampling = data_chan >= 0;
+    uint next_input = 0;
+    if (sampling) {
+        // Let the conversion in flight finish and its sample reach the ring
+        adc_run(false);
+        while (!(adc_hw->cs & ADC_CS_READY_BITS)) {
+            tight_loop_contents();
+        }
+        while (adc_fifo_get_level() > 0) {
+            tight_loop_contents();
+        }
+        next_input = adc_get_selected_input();
+        adc_set_round_robin(0);
+        hw_clear_bits(&adc_hw->fcs, ADC_FCS_EN_BITS); // One-shot results stay out of the ring
+    }
+
+    adc_gpio_init(PICO_VSYS_PIN);
+    adc_select_input(VSYS_ADC_INPUT);
+    // The pin was just the CYW43 SPI clock and the sample-and-hold still carries the
+    // previous channel: the first conversions are unreliable and could look like a brown-out
+    for (int i = 0; i < VSYS_DISCARD; i++) {
+        (void)adc_read();
+    }
+    for (int i = 0; i < VSYS_SAMPLES; i++) {
+        sum += adc_read();
+    }
+
+    if (sampling) {
+        adc_select_input(next_input);
+        adc_set_round_robin(ROUND_ROBIN_MASK);
+        hw_set_bits(&adc_hw->fcs, ADC_FCS_EN_BITS);
+        adc_run(true);
+    }
+    cyw43_thread_exit();
+
+    return sum * VSYS_DIVIDER * ADC_VREF_MV / (VSYS_SAMPLES * 4096u);
+}
@@ -16,10 +16,6 @@ static const uint8_t CMD_INITIALIZE[] = {0xE1, 0x08, 0x00}; // Sensor initializa
 static const uint8_t CMD_TRIGGER[] = {0xAC, 0x33, 0x00};    // Measurement trigger command sequence
 static const uint8_t CMD_SOFT_RESET[] = {0xBA};             // Software reset command
 
-/* ========== PRIVATE VARIABLES ========== */
-
-static i2c_inst_t* i2c_port; // I2C interface instance for sensor communication
-
 /* ========== PUBLIC INTERFACE FUNCTIONS ========== */
 
 /**
@@ -29,39 +25,48 @@ static i2c_inst_t* i2c_port; // I2C interface instance for sensor communication
  * initialization command transmission, and calibration setup. Must be called
  * before attempting to read sensor data.
  * 
- * @param i2c Pointer to I2C interface instance (i2c0 or i2c1)
+ * @param dev Sensor handle to initialize
+ * @param bus Bus the sensor is wired to (hardware or PIO)
+ * @return true if the sensor acknowledged the initialization command
  */
-void aht10_init(i2c_inst_t *i2c) {
-    i2c_port = i2c; // Store I2C interface reference for subsequent operations
+bool aht10_init(Aht10 *dev, I2cBus *bus) {
+    dev->bus = bus; // Store bus reference for subsequent operations
     
     // Execute software reset to ensure clean sensor state
-    i2c_write_blocking(i2c_port, SENSOR_ADDR, CMD_SOFT_RESET, 1, false);
+    i2c_bus_write_blocking(dev->bus, SENSOR_ADDR, CMD_SOFT_RESET, 1, false);
     sleep_ms(20); // Wait for reset completion as per datasheet timing
     
     // Send initialization command to configure sensor parameters
-    i2c_write_blocking(i2c_port, SENSOR_ADDR, CMD_INITIALIZE, 3, false);
+    int rc = i2c_bus_write_blocking(dev->bus, SENSOR_ADDR, CMD_INITIALIZE, 3, false);
     sleep_ms(300); // Wait for initialization completion and calibration
+    return rc == 3;
 }
 
 /**
- * @brief Read calibrated temperature and humidity values
+ * @brief Start a measurement without waiting for it
  * 
- * Triggers a new measurement, waits for conversion completion, reads raw data,
- * and applies calibration formulas to provide accurate temperature (°C) and
- * relative humidity (%) values.
+ * Lets several sensors convert at the same time: trigger all of them, wait
+ * AHT10_MEASUREMENT_MS once, then collect each with aht10_fetch_raw().
  * 
- * @param temp Pointer to store temperature reading (°C, range: -40 to +85)
- * @param humidity Pointer to store humidity reading (%, range: 0 to 100)
- * @return true if measurement successful, false on communication error or busy sensor
+ * @param dev Sensor handle
+ * @return true if the sensor acknowledged the trigger
  */
-bool aht10_read_data(float *temp, float *humidity) {
-    // Trigger measurement conversion in sensor
-    i2c_write_blocking(i2c_port, SENSOR_ADDR, CMD_TRIGGER, 3, false);
-    sleep_ms(80); // Wait for measurement completion (typical: 75ms, max: 80ms)
-    
+bool aht10_trigger(Aht10 *dev) {
+    return i2c_bus_write_blocking(dev->bus, SENSOR_ADDR, CMD_TRIGGER, 3, false) == 3;
+}
+
+/**
+ * @brief Collect the result of a measurement started by aht10_trigger()
+ * 
+ * @param dev Sensor handle
+ * @param raw_temp Pointer to store the 20-bit temperature code
+ * @param raw_humidity Pointer to store the 20-bit humidity code
+ * @return true if successful, false on communication error or busy sensor
+ */
+bool aht10_fetch_raw(Aht10 *dev, uint32_t *raw_temp, uint32_t *raw_humidity) {
     // Read 6-byte result data from sensor
     uint8_t data[6];
-    if (i2c_read_blocking(i2c_port, SENSOR_ADDR, data, 6, false) != 6) {
+    if (i2c_bus_read_blocking(dev->bus, SENSOR_ADDR, data, 6, false) != 6) {
         return false; // Communication error - insufficient data received
     }
     
@@ -71,14 +76,68 @@ bool aht10_read_data(float *temp, float *humidity) {
     }
     
     // Extract 20-bit humidity value from data bytes [1:3]
-    uint32_t raw_humidity = ((uint32_t)data[1] << 12) | ((uint32_t)data[2] << 4) | (data[3] >> 4);
+    *raw_humidity = ((uint32_t)data[1] << 12) | ((uint32_t)data[2] << 4) | (data[3] >> 4);
     
     // Extract 20-bit temperature value from data bytes [3:5]
-    uint32_t raw_temp = (((uint32_t)data[3] & 0x0F) << 16) | ((uint32_t)data[4] << 8) | data[5];
+    *raw_temp = (((uint32_t)data[3] & 0x0F) << 16) | ((uint32_t)data[4] << 8) | data[5];
+    
+    return true; // Measurement successful
+}
+
+/**
+ * @brief Read the raw 20-bit temperature and humidity codes
+ * 
+ * Triggers a new measurement, waits for conversion completion and extracts
+ * the uncalibrated sensor codes. Used directly by the binary USB stream so
+ * the host receives exactly what the sensor reported.
+ * 
+ * @param dev Sensor handle
+ * @param raw_temp Pointer to store the 20-bit temperature code
+ * @param raw_humidity Pointer to store the 20-bit humidity code
+ * @return true if measurement successful, false on communication error or busy sensor
+ */
+bool aht10_read_raw(Aht10 *dev, uint32_t *raw_temp, uint32_t *raw_humidity) {
+    // Trigger measurement conversion in sensor
+    if (!aht10_trigger(dev)) {
+        return false;
+    }
+    sleep_ms(AHT10_MEASUREMENT_MS); // Wait for measurement completion
     
+    return aht10_fetch_raw(dev, raw_temp, raw_humidity);
+}
+
+/**
+ * @brief Convert raw AHT10 codes to engineering units
+ * 
+ * @param raw_temp 20-bit temperature code
+ * @param raw_humidity 20-bit humidity code
+ * @param temp Pointer to store temperature (°C)
+ * @param humidity Pointer to store relative humidity (%)
+ */
+void aht10_convert(uint32_t raw_temp, uint32_t raw_humidity, float *temp, float *humidity) {
     // Apply calibration formulas as specified in AHT10 datasheet
     *humidity = ((float)raw_humidity / 1048576.0) * 100.0;           // Convert to %RH (0-100%)
     *temp = ((float)raw_temp / 1048576.0) * 200.0 - 50.0;          // Convert to °C (-40 to +85°C)
+}
+
+/**
+ * @brief Read calibrated temperature and humidity values
+ * 
+ * Triggers a new measurement, waits for conversion completion, reads raw data,
+ * and applies calibration formulas to provide accurate temperature (°C) and
+ * relative humidity (%) values.
+ * 
+ * @param dev Sensor handle
+ * @param temp Pointer to store temperature reading (°C, range: -40 to +85)
+ * @param humidity Pointer to store humidity reading (%, range: 0 to 100)
+ * @return true if measurement successful, false on communication error or busy sensor
+ */
+bool aht10_read_data(Aht10 *dev, float *temp, float *humidity) {
+    uint32_t raw_temp, raw_humidity;
+    if (!aht10_read_raw(dev, &raw_temp, &raw_humidity)) {
+        return false;
+    }
     
+    aht10_convert(raw_temp, raw_humidity, temp, humidity);
     return true; // Measurement successful
 }
\ No newline at end of file
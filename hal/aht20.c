@@ -0,0 +1,151 @@
+/**
+ * @file aht20.c
+ * @brief AHT20/AHT21 Temperature and Humidity Sensor Driver
+ * 
+ * Successor of the AHT10 with the same measurement command and 20-bit
+ * codes, better long-term stability, a CRC byte after every measurement and
+ * a calibration-status bit that must be checked: a sensor that lost its
+ * calibration coefficients reports it there and is reloaded before its
+ * values are trusted again.
+ */
+
+#include "aht20.h"
+#include "aht10.h"
+
+/* ========== SENSOR CONFIGURATION CONSTANTS ========== */
+
+static const uint8_t SENSOR_ADDR = 0x38;                    // Fixed I2C address (same as AHT10)
+static const uint8_t CMD_INITIALIZE[] = {0xBE, 0x08, 0x00}; // Load calibration coefficients
+static const uint8_t CMD_TRIGGER[] = {0xAC, 0x33, 0x00};    // Measurement trigger command sequence
+static const uint8_t CMD_SOFT_RESET[] = {0xBA};             // Software reset command
+
+#define STATUS_BUSY 0x80           // Measurement in progress
+#define STATUS_CALIBRATED 0x08     // Calibration coefficients loaded
+
+#define DETECT_MEASUREMENTS 2      // CRC-valid measurements required to tell it from an AHT10
+
+/* ========== PRIVATE FUNCTIONS ========== */
+
+/**
+ * @brief Read the status byte, reloading the calibration if it is not enabled
+ *
+ * @return true if the sensor answered and is calibrated
+ */
+static bool ensure_calibrated(Aht20 *dev) {
+    uint8_t status;
+    if (i2c_bus_read_blocking(dev->bus, SENSOR_ADDR, &status, 1, false) != 1) {
+        return false;
+    }
+    if (status & STATUS_CALIBRATED) {
+        return true;
+    }
+
+    i2c_bus_write_blocking(dev->bus, SENSOR_ADDR, CMD_INITIALIZE, 3, false);
+    sleep_ms(10);
+    return i2c_bus_read_blocking(dev->bus, SENSOR_ADDR, &status, 1, false) == 1 &&
+           (status & STATUS_CALIBRATED);
+}
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Detect and initialize an AHT20/AHT21
+ * 
+ * The AHT10 answers at the same address, so the sensor is only accepted if
+ * DETECT_MEASUREMENTS consecutive measurements carry a valid CRC byte (the
+ * AHT10 sends none). Blocks ~200ms; call during initialization.
+ * 
+ * @param dev Sensor handle to initialize
+ * @param bus Bus the sensor is wired to (hardware or PIO)
+ * @return true if an AHT20/AHT21 answered and is calibrated
+ */
+bool aht20_init(Aht20 *dev, I2cBus *bus) {
+    dev->bus = bus; // Store bus reference for subsequent operations
+    
+    // Execute software reset to ensure clean sensor state
+    if (i2c_bus_write_blocking(dev->bus, SENSOR_ADDR, CMD_SOFT_RESET, 1, false) != 1) {
+        return false;
+    }
+    sleep_ms(20); // Wait for reset completion as per datasheet timing
+    
+    if (!ensure_calibrated(dev)) {
+        return false;
+    }
+
+    for (int i = 0; i < DETECT_MEASUREMENTS; i++) {
+        uint32_t raw_temp, raw_humidity;
+        if (!aht20_trigger(dev)) {
+            return false;
+        }
+        sleep_ms(AHT20_MEASUREMENT_MS);
+        if (!aht20_fetch_raw(dev, &raw_temp, &raw_humidity)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Start a measurement without waiting for it
+ * 
+ * @param dev Sensor handle
+ * @return true if the sensor acknowledged the trigger
+ */
+bool aht20_trigger(Aht20 *dev) {
+    return i2c_bus_write_blocking(dev->bus, SENSOR_ADDR, CMD_TRIGGER, 3, false) == 3;
+}
+
+/**
+ * @brief Collect the result of a measurement started by aht20_trigger()
+ * 
+ * The codes use the AHT10 format (see aht10_convert()).
+ * 
+ * @param dev Sensor handle
+ * @param raw_temp Pointer to store the 20-bit temperature code
+ * @param raw_humidity Pointer to store the 20-bit humidity code
+ * @return true if successful, false on communication/CRC error, busy or uncalibrated sensor
+ */
+bool aht20_fetch_raw(Aht20 *dev, uint32_t *raw_temp, uint32_t *raw_humidity) {
+    // Read status, 5 data bytes and CRC
+    uint8_t data[7];
+    if (i2c_bus_read_blocking(dev->bus, SENSOR_ADDR, data, 7, false) != 7) {
+        return false; // Communication error - insufficient data received
+    }
+    if (i2c_bus_crc8(data, 6) != data[6]) {
+        return false; // Corrupted transfer
+    }
+    if (data[0] & STATUS_BUSY) {
+        return false; // Sensor still busy - measurement not complete
+    }
+    if (!(data[0] & STATUS_CALIBRATED)) {
+        ensure_calibrated(dev); // Values are not trustworthy: reload for the next measurement
+        return false;
+    }
+    
+    // Same layout as the AHT10: humidity in bytes [1:3], temperature in bytes [3:5]
+    *raw_humidity = ((uint32_t)data[1] << 12) | ((uint32_t)data[2] << 4) | (data[3] >> 4);
+    *raw_temp = (((uint32_t)data[3] & 0x0F) << 16) | ((uint32_t)data[4] << 8) | data[5];
+    return true;
+}
+
+/**
+ * @brief Read calibrated temperature and humidity values
+ * 
+ * @param dev Sensor handle
+ * @param temp Pointer to store temperature reading (°C, range: -40 to +85)
+ * @param humidity Pointer to store humidity reading (%, range: 0 to 100)
+ * @return true if measurement successful
+ */
+bool aht20_read_data(Aht20 *dev, float *temp, float *humidity) {
+    uint32_t raw_temp, raw_humidity;
+    if (!aht20_trigger(dev)) {
+        return false;
+    }
+    sleep_ms(AHT20_MEASUREMENT_MS);
+    if (!aht20_fetch_raw(dev, &raw_temp, &raw_humidity)) {
+        return false;
+    }
+    
+    aht10_convert(raw_temp, raw_humidity, temp, humidity);
+    return true;
+}
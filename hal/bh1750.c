@@ -14,10 +14,6 @@
 static const uint8_t SENSOR_ADDR = 0x23;      // Standard I2C address for BH1750 sensor
 static const uint8_t CONT_HRES_MODE = 0x10;   // Continuous high-resolution measurement mode (1 lx resolution)
 
-/* ========== PRIVATE VARIABLES ========== */
-
-static i2c_inst_t* i2c_port; // I2C interface instance for sensor communication
-
 /* ========== PUBLIC INTERFACE FUNCTIONS ========== */
 
 /**
@@ -27,46 +23,75 @@ static i2c_inst_t* i2c_port; // I2C interface instance for sensor communication
  * 1 lux resolution with automatic measurement cycling. Sensor will
  * continuously update internal measurement register.
  * 
- * @param i2c Pointer to I2C interface instance (i2c0 or i2c1)
+ * @param dev Sensor handle to initialize
+ * @param bus Bus the sensor is wired to (hardware or PIO)
+ * @return true if the sensor acknowledged the mode command
  */
-void bh1750_init(i2c_inst_t *i2c) {
-    i2c_port = i2c; // Store I2C interface reference for subsequent operations
+bool bh1750_init(Bh1750 *dev, I2cBus *bus) {
+    dev->bus = bus; // Store bus reference for subsequent operations
     
     // Configure sensor for continuous high-resolution measurement mode
     uint8_t cmd = CONT_HRES_MODE;
-    i2c_write_blocking(i2c_port, SENSOR_ADDR, &cmd, 1, false);
+    int rc = i2c_bus_write_blocking(dev->bus, SENSOR_ADDR, &cmd, 1, false);
     
     // Wait for first measurement completion (typical: 120ms, max: 180ms)
     sleep_ms(180);
+    return rc == 1;
 }
 
 /**
- * @brief Read current light intensity measurement
- * 
- * Retrieves the most recent light intensity measurement from the sensor's
- * internal register. In continuous mode, this value is automatically
- * updated by the sensor approximately every 120ms.
+ * @brief Read the raw 16-bit light measurement register
  * 
- * @param lux Pointer to store light intensity reading (range: 0 to 65535 lux)
+ * @param dev Sensor handle
+ * @param raw Pointer to store the uncalibrated measurement code
  * @return true if measurement successful, false on communication error
  */
-bool bh1750_read_lux(float *lux) {
+bool bh1750_read_raw(Bh1750 *dev, uint16_t *raw) {
     // Read 16-bit measurement data from sensor (MSB first)
     uint8_t data[2];
-    int bytes_read = i2c_read_blocking(i2c_port, SENSOR_ADDR, data, 2, false);
+    int bytes_read = i2c_bus_read_blocking(dev->bus, SENSOR_ADDR, data, 2, false);
     
     // Verify complete data reception
     if (bytes_read != 2) {
-        *lux = 0; // Set safe default value on communication failure
+        *raw = 0;
         return false;
     }
     
     // Combine MSB and LSB to form 16-bit raw measurement value
-    uint16_t raw = (data[0] << 8) | data[1];
-    
-    // Apply calibration factor to convert raw value to lux
-    // BH1750 datasheet specifies: Lux = Raw_Value / 1.2 (at default sensitivity)
-    *lux = raw / 1.2f;
+    *raw = (data[0] << 8) | data[1];
+    return true;
+}
+
+/**
+ * @brief Convert a raw BH1750 code to lux
+ * 
+ * BH1750 datasheet specifies: Lux = Raw_Value / 1.2 (at default sensitivity)
+ * 
+ * @param raw 16-bit measurement code
+ * @return Light intensity in lux
+ */
+float bh1750_convert(uint16_t raw) {
+    return raw / 1.2f;
+}
+
+/**
+ * @brief Read current light intensity measurement
+ * 
+ * Retrieves the most recent light intensity measurement from the sensor's
+ * internal register. In continuous mode, this value is automatically
+ * updated by the sensor approximately every 120ms.
+ * 
+ * @param dev Sensor handle
+ * @param lux Pointer to store light intensity reading (range: 0 to 65535 lux)
+ * @return true if measurement successful, false on communication error
+ */
+bool bh1750_read_lux(Bh1750 *dev, float *lux) {
+    uint16_t raw;
+    if (!bh1750_read_raw(dev, &raw)) {
+        *lux = 0; // Set safe default value on communication failure
+        return false;
+    }
     
+    *lux = bh1750_convert(raw);
     return true; // Measurement successful
 }
\ No newline at end of file
@@ -0,0 +1,825 @@
+/**
+ * @file coap_server.c
+ * @brief CoAP telemetry server with Observe on lwIP raw UDP
+ *
+ * A compact RFC 7252 server for consumers on lossy links, where MQTT's TCP
+ * session, keep-alives and head-of-line blocking hurt. GET requests get
+ * piggybacked responses (CON) or NON responses, built directly in the
+ * outgoing pbuf.
+ *
+ * Observe (RFC 7641): a GET with Observe=0 registers the requester for the
+ * resource, Observe=1 or a RST removes it. /sensores is notified with NON
+ * messages on each new acquisition, except every COAP_CON_EVERY-th
+ * notification, which goes out CON so clients that went away are noticed.
+ * /alertas is notified with CON messages whenever an alert flag changes.
+ * A confirmable notification is kept per observer and retransmitted with
+ * exponential back-off (ACK_TIMEOUT 2 s, random factor 1.5); the observer
+ * is dropped after COAP_MAX_RETRANSMIT unanswered attempts. Routine
+ * notifications are skipped while a CON one is in flight to that observer.
+ *
+ * Block-wise (RFC 7959): /historico returns the raw 16-byte FlashLogRecord
+ * entries (see flash_log.h), oldest first or from ?desde=<seq>. Blocks
+ * always hold whole records. The ETag is the first sequence number of the
+ * transfer and changes if the ring wraps in the middle of a transfer.
+ *
+ * Duplicate CON requests are answered again rather than deduplicated; every
+ * resource is read-only, so that is harmless.
+ *
+ * The receive path runs in lwIP context; coap_server_notify() and
+ * coap_server_poll() run in the network context under the lwIP lock.
+ */
+
+#include "coap_server.h"
+#include "app_config.h"
+#include "flash_log.h"
+#include "state_snapshot.h"
+#include "pico/cyw43_arch.h"
+#include "pico/rand.h"
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+/* ========== PROTOCOL CONSTANTS ========== */
+
+#define COAP_VERSION 1
+
+#define COAP_TYPE_CON 0
+#define COAP_TYPE_NON 1
+#define COAP_TYPE_ACK 2
+#define COAP_TYPE_RST 3
+
+#define COAP_CODE(cls, detail) (((cls) << 5) | (detail))
+#define COAP_GET COAP_CODE(0, 1)
+#define COAP_CONTENT COAP_CODE(2, 5)
+#define COAP_BAD_REQUEST COAP_CODE(4, 0)
+#define COAP_BAD_OPTION COAP_CODE(4, 2)
+#define COAP_NOT_FOUND COAP_CODE(4, 4)
+#define COAP_METHOD_NOT_ALLOWED COAP_CODE(4, 5)
+
+#define OPT_ETAG 4
+#define OPT_OBSERVE 6
+#define OPT_URI_PATH 11
+#define OPT_CONTENT_FORMAT 12
+#define OPT_URI_QUERY 15
+#define OPT_ACCEPT 17
+#define OPT_BLOCK2 23
+#define OPT_SIZE2 28
+
+#define CT_LINK_FORMAT 40
+#define CT_OCTET_STREAM 42
+#define CT_JSON 50
+
+#define COAP_ACK_TIMEOUT_MS 2000
+#define COAP_MAX_TOKEN 8
+#define COAP_HEADER_OVERHEAD 64                        // Header, token and options of a block response
+#define COAP_MAX_MESSAGE ((16u << COAP_BLOCK_SZX) + COAP_HEADER_OVERHEAD)
+#define IP_UDP_HEADERS 28                              // Counted in the wire byte statistics
+
+/* ========== TYPES ========== */
+
+typedef enum {
+    RES_CORE = 0,       // /.well-known/core
+    RES_SENSORS,
+    RES_ALERTS,
+    RES_HISTORY,
+    RES_COUNT
+} CoapResource;
+
+static const char *const resource_paths[RES_COUNT] = {
+    [RES_CORE] = ".well-known/core",
+    [RES_SENSORS] = "sensores",
+    [RES_ALERTS] = "alertas",
+    [RES_HISTORY] = "historico",
+};
+
+/**
+ * @brief Parsed request (options the server understands)
+ */
+typedef struct {
+    uint8_t type;
+    uint8_t code;
+    uint16_t mid;
+    uint8_t token_len;
+    uint8_t token[COAP_MAX_TOKEN];
+    char path[32];                  // Uri-Path segments joined with '/'
+    bool has_observe;
+    uint32_t observe;
+    bool has_block2;
+    uint32_t block2;
+    bool has_since;
+    uint32_t since;                 // ?desde=<seq> on /historico
+    bool bad_option;                // Unrecognized critical option
+} CoapRequest;
+
+/**
+ * @brief Message under construction (options must be added in ascending order)
+ */
+typedef struct {
+    uint8_t *buf;
+    size_t cap;
+    size_t len;
+    uint16_t last_option;
+    bool overflow;
+} CoapWriter;
+
+/**
+ * @brief Registered observer and its confirmable notification in flight
+ */
+typedef struct {
+    bool used;
+    CoapResource resource;
+    ip_addr_t addr;
+    uint16_t port;
+    uint8_t token_len;
+    uint8_t token[COAP_MAX_TOKEN];
+    uint16_t last_mid;              // Last notification sent (a RST to it deregisters)
+    uint16_t since_con;             // Routine notifications since the last CON one
+    bool pending;                   // CON notification awaiting its ACK
+    uint8_t retransmits;
+    uint32_t timeout_ms;
+    absolute_time_t deadline;
+    uint16_t pending_len;
+    uint8_t pending_buf[COAP_NOTIFY_BUF_SIZE];
+} CoapObserver;
+
+/**
+ * @brief Counters for the benchmark report (wire bytes include IP/UDP headers)
+ */
+typedef struct {
+    uint32_t requests;
+    uint32_t notifications_non;
+    uint32_t notifications_con;
+    uint32_t retransmissions;
+    uint32_t observers_dropped;
+    uint32_t bytes_in;
+    uint32_t bytes_out;
+} CoapStats;
+
+/* ========== PRIVATE VARIABLES ========== */
+
+static struct udp_pcb *pcb;
+static uint16_t next_mid;
+static uint32_t observe_seq[RES_COUNT];     // 24-bit Observe sequence per resource
+
+static CoapObserver observers[COAP_MAX_OBSERVERS];
+static CoapStats stats;
+
+static uint8_t rx_buf[COAP_RX_BUF_SIZE];    // Request copied out of the pbuf (lwIP context)
+static uint8_t notify_buf[COAP_NOTIFY_BUF_SIZE]; // Non-confirmable notification being built
+
+static absolute_time_t last_notified;
+static uint16_t last_alert_mask;
+
+/* ========== MESSAGE WRITER ========== */
+
+static void put_bytes(CoapWriter *w, const void *data, size_t len) {
+    if (w->len + len > w->cap) {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->len, data, len);
+    w->len += len;
+}
+
+static void put_header(CoapWriter *w, uint8_t type, uint8_t code, uint16_t mid,
+                       const uint8_t *token, uint8_t token_len) {
+    uint8_t header[4] = { (uint8_t)((COAP_VERSION << 6) | (type << 4) | token_len), code,
+                          (uint8_t)(mid >> 8), (uint8_t)mid };
+    put_bytes(w, header, sizeof(header));
+    put_bytes(w, token, token_len);
+    w->last_option = 0;
+}
+
+/**
+ * @brief Delta/length nibble and its extension bytes (RFC 7252 §3.1)
+ */
+static uint8_t option_nibble(uint32_t value, uint8_t ext[2], size_t *ext_len) {
+    if (value < 13) {
+        *ext_len = 0;
+        return (uint8_t)value;
+    }
+    if (value < 269) {
+        ext[0] = (uint8_t)(value - 13);
+        *ext_len = 1;
+        return 13;
+    }
+    ext[0] = (uint8_t)((value - 269) >> 8);
+    ext[1] = (uint8_t)(value - 269);
+    *ext_len = 2;
+    return 14;
+}
+
+static void put_option(CoapWriter *w, uint16_t number, const void *value, size_t len) {
+    uint8_t delta_ext[2], len_ext[2];
+    size_t delta_ext_len, len_ext_len;
+    uint8_t delta = option_nibble(number - w->last_option, delta_ext, &delta_ext_len);
+    uint8_t length = option_nibble((uint32_t)len, len_ext, &len_ext_len);
+    uint8_t first = (uint8_t)((delta << 4) | length);
+
+    put_bytes(w, &first, 1);
+    put_bytes(w, delta_ext, delta_ext_len);
+    put_bytes(w, len_ext, len_ext_len);
+    put_bytes(w, value, len);
+    w->last_option = number;
+}
+
+/**
+ * @brief Unsigned option in the fewest bytes (0 is the empty value)
+ */
+static void put_uint_option(CoapWriter *w, uint16_t number, uint32_t value) {
+    uint8_t bytes[4];
+    size_t len = 0;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        if (len > 0 || (value >> shift) & 0xFF) {
+            bytes[len++] = (uint8_t)(value >> shift);
+        }
+    }
+    put_option(w, number, bytes, len);
+}
+
+/**
+ * @brief Add the payload marker and reserve @p len bytes of payload
+ *
+ * @return Where to write the payload, NULL if it does not fit
+ */
+static uint8_t *put_payload(CoapWriter *w, size_t len) {
+    if (len == 0) {
+        return w->buf + w->len;
+    }
+    if (w->len + 1 + len > w->cap) {
+        w->overflow = true;
+        return NULL;
+    }
+    w->buf[w->len++] = 0xFF;
+    uint8_t *payload = w->buf + w->len;
+    w->len += len;
+    return payload;
+}
+
+/* ========== REQUEST PARSER ========== */
+
+static bool read_nibble(uint8_t nibble, const uint8_t **p, const uint8_t *end, uint32_t *value) {
+    if (nibble < 13) {
+        *value = nibble;
+    } else if (nibble == 13 && *p + 1 <= end) {
+        *value = 13 + (*p)[0];
+        *p += 1;
+    } else if (nibble == 14 && *p + 2 <= end) {
+        *value = 269 + ((uint32_t)(*p)[0] << 8 | (*p)[1]);
+        *p += 2;
+    } else {
+        return false; // 15 is reserved (payload marker)
+    }
+    return true;
+}
+
+static uint32_t read_uint(const uint8_t *value, uint32_t len) {
+    uint32_t v = 0;
+    for (uint32_t i = 0; i < len && i < 4; i++) {
+        v = (v << 8) | value[i];
+    }
+    return v;
+}
+
+/**
+ * @return false for a message that is not well-formed CoAP
+ */
+static bool parse_request(const uint8_t *msg, size_t len, CoapRequest *req) {
+    memset(req, 0, sizeof(*req));
+    if (len < 4 || (msg[0] >> 6) != COAP_VERSION || (msg[0] & 0x0F) > COAP_MAX_TOKEN) {
+        return false;
+    }
+    req->type = (msg[0] >> 4) & 0x03;
+    req->token_len = msg[0] & 0x0F;
+    req->code = msg[1];
+    req->mid = (uint16_t)(msg[2] << 8 | msg[3]);
+    if (4u + req->token_len > len) {
+        return false;
+    }
+    memcpy(req->token, msg + 4, req->token_len);
+
+    const uint8_t *p = msg + 4 + req->token_len;
+    const uint8_t *end = msg + len;
+    uint32_t number = 0;
+    size_t path_len = 0;
+
+    while (p < end && *p != 0xFF) {
+        uint8_t first = *p++;
+        uint32_t delta, opt_len;
+        if (!read_nibble(first >> 4, &p, end, &delta) || !read_nibble(first & 0x0F, &p, end, &opt_len) ||
+            p + opt_len > end) {
+            return false;
+        }
+        number += delta;
+
+        switch (number) {
+            case OPT_URI_PATH:
+                if (path_len + opt_len + 1 < sizeof(req->path)) {
+                    if (path_len > 0) {
+                        req->path[path_len++] = '/';
+                    }
+                    memcpy(req->path + path_len, p, opt_len);
+                    path_len += opt_len;
+                    req->path[path_len] = '\0';
+                }
+                break;
+            case OPT_OBSERVE:
+                req->has_observe = true;
+                req->observe = read_uint(p, opt_len);
+                break;
+            case OPT_BLOCK2:
+                req->has_block2 = true;
+                req->block2 = read_uint(p, opt_len);
+                break;
+            case OPT_URI_QUERY:
+                if (opt_len > 6 && memcmp(p, "desde=", 6) == 0) {
+                    uint32_t since = 0;
+                    for (uint32_t i = 6; i < opt_len && p[i] >= '0' && p[i] <= '9'; i++) {
+                        since = since * 10 + (p[i] - '0');
+                    }
+                    req->has_since = true;
+                    req->since = since;
+                }
+                break;
+            case OPT_ACCEPT:
+            case OPT_ETAG:
+                break; // One representation per resource
+            default:
+                if (number & 1) {
+                    req->bad_option = true; // Unknown critical option
+                }
+                break;
+        }
+        p += opt_len;
+    }
+    return true;
+}
+
+/* ========== REPRESENTATIONS ========== */
+
+static int put_json_number(char *buf, size_t cap, const char *key, bool ok, float value, int decimals,
+                           bool first) {
+    if (ok && !isnan(value)) {
+        return snprintf(buf, cap, "%s\"%s\":%.*f", first ? "" : ",", key, decimals, value);
+    }
+    return snprintf(buf, cap, "%s\"%s\":null", first ? "" : ",", key);
+}
+
+static size_t render_sensors(char *buf, size_t cap, const SensorData *s) {
+    const struct {
+        const char *key;
+        bool ok;
+        float value;
+        int decimals;
+    } fields[] = {
+        { "temperatura", s->aht_ok, s->temperature, 2 },
+        { "umidade", s->aht_ok, s->humidity, 2 },
+        { "luminosidade", s->lux_ok, s->lux, 1 },
+        { "ph", s->probes_ok, s->ph, 2 },
+        { "ec", s->probes_ok, s->ec, 2 },
+        { "nivel", s->probes_ok, s->water_level, 1 },
+        { "temperatura_agua", s->water_temp_ok, s->water_temperature, 2 },
+        { "vazao", s->pulses_ok, s->flow_lpm, 2 },
+        { "co2", s->co2_ok, s->co2_ppm, 0 },
+    };
+    int len = snprintf(buf, cap, "{");
+    // A truncated append leaves len >= cap: stop before cap - len wraps
+    for (unsigned i = 0; i < sizeof(fields) / sizeof(fields[0]) && (size_t)len < cap; i++) {
+        len += put_json_number(buf + len, cap - len, fields[i].key, fields[i].ok, fields[i].value,
+                               fields[i].decimals, i == 0);
+    }
+    if ((size_t)len < cap) {
+        len += snprintf(buf + len, cap - len, "}");
+    }
+    return (size_t)len < cap ? (size_t)len : 0;
+}
+
+static uint16_t alert_mask(const AlertStatus *a) {
+    return (uint16_t)(a->temp_critical << 0 | a->humidity_critical << 1 | a->lux_critical << 2 |
+                      a->ph_critical << 3 | a->ec_critical << 4 | a->level_critical << 5 |
+                      a->water_temp_critical << 6 | a->flow_critical << 7 | a->pump_critical << 8 |
+                      a->co2_critical << 9);
+}
+
+static size_t render_alerts(char *buf, size_t cap, const AlertStatus *a) {
+    static const char *const keys[] = { "temperatura", "umidade", "luminosidade", "ph", "ec", "nivel",
+                                        "temperatura_agua", "vazao", "bomba", "co2" };
+    uint16_t mask = alert_mask(a);
+    int len = snprintf(buf, cap, "{");
+    for (unsigned i = 0; i < sizeof(keys) / sizeof(keys[0]) && (size_t)len < cap; i++) {
+        len += snprintf(buf + len, cap - len, "%s\"%s\":%s", i > 0 ? "," : "", keys[i],
+                        (mask >> i) & 1 ? "true" : "false");
+    }
+    if ((size_t)len < cap) {
+        len += snprintf(buf + len, cap - len, "}");
+    }
+    return (size_t)len < cap ? (size_t)len : 0;
+}
+
+/* ========== TRANSMISSION ========== */
+
+static void send_datagram(struct pbuf *p, const ip_addr_t *addr, uint16_t port) {
+    if (udp_sendto(pcb, p, addr, port) == ERR_OK) {
+        stats.bytes_out += p->tot_len + IP_UDP_HEADERS;
+    }
+}
+
+static void send_copy(const uint8_t *msg, size_t len, const ip_addr_t *addr, uint16_t port) {
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)len, PBUF_RAM);
+    if (p == NULL) {
+        return;
+    }
+    memcpy(p->payload, msg, len);
+    send_datagram(p, addr, port);
+    pbuf_free(p);
+}
+
+static void send_empty(uint8_t type, uint16_t mid, const ip_addr_t *addr, uint16_t port) {
+    uint8_t msg[4] = { (uint8_t)((COAP_VERSION << 6) | (type << 4)), 0, (uint8_t)(mid >> 8), (uint8_t)mid };
+    send_copy(msg, sizeof(msg), addr, port);
+}
+
+/* ========== OBSERVERS ========== */
+
+static CoapObserver *find_observer(CoapResource res, const ip_addr_t *addr, uint16_t port) {
+    for (int i = 0; i < COAP_MAX_OBSERVERS; i++) {
+        CoapObserver *obs = &observers[i];
+        if (obs->used && obs->resource == res && obs->port == port && ip_addr_cmp(&obs->addr, addr)) {
+            return obs;
+        }
+    }
+    return NULL;
+}
+
+static void drop_observer(CoapObserver *obs, const char *reason) {
+    printf("CoAP: observador de /%s removido (%s)\n", resource_paths[obs->resource], reason);
+    obs->used = false;
+    stats.observers_dropped++;
+}
+
+/**
+ * @brief Register (or refresh) an observer; NULL when the table is full
+ */
+static CoapObserver *add_observer(CoapResource res, const CoapRequest *req, const ip_addr_t *addr,
+                                  uint16_t port) {
+    CoapObserver *obs = find_observer(res, addr, port); // Same client re-registering
+    for (int i = 0; obs == NULL && i < COAP_MAX_OBSERVERS; i++) {
+        if (!observers[i].used) {
+            obs = &observers[i];
+        }
+    }
+    if (obs == NULL) {
+        return NULL;
+    }
+    *obs = (CoapObserver){ .used = true, .resource = res, .addr = *addr, .port = port,
+                           .token_len = req->token_len };
+    memcpy(obs->token, req->token, req->token_len);
+    return obs;
+}
+
+/**
+ * @brief Build and send one notification of @p res to @p obs
+ *
+ * Confirmable notifications are built in the observer's pending buffer so
+ * they can be retransmitted; a new one replaces one still in flight.
+ */
+static void notify_observer(CoapObserver *obs, bool confirmable, const char *payload, size_t payload_len) {
+    CoapWriter w = { .buf = confirmable ? obs->pending_buf : notify_buf, .cap = COAP_NOTIFY_BUF_SIZE };
+    uint16_t mid = next_mid++;
+
+    put_header(&w, confirmable ? COAP_TYPE_CON : COAP_TYPE_NON, COAP_CONTENT, mid, obs->token, obs->token_len);
+    put_uint_option(&w, OPT_OBSERVE, observe_seq[obs->resource]);
+    put_uint_option(&w, OPT_CONTENT_FORMAT, CT_JSON);
+    uint8_t *body = put_payload(&w, payload_len);
+    if (w.overflow || body == NULL) {
+        return;
+    }
+    memcpy(body, payload, payload_len);
+    obs->last_mid = mid;
+
+    if (confirmable) {
+        if (!obs->pending) {
+            obs->retransmits = 0;
+            obs->timeout_ms = COAP_ACK_TIMEOUT_MS + get_rand_32() % (COAP_ACK_TIMEOUT_MS / 2);
+        }
+        obs->pending = true;
+        obs->pending_len = (uint16_t)w.len;
+        obs->deadline = make_timeout_time_ms(obs->timeout_ms);
+        obs->since_con = 0;
+        stats.notifications_con++;
+    } else {
+        stats.notifications_non++;
+    }
+    send_copy(w.buf, w.len, &obs->addr, obs->port);
+}
+
+/* ========== REQUEST HANDLING ========== */
+
+/**
+ * @brief /historico block: whole FlashLogRecords, from ?desde= or the oldest
+ */
+static void write_history(CoapWriter *w, const CoapRequest *req, uint8_t *code) {
+    uint32_t first = flash_log_first_seq();
+    uint32_t next = flash_log_next_seq();
+    uint32_t start = req->has_since && req->since > first ? req->since : first;
+    if (start > next) {
+        start = next;
+    }
+    uint32_t total = (next - start) * sizeof(FlashLogRecord);
+
+    uint32_t szx = COAP_BLOCK_SZX;
+    uint32_t num = 0;
+    if (req->has_block2) {
+        num = req->block2 >> 4;
+        if ((req->block2 & 0x07) < szx) {
+            szx = req->block2 & 0x07; // Client asked for smaller blocks
+        }
+    }
+    uint32_t size = 16u << szx;
+    uint32_t offset = num * size;
+    if (offset > total || (offset == total && num > 0)) {
+        *code = COAP_BAD_REQUEST;
+        return;
+    }
+    uint32_t len = total - offset < size ? total - offset : size;
+    bool more = offset + len < total;
+
+    uint8_t etag[4] = { (uint8_t)(start >> 24), (uint8_t)(start >> 16), (uint8_t)(start >> 8), (uint8_t)start };
+    put_option(w, OPT_ETAG, etag, sizeof(etag));
+    put_uint_option(w, OPT_CONTENT_FORMAT, CT_OCTET_STREAM);
+    put_uint_option(w, OPT_BLOCK2, num << 4 | (more ? 0x08 : 0) | szx);
+    if (num == 0) {
+        put_uint_option(w, OPT_SIZE2, total);
+    }
+
+    uint8_t *body = put_payload(w, len);
+    if (body == NULL) {
+        return;
+    }
+    uint32_t seq = start + offset / sizeof(FlashLogRecord);
+    for (uint32_t i = 0; i < len / sizeof(FlashLogRecord); i++) {
+        FlashLogRecord rec;
+        if (!flash_log_read(seq + i, &rec)) {
+            memset(&rec, 0, sizeof(rec)); // Corrupt slot: all-zero record (CRC fails on the host too)
+        }
+        memcpy(body + i * sizeof(FlashLogRecord), &rec, sizeof(rec));
+    }
+}
+
+static void write_core(CoapWriter *w) {
+    static const char links[] = "</sensores>;obs;ct=50;rt=\"smavhiot.sensores\","
+                                "</alertas>;obs;ct=50;rt=\"smavhiot.alertas\","
+                                "</historico>;ct=42;rt=\"smavhiot.historico\"";
+    put_uint_option(w, OPT_CONTENT_FORMAT, CT_LINK_FORMAT);
+    uint8_t *body = put_payload(w, sizeof(links) - 1);
+    if (body != NULL) {
+        memcpy(body, links, sizeof(links) - 1);
+    }
+}
+
+/**
+ * @brief Observable resources: current representation, registering if asked
+ */
+static void write_observable(CoapWriter *w, CoapResource res, const CoapRequest *req, const ip_addr_t *addr,
+                             uint16_t port) {
+    StateSnapshot snap;
+    state_snapshot_read(&snap);
+    char payload[COAP_NOTIFY_BUF_SIZE];
+    size_t len = res == RES_SENSORS ? render_sensors(payload, sizeof(payload), &snap.sensors)
+                                    : render_alerts(payload, sizeof(payload), &snap.alerts);
+    if (len == 0) {
+        w->overflow = true; // Representation does not fit: 5.00, no registration
+        return;
+    }
+
+    bool registered = false;
+    if (req->has_observe && req->observe == 0) {
+        registered = add_observer(res, req, addr, port) != NULL;
+        if (!registered) {
+            printf("CoAP: tabela de observadores cheia\n");
+        }
+    } else if (req->has_observe && req->observe == 1) {
+        CoapObserver *obs = find_observer(res, addr, port);
+        if (obs != NULL) {
+            obs->used = false;
+        }
+    }
+
+    if (registered) {
+        put_uint_option(w, OPT_OBSERVE, observe_seq[res]);
+    }
+    put_uint_option(w, OPT_CONTENT_FORMAT, CT_JSON);
+    uint8_t *body = put_payload(w, len);
+    if (body != NULL) {
+        memcpy(body, payload, len);
+    }
+}
+
+static void handle_request(const CoapRequest *req, const ip_addr_t *addr, uint16_t port) {
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, COAP_MAX_MESSAGE, PBUF_RAM);
+    if (p == NULL) {
+        return;
+    }
+    CoapWriter w = { .buf = p->payload, .cap = COAP_MAX_MESSAGE };
+    bool piggybacked = req->type == COAP_TYPE_CON;
+    uint8_t type = piggybacked ? COAP_TYPE_ACK : COAP_TYPE_NON;
+    uint16_t mid = piggybacked ? req->mid : next_mid++;
+
+    CoapResource res = RES_COUNT;
+    for (int i = 0; i < RES_COUNT; i++) {
+        if (strcmp(req->path, resource_paths[i]) == 0) {
+            res = (CoapResource)i;
+        }
+    }
+
+    uint8_t code = COAP_CONTENT;
+    if (req->bad_option) {
+        code = COAP_BAD_OPTION;
+    } else if (res == RES_COUNT) {
+        code = COAP_NOT_FOUND;
+    } else if (req->code != COAP_GET) {
+        code = COAP_METHOD_NOT_ALLOWED;
+    }
+
+    put_header(&w, type, code, mid, req->token, req->token_len);
+    if (code == COAP_CONTENT) {
+        size_t header_len = w.len;
+        switch (res) {
+            case RES_CORE: write_core(&w); break;
+            case RES_HISTORY: write_history(&w, req, &code); break;
+            default: write_observable(&w, res, req, addr, port); break;
+        }
+        if (code != COAP_CONTENT || w.overflow) {
+            w.len = header_len; // Drop the options written so far
+            w.buf[1] = code != COAP_CONTENT ? code : COAP_CODE(5, 0);
+        }
+    }
+
+    pbuf_realloc(p, (u16_t)w.len);
+    send_datagram(p, addr, port);
+    pbuf_free(p);
+}
+
+/**
+ * @brief ACK or RST from a client: settles confirmable notifications
+ */
+static void handle_reply(const CoapRequest *msg, const ip_addr_t *addr, uint16_t port) {
+    for (int i = 0; i < COAP_MAX_OBSERVERS; i++) {
+        CoapObserver *obs = &observers[i];
+        if (!obs->used || obs->last_mid != msg->mid || obs->port != port || !ip_addr_cmp(&obs->addr, addr)) {
+            continue;
+        }
+        if (msg->type == COAP_TYPE_RST) {
+            drop_observer(obs, "RST");
+        } else {
+            obs->pending = false;
+        }
+    }
+}
+
+static void coap_recv(void *arg, struct udp_pcb *upcb, struct pbuf *p, const ip_addr_t *addr, u16_t port) {
+    size_t len = pbuf_copy_partial(p, rx_buf, sizeof(rx_buf), 0);
+    stats.bytes_in += p->tot_len + IP_UDP_HEADERS;
+    pbuf_free(p);
+
+    CoapRequest req;
+    if (!parse_request(rx_buf, len, &req)) {
+        return; // Silently ignored (RFC 7252 §4.2)
+    }
+
+    if (req.type == COAP_TYPE_ACK || req.type == COAP_TYPE_RST) {
+        handle_reply(&req, addr, port);
+    } else if (req.code == 0) {
+        if (req.type == COAP_TYPE_CON) {
+            send_empty(COAP_TYPE_RST, req.mid, addr, port); // CoAP ping
+        }
+    } else if ((req.code >> 5) == 0) {
+        stats.requests++;
+        handle_request(&req, addr, port);
+    }
+}
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Open the CoAP port (once, after the first WiFi join)
+ */
+void coap_server_start(void) {
+    if (pcb != NULL) {
+        return;
+    }
+
+    cyw43_arch_lwip_begin();
+    pcb = udp_new_ip_type(IPADDR_TYPE_ANY);
+    if (pcb != NULL && udp_bind(pcb, IP_ANY_TYPE, COAP_PORT) != ERR_OK) {
+        udp_remove(pcb);
+        pcb = NULL;
+    }
+    if (pcb != NULL) {
+        udp_recv(pcb, coap_recv, NULL);
+    }
+    cyw43_arch_lwip_end();
+
+    next_mid = (uint16_t)get_rand_32();
+    last_notified = nil_time;
+    if (pcb != NULL) {
+        printf("Servidor CoAP na porta %d\n", COAP_PORT);
+    } else {
+        printf("Falha ao abrir a porta CoAP %d\n", COAP_PORT);
+    }
+}
+
+/**
+ * @brief Notify observers of a new acquisition (network context)
+ *
+ * Safe to call repeatedly with the same sample: only a new @p timestamp
+ * produces notifications.
+ */
+void coap_server_notify(const SensorData *sensors, const AlertStatus *alerts, absolute_time_t timestamp) {
+    if (pcb == NULL || to_us_since_boot(timestamp) == to_us_since_boot(last_notified)) {
+        return;
+    }
+    last_notified = timestamp;
+
+    uint16_t mask = alert_mask(alerts);
+    bool alerts_changed = mask != last_alert_mask;
+    last_alert_mask = mask;
+
+    char sensors_json[COAP_NOTIFY_BUF_SIZE - COAP_HEADER_OVERHEAD / 2];
+    char alerts_json[COAP_NOTIFY_BUF_SIZE - COAP_HEADER_OVERHEAD / 2];
+    size_t sensors_len = render_sensors(sensors_json, sizeof(sensors_json), sensors);
+    size_t alerts_len = render_alerts(alerts_json, sizeof(alerts_json), alerts);
+
+    cyw43_arch_lwip_begin();
+    observe_seq[RES_SENSORS] = (observe_seq[RES_SENSORS] + 1) & 0xFFFFFF;
+    if (alerts_changed) {
+        observe_seq[RES_ALERTS] = (observe_seq[RES_ALERTS] + 1) & 0xFFFFFF;
+    }
+
+    for (int i = 0; i < COAP_MAX_OBSERVERS; i++) {
+        CoapObserver *obs = &observers[i];
+        if (!obs->used) {
+            continue;
+        }
+        if (obs->resource == RES_SENSORS && !obs->pending && sensors_len > 0) {
+            bool confirmable = ++obs->since_con >= COAP_CON_EVERY;
+            notify_observer(obs, confirmable, sensors_json, sensors_len);
+        } else if (obs->resource == RES_ALERTS && alerts_changed && alerts_len > 0) {
+            notify_observer(obs, true, alerts_json, alerts_len);
+        }
+    }
+    cyw43_arch_lwip_end();
+}
+
+/**
+ * @brief Retransmit overdue confirmable notifications (network context)
+ *
+ * @return When the next retransmission is due (at_the_end_of_time if none)
+ */
+absolute_time_t coap_server_poll(void) {
+    absolute_time_t next = at_the_end_of_time;
+    if (pcb == NULL) {
+        return next;
+    }
+
+    cyw43_arch_lwip_begin();
+    for (int i = 0; i < COAP_MAX_OBSERVERS; i++) {
+        CoapObserver *obs = &observers[i];
+        if (!obs->used || !obs->pending) {
+            continue;
+        }
+        if (time_reached(obs->deadline)) {
+            if (obs->retransmits >= COAP_MAX_RETRANSMIT) {
+                drop_observer(obs, "sem ACK");
+                continue;
+            }
+            obs->retransmits++;
+            obs->timeout_ms *= 2;
+            obs->deadline = make_timeout_time_ms(obs->timeout_ms);
+            stats.retransmissions++;
+            send_copy(obs->pending_buf, obs->pending_len, &obs->addr, obs->port);
+        }
+        if (absolute_time_diff_us(obs->deadline, next) > 0) {
+            next = obs->deadline;
+        }
+    }
+    cyw43_arch_lwip_end();
+    return next;
+}
+
+void coap_server_print_stats(void) {
+    if (pcb == NULL) {
+        return;
+    }
+    int active = 0;
+    for (int i = 0; i < COAP_MAX_OBSERVERS; i++) {
+        active += observers[i].used;
+    }
+    printf("[coap] %lu requisicoes, %lu notificacoes NON, %lu CON, %lu retransmissoes, "
+           "%d observadores (%lu removidos), %lu B recebidos, %lu B enviados\n",
+           (unsigned long)stats.requests, (unsigned long)stats.notifications_non,
+           (unsigned long)stats.notifications_con, (unsigned long)stats.retransmissions, active,
+           (unsigned long)stats.observers_dropped, (unsigned long)stats.bytes_in, (unsigned long)stats.bytes_out);
+}
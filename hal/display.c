@@ -10,10 +10,13 @@
 #include "display.h"
 #include "ssd1306.h"
 #include <stdio.h>
+#include <math.h>
 
 /* ========== PRIVATE VARIABLES ========== */
 
 static ssd1306_t disp; // Display driver instance for SSD1306 OLED
+static bool disp_on = true;       // Panel state last sent to the controller
+static uint8_t disp_contrast = 0xFF;
 
 /* ========== PUBLIC INTERFACE FUNCTIONS ========== */
 
@@ -35,17 +38,17 @@ void display_init(i2c_inst_t *i2c_port, uint8_t i2c_address) {
  * @brief Render comprehensive environmental sensor data display
  * 
  * Creates formatted multi-line display showing temperature, humidity,
- * atmospheric pressure, and light intensity with sensor status indicators.
+ * CO2 concentration, and light intensity with sensor status indicators.
  * Layout optimized for 128x64 OLED display readability.
  * 
  * @param aht_temp Temperature reading from AHT10 sensor (°C)
  * @param humidity Relative humidity reading (%)
- * @param pressure Atmospheric pressure reading (hPa) - may be unused
- * @param bmp_ok BMP280 sensor operational status
+ * @param co2_ppm CO2 concentration from SCD4x sensor (ppm)
+ * @param co2_ok SCD4x sensor operational status
  * @param lux Light intensity reading (lux)
  * @param bh1750_ok BH1750 sensor operational status
  */
-void display_update(float aht_temp, float humidity, float pressure, bool bmp_ok, float lux, bool bh1750_ok) {
+void display_update(float aht_temp, float humidity, float co2_ppm, bool co2_ok, float lux, bool bh1750_ok) {
     char line1[20], line2[20], line3[20], line4[20]; // Text buffer for each display line
     ssd1306_clear(&disp); // Clear display buffer for fresh content
     
@@ -55,11 +58,11 @@ void display_update(float aht_temp, float humidity, float pressure, bool bmp_ok,
     // Format humidity reading with integer precision and percentage symbol
     snprintf(line2, sizeof(line2), "Umid: %.0f %%RH", humidity);
     
-    // Format pressure reading with sensor status indication
-    if (bmp_ok) {
-        snprintf(line3, sizeof(line3), "Pres: %.0f hPa", pressure);
+    // Format CO2 reading with sensor status indication
+    if (co2_ok) {
+        snprintf(line3, sizeof(line3), "CO2: %.0f ppm", co2_ppm);
     } else {
-        snprintf(line3, sizeof(line3), "Pres: Falha"); // Indicate sensor failure
+        snprintf(line3, sizeof(line3), "CO2: Falha"); // Indicate sensor failure
     }
     
     // Format light intensity reading with sensor status indication
@@ -72,7 +75,7 @@ void display_update(float aht_temp, float humidity, float pressure, bool bmp_ok,
     // Render text lines at 16-pixel intervals for proper spacing
     ssd1306_draw_string(&disp, 0, 0, 1, line1);   // Line 1: Temperature
     ssd1306_draw_string(&disp, 0, 16, 1, line2);  // Line 2: Humidity
-    ssd1306_draw_string(&disp, 0, 32, 1, line3);  // Line 3: Pressure
+    ssd1306_draw_string(&disp, 0, 32, 1, line3);  // Line 3: CO2
     ssd1306_draw_string(&disp, 0, 48, 1, line4);  // Line 4: Light intensity
     
     ssd1306_show(&disp); // Update physical display with buffered content
@@ -138,6 +141,39 @@ void display_render_wifi_status(const char* text, bool status, bool is_alert) {
     ssd1306_show(&disp); // Update physical display with buffered content
 }
 
+/**
+ * @brief Render MQTT connection and Wi-Fi link quality
+ * 
+ * Shows the broker connection, the link class chosen by the link monitor,
+ * the filtered RSSI and the telemetry interval that class currently gives.
+ * 
+ * @param connected Broker connection state
+ * @param link_class Link class name ("boa", "regular", "ruim")
+ * @param rssi_dbm Filtered RSSI (dBm, 0 if not sampled yet)
+ * @param interval_s Current telemetry interval (s)
+ */
+void display_render_mqtt_status(bool connected, const char *link_class, int32_t rssi_dbm, uint32_t interval_s) {
+    char line1[20], line2[20], line3[20], line4[20]; // Text buffer for each display line
+    ssd1306_clear(&disp); // Clear display buffer for fresh content
+    
+    snprintf(line1, sizeof(line1), "MQTT: %s", connected ? "Conectado" : "Desconectado");
+    snprintf(line2, sizeof(line2), "Link: %s", link_class);
+    if (rssi_dbm != 0) {
+        int rssi = rssi_dbm < -128 ? -128 : rssi_dbm > 0 ? 0 : (int)rssi_dbm; // Keeps the line within 16 columns
+        snprintf(line3, sizeof(line3), "RSSI: %d dBm", rssi);
+    } else {
+        snprintf(line3, sizeof(line3), "RSSI: --");
+    }
+    snprintf(line4, sizeof(line4), "Envio: %lus", (unsigned long)interval_s);
+    
+    ssd1306_draw_string(&disp, 0, 0, 1, line1);   // Line 1: Broker connection
+    ssd1306_draw_string(&disp, 0, 16, 1, line2);  // Line 2: Link class
+    ssd1306_draw_string(&disp, 0, 32, 1, line3);  // Line 3: Signal strength
+    ssd1306_draw_string(&disp, 0, 48, 1, line4);  // Line 4: Telemetry interval
+    
+    ssd1306_show(&disp); // Update physical display with buffered content
+}
+
 /**
  * @brief Render environmental alert status display
  * 
@@ -165,6 +201,54 @@ void display_render_alerts(bool temp_critical, bool humidity_critical, bool lux_
     ssd1306_show(&disp); // Update physical display with buffered content
 }
 
+/**
+ * @brief Render nutrient solution readings
+ * 
+ * Shows pH, electrical conductivity and reservoir level from the analog
+ * probes, the solution temperature and the nutrient line flow, or a failure
+ * notice for each input that is not running.
+ * 
+ * @param ph Solution pH
+ * @param ec Solution conductivity (mS/cm)
+ * @param level Reservoir level (% of full)
+ * @param probes_ok Analog probe sampler operational status
+ * @param flow_lpm Nutrient line flow (L/min)
+ * @param pulses_ok Pulse counter operational status
+ * @param water_temp Solution temperature (°C, NaN if unknown)
+ */
+void display_render_nutrients(float ph, float ec, float level, bool probes_ok, float flow_lpm, bool pulses_ok,
+                              float water_temp) {
+    char line1[20], line2[20], line3[20], line4[20]; // Text buffer for each display line
+    ssd1306_clear(&disp); // Clear display buffer for fresh content
+    
+    if (probes_ok) {
+        if (isnan(water_temp)) {
+            snprintf(line1, sizeof(line1), "pH: %.2f", ph);
+        } else {
+            snprintf(line1, sizeof(line1), "pH:%.2f T:%.1fC", ph, water_temp);
+        }
+        snprintf(line2, sizeof(line2), "EC: %.2f mS/cm", ec);
+        snprintf(line3, sizeof(line3), "Nivel: %.0f %%", level);
+    } else {
+        snprintf(line1, sizeof(line1), "pH: Falha");
+        snprintf(line2, sizeof(line2), "EC: Falha");
+        snprintf(line3, sizeof(line3), "Nivel: Falha");
+    }
+    
+    if (pulses_ok) {
+        snprintf(line4, sizeof(line4), "Vazao: %.1f L/min", flow_lpm);
+    } else {
+        snprintf(line4, sizeof(line4), "Vazao: Falha");
+    }
+    
+    ssd1306_draw_string(&disp, 0, 0, 1, line1);   // Line 1: pH
+    ssd1306_draw_string(&disp, 0, 16, 1, line2);  // Line 2: Conductivity
+    ssd1306_draw_string(&disp, 0, 32, 1, line3);  // Line 3: Reservoir level
+    ssd1306_draw_string(&disp, 0, 48, 1, line4);  // Line 4: Nutrient flow
+    
+    ssd1306_show(&disp); // Update physical display with buffered content
+}
+
 /**
  * @brief Clear display buffer without updating screen
  * 
@@ -183,4 +267,26 @@ void display_clear(void) {
  */
 void display_show(void) {
     ssd1306_show(&disp);
-}
\ No newline at end of file
+}
+/**
+ * @brief Set the panel power and contrast (power saving)
+ *
+ * Only sends commands when something changes, so it can be called before
+ * every refresh. While the panel is off the controller keeps its RAM.
+ *
+ * @param on       false puts the controller to sleep (panel dark)
+ * @param contrast Contrast to use while on (0x00-0xFF)
+ */
+void display_set_power(bool on, uint8_t contrast) {
+    if (on && !disp_on) {
+        ssd1306_poweron(&disp);
+    } else if (!on && disp_on) {
+        ssd1306_poweroff(&disp);
+    }
+    disp_on = on;
+
+    if (on && contrast != disp_contrast) {
+        ssd1306_contrast(&disp, contrast);
+        disp_contrast = contrast;
+    }
+}
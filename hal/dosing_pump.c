@@ -0,0 +1,494 @@
+/**
+ * @file dosing_pump.c
+ * @brief Stepper-driven dosing pumps: PIO step generation with DMA-fed ramps
+ *
+ * Each pump has a state machine running drivers/stepper.pio, which emits one
+ * STEP pulse per 16-bit period word, and a DMA channel feeding it. A dose of
+ * N steps is at most four DMA segments: the acceleration table, the cruise
+ * period repeated (read increment off), the mirrored table for deceleration
+ * and a 0 word that makes the state machine raise its IRQ flag. The CPU only
+ * chains the segments from the DMA interrupt (the joined 8-word FIFO covers
+ * the latency) and turns the PIO interrupt into a completion event, so step
+ * timing never competes with lwIP or the sample loop.
+ *
+ * The ramp follows constant acceleration, v(i) = sqrt(v0² + 2·a·i), computed
+ * once at init. Short doses use a triangular profile: half the steps on the
+ * way up, half on the way down. All pumps share one ENABLE line, asserted
+ * while any pump runs (peristaltic pumps need no holding torque).
+ *
+ * Requests arrive from the sampling context (local rules) and from lwIP
+ * (MQTT commands), possibly on the other core, so queues and pump state are
+ * guarded by a critical section that the interrupt handlers also take.
+ */
+
+#include "dosing_pump.h"
+#include "app_config.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "hardware/timer.h"
+#include "pico/critical_section.h"
+#include "stepper.pio.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+_Static_assert(sizeof(stepper_program_instructions) / sizeof(uint16_t) == DOSING_PIO_INSTRUCTIONS,
+               "update DOSING_PIO_INSTRUCTIONS (PIO budget)");
+
+/* ========== PRIVATE TYPES ========== */
+
+#define STEP_OVERHEAD_US 12u           // Step period = word + 12 cycles (1 cycle = 1us)
+#define RAMP_MAX_STEPS 512             // Longest acceleration ramp kept in RAM
+#define EVENT_QUEUE_LEN 8
+#define MAX_SEGMENTS 4                 // Ramp up, cruise, ramp down, end word
+
+#define DOSING_DMA_IRQ DMA_IRQ_1       // Shared with the ADC probes; DMA_IRQ_0 is left to the CYW43 driver
+#define DOSING_DMA_IRQ_INDEX 1
+
+/**
+ * @brief One DMA transfer of a dose
+ */
+typedef struct {
+    const uint16_t *src;
+    uint32_t count;
+    bool increment;
+} Segment;
+
+typedef struct {
+    int32_t steps;                     // Signed: negative runs the pump backwards
+    float ml;
+    DoseSource source;
+    uint32_t id;
+} DoseRequest;
+
+/**
+ * @brief Hardware, running dose and request queue of one pump
+ */
+typedef struct {
+    uint step_pin;
+    uint dir_pin;
+    float steps_per_ml;
+    PIO pio;
+    uint sm;
+    int dma;
+    bool running;                      // Resources claimed
+
+    bool active;                       // A dose is on the wire
+    DoseRequest dose;
+    Segment segments[MAX_SEGMENTS];
+    uint seg_count;
+    uint seg_index;
+    uint32_t steps_done;               // Steps in the segments already transferred
+    uint16_t cruise_word;
+    uint64_t start_us;
+
+    DoseRequest queue[DOSING_QUEUE_LEN];
+    uint queue_head;
+    uint queue_count;
+} DosingPump;
+
+/* ========== PRIVATE VARIABLES ========== */
+
+static DosingPump pumps[DOSING_PUMP_COUNT] = {
+    [DOSING_PUMP_NUTRIENT] = { .step_pin = DOSING_NUTRIENT_STEP_PIN, .dir_pin = DOSING_NUTRIENT_DIR_PIN,
+                               .steps_per_ml = DOSING_NUTRIENT_STEPS_PER_ML },
+    [DOSING_PUMP_PH_DOWN]  = { .step_pin = DOSING_PH_STEP_PIN, .dir_pin = DOSING_PH_DIR_PIN,
+                               .steps_per_ml = DOSING_PH_STEPS_PER_ML },
+};
+
+static const char *const pump_names[DOSING_PUMP_COUNT] = { "nutriente", "ph" };
+
+// Step period words: accel_ramp[i] for step i of the ramp, decel_ramp mirrored
+static uint16_t accel_ramp[RAMP_MAX_STEPS];
+static uint16_t decel_ramp[RAMP_MAX_STEPS];
+static uint ramp_len;
+static const uint16_t end_word = 0;
+
+static DoseEvent events[EVENT_QUEUE_LEN];
+static uint event_head;
+static uint event_count;
+static uint32_t events_lost;
+
+static critical_section_t dosing_lock;
+
+static PIO program_pio;                // DOSING_PIO once the program is loaded (shared by all pumps)
+static uint program_offset;
+static uint32_t pio_irqs_hooked;       // PIO IRQ lines with our handler installed
+
+/* ========== PRIVATE FUNCTIONS ========== */
+
+static uint16_t period_word(float steps_per_s) {
+    float period_us = 1000000.0f / steps_per_s;
+    if (period_us > 65535.0f + STEP_OVERHEAD_US) {
+        return 65535;
+    }
+    return period_us > STEP_OVERHEAD_US + 1 ? (uint16_t)(period_us - STEP_OVERHEAD_US) : 1;
+}
+
+/**
+ * @brief Constant-acceleration ramp from DOSING_START_SPS up to DOSING_MAX_SPS
+ */
+static void build_ramp(void) {
+    float v0 = DOSING_START_SPS;
+    float v_max = DOSING_MAX_SPS;
+    float accel = DOSING_ACCEL_SPS2;
+
+    ramp_len = (uint)((v_max * v_max - v0 * v0) / (2.0f * accel)) + 1;
+    if (ramp_len > RAMP_MAX_STEPS) {
+        ramp_len = RAMP_MAX_STEPS;
+    }
+    for (uint i = 0; i < ramp_len; i++) {
+        float v = sqrtf(v0 * v0 + 2.0f * accel * i);
+        accel_ramp[i] = period_word(v < v_max ? v : v_max);
+    }
+    for (uint i = 0; i < ramp_len; i++) {
+        decel_ramp[i] = accel_ramp[ramp_len - 1 - i];
+    }
+}
+
+static void set_drivers_enabled(bool enabled) {
+    gpio_put(DOSING_ENABLE_PIN, !enabled); // Active low
+}
+
+static void start_segment(DosingPump *p) {
+    const Segment *seg = &p->segments[p->seg_index];
+    dma_channel_config cfg = dma_channel_get_default_config(p->dma);
+    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_16);
+    channel_config_set_read_increment(&cfg, seg->increment);
+    channel_config_set_write_increment(&cfg, false);
+    channel_config_set_dreq(&cfg, pio_get_dreq(p->pio, p->sm, true));
+    dma_channel_configure(p->dma, &cfg, &p->pio->txf[p->sm], seg->src, seg->count, true);
+}
+
+static void add_segment(DosingPump *p, const uint16_t *src, uint32_t count, bool increment) {
+    if (count > 0) {
+        p->segments[p->seg_count++] = (Segment){ .src = src, .count = count, .increment = increment };
+    }
+}
+
+/**
+ * @brief Split a dose into DMA segments and start the first one (lock held)
+ */
+static void start_dose(DosingPump *p, const DoseRequest *req) {
+    uint32_t steps = (uint32_t)abs(req->steps);
+    uint32_t ramp = steps / 2 < ramp_len ? steps / 2 : ramp_len;
+
+    p->cruise_word = accel_ramp[ramp < ramp_len ? ramp : ramp_len - 1];
+    p->seg_count = 0;
+    add_segment(p, accel_ramp, ramp, true);
+    add_segment(p, &p->cruise_word, steps - 2 * ramp, false);
+    add_segment(p, &decel_ramp[ramp_len - ramp], ramp, true);
+    add_segment(p, &end_word, 1, false);
+
+    gpio_put(p->dir_pin, req->steps < 0);
+    set_drivers_enabled(true);
+
+    p->dose = *req;
+    p->active = true;
+    p->seg_index = 0;
+    p->steps_done = 0;
+    p->start_us = time_us_64();
+
+    // The previous dose's last segment may still have its interrupt pending
+    dma_irqn_acknowledge_channel(DOSING_DMA_IRQ_INDEX, (uint)p->dma);
+    start_segment(p);
+}
+
+static void push_event(const DosingPump *p, const DoseRequest *req, int32_t delivered_steps,
+                       uint32_t duration_ms, bool cancelled) {
+    if (event_count == EVENT_QUEUE_LEN) {
+        events_lost++;
+        return;
+    }
+    DoseEvent *ev = &events[(event_head + event_count++) % EVENT_QUEUE_LEN];
+    *ev = (DoseEvent){
+        .pump = (DosingPumpId)(p - pumps),
+        .source = req->source,
+        .id = req->id,
+        .requested_ml = req->ml,
+        .delivered_ml = delivered_steps / p->steps_per_ml,
+        .delivered_steps = delivered_steps,
+        .duration_ms = duration_ms,
+        .cancelled = cancelled,
+    };
+}
+
+static bool any_pump_active(void) {
+    for (int i = 0; i < DOSING_PUMP_COUNT; i++) {
+        if (pumps[i].active) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Report the running dose and start the next queued one (lock held)
+ */
+static void finish_dose(DosingPump *p, int32_t delivered_steps, bool cancelled) {
+    push_event(p, &p->dose, delivered_steps, (uint32_t)((time_us_64() - p->start_us) / 1000), cancelled);
+    p->active = false;
+
+    if (p->queue_count > 0) {
+        DoseRequest next = p->queue[p->queue_head];
+        p->queue_head = (p->queue_head + 1) % DOSING_QUEUE_LEN;
+        p->queue_count--;
+        start_dose(p, &next);
+    } else if (!any_pump_active()) {
+        set_drivers_enabled(false);
+    }
+}
+
+/**
+ * @brief Chain the next segment of every pump whose DMA transfer ended
+ */
+static void __isr dosing_dma_irq_handler(void) {
+    for (int i = 0; i < DOSING_PUMP_COUNT; i++) {
+        DosingPump *p = &pumps[i];
+        if (!p->running || !dma_irqn_get_channel_status(DOSING_DMA_IRQ_INDEX, (uint)p->dma)) {
+            continue;
+        }
+        dma_irqn_acknowledge_channel(DOSING_DMA_IRQ_INDEX, (uint)p->dma);
+
+        critical_section_enter_blocking(&dosing_lock);
+        if (p->active && p->seg_index + 1 < p->seg_count) {
+            p->steps_done += p->segments[p->seg_index].count;
+            p->seg_index++;
+            start_segment(p);
+        }
+        critical_section_exit(&dosing_lock);
+    }
+}
+
+/**
+ * @brief A state machine consumed its end word: the last step is out
+ */
+static void __isr dosing_pio_irq_handler(void) {
+    for (int i = 0; i < DOSING_PUMP_COUNT; i++) {
+        DosingPump *p = &pumps[i];
+        if (!p->running || !pio_interrupt_get(p->pio, p->sm)) {
+            continue;
+        }
+        pio_interrupt_clear(p->pio, p->sm);
+
+        critical_section_enter_blocking(&dosing_lock);
+        if (p->active) {
+            finish_dose(p, p->dose.steps, false);
+        }
+        critical_section_exit(&dosing_lock);
+    }
+}
+
+/**
+ * @brief Claim a state machine in DOSING_PIO, loading the program on first use
+ */
+static bool claim_state_machine(DosingPump *p) {
+    PIO pio = pio_get_instance(DOSING_PIO);
+    if (program_pio == NULL && !pio_can_add_program(pio, &stepper_program)) {
+        return false;
+    }
+    int sm = pio_claim_unused_sm(pio, false);
+    if (sm < 0) {
+        return false;
+    }
+    if (program_pio == NULL) {
+        program_offset = pio_add_program(pio, &stepper_program);
+        program_pio = pio;
+    }
+    p->pio = pio;
+    p->sm = (uint)sm;
+    return true;
+}
+
+static bool start_pump(DosingPump *p) {
+    gpio_init(p->dir_pin);
+    gpio_set_dir(p->dir_pin, GPIO_OUT);
+    gpio_put(p->dir_pin, 0);
+
+    if (!claim_state_machine(p)) {
+        return false;
+    }
+    p->dma = dma_claim_unused_channel(false);
+    if (p->dma < 0) {
+        pio_sm_unclaim(p->pio, p->sm);
+        return false;
+    }
+
+    stepper_program_init(p->pio, p->sm, program_offset, p->step_pin);
+    pio_interrupt_clear(p->pio, p->sm);
+    pio_set_irqn_source_enabled(p->pio, 0, (enum pio_interrupt_source)(pis_interrupt0 + p->sm), true);
+
+    uint irq = pio_get_irq_num(p->pio, 0);
+    if (!(pio_irqs_hooked & (1u << irq))) {
+        irq_add_shared_handler(irq, dosing_pio_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(irq, true);
+        pio_irqs_hooked |= 1u << irq;
+    }
+    dma_irqn_set_channel_enabled(DOSING_DMA_IRQ_INDEX, (uint)p->dma, true);
+
+    p->running = true;
+    return true;
+}
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Build the ramp and start every pump's state machine (drivers disabled)
+ *
+ * @return true if all pumps got a state machine and a DMA channel
+ */
+bool dosing_pump_init(void) {
+    critical_section_init(&dosing_lock);
+    build_ramp();
+
+    gpio_init(DOSING_ENABLE_PIN);
+    gpio_set_dir(DOSING_ENABLE_PIN, GPIO_OUT);
+    set_drivers_enabled(false);
+
+    irq_add_shared_handler(DOSING_DMA_IRQ, dosing_dma_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DOSING_DMA_IRQ, true);
+
+    bool ok = true;
+    for (int i = 0; i < DOSING_PUMP_COUNT; i++) {
+        if (!start_pump(&pumps[i])) {
+            printf("Bomba dosadora %s: sem recursos para GPIO %u\n", pump_names[i], pumps[i].step_pin);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+/**
+ * @brief Queue a dose; it starts at once if the pump is idle
+ *
+ * Safe from any core and from lwIP callbacks.
+ *
+ * @param pump Pump to run
+ * @param volume_ml Volume to deliver (negative runs the pump backwards)
+ * @param source Origin reported in the completion event
+ * @param id Identifier reported in the completion event
+ * @return false if the volume is out of range, the pump unavailable or its queue full
+ */
+bool dosing_pump_request(DosingPumpId pump, float volume_ml, DoseSource source, uint32_t id) {
+    if (pump >= DOSING_PUMP_COUNT || !(fabsf(volume_ml) <= DOSING_MAX_DOSE_ML)) {
+        return false;
+    }
+    DosingPump *p = &pumps[pump];
+    DoseRequest req = {
+        .steps = (int32_t)lroundf(volume_ml * p->steps_per_ml),
+        .ml = volume_ml,
+        .source = source,
+        .id = id,
+    };
+    if (!p->running || req.steps == 0) {
+        return false;
+    }
+
+    bool accepted = true;
+    critical_section_enter_blocking(&dosing_lock);
+    if (!p->active) {
+        start_dose(p, &req);
+    } else if (p->queue_count < DOSING_QUEUE_LEN) {
+        p->queue[(p->queue_head + p->queue_count++) % DOSING_QUEUE_LEN] = req;
+    } else {
+        accepted = false;
+    }
+    critical_section_exit(&dosing_lock);
+    return accepted;
+}
+
+/**
+ * @brief Stop the running dose and drop the queued ones
+ *
+ * Every dropped request gets a cancelled event; the running one reports
+ * the steps already generated (to within a step).
+ */
+void dosing_pump_cancel(DosingPumpId pump) {
+    if (pump >= DOSING_PUMP_COUNT || !pumps[pump].running) {
+        return;
+    }
+    DosingPump *p = &pumps[pump];
+
+    critical_section_enter_blocking(&dosing_lock);
+    while (p->queue_count > 0) {
+        push_event(p, &p->queue[p->queue_head], 0, 0, true);
+        p->queue_head = (p->queue_head + 1) % DOSING_QUEUE_LEN;
+        p->queue_count--;
+    }
+
+    if (p->active) {
+        // Steps handed to the FIFO minus those still waiting in it
+        const Segment *seg = &p->segments[p->seg_index];
+        uint32_t sent = p->steps_done;
+        if (seg->src != &end_word) {
+            sent += seg->count - dma_channel_hw_addr((uint)p->dma)->transfer_count;
+        }
+        uint32_t waiting = pio_sm_get_tx_fifo_level(p->pio, p->sm);
+        int32_t delivered = (int32_t)(sent > waiting ? sent - waiting : 0);
+
+        // The abort may raise a completion interrupt: mask it meanwhile
+        dma_irqn_set_channel_enabled(DOSING_DMA_IRQ_INDEX, (uint)p->dma, false);
+        dma_channel_abort((uint)p->dma);
+        dma_irqn_acknowledge_channel(DOSING_DMA_IRQ_INDEX, (uint)p->dma);
+        dma_irqn_set_channel_enabled(DOSING_DMA_IRQ_INDEX, (uint)p->dma, true);
+
+        pio_sm_set_enabled(p->pio, p->sm, false);
+        pio_sm_clear_fifos(p->pio, p->sm);
+        pio_sm_restart(p->pio, p->sm);
+        pio_sm_set_pins_with_mask(p->pio, p->sm, 0, 1u << p->step_pin);
+        pio_sm_exec(p->pio, p->sm, pio_encode_jmp(program_offset));
+        pio_interrupt_clear(p->pio, p->sm);
+        pio_sm_set_enabled(p->pio, p->sm, true);
+
+        finish_dose(p, p->dose.steps < 0 ? -delivered : delivered, true);
+    }
+    critical_section_exit(&dosing_lock);
+}
+
+/**
+ * @brief true while the pump runs a dose or has doses queued
+ */
+bool dosing_pump_busy(DosingPumpId pump) {
+    return pump < DOSING_PUMP_COUNT && (pumps[pump].active || pumps[pump].queue_count > 0);
+}
+
+/**
+ * @brief Take the oldest completion event
+ *
+ * @return false if none is waiting
+ */
+bool dosing_pump_get_event(DoseEvent *out) {
+    bool found = false;
+    critical_section_enter_blocking(&dosing_lock);
+    if (event_count > 0) {
+        *out = events[event_head];
+        event_head = (event_head + 1) % EVENT_QUEUE_LEN;
+        event_count--;
+        found = true;
+    }
+    uint32_t lost = events_lost;
+    events_lost = 0;
+    critical_section_exit(&dosing_lock);
+
+    if (lost > 0) {
+        printf("Bombas dosadoras: %lu evento(s) de conclusão descartado(s)\n", (unsigned long)lost);
+    }
+    return found;
+}
+
+/**
+ * @brief Pump name used in commands, events and logs
+ */
+const char *dosing_pump_name(DosingPumpId pump) {
+    return pump < DOSING_PUMP_COUNT ? pump_names[pump] : "?";
+}
+
+/**
+ * @brief Request origin as reported in events
+ */
+const char *dosing_source_name(DoseSource source) {
+    return source == DOSE_SOURCE_MQTT ? "mqtt" : "regra";
+}
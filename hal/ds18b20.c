@@ -0,0 +1,230 @@
+/**
+ * @file ds18b20.c
+ * @brief Non-blocking DS18B20 acquisition on the PIO 1-Wire bus
+ *
+ * A 10ms repeating timer steps a small state machine that never waits on
+ * the bus itself; every step starts a DMA command batch and returns:
+ *
+ *   IDLE        every DS18B20_INTERVAL_MS: reset, SKIP ROM, CONVERT T
+ *               (one broadcast conversion for all probes)
+ *   CONVERTING  presence checked; issue a read slot
+ *   POLLING     the probes hold the line low until the conversion ends:
+ *               re-issue one read slot per tick until it reads 1
+ *   READING     one batch with reset, MATCH ROM and READ SCRATCHPAD for
+ *               every probe; CRC-checked results are published
+ *
+ * The 750ms conversion therefore costs a few microseconds of CPU per tick
+ * and neither the sample loop nor lwIP ever blocks on it.
+ */
+
+#include "ds18b20.h"
+#include "app_config.h"
+#include "onewire.h"
+#include "pico/critical_section.h"
+#include "pico/time.h"
+#include <stdio.h>
+
+/* ========== PROTOCOL ========== */
+
+#define DS18B20_FAMILY 0x28
+#define DS18B20_CMD_CONVERT_T 0x44
+#define DS18B20_CMD_READ_SCRATCHPAD 0xBE
+#define SCRATCHPAD_SIZE 9
+
+// Per probe: reset, MATCH ROM, 8 ROM bytes, READ SCRATCHPAD, 9 scratchpad bytes
+#define READ_WORDS_PER_PROBE (1 + 1 + 8 + 1 + SCRATCHPAD_SIZE)
+#define READ_SCRATCHPAD_OFFSET (READ_WORDS_PER_PROBE - SCRATCHPAD_SIZE)
+
+#define RESULT_STALE_MS (3 * DS18B20_INTERVAL_MS) // Older readings are reported invalid
+
+/* ========== PRIVATE TYPES ========== */
+
+typedef enum {
+    BUS_IDLE = 0,
+    BUS_CONVERTING,
+    BUS_POLLING,
+    BUS_READING
+} BusState;
+
+/* ========== PRIVATE VARIABLES ========== */
+
+static OneWireBus bus;
+static uint64_t roms[DS18B20_MAX_PROBES];
+static int probe_count;
+
+// DMA batch buffers (owned by the timer callback while a batch runs)
+static uint32_t commands[DS18B20_MAX_PROBES * READ_WORDS_PER_PROBE];
+static uint32_t results[DS18B20_MAX_PROBES * READ_WORDS_PER_PROBE];
+
+static repeating_timer_t tick_timer;
+static BusState state;
+static absolute_time_t next_conversion;
+static absolute_time_t conversion_deadline;
+
+// Published results (timer IRQ -> application)
+static critical_section_t result_lock;
+static float temperatures[DS18B20_MAX_PROBES];
+static absolute_time_t read_time[DS18B20_MAX_PROBES];
+
+/* ========== PRIVATE FUNCTIONS ========== */
+
+static void start_conversion(void) {
+    commands[0] = onewire_cmd_reset();
+    commands[1] = onewire_cmd_byte(ONEWIRE_CMD_SKIP_ROM);
+    commands[2] = onewire_cmd_byte(DS18B20_CMD_CONVERT_T);
+    onewire_start(&bus, commands, results, 3);
+}
+
+static void start_poll_slot(void) {
+    commands[0] = onewire_cmd_bits(0x01, 1);
+    onewire_start(&bus, commands, results, 1);
+}
+
+static void start_scratchpad_reads(void) {
+    uint32_t *cmd = commands;
+    for (int p = 0; p < probe_count; p++) {
+        *cmd++ = onewire_cmd_reset();
+        *cmd++ = onewire_cmd_byte(ONEWIRE_CMD_MATCH_ROM);
+        for (int i = 0; i < 8; i++) {
+            *cmd++ = onewire_cmd_byte((uint8_t)(roms[p] >> (8 * i)));
+        }
+        *cmd++ = onewire_cmd_byte(DS18B20_CMD_READ_SCRATCHPAD);
+        for (int i = 0; i < SCRATCHPAD_SIZE; i++) {
+            *cmd++ = onewire_cmd_byte(0xFF); // Read slots
+        }
+    }
+    onewire_start(&bus, commands, results, (uint)(cmd - commands));
+}
+
+/**
+ * @brief Check and publish the scratchpads of the finished read batch
+ */
+static void publish_scratchpads(void) {
+    absolute_time_t now = get_absolute_time();
+
+    for (int p = 0; p < probe_count; p++) {
+        const uint32_t *res = &results[p * READ_WORDS_PER_PROBE];
+        if ((res[0] >> 31) != 0) {
+            continue; // No presence pulse: bus fault
+        }
+
+        uint8_t pad[SCRATCHPAD_SIZE];
+        uint8_t any_bit = 0;
+        for (int i = 0; i < SCRATCHPAD_SIZE; i++) {
+            pad[i] = onewire_result_bits(res[READ_SCRATCHPAD_OFFSET + i], 8);
+            any_bit |= pad[i];
+        }
+        if (onewire_crc8(pad, SCRATCHPAD_SIZE - 1) != pad[SCRATCHPAD_SIZE - 1]) {
+            continue; // Corrupted or missing probe: keep the previous reading until it goes stale
+        }
+        if (any_bit == 0) {
+            continue; // Data line held low (short): all zeros pass the CRC but are not 0 °C
+        }
+
+        int16_t raw = (int16_t)((pad[1] << 8) | pad[0]); // 1/16 °C
+        critical_section_enter_blocking(&result_lock);
+        temperatures[p] = raw / 16.0f;
+        read_time[p] = now;
+        critical_section_exit(&result_lock);
+    }
+}
+
+/**
+ * @brief Bus state machine step (default alarm pool, IRQ context)
+ */
+static bool ds18b20_tick(repeating_timer_t *timer) {
+    if (onewire_busy(&bus)) {
+        return true;
+    }
+
+    switch (state) {
+        case BUS_IDLE:
+            if (time_reached(next_conversion)) {
+                next_conversion = delayed_by_ms(next_conversion, DS18B20_INTERVAL_MS);
+                conversion_deadline = make_timeout_time_ms(DS18B20_CONVERT_TIMEOUT_MS);
+                start_conversion();
+                state = BUS_CONVERTING;
+            }
+            break;
+
+        case BUS_CONVERTING:
+            if ((results[0] >> 31) != 0) {
+                state = BUS_IDLE; // Nobody answered the reset
+                break;
+            }
+            start_poll_slot();
+            state = BUS_POLLING;
+            break;
+
+        case BUS_POLLING:
+            if (onewire_result_bits(results[0], 1)) {
+                start_scratchpad_reads();
+                state = BUS_READING;
+            } else if (time_reached(conversion_deadline)) {
+                state = BUS_IDLE;
+            } else {
+                start_poll_slot();
+            }
+            break;
+
+        case BUS_READING:
+            publish_scratchpads();
+            state = BUS_IDLE;
+            break;
+    }
+    return true;
+}
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Start the bus, enumerate the probes and start background conversions
+ *
+ * The ROM search blocks for ~15ms per probe; call during initialization.
+ *
+ * @return Number of probes found (0 if none or no PIO resources)
+ */
+int ds18b20_init(void) {
+    critical_section_init(&result_lock);
+
+    if (!onewire_init(&bus, ONEWIRE_PIN)) {
+        printf("1-Wire: sem recursos PIO/DMA\n");
+        return 0;
+    }
+
+    probe_count = onewire_search(&bus, roms, DS18B20_MAX_PROBES, DS18B20_FAMILY);
+    for (int p = 0; p < probe_count; p++) {
+        read_time[p] = nil_time;
+        printf("DS18B20 %d: %016llx\n", p, (unsigned long long)roms[p]);
+    }
+    if (probe_count == 0) {
+        return 0;
+    }
+
+    state = BUS_IDLE;
+    next_conversion = get_absolute_time();
+    add_repeating_timer_ms(DS18B20_TICK_MS, ds18b20_tick, NULL, &tick_timer);
+    return probe_count;
+}
+
+/**
+ * @brief Copy the latest result of every probe
+ *
+ * @param probes Output, one entry per probe in ROM search order
+ * @param max_probes Capacity of @p probes
+ * @return Number of entries written
+ */
+int ds18b20_read(Ds18b20Probe *probes, int max_probes) {
+    int count = probe_count < max_probes ? probe_count : max_probes;
+    absolute_time_t now = get_absolute_time();
+
+    critical_section_enter_blocking(&result_lock);
+    for (int p = 0; p < count; p++) {
+        probes[p].rom = roms[p];
+        probes[p].temperature = temperatures[p];
+        probes[p].valid = !is_nil_time(read_time[p]) &&
+                          absolute_time_diff_us(read_time[p], now) < (int64_t)RESULT_STALE_MS * 1000;
+    }
+    critical_section_exit(&result_lock);
+    return count;
+}
@@ -0,0 +1,227 @@
+/**
+ * @file flash_log.c
+ * @brief Persistent sensor history in a ring of on-board flash sectors
+ *
+ * The last FLASH_LOG_SIZE bytes of the QSPI flash hold fixed 16-byte records.
+ * Record number seq always lives in slot seq % capacity, so the ring needs no
+ * header: at boot the newest record is found by scanning the first slot of
+ * every sector, and entering a new sector erases it (dropping its oldest
+ * records) just before the first write.
+ *
+ * Each record is programmed on its own: NOR flash only clears bits, so a page
+ * program with 0xFF everywhere except the new record leaves the neighbouring
+ * records untouched and nothing is lost on power failure. Reads go straight
+ * through XIP and are safe from interrupt context (USB mass-storage).
+ */
+
+#include "flash_log.h"
+#include "app_config.h"
+#include "hardware/flash.h"
+#include "pico/flash.h"
+#include <stdio.h>
+#include <string.h>
+
+/* ========== GEOMETRY ========== */
+
+#define FLASH_LOG_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_LOG_SIZE)
+#define RECORDS_PER_SECTOR (FLASH_SECTOR_SIZE / sizeof(FlashLogRecord))
+#define RECORDS_PER_PAGE (FLASH_PAGE_SIZE / sizeof(FlashLogRecord))
+#define LOG_CAPACITY (FLASH_LOG_SIZE / sizeof(FlashLogRecord))
+#define ERASED_SEQ 0xFFFFFFFFu
+
+_Static_assert(FLASH_LOG_SIZE % FLASH_SECTOR_SIZE == 0, "FLASH_LOG_SIZE must be whole sectors");
+
+extern char __flash_binary_end; // Linker symbol: end of the firmware image
+
+/* ========== PRIVATE VARIABLES ========== */
+
+static const FlashLogRecord *const log_base = (const FlashLogRecord *)(XIP_BASE + FLASH_LOG_OFFSET);
+
+static bool log_ready;            // Region validated and scanned
+static uint32_t first_seq;        // Oldest record still in flash
+static uint32_t next_seq;         // Number given to the next record
+
+static uint8_t page_buffer[FLASH_PAGE_SIZE]; // Page image for the flash program
+
+/* ========== PRIVATE FUNCTIONS ========== */
+
+/**
+ * @brief CRC-8 (poly 0x07, init 0x00)
+ */
+static uint8_t crc8(const uint8_t *data, size_t len) {
+    uint8_t crc = 0;
+    while (len--) {
+        crc ^= *data++;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static bool record_valid(const FlashLogRecord *record) {
+    return record->seq != ERASED_SEQ &&
+           record->crc == crc8((const uint8_t *)record, offsetof(FlashLogRecord, crc));
+}
+
+typedef struct {
+    uint32_t offset;      // Flash offset of the sector or page
+    bool erase;           // Erase the sector before programming
+    bool program;         // Program page_buffer at offset (page aligned)
+} FlashOp;
+
+/**
+ * @brief Runs with XIP disabled and the other core / tasks locked out
+ */
+static void __no_inline_not_in_flash_func(flash_op_run)(void *param) {
+    const FlashOp *op = param;
+    if (op->erase) {
+        flash_range_erase(op->offset & ~(FLASH_SECTOR_SIZE - 1), FLASH_SECTOR_SIZE);
+    }
+    if (op->program) {
+        flash_range_program(op->offset, page_buffer, FLASH_PAGE_SIZE);
+    }
+}
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Locate the ring head and tail
+ *
+ * @return false if the log region overlaps the firmware image (log disabled)
+ */
+bool flash_log_init(void) {
+    if ((uintptr_t)&__flash_binary_end > XIP_BASE + FLASH_LOG_OFFSET) {
+        printf("Log em flash desativado: firmware invade a regiao do log\n");
+        return false;
+    }
+
+    // Newest sector = highest seq in a sector's first slot; oldest = lowest
+    bool found = false;
+    uint32_t newest_sector = 0;
+    first_seq = 0;
+    next_seq = 0;
+    for (uint32_t sector = 0; sector < LOG_CAPACITY / RECORDS_PER_SECTOR; sector++) {
+        const FlashLogRecord *head = &log_base[sector * RECORDS_PER_SECTOR];
+        if (!record_valid(head)) {
+            continue;
+        }
+        if (!found || head->seq > log_base[newest_sector * RECORDS_PER_SECTOR].seq) {
+            newest_sector = sector;
+        }
+        if (!found || head->seq < first_seq) {
+            first_seq = head->seq;
+        }
+        found = true;
+    }
+
+    if (found) {
+        // Walk the newest sector up to its first free slot
+        const FlashLogRecord *sector = &log_base[newest_sector * RECORDS_PER_SECTOR];
+        uint32_t used = 1;
+        while (used < RECORDS_PER_SECTOR && record_valid(&sector[used])) {
+            used++;
+        }
+        next_seq = sector[0].seq + used;
+    }
+
+    log_ready = true;
+    printf("Log em flash: %lu registros (capacidade %lu)\n",
+           (unsigned long)(next_seq - first_seq), (unsigned long)LOG_CAPACITY);
+    return true;
+}
+
+/**
+ * @brief Persist one history record
+ *
+ * Blocks for one page program (~1 ms); entering a new sector also erases it
+ * (tens of ms). Both run with interrupts off on this core and the other core
+ * parked, via flash_safe_execute().
+ *
+ * @param sensors Readings to store
+ * @param alerts Alert evaluation of the same readings
+ * @param time_s Timestamp in seconds
+ * @param wall_clock true if time_s is a Unix timestamp, false if uptime
+ * @return true if the record was written
+ */
+bool flash_log_append(const SensorData *sensors, const AlertStatus *alerts, uint32_t time_s, bool wall_clock) {
+    if (!log_ready) {
+        return false;
+    }
+
+    float lux = sensors->lux > 65535.0f ? 65535.0f : sensors->lux;
+    FlashLogRecord record = {
+        .seq = next_seq,
+        .time_s = time_s,
+        .temperature_c100 = (int16_t)(sensors->temperature * 100.0f),
+        .humidity_c100 = (uint16_t)(sensors->humidity * 100.0f),
+        .lux = (uint16_t)lux,
+        .flags = (sensors->aht_ok ? FLASH_LOG_FLAG_AHT_OK : 0) |
+                 (sensors->lux_ok ? FLASH_LOG_FLAG_LUX_OK : 0) |
+                 (alerts->temp_critical ? FLASH_LOG_FLAG_TEMP_CRIT : 0) |
+                 (alerts->humidity_critical ? FLASH_LOG_FLAG_HUM_CRIT : 0) |
+                 (alerts->lux_critical ? FLASH_LOG_FLAG_LUX_CRIT : 0) |
+                 (wall_clock ? FLASH_LOG_FLAG_WALL_CLOCK : 0),
+    };
+    record.crc = crc8((const uint8_t *)&record, offsetof(FlashLogRecord, crc));
+
+    uint32_t slot = next_seq % LOG_CAPACITY;
+    FlashOp op = {
+        .offset = FLASH_LOG_OFFSET + (slot / RECORDS_PER_PAGE) * FLASH_PAGE_SIZE,
+        .erase = (slot % RECORDS_PER_SECTOR) == 0,
+        .program = true,
+    };
+    memset(page_buffer, 0xFF, sizeof(page_buffer));
+    memcpy(&page_buffer[(slot % RECORDS_PER_PAGE) * sizeof(record)], &record, sizeof(record));
+
+    if (flash_safe_execute(flash_op_run, &op, FLASH_LOG_TIMEOUT_MS) != PICO_OK) {
+        printf("Log em flash: escrita falhou\n");
+        return false;
+    }
+
+    next_seq++;
+
+    // Whole other sectors plus the filled part of the current one survive erases
+    uint32_t retained = LOG_CAPACITY - RECORDS_PER_SECTOR + (slot % RECORDS_PER_SECTOR) + 1;
+    if (next_seq - first_seq > retained) {
+        first_seq = next_seq - retained;
+    }
+    return true;
+}
+
+/**
+ * @brief Sequence number of the oldest record still stored
+ */
+uint32_t flash_log_first_seq(void) {
+    return first_seq;
+}
+
+/**
+ * @brief Sequence number the next record will get (newest = next - 1)
+ */
+uint32_t flash_log_next_seq(void) {
+    return next_seq;
+}
+
+/**
+ * @brief Maximum number of records the ring can hold
+ */
+uint32_t flash_log_capacity(void) {
+    return LOG_CAPACITY;
+}
+
+/**
+ * @brief Fetch a record by sequence number (interrupt safe)
+ *
+ * @param seq Record number
+ * @param record Destination
+ * @return false if the record was overwritten, never written or is corrupt
+ */
+bool flash_log_read(uint32_t seq, FlashLogRecord *record) {
+    if (!log_ready) {
+        return false;
+    }
+
+    *record = log_base[seq % LOG_CAPACITY];
+    return record_valid(record) && record->seq == seq;
+}
@@ -0,0 +1,268 @@
+/**
+ * @file i2c_bus.c
+ * @brief Hardware and PIO I2C buses behind the SDK's blocking transaction API
+ *
+ * Both I2C controllers are taken (sensors on i2c0, OLED on i2c1), so extra
+ * sensor groups get PIO buses. The PIO program (drivers/i2c_master.pio)
+ * generates the bit timing, START/STOP conditions and clock stretching; the
+ * CPU hands it one command word per byte and reads back the sampled bits,
+ * so a byte costs a FIFO exchange instead of nine bit-banged clock cycles.
+ *
+ * Return values follow i2c_write_blocking()/i2c_read_blocking(): the byte
+ * count, PICO_ERROR_GENERIC when the address or a data byte is not
+ * acknowledged, PICO_ERROR_TIMEOUT when a PIO bus stays held.
+ */
+
+#include "i2c_bus.h"
+#include "app_config.h"
+#include "hardware/clocks.h"
+#include "hardware/gpio.h"
+#include "hardware/timer.h"
+#include "i2c_master.pio.h"
+
+_Static_assert(sizeof(i2c_master_program_instructions) / sizeof(uint16_t) == SHELF_I2C_PIO_INSTRUCTIONS,
+               "update SHELF_I2C_PIO_INSTRUCTIONS (PIO budget)");
+
+/* ========== PIO COMMAND WORDS ========== */
+
+#define PIO_CMD_BYTE  0x80000000u
+#define PIO_CMD_START 0x20000000u      // SDA released, then pulled low with SCL high
+#define PIO_CMD_STOP  0x40000000u      // SDA low, then released with SCL high
+
+#define PIO_BYTE_TIMEOUT_US 10000      // Byte plus the longest clock stretch we accept
+
+/* ========== PRIVATE VARIABLES ========== */
+
+static PIO program_pio;                // SHELF_I2C_PIO once the program is loaded (shared by all PIO buses)
+static uint program_offset;
+
+/* ========== PRIVATE FUNCTIONS ========== */
+
+static inline uint32_t pio_cmd_write(uint8_t value) {
+    return PIO_CMD_BYTE | ((uint32_t)(uint8_t)~value << 23); // ACK slot released for the slave
+}
+
+static inline uint32_t pio_cmd_read(bool ack) {
+    return PIO_CMD_BYTE | (ack ? 1u << 22 : 0u);            // Data slots released, master ACKs
+}
+
+/**
+ * @brief Claim a state machine in SHELF_I2C_PIO, loading the program on first use
+ */
+static bool claim_state_machine(I2cBus *bus) {
+    PIO pio = pio_get_instance(SHELF_I2C_PIO);
+    if (program_pio == NULL && !pio_can_add_program(pio, &i2c_master_program)) {
+        return false;
+    }
+    int sm = pio_claim_unused_sm(pio, false);
+    if (sm < 0) {
+        return false;
+    }
+    if (program_pio == NULL) {
+        program_offset = pio_add_program(pio, &i2c_master_program);
+        program_pio = pio;
+    }
+    bus->pio = pio;
+    bus->sm = (uint)sm;
+    bus->offset = program_offset;
+    return true;
+}
+
+/**
+ * @brief Release a stuck bus: restart the state machine with both lines released
+ */
+static void pio_recover(I2cBus *bus) {
+    pio_sm_set_enabled(bus->pio, bus->sm, false);
+    pio_sm_clear_fifos(bus->pio, bus->sm);
+    pio_sm_restart(bus->pio, bus->sm);
+    pio_sm_set_pindirs_with_mask(bus->pio, bus->sm, 0, 3u << bus->sda_pin);
+    pio_sm_exec(bus->pio, bus->sm, pio_encode_jmp(bus->offset));
+    pio_sm_set_enabled(bus->pio, bus->sm, true);
+}
+
+/**
+ * @brief Send one byte command and wait for its 9 sampled bits
+ *
+ * @return Sampled bits (data in 8-1, ACK in 0), or -1 on timeout
+ */
+static int pio_byte(I2cBus *bus, uint32_t command) {
+    pio_sm_put_blocking(bus->pio, bus->sm, command);
+    absolute_time_t deadline = make_timeout_time_us(PIO_BYTE_TIMEOUT_US);
+    while (pio_sm_is_rx_fifo_empty(bus->pio, bus->sm)) {
+        if (time_reached(deadline)) {
+            pio_recover(bus);
+            return -1;
+        }
+    }
+    return (int)(pio_sm_get(bus->pio, bus->sm) & 0x1FF);
+}
+
+/**
+ * @brief START and address byte
+ *
+ * @return 0, PICO_ERROR_GENERIC (not acknowledged, STOP sent) or PICO_ERROR_TIMEOUT
+ */
+static int pio_address(I2cBus *bus, uint8_t addr, bool read) {
+    pio_sm_put_blocking(bus->pio, bus->sm, PIO_CMD_START);
+    int bits = pio_byte(bus, pio_cmd_write((uint8_t)((addr << 1) | (read ? 1 : 0))));
+    bus->stats.bytes++;
+    if (bits < 0) {
+        return PICO_ERROR_TIMEOUT;
+    }
+    if (bits & 1) {
+        pio_sm_put_blocking(bus->pio, bus->sm, PIO_CMD_STOP);
+        return PICO_ERROR_GENERIC;
+    }
+    return 0;
+}
+
+static int pio_write(I2cBus *bus, uint8_t addr, const uint8_t *src, size_t len, bool nostop) {
+    int rc = pio_address(bus, addr, false);
+    if (rc < 0) {
+        return rc;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        int bits = pio_byte(bus, pio_cmd_write(src[i]));
+        bus->stats.bytes++;
+        if (bits < 0) {
+            return PICO_ERROR_TIMEOUT;
+        }
+        if (bits & 1) {
+            pio_sm_put_blocking(bus->pio, bus->sm, PIO_CMD_STOP);
+            return PICO_ERROR_GENERIC;
+        }
+    }
+
+    if (!nostop) {
+        pio_sm_put_blocking(bus->pio, bus->sm, PIO_CMD_STOP);
+    }
+    return (int)len;
+}
+
+static int pio_read(I2cBus *bus, uint8_t addr, uint8_t *dst, size_t len, bool nostop) {
+    int rc = pio_address(bus, addr, true);
+    if (rc < 0) {
+        return rc;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        int bits = pio_byte(bus, pio_cmd_read(i + 1 < len)); // NAK the last byte
+        bus->stats.bytes++;
+        if (bits < 0) {
+            return PICO_ERROR_TIMEOUT;
+        }
+        dst[i] = (uint8_t)(bits >> 1);
+    }
+
+    if (!nostop) {
+        pio_sm_put_blocking(bus->pio, bus->sm, PIO_CMD_STOP);
+    }
+    return (int)len;
+}
+
+/**
+ * @brief Account one finished transaction
+ */
+static int account(I2cBus *bus, int rc, uint64_t start_us, size_t len) {
+    bus->stats.transactions++;
+    bus->stats.busy_us += (uint32_t)(time_us_64() - start_us);
+    if (rc < 0) {
+        bus->stats.errors++;
+    } else if (bus->type == I2C_BUS_HW) {
+        bus->stats.bytes += (uint32_t)len + 1; // PIO buses count bytes as they go
+    }
+    return rc;
+}
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Set up an I2C controller with pull-ups on its pins
+ *
+ * @return true (kept for symmetry with i2c_bus_init_pio())
+ */
+bool i2c_bus_init_hw(I2cBus *bus, const char *name, i2c_inst_t *i2c, uint sda_pin, uint scl_pin, uint baudrate) {
+    *bus = (I2cBus){ .name = name, .type = I2C_BUS_HW, .hw = i2c, .sda_pin = sda_pin };
+
+    i2c_init(i2c, baudrate);
+    gpio_set_function(sda_pin, GPIO_FUNC_I2C);
+    gpio_set_function(scl_pin, GPIO_FUNC_I2C);
+    gpio_pull_up(sda_pin);
+    gpio_pull_up(scl_pin);
+    return true;
+}
+
+/**
+ * @brief Start a PIO bus on @p sda_pin (SDA) and @p sda_pin + 1 (SCL)
+ *
+ * @return false if no state machine or instruction memory is left
+ */
+bool i2c_bus_init_pio(I2cBus *bus, const char *name, uint sda_pin, uint baudrate) {
+    *bus = (I2cBus){ .name = name, .type = I2C_BUS_PIO, .sda_pin = sda_pin };
+
+    if (!claim_state_machine(bus)) {
+        return false;
+    }
+    i2c_master_program_init(bus->pio, bus->sm, bus->offset, sda_pin, baudrate);
+    return true;
+}
+
+/**
+ * @brief Write @p len bytes to @p addr (same contract as i2c_write_blocking())
+ *
+ * @param nostop true to keep the bus for a repeated START
+ * @return Bytes written, PICO_ERROR_GENERIC if not acknowledged, PICO_ERROR_TIMEOUT
+ */
+int i2c_bus_write_blocking(I2cBus *bus, uint8_t addr, const uint8_t *src, size_t len, bool nostop) {
+    uint64_t start_us = time_us_64();
+    int rc;
+    if (bus->type == I2C_BUS_HW) {
+        rc = i2c_write_blocking(bus->hw, addr, src, len, nostop);
+    } else if (bus->pio == NULL) {
+        rc = PICO_ERROR_GENERIC; // PIO bus never started (no resources)
+    } else {
+        rc = pio_write(bus, addr, src, len, nostop);
+    }
+    return account(bus, rc, start_us, len);
+}
+
+/**
+ * @brief Read @p len bytes from @p addr (same contract as i2c_read_blocking())
+ *
+ * @param nostop true to keep the bus for a repeated START
+ * @return Bytes read, PICO_ERROR_GENERIC if not acknowledged, PICO_ERROR_TIMEOUT
+ */
+int i2c_bus_read_blocking(I2cBus *bus, uint8_t addr, uint8_t *dst, size_t len, bool nostop) {
+    uint64_t start_us = time_us_64();
+    int rc;
+    if (bus->type == I2C_BUS_HW) {
+        rc = i2c_read_blocking(bus->hw, addr, dst, len, nostop);
+    } else if (bus->pio == NULL) {
+        rc = PICO_ERROR_GENERIC; // PIO bus never started (no resources)
+    } else {
+        rc = pio_read(bus, addr, dst, len, nostop);
+    }
+    return account(bus, rc, start_us, len);
+}
+
+/**
+ * @brief Copy the traffic counters of @p bus
+ */
+void i2c_bus_get_stats(const I2cBus *bus, I2cBusStats *stats) {
+    *stats = bus->stats;
+}
+
+/**
+ * @brief CRC-8 of the Sensirion and Aosong sensors (poly 0x31, init 0xFF)
+ */
+uint8_t i2c_bus_crc8(const uint8_t *data, size_t len) {
+    uint8_t crc = 0xFF;
+    while (len--) {
+        crc ^= *data++;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
@@ -0,0 +1,97 @@
+/**
+ * @file influx_udp.c
+ * @brief InfluxDB line-protocol uplink over UDP (lwIP raw API)
+ *
+ * Each batch from the uplink goes out as a single datagram, capped at
+ * INFLUX_UDP_MAX_PAYLOAD so it never needs IP fragmentation. The payload is
+ * referenced in place (PBUF_REF) instead of copied: lwIP only chains the
+ * UDP/IP headers in front of it, the CYW43 driver copies the frame out
+ * before udp_sendto() returns, and a datagram waiting for ARP is cloned by
+ * lwIP itself.
+ *
+ * UDP gives no delivery report: a batch counts as sent once lwIP accepts
+ * it. The uplink's store-and-forward covers the link being down.
+ */
+
+#include "influx_udp.h"
+#include "app_config.h"
+#include "pico/cyw43_arch.h"
+#include "lwip/ip_addr.h"
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+#include <stdio.h>
+
+/* ========== PRIVATE VARIABLES ========== */
+
+static struct udp_pcb *pcb;            // Created on the first send (lwIP is up by then)
+static ip_addr_t dest_addr;
+static uint16_t dest_port;
+static bool dest_valid;
+
+/* ========== TRANSPORT ========== */
+
+static bool influx_udp_ready(void) {
+    return dest_valid && cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA) == CYW43_LINK_UP;
+}
+
+static bool influx_udp_send(const uint8_t *data, size_t len) {
+    err_t err = ERR_MEM;
+
+    cyw43_arch_lwip_begin();
+    if (pcb == NULL) {
+        pcb = udp_new_ip_type(IPADDR_TYPE_ANY);
+    }
+    if (pcb != NULL) {
+        struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)len, PBUF_REF);
+        if (p != NULL) {
+            p->payload = (void *)data;
+            err = udp_sendto(pcb, p, &dest_addr, dest_port);
+            pbuf_free(p);
+        }
+    }
+    cyw43_arch_lwip_end();
+
+    if (err != ERR_OK) {
+        printf("InfluxDB UDP: envio falhou (%d)\n", err);
+    }
+    return err == ERR_OK;
+}
+
+const UplinkTransport influx_udp_transport = {
+    .name = "influx-udp",
+    .max_payload = INFLUX_UDP_MAX_PAYLOAD,
+    .ready = influx_udp_ready,
+    .send = influx_udp_send,
+};
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Set the configured destination (INFLUX_UDP_HOST:INFLUX_UDP_PORT)
+ */
+void influx_udp_init(void) {
+    dest_valid = ipaddr_aton(INFLUX_UDP_HOST, &dest_addr) != 0;
+    dest_port = INFLUX_UDP_PORT;
+    if (!dest_valid) {
+        printf("InfluxDB UDP: endereço inválido %s\n", INFLUX_UDP_HOST);
+    }
+}
+
+/**
+ * @brief Point the uplink at another database (lwIP context, e.g. an MQTT handler)
+ *
+ * @param ip Dotted IPv4 address (no DNS lookup)
+ * @param port UDP port of the line-protocol listener
+ * @return false if the address or port is invalid (destination unchanged)
+ */
+bool influx_udp_set_destination(const char *ip, uint16_t port) {
+    ip_addr_t addr;
+    if (port == 0 || !ipaddr_aton(ip, &addr)) {
+        return false;
+    }
+    dest_addr = addr;
+    dest_port = port;
+    dest_valid = true;
+    printf("InfluxDB UDP: destino %s:%u\n", ip, port);
+    return true;
+}
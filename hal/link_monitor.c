@@ -0,0 +1,218 @@
+/**
+ * @file link_monitor.c
+ * @brief Wi-Fi link quality classes and the telemetry policy for each
+ *
+ * Every LINK_SAMPLE_INTERVAL_MS the monitor reads the RSSI from the CYW43
+ * and the lwIP MIB-II TCP counters (segments sent and retransmitted,
+ * established connections reset). Failed connection attempts are not
+ * counted: an edge broker that is switched off says nothing about the
+ * radio. The RSSI is low-passed; the retransmission rate is computed once
+ * at least LINK_MIN_SEGMENTS have been sent, so a quiet link does not
+ * swing on two segments.
+ *
+ * A window classes the link as:
+ * - poor: RSSI below LINK_RSSI_POOR_DBM, retransmissions at or above
+ *   LINK_RETRANS_POOR_PCT, or an established TCP connection dropped;
+ * - fair: RSSI below LINK_RSSI_FAIR_DBM or retransmissions at or above
+ *   LINK_RETRANS_FAIR_PCT;
+ * - good otherwise.
+ *
+ * A worse class applies at once. A better one needs LINK_RECOVER_WINDOWS
+ * consecutive windows, with the RSSI clearing the threshold by
+ * LINK_HYSTERESIS_DB, so a link on the edge does not flap.
+ *
+ * Each class stretches the telemetry interval (link_publish_interval_ms())
+ * and caps uplink batches, compressing them on transports set to
+ * UPLINK_COMPRESS_DEGRADED_LINK: a long frame at -80 dBm is lost and
+ * resent far more often than a short one.
+ *
+ * Network context only (main loop or network task); the class and RSSI
+ * may be read from any context.
+ */
+
+#include "link_monitor.h"
+#include "app_config.h"
+#include "uplink.h"
+#include "pico/cyw43_arch.h"
+#include "lwip/stats.h"
+#include <stdio.h>
+
+#if !MIB2_STATS
+#error "link_monitor needs MIB2_STATS in lwipopts.h (TCP retransmission counters)"
+#endif
+
+/* ========== POLICY ========== */
+
+#define RSSI_FILTER_SHIFT 2                    // EMA weight 1/4 per window
+
+/**
+ * @brief What one class changes
+ */
+typedef struct {
+    const char *name;
+    uint8_t interval_factor;                   // Telemetry period multiplier
+    uint16_t batch_bytes;                      // Uplink payload cap
+    bool compress;                             // For UPLINK_COMPRESS_DEGRADED_LINK transports
+} LinkPolicy;
+
+static const LinkPolicy policies[LINK_CLASS_COUNT] = {
+    [LINK_CLASS_GOOD] = { "boa", 1, BATCH_BUF_SIZE, false },
+    [LINK_CLASS_FAIR] = { "regular", LINK_FAIR_INTERVAL_FACTOR, LINK_FAIR_BATCH_BYTES, true },
+    [LINK_CLASS_POOR] = { "ruim", LINK_POOR_INTERVAL_FACTOR, LINK_POOR_BATCH_BYTES, true },
+};
+
+/* ========== PRIVATE VARIABLES ========== */
+
+static volatile LinkClass current = LINK_CLASS_GOOD;
+static volatile int32_t rssi_dbm;              // Filtered
+static int32_t rssi_q;                         // Filtered RSSI << RSSI_FILTER_SHIFT
+static bool rssi_valid;
+static absolute_time_t next_sample;
+
+static uint32_t base_out;                      // Counters at the start of the retransmission window
+static uint32_t base_retrans;
+static uint32_t last_resets;                   // Established connections reset, at the last window
+static uint32_t retrans_pct;                   // Last complete retransmission window
+static uint8_t better_windows;                 // Consecutive windows in a better class
+
+static uint32_t windows[LINK_CLASS_COUNT];     // Windows spent in each class
+static uint32_t changes;
+static uint32_t resets_total;
+
+/* ========== PRIVATE FUNCTIONS ========== */
+
+static LinkClass class_for(int32_t rssi, uint32_t pct, uint32_t resets) {
+    if (rssi < LINK_RSSI_POOR_DBM || pct >= LINK_RETRANS_POOR_PCT || resets > 0) {
+        return LINK_CLASS_POOR;
+    }
+    if (rssi < LINK_RSSI_FAIR_DBM || pct >= LINK_RETRANS_FAIR_PCT) {
+        return LINK_CLASS_FAIR;
+    }
+    return LINK_CLASS_GOOD;
+}
+
+static void apply(LinkClass link) {
+    const LinkPolicy *p = &policies[link];
+    printf("Link WiFi %s -> %s (RSSI %ld dBm, %lu%% retransmissões): envio x%u, lotes até %u bytes%s\n",
+           policies[current].name, p->name, (long)rssi_dbm, (unsigned long)retrans_pct, p->interval_factor,
+           p->batch_bytes, p->compress ? ", comprimidos" : "");
+    current = link;
+    changes++;
+    uplink_set_link_policy(p->batch_bytes, p->compress);
+}
+
+/**
+ * @brief One observation window
+ */
+static void sample(void) {
+    int32_t rssi;
+    cyw43_arch_lwip_begin();
+    bool up = cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA) == CYW43_LINK_UP &&
+              cyw43_wifi_get_rssi(&cyw43_state, &rssi) == 0;
+    uint32_t out = lwip_stats.mib2.tcpoutsegs;
+    uint32_t retrans = lwip_stats.mib2.tcpretranssegs;
+    uint32_t resets = lwip_stats.mib2.tcpestabresets;
+    cyw43_arch_lwip_end();
+
+    uint32_t new_resets = resets - last_resets;
+    last_resets = resets;
+    if (!up) {
+        return; // Nothing to measure: the class stays until the link is back
+    }
+    resets_total += new_resets;
+
+    if (!rssi_valid) {
+        rssi_q = rssi << RSSI_FILTER_SHIFT;
+        rssi_valid = true;
+    } else {
+        rssi_q += rssi - (rssi_q >> RSSI_FILTER_SHIFT);
+    }
+    rssi_dbm = rssi_q >> RSSI_FILTER_SHIFT;
+
+    if (out - base_out >= LINK_MIN_SEGMENTS) {
+        retrans_pct = (retrans - base_retrans) * 100 / (out - base_out);
+        base_out = out;
+        base_retrans = retrans;
+    }
+
+    LinkClass link = class_for(rssi_dbm, retrans_pct, new_resets);
+    if (link > current) {
+        better_windows = 0;
+        apply(link);
+    } else if (link < current && class_for(rssi_dbm - LINK_HYSTERESIS_DB, retrans_pct, new_resets) < current) {
+        if (++better_windows >= LINK_RECOVER_WINDOWS) {
+            better_windows = 0;
+            apply((LinkClass)(current - 1)); // One class at a time
+        }
+    } else {
+        better_windows = 0;
+    }
+    windows[current]++;
+}
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Sample the link when due (network context, every loop pass)
+ *
+ * @return Time of the next sample, to size the caller's wait
+ */
+absolute_time_t link_monitor_poll(void) {
+    if (time_reached(next_sample)) {
+        next_sample = make_timeout_time_ms(LINK_SAMPLE_INTERVAL_MS);
+        sample();
+    }
+    return next_sample;
+}
+
+/**
+ * @brief Start over on a new association (after a roaming handover)
+ *
+ * The RSSI filter is reseeded from the next sample and the retransmission
+ * window restarts, so the old access point does not weigh on the new one.
+ * The class itself stays and recovers as usual.
+ */
+void link_monitor_restart(void) {
+    cyw43_arch_lwip_begin();
+    base_out = lwip_stats.mib2.tcpoutsegs;
+    base_retrans = lwip_stats.mib2.tcpretranssegs;
+    cyw43_arch_lwip_end();
+    rssi_valid = false;
+    retrans_pct = 0;
+    better_windows = 0;
+    next_sample = make_timeout_time_ms(LINK_SAMPLE_INTERVAL_MS);
+}
+
+LinkClass link_monitor_class(void) {
+    return current;
+}
+
+const char *link_class_name(LinkClass link) {
+    return link < LINK_CLASS_COUNT ? policies[link].name : "?";
+}
+
+/**
+ * @brief Filtered RSSI (dBm), 0 before the first sample
+ */
+int32_t link_monitor_rssi(void) {
+    return rssi_dbm;
+}
+
+/**
+ * @brief Telemetry period for the current link class
+ *
+ * Applied on top of power_publish_interval_ms().
+ */
+uint32_t link_publish_interval_ms(uint32_t base_ms) {
+    return base_ms * policies[current].interval_factor;
+}
+
+void link_monitor_print_stats(void) {
+    printf("[link] %s, RSSI %ld dBm, retransmissões %lu%% (%lu de %lu segmentos TCP), %lu conexões derrubadas, "
+           "%lu mudanças de classe\n",
+           policies[current].name, (long)rssi_dbm, (unsigned long)retrans_pct,
+           (unsigned long)lwip_stats.mib2.tcpretranssegs, (unsigned long)lwip_stats.mib2.tcpoutsegs,
+           (unsigned long)resets_total, (unsigned long)changes);
+    printf("[link] janelas: %lu boa, %lu regular, %lu ruim\n", (unsigned long)windows[LINK_CLASS_GOOD],
+           (unsigned long)windows[LINK_CLASS_FAIR], (unsigned long)windows[LINK_CLASS_POOR]);
+}
@@ -0,0 +1,927 @@
+/**
+ * @file mqtt5_client.c
+ * @brief MQTT 5.0 sessions on lwIP raw TCP (QoS 0/1 publish, QoS 1 subscribe)
+ *
+ * Replaces lwIP's MQTT 3.1.1 client for brokers that speak MQTT 5
+ * (Mosquitto 2.x and later). Sessions are independent, so the device can
+ * hold a local and a cloud connection at the same time:
+ *
+ * - Topic aliases: the broker's Topic Alias Maximum comes in CONNACK. The
+ *   first publish on a topic carries the full name and an alias, later
+ *   ones an empty name and the alias only. Aliases live for the network
+ *   connection and are assigned again after a reconnection.
+ * - Message expiry: telemetry that would be stale by the time a queued
+ *   subscriber gets it carries a Message Expiry Interval (see the policy
+ *   table), so the broker discards it instead of delivering old readings.
+ * - User properties: "enc" and "schema" describe the payload. They go out
+ *   on the first publish per topic and connection and then every
+ *   MQTT5_SCHEMA_EVERY-th publish, so they do not undo what the alias saves.
+ * - Reason codes from CONNACK, SUBACK, PUBACK and DISCONNECT are counted
+ *   per packet type and code and shown in the statistics report.
+ *
+ * Packets are built in the session's small header buffer, which
+ * tcp_write() copies; the payload is a SharedBuf that lwIP sends in place.
+ * The session keeps a reference per packet in its in-flight table and
+ * drops it once TCP has acknowledged the bytes and, for QoS 1, the broker
+ * has sent PUBACK. A connection with payloads still in flight is aborted
+ * rather than closed, so lwIP never keeps a pointer to a released buffer.
+ * QoS 1 messages are not resent after a reconnection (clean start); they
+ * are counted as lost.
+ *
+ * Incoming packets larger than MQTT5_RX_BUF_SIZE are never sent: that size
+ * goes to the broker as Maximum Packet Size.
+ *
+ * Callbacks run in lwIP context; the public functions take the lwIP lock.
+ */
+
+#include "mqtt5_client.h"
+#include "pico/cyw43_arch.h"
+#include "lwip/pbuf.h"
+#include "lwip/tcp.h"
+#include <stdio.h>
+#include <string.h>
+
+/* ========== PROTOCOL CONSTANTS ========== */
+
+#define PKT_CONNECT 0x10
+#define PKT_CONNACK 0x20
+#define PKT_PUBLISH 0x30
+#define PKT_PUBACK 0x40
+#define PKT_SUBSCRIBE 0x82
+#define PKT_SUBACK 0x90
+#define PKT_PINGREQ 0xC0
+#define PKT_PINGRESP 0xD0
+#define PKT_DISCONNECT 0xE0
+
+#define PUBLISH_QOS1 0x02
+
+#define PROP_MESSAGE_EXPIRY 0x02
+#define PROP_SERVER_KEEP_ALIVE 0x13
+#define PROP_TOPIC_ALIAS_MAXIMUM 0x22
+#define PROP_TOPIC_ALIAS 0x23
+#define PROP_USER_PROPERTY 0x26
+#define PROP_MAXIMUM_PACKET_SIZE 0x27
+
+#define CONNECT_CLEAN_START 0x02
+#define RC_SUCCESS 0x00
+#define RC_FAILURE 0x80                        // First error code
+
+#define MQTT5_PORT_DEFAULT 1883
+#define MQTT5_CONNACK_TIMEOUT_MS 10000
+#define MQTT5_POLL_INTERVAL 2                  // tcp_poll() period, 500 ms units
+#define TCP_IP_HEADERS 40                      // Counted in the wire byte statistics
+
+/* ========== TYPES ========== */
+
+/**
+ * @brief Expiry and payload description of a published topic
+ */
+typedef struct {
+    const char *topic;
+    uint32_t expiry_s;                         // Message Expiry Interval (0 = never)
+    const char *encoding;                      // "enc" user property
+    const char *schema;                        // "schema" user property
+} Mqtt5TopicPolicy;
+
+/**
+ * @brief Packet under construction
+ */
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+    size_t cap;
+    bool overflow;
+} Mqtt5Writer;
+
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+    bool error;
+} Mqtt5Reader;
+
+/* ========== POLICY TABLE ========== */
+
+static const Mqtt5TopicPolicy policies[] = {
+    { "pico_w/sensors/data", MQTT5_TELEMETRY_EXPIRY_S, "json", "smavhiot.sensores/1" },
+    { "pico_w/sensors/line", MQTT5_TELEMETRY_EXPIRY_S, "influx-lp", "smavhiot.lote/1" },
+    { "pico_w/control/status", MQTT5_TELEMETRY_EXPIRY_S, "json", "smavhiot.controle/1" },
+    { "pico_w/sensors/alerts", MQTT5_ALERT_EXPIRY_S, "json", "smavhiot.alertas/1" },
+    { "pico_w/sensors/batch", MQTT5_BATCH_EXPIRY_S, "influx-lp", "smavhiot.lote/1" },
+    { "pico_w/dosing/events", 0, "json", "smavhiot.dosagem/1" },
+};
+
+#define POLICY_COUNT (sizeof(policies) / sizeof(policies[0]))
+
+_Static_assert(POLICY_COUNT <= MQTT5_POLICY_SLOTS, "MQTT5_POLICY_SLOTS too small");
+
+/* ========== ENCODING ========== */
+
+static void put_byte(Mqtt5Writer *w, uint8_t b) {
+    if (w->len < w->cap) {
+        w->buf[w->len++] = b;
+    } else {
+        w->overflow = true;
+    }
+}
+
+static void put_u16(Mqtt5Writer *w, uint16_t v) {
+    put_byte(w, (uint8_t)(v >> 8));
+    put_byte(w, (uint8_t)v);
+}
+
+static void put_u32(Mqtt5Writer *w, uint32_t v) {
+    put_u16(w, (uint16_t)(v >> 16));
+    put_u16(w, (uint16_t)v);
+}
+
+static void put_varint(Mqtt5Writer *w, uint32_t v) {
+    do {
+        uint8_t b = v & 0x7F;
+        v >>= 7;
+        put_byte(w, v > 0 ? (b | 0x80) : b);
+    } while (v > 0);
+}
+
+static void put_string(Mqtt5Writer *w, const char *s, size_t len) {
+    put_u16(w, (uint16_t)len);
+    for (size_t i = 0; i < len; i++) {
+        put_byte(w, (uint8_t)s[i]);
+    }
+}
+
+static void put_cstring(Mqtt5Writer *w, const char *s) {
+    put_string(w, s, strlen(s));
+}
+
+static size_t varint_size(uint32_t v) {
+    return v < 128 ? 1 : v < 16384 ? 2 : v < 2097152 ? 3 : 4;
+}
+
+/**
+ * @brief Start a packet in the session's header buffer (room left for the fixed header)
+ */
+static Mqtt5Writer begin_packet(Mqtt5Session *s) {
+    return (Mqtt5Writer){ .buf = s->tx_buf + 5, .cap = sizeof(s->tx_buf) - 5 };
+}
+
+/**
+ * @brief Append properties built in @p props, prefixed by their length
+ */
+static void put_properties(Mqtt5Writer *w, const Mqtt5Writer *props) {
+    put_varint(w, (uint32_t)props->len);
+    for (size_t i = 0; i < props->len; i++) {
+        put_byte(w, props->buf[i]);
+    }
+    w->overflow |= props->overflow;
+}
+
+static uint16_t new_packet_id(Mqtt5Session *s) {
+    uint16_t id = s->next_packet_id++;
+    if (s->next_packet_id == 0) {
+        s->next_packet_id = 1;
+    }
+    return id;
+}
+
+/**
+ * @brief Write the fixed header in front of @p w and queue header + payload
+ *
+ * The header is copied; @p payload is sent in place and must stay valid
+ * until TCP has acknowledged it (see track_payload()).
+ *
+ * @return false if not connected, lwIP's send buffer cannot take the whole
+ *         packet, or the packet exceeds the broker's Maximum Packet Size
+ */
+static bool send_packet(Mqtt5Session *s, uint8_t type, const Mqtt5Writer *w, const uint8_t *payload,
+                        size_t payload_len) {
+    if (s->pcb == NULL || w->overflow) {
+        return false;
+    }
+    uint32_t remaining = (uint32_t)(w->len + payload_len);
+    size_t header_len = 1 + varint_size(remaining);
+    uint8_t *start = w->buf - header_len;
+    Mqtt5Writer fixed = { .buf = start, .cap = header_len };
+    put_byte(&fixed, type);
+    put_varint(&fixed, remaining);
+
+    size_t total = header_len + remaining;
+    if ((s->broker_max_packet > 0 && total > s->broker_max_packet) || tcp_sndbuf(s->pcb) < total ||
+        tcp_sndqueuelen(s->pcb) + 2 > TCP_SND_QUEUELEN) {
+        return false;
+    }
+
+    err_t err = tcp_write(s->pcb, start, (u16_t)(header_len + w->len),
+                          TCP_WRITE_FLAG_COPY | (payload_len > 0 ? TCP_WRITE_FLAG_MORE : 0));
+    if (err == ERR_OK && payload_len > 0) {
+        err = tcp_write(s->pcb, payload, (u16_t)payload_len, 0);
+    }
+    if (err != ERR_OK) {
+        // Space was checked above, so this is the payload write failing
+        // after its header: the stream cannot be repaired
+        tcp_abort(s->pcb);
+        s->pcb_aborted = true;
+        return false;
+    }
+    tcp_output(s->pcb);
+    s->queued += total;
+    s->last_tx = get_absolute_time();
+    s->stats.bytes_out += total + TCP_IP_HEADERS;
+    return true;
+}
+
+/* ========== DECODING ========== */
+
+static uint8_t get_byte(Mqtt5Reader *r) {
+    if (r->p >= r->end) {
+        r->error = true;
+        return 0;
+    }
+    return *r->p++;
+}
+
+static uint16_t get_u16(Mqtt5Reader *r) {
+    uint16_t hi = get_byte(r);
+    return (uint16_t)((hi << 8) | get_byte(r));
+}
+
+static uint32_t get_u32(Mqtt5Reader *r) {
+    uint32_t hi = get_u16(r);
+    return (hi << 16) | get_u16(r);
+}
+
+static uint32_t get_varint(Mqtt5Reader *r) {
+    uint32_t value = 0;
+    for (int shift = 0; shift < 28; shift += 7) {
+        uint8_t b = get_byte(r);
+        value |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            return value;
+        }
+    }
+    r->error = true;
+    return 0;
+}
+
+static void skip(Mqtt5Reader *r, size_t n) {
+    if ((size_t)(r->end - r->p) < n) {
+        r->error = true;
+        r->p = r->end;
+    } else {
+        r->p += n;
+    }
+}
+
+/**
+ * @brief Skip the value of property @p id (its size depends on the type)
+ */
+static void skip_property(Mqtt5Reader *r, uint8_t id) {
+    switch (id) {
+    case 0x01: case 0x17: case 0x19: case 0x24: case 0x25: case 0x28: case 0x29: case 0x2A:
+        skip(r, 1);
+        break;
+    case 0x13: case 0x21: case 0x22: case 0x23:
+        skip(r, 2);
+        break;
+    case 0x02: case 0x11: case 0x18: case 0x27:
+        skip(r, 4);
+        break;
+    case 0x0B:
+        get_varint(r);
+        break;
+    case 0x03: case 0x08: case 0x09: case 0x12: case 0x15: case 0x16: case 0x1A: case 0x1C: case 0x1F:
+        skip(r, get_u16(r));
+        break;
+    case PROP_USER_PROPERTY:
+        skip(r, get_u16(r));
+        skip(r, get_u16(r));
+        break;
+    default:
+        r->error = true; // Unknown property: the rest cannot be parsed
+        break;
+    }
+}
+
+/* ========== IN-FLIGHT PAYLOADS ========== */
+
+/**
+ * @brief Hold a reference to a payload until TCP (and PUBACK) release it
+ */
+static void track_payload(Mqtt5Session *s, SharedBuf *buf, uint16_t packet_id) {
+    Mqtt5InFlight *f = &s->inflight[(s->inflight_head + s->inflight_count) % MQTT5_INFLIGHT];
+    shared_buf_ref(buf);
+    *f = (Mqtt5InFlight){ .buf = buf, .end = s->queued, .packet_id = packet_id,
+                          .sent_at = get_absolute_time() };
+    s->inflight_count++;
+    if (s->inflight_count > s->stats.inflight_high) {
+        s->stats.inflight_high = s->inflight_count;
+    }
+}
+
+/**
+ * @brief Release the oldest payloads that TCP acknowledged and, if QoS 1, the broker too
+ */
+static void release_acked(Mqtt5Session *s) {
+    while (s->inflight_count > 0) {
+        Mqtt5InFlight *f = &s->inflight[s->inflight_head];
+        if ((int32_t)(s->acked - f->end) < 0 || f->packet_id != 0) {
+            return;
+        }
+        shared_buf_release(f->buf);
+        s->inflight_head = (s->inflight_head + 1) % MQTT5_INFLIGHT;
+        s->inflight_count--;
+    }
+}
+
+/**
+ * @brief Drop every reference (the pcb is gone, so lwIP holds none)
+ */
+static void release_all(Mqtt5Session *s) {
+    while (s->inflight_count > 0) {
+        Mqtt5InFlight *f = &s->inflight[s->inflight_head];
+        if (f->packet_id != 0) {
+            s->stats.lost++;
+        }
+        shared_buf_release(f->buf);
+        s->inflight_head = (s->inflight_head + 1) % MQTT5_INFLIGHT;
+        s->inflight_count--;
+    }
+}
+
+/* ========== SESSION ========== */
+
+static void count_reason(Mqtt5Session *s, uint8_t packet, uint8_t code) {
+    for (int i = 0; i < MQTT5_REASON_SLOTS; i++) {
+        Mqtt5ReasonCount *r = &s->reasons[i];
+        if (r->count == 0) {
+            *r = (Mqtt5ReasonCount){ packet, code, 1 };
+            return;
+        }
+        if (r->packet == packet && r->code == code) {
+            r->count++;
+            return;
+        }
+    }
+}
+
+static const char *packet_name(uint8_t packet) {
+    switch (packet) {
+    case PKT_CONNACK: return "CONNACK";
+    case PKT_SUBACK: return "SUBACK";
+    case PKT_PUBACK: return "PUBACK";
+    case PKT_DISCONNECT: return "DISCONNECT";
+    default: return "?";
+    }
+}
+
+/**
+ * @brief Forget the connection (the pcb is already closed or freed)
+ */
+static void reset_session(Mqtt5Session *s) {
+    bool was_up = s->state == MQTT5_CONNECTED;
+    release_all(s);
+    s->pcb = NULL;
+    s->state = MQTT5_IDLE;
+    s->ping_pending = false;
+    s->alias_count = 0;
+    s->rx = (Mqtt5Rx){ 0 };
+    if (was_up) {
+        s->stats.disconnects++;
+        if (s->on_status != NULL) {
+            s->on_status(s, false);
+        }
+    }
+}
+
+static void close_connection(Mqtt5Session *s, const char *reason) {
+    printf("MQTT5 %s: conexão encerrada (%s)\n", s->name, reason);
+    if (s->pcb != NULL) {
+        tcp_arg(s->pcb, NULL);
+        tcp_recv(s->pcb, NULL);
+        tcp_sent(s->pcb, NULL);
+        tcp_err(s->pcb, NULL);
+        tcp_poll(s->pcb, NULL, 0);
+        // Segments still pointing at shared payloads: abort frees them now
+        if (s->inflight_count > 0 || tcp_close(s->pcb) != ERR_OK) {
+            tcp_abort(s->pcb);
+            s->pcb_aborted = true;
+        }
+    }
+    reset_session(s);
+}
+
+static void send_subscribe(Mqtt5Session *s, const Mqtt5Subscription *sub) {
+    Mqtt5Writer w = begin_packet(s);
+    put_u16(&w, new_packet_id(s));
+    put_varint(&w, 0);                         // No properties
+    put_cstring(&w, sub->topic);
+    put_byte(&w, 0x01);                        // Maximum QoS 1
+    if (!send_packet(s, PKT_SUBSCRIBE, &w, NULL, 0)) {
+        printf("MQTT5 %s: erro ao inscrever em %s\n", s->name, sub->topic);
+    }
+}
+
+static void send_connect(Mqtt5Session *s) {
+    uint8_t prop_buf[16];
+    Mqtt5Writer props = { .buf = prop_buf, .cap = sizeof(prop_buf) };
+    put_byte(&props, PROP_MAXIMUM_PACKET_SIZE);
+    put_u32(&props, MQTT5_RX_BUF_SIZE);
+
+    Mqtt5Writer w = begin_packet(s);
+    put_cstring(&w, "MQTT");
+    put_byte(&w, 5);                           // Protocol version
+    put_byte(&w, CONNECT_CLEAN_START);
+    put_u16(&w, MQTT5_KEEPALIVE_S);
+    put_properties(&w, &props);
+    put_cstring(&w, s->client_id);
+    send_packet(s, PKT_CONNECT, &w, NULL, 0);
+}
+
+static void handle_connack(Mqtt5Session *s, Mqtt5Reader *r) {
+    get_byte(r);                               // Acknowledge flags (session present)
+    uint8_t code = get_byte(r);
+    count_reason(s, PKT_CONNACK, code);
+    if (code >= RC_FAILURE || r->error) {
+        printf("MQTT5 %s: conexão recusada pelo broker (0x%02X)\n", s->name, code);
+        close_connection(s, "CONNACK");
+        return;
+    }
+
+    s->keepalive_s = MQTT5_KEEPALIVE_S;
+    s->alias_max = 0;
+    s->broker_max_packet = 0;
+    uint32_t props_len = get_varint(r);
+    const uint8_t *props_end = r->p + props_len;
+    while (!r->error && r->p < props_end) {
+        uint8_t id = get_byte(r);
+        switch (id) {
+        case PROP_TOPIC_ALIAS_MAXIMUM: {
+            uint16_t max = get_u16(r);
+            s->alias_max = max < MQTT5_TOPIC_ALIASES ? max : MQTT5_TOPIC_ALIASES;
+            break;
+        }
+        case PROP_MAXIMUM_PACKET_SIZE:
+            s->broker_max_packet = get_u32(r);
+            break;
+        case PROP_SERVER_KEEP_ALIVE:
+            s->keepalive_s = get_u16(r);
+            break;
+        default:
+            skip_property(r, id);
+            break;
+        }
+    }
+
+    s->state = MQTT5_CONNECTED;
+    s->alias_count = 0;
+    memset(s->schema_countdown, 0, sizeof(s->schema_countdown));
+    s->stats.up_since = get_absolute_time();
+    printf("MQTT5 %s: conectado (aliases: %u, keep-alive: %u s)\n", s->name, s->alias_max, s->keepalive_s);
+    for (int i = 0; i < s->subscription_count; i++) {
+        send_subscribe(s, &s->subscriptions[i]);
+    }
+    if (s->on_status != NULL) {
+        s->on_status(s, true);
+    }
+}
+
+static void handle_publish(Mqtt5Session *s, uint8_t flags, Mqtt5Reader *r) {
+    uint8_t qos = (flags >> 1) & 0x03;
+    uint16_t topic_len = get_u16(r);
+    const char *topic = (const char *)r->p;
+    skip(r, topic_len);
+    uint16_t packet_id = qos > 0 ? get_u16(r) : 0;
+    uint32_t props_len = get_varint(r);
+    skip(r, props_len);
+    if (r->error) {
+        return;
+    }
+
+    if (qos == 1) {
+        Mqtt5Writer w = begin_packet(s);
+        put_u16(&w, packet_id);                // Success, no properties: short form
+        send_packet(s, PKT_PUBACK, &w, NULL, 0);
+    }
+
+    // Topic copied out before the payload is terminated in place
+    char name[MQTT5_TOPIC_MAX];
+    if (topic_len >= sizeof(name)) {
+        return;
+    }
+    memcpy(name, topic, topic_len);
+    name[topic_len] = '\0';
+    size_t data_len = (size_t)(r->end - r->p);
+    char *data = (char *)r->p;
+    data[data_len] = '\0';                     // rx_buf has a spare byte past the body
+    s->stats.received++;
+
+    for (int i = 0; i < s->subscription_count; i++) {
+        if (strcmp(s->subscriptions[i].topic, name) == 0) {
+            s->subscriptions[i].handler(name, data, data_len);
+        }
+    }
+}
+
+static void handle_puback(Mqtt5Session *s, Mqtt5Reader *r, size_t len) {
+    uint16_t packet_id = get_u16(r);
+    uint8_t code = len > 2 ? get_byte(r) : RC_SUCCESS;
+    count_reason(s, PKT_PUBACK, code);
+
+    for (uint8_t i = 0; i < s->inflight_count; i++) {
+        Mqtt5InFlight *f = &s->inflight[(s->inflight_head + i) % MQTT5_INFLIGHT];
+        if (f->packet_id == packet_id) {
+            uint32_t rtt = (uint32_t)absolute_time_diff_us(f->sent_at, get_absolute_time());
+            if (code < RC_FAILURE) {
+                s->stats.acknowledged++;
+                s->stats.puback_rtt_sum_us += rtt;
+                if (rtt > s->stats.puback_rtt_max_us) {
+                    s->stats.puback_rtt_max_us = rtt;
+                }
+            }
+            f->packet_id = 0;
+            break;
+        }
+    }
+    release_acked(s);
+}
+
+static void handle_packet(Mqtt5Session *s, uint8_t header, size_t len) {
+    Mqtt5Reader r = { .p = s->rx_buf, .end = s->rx_buf + len };
+    switch (header & 0xF0) {
+    case PKT_CONNACK:
+        if (s->state == MQTT5_WAIT_CONNACK) {
+            handle_connack(s, &r);
+        }
+        break;
+
+    case PKT_PUBLISH:
+        handle_publish(s, header & 0x0F, &r);
+        break;
+
+    case PKT_PUBACK:
+        handle_puback(s, &r, len);
+        break;
+
+    case PKT_SUBACK: {
+        get_u16(&r);                           // Packet identifier
+        skip(&r, get_varint(&r));
+        while (!r.error && r.p < r.end) {
+            uint8_t code = get_byte(&r);
+            count_reason(s, PKT_SUBACK, code);
+            if (code >= RC_FAILURE) {
+                printf("MQTT5 %s: inscrição recusada (0x%02X)\n", s->name, code);
+            }
+        }
+        break;
+    }
+
+    case PKT_PINGRESP:
+        s->ping_pending = false;
+        break;
+
+    case PKT_DISCONNECT: {
+        uint8_t code = len > 0 ? get_byte(&r) : RC_SUCCESS;
+        count_reason(s, PKT_DISCONNECT, code);
+        printf("MQTT5 %s: DISCONNECT do broker (0x%02X)\n", s->name, code);
+        close_connection(s, "broker");
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Feed received bytes to the packet parser
+ */
+static void parse_stream(Mqtt5Session *s, const uint8_t *data, size_t len) {
+    Mqtt5Rx *rx = &s->rx;
+    while (len > 0 && s->pcb != NULL) {
+        if (rx->header == 0) {
+            *rx = (Mqtt5Rx){ .header = *data++, .multiplier = 1 };
+            len--;
+            continue;
+        }
+        if (rx->multiplier != 0) {
+            uint8_t b = *data++;
+            len--;
+            rx->remaining += (uint32_t)(b & 0x7F) * rx->multiplier;
+            rx->multiplier = (b & 0x80) ? rx->multiplier * 128 : 0;
+            if (rx->multiplier > 128 * 128 * 128) {
+                close_connection(s, "pacote malformado");
+                return;
+            }
+        } else {
+            size_t chunk = rx->remaining - rx->received;
+            if (chunk > len) {
+                chunk = len;
+            }
+            if (rx->remaining <= MQTT5_RX_BUF_SIZE) {
+                memcpy(s->rx_buf + rx->received, data, chunk);
+            }
+            rx->received += chunk;
+            data += chunk;
+            len -= chunk;
+        }
+        if (rx->multiplier == 0 && rx->received == rx->remaining) {
+            uint8_t header = rx->header;
+            uint32_t remaining = rx->remaining;
+            *rx = (Mqtt5Rx){ 0 };
+            if (remaining <= MQTT5_RX_BUF_SIZE) {
+                handle_packet(s, header, remaining);
+            } else {
+                s->stats.oversized++;
+            }
+        }
+    }
+}
+
+/* ========== LWIP CALLBACKS ========== */
+
+static err_t mqtt5_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err) {
+    Mqtt5Session *s = arg;
+    s->pcb_aborted = false;
+    if (p == NULL) {
+        close_connection(s, "fechada pelo broker");
+        return s->pcb_aborted ? ERR_ABRT : ERR_OK;
+    }
+    s->stats.bytes_in += p->tot_len;
+    tcp_recved(tpcb, p->tot_len);
+    for (struct pbuf *q = p; q != NULL && s->pcb == tpcb; q = q->next) {
+        parse_stream(s, q->payload, q->len);
+    }
+    pbuf_free(p);
+    return s->pcb_aborted ? ERR_ABRT : ERR_OK;
+}
+
+static err_t mqtt5_sent(void *arg, struct tcp_pcb *tpcb, u16_t len) {
+    Mqtt5Session *s = arg;
+    s->acked += len;
+    release_acked(s);
+    return ERR_OK;
+}
+
+static void mqtt5_err(void *arg, err_t err) {
+    Mqtt5Session *s = arg;
+    printf("MQTT5 %s: erro TCP %d\n", s->name, err);
+    reset_session(s);                          // lwIP already freed the pcb and its segments
+}
+
+static err_t mqtt5_poll(void *arg, struct tcp_pcb *tpcb) {
+    Mqtt5Session *s = arg;
+    int64_t keepalive_us = (int64_t)s->keepalive_s * 1000000;
+    absolute_time_t now = get_absolute_time();
+    s->pcb_aborted = false;
+
+    if (s->state == MQTT5_WAIT_CONNACK &&
+        absolute_time_diff_us(s->connect_started, now) > (int64_t)MQTT5_CONNACK_TIMEOUT_MS * 1000) {
+        close_connection(s, "sem CONNACK");
+        return s->pcb_aborted ? ERR_ABRT : ERR_OK;
+    }
+    if (s->state != MQTT5_CONNECTED || s->keepalive_s == 0) {
+        return ERR_OK;
+    }
+    if (s->ping_pending && absolute_time_diff_us(s->ping_sent, now) > keepalive_us) {
+        close_connection(s, "sem PINGRESP");
+        return s->pcb_aborted ? ERR_ABRT : ERR_OK;
+    }
+    if (!s->ping_pending && absolute_time_diff_us(s->last_tx, now) >= keepalive_us * 3 / 4) {
+        Mqtt5Writer w = begin_packet(s);
+        if (send_packet(s, PKT_PINGREQ, &w, NULL, 0)) {
+            s->ping_pending = true;
+            s->ping_sent = now;
+        }
+    }
+    return s->pcb_aborted ? ERR_ABRT : ERR_OK;
+}
+
+static err_t mqtt5_connected(void *arg, struct tcp_pcb *tpcb, err_t err) {
+    Mqtt5Session *s = arg;
+    s->pcb_aborted = false;
+    if (err != ERR_OK) {
+        close_connection(s, "TCP");
+        return s->pcb_aborted ? ERR_ABRT : ERR_OK;
+    }
+    s->state = MQTT5_WAIT_CONNACK;
+    s->connect_started = get_absolute_time();
+    s->stats.connects++;
+    send_connect(s);
+    return s->pcb_aborted ? ERR_ABRT : ERR_OK;
+}
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Prepare a session (once, before the first connect)
+ *
+ * @param name Label for logs and statistics
+ * @param client_id Client ID sent in CONNECT (string with static lifetime)
+ * @param on_status Optional up/down notification, called in lwIP context
+ */
+void mqtt5_session_init(Mqtt5Session *session, const char *name, const char *client_id,
+                        mqtt5_status_cb_t on_status) {
+    memset(session, 0, sizeof(*session));
+    session->name = name;
+    session->client_id = client_id;
+    session->on_status = on_status;
+    session->next_packet_id = 1;
+}
+
+/**
+ * @brief Open a new connection (closing the previous one)
+ *
+ * @param broker Broker address
+ * @param port Broker port (0 = 1883)
+ * @return false if the TCP connection could not be started
+ */
+bool mqtt5_session_connect(Mqtt5Session *s, const ip_addr_t *broker, uint16_t port) {
+    cyw43_arch_lwip_begin();
+    if (s->pcb != NULL) {
+        if (s->state == MQTT5_CONNECTED) {
+            Mqtt5Writer w = begin_packet(s);
+            send_packet(s, PKT_DISCONNECT, &w, NULL, 0);
+        }
+        close_connection(s, "reconexão");
+    }
+
+    s->queued = 0;
+    s->acked = 0;
+    s->pcb = tcp_new_ip_type(IPADDR_TYPE_ANY);
+    err_t err = ERR_MEM;
+    if (s->pcb != NULL) {
+        tcp_nagle_disable(s->pcb);             // Small packets: no 200 ms coalescing delay
+        tcp_arg(s->pcb, s);
+        tcp_recv(s->pcb, mqtt5_recv);
+        tcp_sent(s->pcb, mqtt5_sent);
+        tcp_err(s->pcb, mqtt5_err);
+        tcp_poll(s->pcb, mqtt5_poll, MQTT5_POLL_INTERVAL);
+        s->state = MQTT5_TCP_CONNECTING;
+        err = tcp_connect(s->pcb, broker, port != 0 ? port : MQTT5_PORT_DEFAULT, mqtt5_connected);
+        if (err != ERR_OK) {
+            tcp_err(s->pcb, NULL);
+            tcp_abort(s->pcb);
+            reset_session(s);
+        }
+    }
+    cyw43_arch_lwip_end();
+
+    if (err != ERR_OK) {
+        printf("MQTT5 %s: erro ao iniciar conexão: %d\n", s->name, err);
+        return false;
+    }
+    printf("MQTT5 %s: conectando ao broker %s\n", s->name, ipaddr_ntoa(broker));
+    return true;
+}
+
+/**
+ * @brief Whether the session is connected (CONNACK received)
+ */
+bool mqtt5_session_is_up(const Mqtt5Session *s) {
+    return s->state == MQTT5_CONNECTED;
+}
+
+/**
+ * @brief Whether a connection is open or being opened
+ */
+bool mqtt5_session_is_busy(const Mqtt5Session *s) {
+    return s->state != MQTT5_IDLE;
+}
+
+/**
+ * @brief Publish a shared payload, using a topic alias when one is available
+ *
+ * The session takes its own reference to @p payload; the caller keeps
+ * (and later releases) its one.
+ *
+ * @param qos 0 or 1
+ * @return false if not connected, the in-flight table is full or the
+ *         packet does not fit in lwIP's send buffer right now
+ */
+bool mqtt5_session_publish(Mqtt5Session *s, const char *topic, SharedBuf *payload, uint8_t qos) {
+    const Mqtt5TopicPolicy *policy = NULL;
+    size_t policy_index = 0;
+    for (size_t i = 0; i < POLICY_COUNT; i++) {
+        if (strcmp(policies[i].topic, topic) == 0) {
+            policy = &policies[i];
+            policy_index = i;
+        }
+    }
+
+    cyw43_arch_lwip_begin();
+    bool ok = false;
+    if (s->state == MQTT5_CONNECTED && s->inflight_count < MQTT5_INFLIGHT) {
+        // Alias: existing one, a new one (full name sent once more), or none
+        size_t topic_len = strlen(topic);
+        uint16_t alias = 0;
+        bool new_alias = false;
+        for (uint16_t a = 0; a < s->alias_count; a++) {
+            if (strcmp(s->aliases[a], topic) == 0) {
+                alias = a + 1;
+            }
+        }
+        if (alias == 0 && s->alias_count < s->alias_max && topic_len < MQTT5_TOPIC_MAX) {
+            alias = s->alias_count + 1;
+            new_alias = true;
+        }
+        bool send_schema = policy != NULL && s->schema_countdown[policy_index] == 0;
+
+        uint8_t prop_buf[96];
+        Mqtt5Writer props = { .buf = prop_buf, .cap = sizeof(prop_buf) };
+        if (policy != NULL && policy->expiry_s > 0) {
+            put_byte(&props, PROP_MESSAGE_EXPIRY);
+            put_u32(&props, policy->expiry_s);
+        }
+        if (alias != 0) {
+            put_byte(&props, PROP_TOPIC_ALIAS);
+            put_u16(&props, alias);
+        }
+        if (send_schema) {
+            put_byte(&props, PROP_USER_PROPERTY);
+            put_cstring(&props, "enc");
+            put_cstring(&props, policy->encoding);
+            put_byte(&props, PROP_USER_PROPERTY);
+            put_cstring(&props, "schema");
+            put_cstring(&props, policy->schema);
+        }
+
+        Mqtt5Writer w = begin_packet(s);
+        bool name_elided = alias != 0 && !new_alias;
+        put_string(&w, topic, name_elided ? 0 : topic_len);
+        uint16_t packet_id = 0;
+        if (qos > 0) {
+            packet_id = new_packet_id(s);
+            put_u16(&w, packet_id);
+        }
+        put_properties(&w, &props);
+        ok = send_packet(s, PKT_PUBLISH | (qos > 0 ? PUBLISH_QOS1 : 0), &w, payload->data, payload->len);
+
+        if (ok) {
+            track_payload(s, payload, packet_id);
+            s->stats.published++;
+            if (new_alias) {
+                snprintf(s->aliases[s->alias_count++], MQTT5_TOPIC_MAX, "%s", topic);
+            }
+            if (name_elided) {
+                s->stats.aliased++;
+                s->stats.topic_bytes_saved += topic_len;
+            }
+            if (policy != NULL) {
+                s->schema_countdown[policy_index] =
+                    send_schema ? MQTT5_SCHEMA_EVERY : s->schema_countdown[policy_index] - 1;
+            }
+        }
+    }
+    cyw43_arch_lwip_end();
+
+    if (!ok) {
+        s->stats.refused++;
+    }
+    return ok;
+}
+
+/**
+ * @brief Subscribe with QoS 1 (now and after every reconnection)
+ *
+ * @param topic Topic filter (string with static lifetime)
+ */
+bool mqtt5_session_subscribe(Mqtt5Session *s, const char *topic, mqtt_message_handler_t handler) {
+    cyw43_arch_lwip_begin();
+    bool ok = s->subscription_count < MQTT5_MAX_SUBSCRIPTIONS;
+    if (ok) {
+        s->subscriptions[s->subscription_count] = (Mqtt5Subscription){ topic, handler };
+        if (s->state == MQTT5_CONNECTED) {
+            send_subscribe(s, &s->subscriptions[s->subscription_count]);
+        }
+        s->subscription_count++;
+    }
+    cyw43_arch_lwip_end();
+    return ok;
+}
+
+void mqtt5_session_print_stats(const Mqtt5Session *s) {
+    static const char *const state_names[] = { "desconectado", "conectando", "aguardando CONNACK", "conectado" };
+    const Mqtt5Stats *st = &s->stats;
+    if (s->state == MQTT5_CONNECTED) {
+        printf("[mqtt5:%s] conectado há %lld s, ", s->name,
+               (long long)(absolute_time_diff_us(st->up_since, get_absolute_time()) / 1000000));
+    } else {
+        printf("[mqtt5:%s] %s, ", s->name, state_names[s->state]);
+    }
+    printf("%lu conexões, %lu quedas\n", (unsigned long)st->connects, (unsigned long)st->disconnects);
+    printf("[mqtt5:%s] %lu publicados (%lu com alias, %llu bytes de tópico economizados), %lu recusados, "
+           "%lu recebidos, %lu grandes demais\n",
+           s->name, (unsigned long)st->published, (unsigned long)st->aliased,
+           (unsigned long long)st->topic_bytes_saved, (unsigned long)st->refused,
+           (unsigned long)st->received, (unsigned long)st->oversized);
+    printf("[mqtt5:%s] QoS 1: %lu confirmados, %lu perdidos, PUBACK médio %lu us (máx %lu us), "
+           "em voo %u (pico %u)\n",
+           s->name, (unsigned long)st->acknowledged, (unsigned long)st->lost,
+           (unsigned long)(st->acknowledged > 0 ? st->puback_rtt_sum_us / st->acknowledged : 0),
+           (unsigned long)st->puback_rtt_max_us, s->inflight_count, st->inflight_high);
+    printf("[mqtt5:%s] %llu bytes enviados, %llu recebidos\n", s->name,
+           (unsigned long long)st->bytes_out, (unsigned long long)st->bytes_in);
+    for (int i = 0; i < MQTT5_REASON_SLOTS && s->reasons[i].count > 0; i++) {
+        printf("[mqtt5:%s] %s 0x%02X: %lu\n", s->name, packet_name(s->reasons[i].packet),
+               s->reasons[i].code, (unsigned long)s->reasons[i].count);
+    }
+}
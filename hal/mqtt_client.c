@@ -1,15 +1,93 @@
 #include "lwip/apps/mqtt.h" // Biblioteca MQTT do lwIP
+#include "lwip/apps/mqtt_priv.h" // Definição de mqtt_client_t (alocação estática)
 #include "mqtt_client.h" // Header file com as declarações locais
 // Base: https://github.com/BitDogLab/BitDogLab-C/blob/main/wifi_button_and_led/lwipopts.h
 #include "lwipopts.h" // Configurações customizadas do lwIP
+#include "app_config.h" // MQTT_SN_ENABLED
+#include "mqtt_sn_client.h" // Modo MQTT-SN (gateway local via UDP)
+#include "mqtt_fanout.h" // Sessões MQTT 5 paralelas (nuvem + broker local)
+#include "mqtt_outbox.h" // Fila de saída com prioridade (alertas primeiro)
+#include "pico/cyw43_arch.h" // cyw43_arch_lwip_begin/end (acesso seguro ao lwIP)
 #include <stdio.h>
 #include <string.h>
 
+#if !MQTT_V5_ENABLED
 /* Variável global estática para armazenar a instância do cliente MQTT
-* 'static' limita o escopo deste arquivo */
+* 'static' limita o escopo deste arquivo. O cliente é alocado estaticamente
+* (em vez de mqtt_client_new()) para não depender do heap em tempo de execução
+* e para que reconexões reutilizem sempre a mesma memória */
+static mqtt_client_t client_storage;
 static mqtt_client_t *client;
 extern bool conct_status_mqtt;
 
+#define MQTT_MAX_SUBSCRIPTIONS 4   // Tópicos de comando inscritos
+#define MQTT_RX_BUF_SIZE 256       // Maior mensagem recebida aceita
+
+/* Tabela de inscrições: refeita a cada conexão aceita pelo broker */
+typedef struct {
+    const char *topic;
+    mqtt_message_handler_t handler;
+} MqttSubscription;
+
+static MqttSubscription subscriptions[MQTT_MAX_SUBSCRIPTIONS];
+static int subscription_count;
+
+/* Mensagem recebida em montagem (o lwIP entrega o payload em fragmentos) */
+static char rx_topic[64];
+static char rx_buf[MQTT_RX_BUF_SIZE];
+static size_t rx_len;
+static bool rx_drop;
+
+/* Callback de confirmação de inscrição */
+static void mqtt_sub_request_cb(void *arg, err_t result) {
+    const char *topic = arg;
+    if (result != ERR_OK) {
+        printf("Falha na inscrição MQTT em %s: %d\n", topic, result);
+    }
+}
+
+/* Início de uma publicação recebida: guarda o tópico e prepara o buffer
+* Parâmetros:
+* - topic: tópico da mensagem
+* - tot_len: tamanho total do payload */
+static void mqtt_incoming_publish_cb(void *arg, const char *topic, uint32_t tot_len) {
+    snprintf(rx_topic, sizeof(rx_topic), "%s", topic);
+    rx_len = 0;
+    rx_drop = tot_len >= sizeof(rx_buf);
+    if (rx_drop) {
+        printf("Mensagem MQTT em %s descartada (%lu bytes)\n", topic, (unsigned long)tot_len);
+    }
+}
+
+/* Fragmento do payload: acumula e, no último, entrega ao handler do tópico */
+static void mqtt_incoming_data_cb(void *arg, const uint8_t *data, uint16_t len, uint8_t flags) {
+    if (!rx_drop) {
+        memcpy(rx_buf + rx_len, data, len);
+        rx_len += len;
+    }
+    if (!(flags & MQTT_DATA_FLAG_LAST) || rx_drop) {
+        return;
+    }
+
+    rx_buf[rx_len] = '\0';
+    for (int i = 0; i < subscription_count; i++) {
+        if (strcmp(subscriptions[i].topic, rx_topic) == 0) {
+            subscriptions[i].handler(rx_topic, rx_buf, rx_len);
+        }
+    }
+}
+
+/* Inscreve os tópicos da tabela a partir de 'first' (contexto do lwIP) */
+static void subscribe_from(mqtt_client_t *client, int first) {
+    for (int i = first; i < subscription_count; i++) {
+        err_t err = mqtt_subscribe(client, subscriptions[i].topic, 1, mqtt_sub_request_cb,
+                                   (void *)subscriptions[i].topic);
+        if (err != ERR_OK) {
+            printf("Erro ao inscrever em %s: %d\n", subscriptions[i].topic, err);
+        }
+    }
+}
+
 /* Callback de conexão MQTT - chamado quando o status da conexão muda
 * Parâmetros:
 * - client: instância do cliente MQTT
@@ -19,11 +97,15 @@ static void mqtt_connection_cb(mqtt_client_t *client, void *arg, mqtt_connection
     if (status == MQTT_CONNECT_ACCEPTED) {
         printf("Conectado ao broker MQTT com sucesso!\n");
         conct_status_mqtt=true;
+        subscribe_from(client, 0);
+        mqtt_outbox_drain(); // Envia o que ficou retido enquanto desconectado
     } else {
         printf("Falha ao conectar ao broker, código: %d\n", status);
         conct_status_mqtt=false;
     }
 }
+#endif // !MQTT_V5_ENABLED (cliente MQTT 3.1.1 do lwIP)
+
 /* Função para configurar e iniciar a conexão MQTT
 * Parâmetros:
 * - client_id: identificador único para este cliente
@@ -54,13 +136,26 @@ void mqtt_setup(const char *client_id, const char *broker_ip, bool *status_mqtt)
         return;
     }
     
-    // Cria uma nova instância do cliente MQTT
-    client = mqtt_client_new();
-    if (client == NULL) {
-        printf("Falha ao criar o cliente MQTT\n");
-        *status_mqtt = false;
-        return;
+#if MQTT_V5_ENABLED
+    // MQTT 5: sessões próprias sobre TCP (o cliente do lwIP só fala 3.1.1);
+    // este broker é o da nuvem, o local vem do app_config.h
+    mqtt_fanout_start(client_id, &broker_addr, status_mqtt);
+#else
+    // Chamadas ao lwIP fora dos callbacks precisam do lock do cyw43_arch
+    // (obrigatório no build FreeRTOS, onde o lwIP roda em outra thread)
+    cyw43_arch_lwip_begin();
+
+    // Reconexão: encerra a sessão anterior antes de reutilizar a instância,
+    // inclusive uma conexão ainda em andamento (o PCB dela aponta para a
+    // estrutura que vai ser zerada); mqtt_disconnect() trata todos os estados
+    if (client != NULL) {
+        mqtt_disconnect(client);
     }
+
+    // Prepara a instância estática do cliente MQTT (o lwIP exige a estrutura zerada)
+    memset(&client_storage, 0, sizeof(client_storage));
+    client = &client_storage;
+    mqtt_set_inpub_callback(client, mqtt_incoming_publish_cb, mqtt_incoming_data_cb, NULL);
     
     printf("Conectando ao broker MQTT: %s\n", broker_ip);
     
@@ -78,26 +173,54 @@ void mqtt_setup(const char *client_id, const char *broker_ip, bool *status_mqtt)
         printf("Erro ao iniciar conexão MQTT: %d\n", err);
         *status_mqtt = false;
     }
+    cyw43_arch_lwip_end();
+#endif
 }
+#if !MQTT_SN_ENABLED && !MQTT_V5_ENABLED
 /* Callback de confirmação de publicação
-* Chamado quando o broker confirma recebimento da mensagem (para QoS > 0)
+* Chamado quando a mensagem sai do cliente (TCP confirmado em QoS 0, PUBACK
+* em QoS > 0): libera um slot de requisição e espaço no buffer de saída,
+* então a fila de saída tenta de novo
 * Parâmetros:
 * - arg: argumento opcional
 * - result: código de resultado da operação */
 static void mqtt_pub_request_cb(void *arg, err_t result) {
     if (result == ERR_OK) {
         printf("Publicação MQTT enviada com sucesso!\n");
+        mqtt_outbox_drain();
     } else {
         printf("Erro ao publicar via MQTT: %d\n", result);
     }
 }
+#endif
 /* Função para publicar dados em um tópico MQTT
+* Passa pela fila de saída: se o transporte recusar agora, a mensagem fica
+* retida por prioridade e é reenviada depois (ver mqtt_outbox.c)
 * Parâmetros:
 * - topic: nome do tópico (ex: "sensor/temperatura")
 * - data: payload da mensagem (bytes)
-* - len: tamanho do payload */
-void mqtt_comm_publish(const char *topic, const uint8_t *data, size_t len) {
+* - len: tamanho do payload
+* Retorna false se a mensagem não foi enviada nem retida */
+bool mqtt_comm_publish(const char *topic, const uint8_t *data, size_t len) {
+    return mqtt_outbox_publish(topic, data, len);
+}
+
+/* Envio direto pelo transporte ativo, sem fila (usado pela fila de saída)
+* Retorna false se o transporte recusou (desconectado, buffer ou slots cheios) */
+bool mqtt_comm_send(const char *topic, const uint8_t *data, size_t len) {
+#if MQTT_SN_ENABLED
+    // Modo MQTT-SN: mesmo tópico, enviado pelo ID pré-definido com a QoS da tabela
+    return mqtt_sn_publish(topic, data, len);
+#elif MQTT_V5_ENABLED
+    // Copiado uma vez e enviado a todas as sessões que levam o tópico
+    return mqtt_fanout_publish(topic, data, len);
+#else
+    if (client == NULL) {
+        return false; // mqtt_setup() ainda não foi chamado
+    }
+
     // Envia a mensagem MQTT
+    cyw43_arch_lwip_begin();
     err_t status = mqtt_publish(
     client, // Instância do cliente
     topic, // Tópico de publicação
@@ -108,7 +231,37 @@ void mqtt_comm_publish(const char *topic, const uint8_t *data, size_t len) {
     mqtt_pub_request_cb, // Callback de confirmação
     NULL // Argumento para o callback
 );
-    if (status != ERR_OK) {
-        printf("mqtt_publish falhou ao ser enviada: %d\n", status);
+    cyw43_arch_lwip_end();
+    // Recusa (ERR_MEM, ERR_CONN) não é logada: a fila de saída tenta de novo
+    // e contabiliza em mqtt_outbox_print_stats()
+    return status == ERR_OK;
+#endif
+}
+
+/* Função para inscrever um tópico de comandos
+* Parâmetros:
+* - topic: tópico (string com duração estática)
+* - handler: chamado a cada mensagem recebida no tópico */
+bool mqtt_comm_subscribe(const char *topic, mqtt_message_handler_t handler) {
+#if MQTT_SN_ENABLED
+    return mqtt_sn_subscribe(topic, handler);
+#elif MQTT_V5_ENABLED
+    return mqtt_fanout_subscribe(topic, handler);
+#else
+    // O único broker deste cliente é o da nuvem (público, sem autenticação)
+    if (!MQTT_CLOUD_COMMANDS) {
+        return false;
     }
-}
\ No newline at end of file
+    cyw43_arch_lwip_begin();
+    bool ok = subscription_count < MQTT_MAX_SUBSCRIPTIONS;
+    if (ok) {
+        subscriptions[subscription_count++] = (MqttSubscription){ topic, handler };
+        // Já conectado: inscreve agora; senão a inscrição sai na conexão
+        if (client != NULL && mqtt_client_is_connected(client)) {
+            subscribe_from(client, subscription_count - 1);
+        }
+    }
+    cyw43_arch_lwip_end();
+    return ok;
+#endif
+}
@@ -0,0 +1,391 @@
+/**
+ * @file mqtt_fanout.c
+ * @brief Parallel MQTT 5 sessions fed from one encoding per sample
+ *
+ * The cloud broker (given to mqtt_setup()) and an edge broker on the LAN
+ * run as independent Mqtt5Sessions, each with its own policy: QoS, sample
+ * encoding, sample interval, and which topic classes it carries (batches,
+ * events, commands). The edge session can take every acquisition while
+ * the cloud one keeps the publish interval, stretched on battery and
+ * placed at this board's phase (fleet_stagger.c).
+ *
+ * Zero-copy fan-out: a sample is encoded at most once per encoding into a
+ * reference-counted pool buffer, and every session that wants that
+ * encoding sends the same buffer (lwIP reads it in place). The buffer
+ * returns to the pool when the last session has it acknowledged. Other
+ * publishes (alerts, control status, batches) are copied once into a
+ * shared buffer and fanned out the same way.
+ *
+ * Health metrics are kept per session (see mqtt5_session_print_stats())
+ * plus the encode and reuse counters here.
+ */
+
+#include "mqtt_fanout.h"
+#include "mqtt5_client.h"
+#include "mqtt_outbox.h"
+#include "fleet_stagger.h"
+#include "link_monitor.h"
+#include "mqtt_server.h"
+#include "mem_pool.h"
+#include "power_manager.h"
+#include "uplink.h"
+#include "app_config.h"
+#include <stdio.h>
+#include <string.h>
+
+/* ========== CONFIGURATION ========== */
+
+#define TOPIC_BATCH "pico_w/sensors/batch"
+
+/**
+ * @brief What one broker session carries
+ */
+typedef struct {
+    const char *name;                          // Session name in logs and statistics
+    const char *broker_ip;                     // NULL = broker given to mqtt_setup()
+    uint16_t port;
+    uint8_t qos;
+    MqttEncoding encoding;                     // Sample payload format
+    uint32_t sample_interval_ms;               // 0 = every acquisition; stretched on battery
+    bool batches;                              // Line-protocol batches (uplink)
+    bool events;                               // Alerts, control status, dosing events
+    bool commands;                             // Command topic subscriptions
+} MqttSessionPolicy;
+
+static const MqttSessionPolicy policies[] = {
+    { "nuvem", NULL, 1883, MQTT_CLOUD_QOS, MQTT_ENCODING_JSON, MQTT_PUBLISH_INTERVAL_MS, true, true,
+      MQTT_CLOUD_COMMANDS },
+#if MQTT_EDGE_ENABLED
+    { "local", MQTT_EDGE_BROKER_IP, MQTT_EDGE_BROKER_PORT, MQTT_EDGE_QOS,
+      MQTT_EDGE_LINE_PROTOCOL ? MQTT_ENCODING_LINE : MQTT_ENCODING_JSON, MQTT_EDGE_SAMPLE_INTERVAL_MS,
+      false, true, true },
+#endif
+};
+
+#define SESSION_COUNT (sizeof(policies) / sizeof(policies[0]))
+
+static const char *const encoding_topics[MQTT_ENCODING_COUNT] = {
+    "pico_w/sensors/data",
+    "pico_w/sensors/line",
+};
+
+static const char *const encoding_names[MQTT_ENCODING_COUNT] = { "JSON", "line protocol" };
+
+/* ========== TYPES ========== */
+
+typedef struct {
+    Mqtt5Session mqtt;
+    ip_addr_t broker;
+    bool configured;                           // Broker address valid
+    absolute_time_t next_sample;
+    absolute_time_t next_connect;
+    uint32_t samples;                          // Samples handed to the session
+    uint32_t missed;                           // Due but refused (in-flight table or send buffer full)
+} FanoutSession;
+
+typedef struct {
+    uint32_t encodes[MQTT_ENCODING_COUNT];
+    uint64_t encoded_bytes[MQTT_ENCODING_COUNT];
+    uint32_t reuses;                           // Sends that took an existing buffer
+    uint64_t reused_bytes;                     // Encoding/copy work those sends skipped
+    uint32_t exhausted;                        // Publishes dropped for lack of a shared buffer
+} FanoutStats;
+
+/* ========== PRIVATE VARIABLES ========== */
+
+MEM_POOL_DEFINE(fanout_msg_pool, SHARED_BUF_BLOCK_SIZE(MSG_BUF_SIZE), MQTT_FANOUT_MSG_BLOCKS);
+MEM_POOL_DEFINE(fanout_batch_pool, SHARED_BUF_BLOCK_SIZE(BATCH_BUF_SIZE), MQTT_FANOUT_BATCH_BLOCKS);
+
+static FanoutSession sessions[SESSION_COUNT];
+static bool started;
+static bool *status_flag;
+static FanoutStats stats;
+
+/* ========== PRIVATE FUNCTIONS ========== */
+
+/**
+ * @brief Up/down notification of any session (lwIP context)
+ */
+static void session_status_cb(Mqtt5Session *session, bool up) {
+    bool any_up = false;
+    for (size_t i = 0; i < SESSION_COUNT; i++) {
+        any_up |= mqtt5_session_is_up(&sessions[i].mqtt);
+    }
+    *status_flag = any_up;
+    if (up) {
+        mqtt_outbox_drain(); // Messages held while no session was up
+    }
+}
+
+static void connect_session(FanoutSession *fs, const MqttSessionPolicy *policy) {
+    // Randomized around the period so a broker restart does not bring the whole rack back at once
+    fs->next_connect = make_timeout_time_ms(fleet_stagger_backoff_ms(MQTT_FANOUT_RECONNECT_MS));
+    if (fs->configured) {
+        mqtt5_session_connect(&fs->mqtt, &fs->broker, policy->port);
+    }
+}
+
+/**
+ * @brief Encode one sample into a shared buffer
+ *
+ * @return Buffer holding one reference, or NULL if the pool is exhausted
+ */
+static SharedBuf *encode_sample(MqttEncoding encoding, const SensorData *sensors, absolute_time_t timestamp) {
+    SharedBuf *buf = shared_buf_alloc(&fanout_msg_pool);
+    if (buf == NULL) {
+        stats.exhausted++;
+        return NULL;
+    }
+    char *out = (char *)buf->data;
+    size_t capacity = shared_buf_capacity(buf);
+    buf->len = (uint16_t)(encoding == MQTT_ENCODING_JSON ? mqtt_format_sensor_json(sensors, out, capacity)
+                                                         : uplink_format_sample(sensors, timestamp, out, capacity));
+    stats.encodes[encoding]++;
+    stats.encoded_bytes[encoding] += buf->len;
+    return buf;
+}
+
+/**
+ * @brief Publish a sample on one session, encoding it on first use
+ *
+ * @param encoded Buffers already encoded this pass, one per encoding
+ * @return true if the session took it
+ */
+static bool offer_sample(FanoutSession *fs, const MqttSessionPolicy *policy, SharedBuf **encoded,
+                         const SensorData *sensors, absolute_time_t timestamp) {
+    SharedBuf *buf = encoded[policy->encoding];
+    if (buf == NULL) {
+        buf = encoded[policy->encoding] = encode_sample(policy->encoding, sensors, timestamp);
+        if (buf == NULL) {
+            fs->missed++;
+            return false;
+        }
+    } else {
+        stats.reuses++;
+        stats.reused_bytes += buf->len;
+    }
+
+    if (!mqtt5_session_publish(&fs->mqtt, encoding_topics[policy->encoding], buf, policy->qos)) {
+        fs->missed++;
+        return false;
+    }
+    fs->samples++;
+    return true;
+}
+
+static void release_encoded(SharedBuf **encoded) {
+    for (int e = 0; e < MQTT_ENCODING_COUNT; e++) {
+        shared_buf_release(encoded[e]); // Sessions hold their own references
+    }
+}
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Start (or restart) every session
+ *
+ * @param client_id Client ID for all sessions (string with static lifetime)
+ * @param cloud_broker Broker of the sessions without a fixed address
+ * @param status Set while at least one session is up
+ */
+void mqtt_fanout_start(const char *client_id, const ip_addr_t *cloud_broker, bool *status) {
+    if (!started) {
+        mem_pool_init(&fanout_msg_pool);
+        mem_pool_init(&fanout_batch_pool);
+        for (size_t i = 0; i < SESSION_COUNT; i++) {
+            FanoutSession *fs = &sessions[i];
+            mqtt5_session_init(&fs->mqtt, policies[i].name, client_id, session_status_cb);
+            fs->configured = policies[i].broker_ip == NULL || ipaddr_aton(policies[i].broker_ip, &fs->broker);
+            if (!fs->configured) {
+                printf("MQTT %s: endereço de broker inválido: %s\n", policies[i].name, policies[i].broker_ip);
+            }
+            fs->next_sample = nil_time;
+        }
+        started = true;
+    }
+    status_flag = status;
+    *status = false;
+
+    for (size_t i = 0; i < SESSION_COUNT; i++) {
+        if (policies[i].broker_ip == NULL) {
+            sessions[i].broker = *cloud_broker;
+        }
+        connect_session(&sessions[i], &policies[i]);
+    }
+}
+
+/**
+ * @brief Offer one acquisition to the sessions that take every acquisition
+ *
+ * Sessions with a sample interval are served by mqtt_fanout_poll() at this
+ * board's phase instead. Sessions that are down are reconnected here about
+ * every MQTT_FANOUT_RECONNECT_MS (randomized) while WiFi is up.
+ * Call from the network context after each acquisition.
+ *
+ * @param sensors Readings of the cycle
+ * @param timestamp Acquisition time of the cycle
+ */
+void mqtt_fanout_sample(const SensorData *sensors, absolute_time_t timestamp) {
+    if (!started) {
+        return;
+    }
+    SharedBuf *encoded[MQTT_ENCODING_COUNT] = { NULL };
+
+    for (size_t i = 0; i < SESSION_COUNT; i++) {
+        FanoutSession *fs = &sessions[i];
+        const MqttSessionPolicy *policy = &policies[i];
+
+        if (!mqtt5_session_is_up(&fs->mqtt)) {
+            if (!mqtt5_session_is_busy(&fs->mqtt) && time_reached(fs->next_connect) && wifi_check()) {
+                connect_session(fs, policy);
+            }
+            continue;
+        }
+        if (policy->sample_interval_ms == 0) {
+            offer_sample(fs, policy, encoded, sensors, timestamp);
+        }
+    }
+
+    release_encoded(encoded);
+}
+
+/**
+ * @brief Send the latest sample to the sessions whose interval has elapsed
+ *
+ * Each session publishes at this board's fraction of its interval
+ * (fleet_stagger_deadline()), not at the acquisition that follows it:
+ * acquisitions of a rack powered up together fall on the same ticks.
+ * A session that is down skips its deadlines, so a broker restart does not
+ * bring the rack back with one publish each; a deadline left more than an
+ * interval behind (a long loop stall) is put back on the phase.
+ * Call from the network context on every pass.
+ *
+ * @param sensors Latest readings, NULL if nothing was sampled yet
+ * @param timestamp Acquisition time of @p sensors
+ * @return Earliest sample deadline (at_the_end_of_time if none)
+ */
+absolute_time_t mqtt_fanout_poll(const SensorData *sensors, absolute_time_t timestamp) {
+    absolute_time_t next = at_the_end_of_time;
+    if (!started) {
+        return next;
+    }
+    SharedBuf *encoded[MQTT_ENCODING_COUNT] = { NULL };
+
+    for (size_t i = 0; i < SESSION_COUNT; i++) {
+        FanoutSession *fs = &sessions[i];
+        const MqttSessionPolicy *policy = &policies[i];
+        if (policy->sample_interval_ms == 0) {
+            continue;
+        }
+        uint32_t interval = link_publish_interval_ms(power_publish_interval_ms(policy->sample_interval_ms));
+
+        if (is_nil_time(fs->next_sample)) {
+            fs->next_sample = fleet_stagger_deadline(interval);
+        } else if (time_reached(fs->next_sample)) {
+            // Down, refused or nothing sampled yet: the interval is skipped, like the main loop timers
+            if (sensors != NULL && mqtt5_session_is_up(&fs->mqtt)) {
+                offer_sample(fs, policy, encoded, sensors, timestamp);
+            }
+            fs->next_sample = delayed_by_ms(fs->next_sample, interval);
+            if (time_reached(fs->next_sample)) {
+                fs->next_sample = fleet_stagger_deadline(interval);
+            }
+        }
+        if (absolute_time_diff_us(fs->next_sample, next) > 0) {
+            next = fs->next_sample;
+        }
+    }
+
+    release_encoded(encoded);
+    return next;
+}
+
+/**
+ * @brief Put every paced session back on the phase (after a slot change)
+ *
+ * The next mqtt_fanout_poll() takes new deadlines from fleet_stagger_deadline().
+ */
+void mqtt_fanout_restagger(void) {
+    for (size_t i = 0; i < SESSION_COUNT; i++) {
+        sessions[i].next_sample = nil_time;
+    }
+}
+
+/**
+ * @brief Send a ready payload to every session that carries its topic class
+ *
+ * Batches go to the sessions with the batches flag, everything else to
+ * the ones with the events flag. The payload is copied once.
+ *
+ * @return true if at least one session took it (a batch otherwise stays
+ *         queued in the uplink ring)
+ */
+bool mqtt_fanout_publish(const char *topic, const uint8_t *data, size_t len) {
+    bool batch = strcmp(topic, TOPIC_BATCH) == 0;
+    SharedBuf *buf = NULL;
+    bool sent = false;
+
+    for (size_t i = 0; i < SESSION_COUNT; i++) {
+        FanoutSession *fs = &sessions[i];
+        const MqttSessionPolicy *policy = &policies[i];
+        if (!(batch ? policy->batches : policy->events) || !mqtt5_session_is_up(&fs->mqtt)) {
+            continue;
+        }
+        if (buf == NULL) {
+            buf = shared_buf_alloc(batch ? &fanout_batch_pool : &fanout_msg_pool);
+            if (buf == NULL || len > shared_buf_capacity(buf)) {
+                stats.exhausted++;
+                shared_buf_release(buf);
+                return false;
+            }
+            memcpy(buf->data, data, len);
+            buf->len = (uint16_t)len;
+        } else {
+            stats.reuses++;
+            stats.reused_bytes += len;
+        }
+        sent |= mqtt5_session_publish(&fs->mqtt, topic, buf, policy->qos);
+    }
+
+    shared_buf_release(buf);
+    return sent;
+}
+
+/**
+ * @brief Subscribe on every session that takes commands
+ *
+ * @param topic Topic filter (string with static lifetime)
+ */
+bool mqtt_fanout_subscribe(const char *topic, mqtt_message_handler_t handler) {
+    bool ok = true;
+    for (size_t i = 0; i < SESSION_COUNT; i++) {
+        if (policies[i].commands) {
+            ok &= mqtt5_session_subscribe(&sessions[i].mqtt, topic, handler);
+        }
+    }
+    return ok;
+}
+
+void mqtt_fanout_print_stats(void) {
+    if (!started) {
+        return;
+    }
+    for (int e = 0; e < MQTT_ENCODING_COUNT; e++) {
+        printf("[fanout] %s: %lu codificações, %llu bytes\n", encoding_names[e],
+               (unsigned long)stats.encodes[e], (unsigned long long)stats.encoded_bytes[e]);
+    }
+    printf("[fanout] %lu envios reaproveitaram um buffer (%llu bytes não recodificados/copiados), "
+           "%lu descartes por falta de buffer\n",
+           (unsigned long)stats.reuses, (unsigned long long)stats.reused_bytes, (unsigned long)stats.exhausted);
+    for (size_t i = 0; i < SESSION_COUNT; i++) {
+        const FanoutSession *fs = &sessions[i];
+        const MqttSessionPolicy *policy = &policies[i];
+        printf("[fanout] %s: QoS %u, %s a cada %lu ms, %lu amostras, %lu recusadas\n", policy->name,
+               policy->qos, encoding_names[policy->encoding],
+               (unsigned long)(policy->sample_interval_ms > 0
+                                   ? link_publish_interval_ms(power_publish_interval_ms(policy->sample_interval_ms))
+                                   : SENSOR_READ_INTERVAL_MS),
+               (unsigned long)fs->samples, (unsigned long)fs->missed);
+        mqtt5_session_print_stats(&fs->mqtt);
+    }
+}
@@ -0,0 +1,333 @@
+/**
+ * @file mqtt_outbox.c
+ * @brief Bounded priority queue in front of every MQTT transport
+ *
+ * mqtt_comm_publish() sends straight through while nothing is queued. A
+ * message the transport refuses (ERR_MEM from a full send buffer, all
+ * MQTT_REQ_MAX_IN_FLIGHT request slots taken, MQTT 5 in-flight table
+ * full, not connected) is copied into one of MQTT_OUTBOX_ENTRIES slots
+ * instead of being dropped, under one of three classes:
+ *
+ * - alerts (sensor alerts, dosing events): sent first, never expire;
+ * - telemetry (sensor data, line protocol): a newer message on the same
+ *   topic replaces the queued one, since only the latest reading matters;
+ *   line-protocol batches are not queued, the uplink ring retries them;
+ * - diagnostics (control loop status and anything else): same, and
+ *   evicted first when the queue is full.
+ *
+ * A full queue evicts the oldest entry of the lowest class present, as
+ * long as that class is not above the new message's; otherwise the new
+ * message is refused. Telemetry and diagnostics older than
+ * MQTT_OUTBOX_MAX_AGE_MS are dropped as expired.
+ *
+ * The queue drains highest class first, FIFO within a class, and stops at
+ * the first refusal. It is retried when the lwIP client reports a
+ * completed publish (capacity freed), when a connection comes up, and
+ * every MQTT_OUTBOX_RETRY_MS from mqtt_outbox_poll() for transports
+ * without a completion callback.
+ *
+ * Messages larger than a slot (MSG_BUF_SIZE) are sent directly or refused.
+ *
+ * All state is accessed under the lwIP lock, so lwIP callbacks and the
+ * network context can both use it.
+ */
+
+#include "mqtt_outbox.h"
+#include "mqtt_client.h"
+#include "mem_pool.h"
+#include "app_config.h"
+#include "pico/cyw43_arch.h"
+#include <stdio.h>
+#include <string.h>
+
+/* ========== CONFIGURATION ========== */
+
+typedef enum {
+    OUTBOX_KEEP_ALL,                           // Every message is queued
+    OUTBOX_KEEP_LATEST,                        // A newer message replaces the queued one
+    OUTBOX_NO_QUEUE                            // Caller retries on its own
+} OutboxPolicy;
+
+typedef struct {
+    const char *topic;
+    MqttClass cls;
+    OutboxPolicy policy;
+} TopicClass;
+
+// Topics not listed are diagnostics, latest only
+static const TopicClass topic_classes[] = {
+    { "pico_w/sensors/alerts", MQTT_CLASS_ALERT, OUTBOX_KEEP_ALL },
+    { "pico_w/dosing/events", MQTT_CLASS_ALERT, OUTBOX_KEEP_ALL },
+    { "pico_w/sensors/data", MQTT_CLASS_TELEMETRY, OUTBOX_KEEP_LATEST },
+    { "pico_w/sensors/line", MQTT_CLASS_TELEMETRY, OUTBOX_KEEP_LATEST },
+    { "pico_w/sensors/batch", MQTT_CLASS_TELEMETRY, OUTBOX_NO_QUEUE }, // Kept in the uplink ring
+    { "pico_w/control/status", MQTT_CLASS_DIAGNOSTIC, OUTBOX_KEEP_LATEST },
+};
+
+static const char *const class_names[MQTT_CLASS_COUNT] = { "alertas", "telemetria", "diagnóstico" };
+
+/* ========== TYPES ========== */
+
+typedef struct {
+    const char *topic;                         // Static lifetime (callers pass literals)
+    uint8_t *data;                             // outbox_pool block, NULL = free slot
+    uint16_t len;
+    MqttClass cls;
+    uint32_t seq;                              // FIFO order
+    absolute_time_t queued_at;
+} OutboxEntry;
+
+typedef struct {
+    uint32_t direct;                           // Sent without waiting
+    uint32_t queued;                           // Pushed back and queued
+    uint32_t delivered;                        // Sent from the queue
+    uint32_t superseded;                       // Replaced by a newer message on the topic
+    uint32_t evicted;                          // Pushed out by a higher-priority message
+    uint32_t expired;
+    uint32_t refused;                          // Queue full of higher classes, or too large
+    uint64_t wait_sum_us;
+    uint32_t wait_max_us;
+} OutboxClassStats;
+
+/* ========== PRIVATE VARIABLES ========== */
+
+MEM_POOL_DEFINE(outbox_pool, MSG_BUF_SIZE, MQTT_OUTBOX_ENTRIES);
+
+static OutboxEntry entries[MQTT_OUTBOX_ENTRIES];
+static uint8_t depth;
+static uint8_t depth_high;
+static uint32_t next_seq;
+static absolute_time_t next_retry;
+static absolute_time_t last_sent;              // Last message the transport accepted
+static bool initialized;
+static OutboxClassStats stats[MQTT_CLASS_COUNT];
+
+/* ========== PRIVATE FUNCTIONS ========== */
+
+static const TopicClass *classify(const char *topic) {
+    static const TopicClass fallback = { NULL, MQTT_CLASS_DIAGNOSTIC, OUTBOX_KEEP_LATEST };
+    for (size_t i = 0; i < sizeof(topic_classes) / sizeof(topic_classes[0]); i++) {
+        if (strcmp(topic_classes[i].topic, topic) == 0) {
+            return &topic_classes[i];
+        }
+    }
+    return &fallback;
+}
+
+static void release(OutboxEntry *e) {
+    mem_pool_free(&outbox_pool, e->data);
+    e->data = NULL;
+    depth--;
+}
+
+/**
+ * @brief Next entry to send: highest class, oldest first
+ */
+static OutboxEntry *next_entry(void) {
+    OutboxEntry *best = NULL;
+    for (int i = 0; i < MQTT_OUTBOX_ENTRIES; i++) {
+        OutboxEntry *e = &entries[i];
+        if (e->data != NULL &&
+            (best == NULL || e->cls < best->cls || (e->cls == best->cls && (int32_t)(e->seq - best->seq) < 0))) {
+            best = e;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Eviction candidate: lowest class, oldest first
+ */
+static OutboxEntry *victim_entry(void) {
+    OutboxEntry *worst = NULL;
+    for (int i = 0; i < MQTT_OUTBOX_ENTRIES; i++) {
+        OutboxEntry *e = &entries[i];
+        if (e->data != NULL &&
+            (worst == NULL || e->cls > worst->cls || (e->cls == worst->cls && (int32_t)(e->seq - worst->seq) < 0))) {
+            worst = e;
+        }
+    }
+    return worst;
+}
+
+static void expire(absolute_time_t now) {
+    for (int i = 0; i < MQTT_OUTBOX_ENTRIES; i++) {
+        OutboxEntry *e = &entries[i];
+        if (e->data != NULL && e->cls != MQTT_CLASS_ALERT &&
+            absolute_time_diff_us(e->queued_at, now) > (int64_t)MQTT_OUTBOX_MAX_AGE_MS * 1000) {
+            stats[e->cls].expired++;
+            release(e);
+        }
+    }
+}
+
+/**
+ * @brief Keep a copy of a refused message
+ *
+ * @return false if it was refused (not queueable, too large, or queue full
+ *         of higher classes)
+ */
+static bool enqueue(const char *topic, const uint8_t *data, size_t len, const TopicClass *tc,
+                    absolute_time_t now) {
+    MqttClass cls = tc->cls;
+    if (tc->policy == OUTBOX_NO_QUEUE || len > MSG_BUF_SIZE) {
+        stats[cls].refused++;
+        return false;
+    }
+
+    OutboxEntry *slot = NULL;
+    if (tc->policy == OUTBOX_KEEP_LATEST) {
+        for (int i = 0; i < MQTT_OUTBOX_ENTRIES && slot == NULL; i++) {
+            if (entries[i].data != NULL && strcmp(entries[i].topic, topic) == 0) {
+                slot = &entries[i]; // Older reading: replaced in place, keeps its turn
+                stats[cls].superseded++;
+            }
+        }
+    }
+    if (slot == NULL) {
+        uint8_t *block = mem_pool_alloc(&outbox_pool);
+        if (block == NULL) {
+            OutboxEntry *victim = victim_entry();
+            if (victim->cls < cls) {
+                stats[cls].refused++;
+                return false;
+            }
+            stats[victim->cls].evicted++;
+            block = victim->data;
+            victim->data = NULL;
+            depth--;
+        }
+        for (int i = 0; i < MQTT_OUTBOX_ENTRIES && slot == NULL; i++) {
+            if (entries[i].data == NULL) {
+                slot = &entries[i];
+            }
+        }
+        *slot = (OutboxEntry){ .data = block, .seq = next_seq++ };
+        depth++;
+        if (depth > depth_high) {
+            depth_high = depth;
+        }
+    }
+
+    slot->topic = topic;
+    slot->cls = cls;
+    slot->queued_at = now;
+    memcpy(slot->data, data, len);
+    slot->len = (uint16_t)len;
+    stats[cls].queued++;
+    return true;
+}
+
+/**
+ * @brief Send queued messages until the transport pushes back (lwIP lock held)
+ */
+static void drain_locked(absolute_time_t now) {
+    expire(now);
+    while (depth > 0) {
+        OutboxEntry *e = next_entry();
+        if (!mqtt_comm_send(e->topic, e->data, e->len)) {
+            next_retry = make_timeout_time_ms(MQTT_OUTBOX_RETRY_MS);
+            return;
+        }
+        OutboxClassStats *st = &stats[e->cls];
+        uint32_t wait_us = (uint32_t)absolute_time_diff_us(e->queued_at, now);
+        st->delivered++;
+        st->wait_sum_us += wait_us;
+        last_sent = now;
+        if (wait_us > st->wait_max_us) {
+            st->wait_max_us = wait_us;
+        }
+        release(e);
+    }
+}
+
+static void init_once(void) {
+    if (!initialized) {
+        mem_pool_init(&outbox_pool);
+        initialized = true;
+    }
+}
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Send now or queue by priority
+ *
+ * @param topic Topic (string with static lifetime)
+ * @return true if sent or queued; false if refused (a batch stays in the
+ *         uplink ring for its own retry)
+ */
+bool mqtt_outbox_publish(const char *topic, const uint8_t *data, size_t len) {
+    const TopicClass *tc = classify(topic);
+    absolute_time_t now = get_absolute_time();
+    bool queueable = tc->policy != OUTBOX_NO_QUEUE && len <= MSG_BUF_SIZE;
+    bool ok;
+
+    cyw43_arch_lwip_begin();
+    init_once();
+    // What cannot wait in the queue gets a direct attempt regardless
+    if ((depth == 0 || !queueable) && mqtt_comm_send(topic, data, len)) {
+        stats[tc->cls].direct++;
+        last_sent = now;
+        ok = true;
+    } else {
+        // Queued behind (or ahead of) what is waiting, then one drain attempt
+        ok = enqueue(topic, data, len, tc, now);
+        drain_locked(now);
+    }
+    cyw43_arch_lwip_end();
+    return ok;
+}
+
+/**
+ * @brief Retry the queue now (capacity freed or connection up)
+ *
+ * Safe from lwIP callbacks.
+ */
+void mqtt_outbox_drain(void) {
+    cyw43_arch_lwip_begin();
+    if (initialized && depth > 0) {
+        drain_locked(get_absolute_time());
+    }
+    cyw43_arch_lwip_end();
+}
+
+/**
+ * @brief Periodic retry for transports without a completion callback
+ *
+ * @return When to call again (at_the_end_of_time while the queue is empty)
+ */
+absolute_time_t mqtt_outbox_poll(void) {
+    if (depth == 0) {
+        return at_the_end_of_time;
+    }
+    if (time_reached(next_retry)) {
+        mqtt_outbox_drain();
+    }
+    return depth > 0 ? next_retry : at_the_end_of_time;
+}
+
+/**
+ * @brief When the transport last accepted a message (nil_time if never)
+ *
+ * Direct sends and queue drains alike; the roaming manager measures the
+ * data gap of a handover with it.
+ */
+absolute_time_t mqtt_outbox_last_sent(void) {
+    return last_sent;
+}
+
+void mqtt_outbox_print_stats(void) {
+    printf("[outbox] fila %u/%u (pico %u)\n", depth, MQTT_OUTBOX_ENTRIES, depth_high);
+    for (int c = 0; c < MQTT_CLASS_COUNT; c++) {
+        const OutboxClassStats *st = &stats[c];
+        printf("[outbox] %s: %lu diretos, %lu enfileirados, %lu enviados da fila "
+               "(espera média %lu ms, máx %lu ms), %lu substituídos, %lu despejados, %lu expirados, "
+               "%lu recusados\n",
+               class_names[c], (unsigned long)st->direct, (unsigned long)st->queued,
+               (unsigned long)st->delivered,
+               (unsigned long)(st->delivered > 0 ? st->wait_sum_us / st->delivered / 1000 : 0),
+               (unsigned long)(st->wait_max_us / 1000), (unsigned long)st->superseded,
+               (unsigned long)st->evicted, (unsigned long)st->expired, (unsigned long)st->refused);
+    }
+}
@@ -9,15 +9,28 @@
 
 #include "mqtt_server.h"
 #include "mqtt_client.h"
+#include "mem_pool.h"
+#include "app_config.h"
+#include "dosing_pump.h"
+#include "power_manager.h"
+#include "influx_udp.h"
+#include "mqtt_sn_client.h"
+#include "fleet_stagger.h"
 #include "pico/cyw43_arch.h"
+#include "pico/unique_id.h"
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 #include <math.h>
 
 /* ========== GLOBAL STATE VARIABLES ========== */
 
 bool conct_status_mqtt = false; // MQTT broker connection status flag
 
+// "pico_w_" + flash unique ID: 23 characters, the MQTT 3.1.1 limit brokers must accept.
+// A shared ID would make the broker drop each board's session when the next one connects
+static char client_id[sizeof("pico_w_") + 2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES];
+
 /* ========== PUBLIC INTERFACE FUNCTIONS ========== */
 
 /**
@@ -30,51 +43,106 @@ bool conct_status_mqtt = false; // MQTT broker connection status flag
 void mqtt_conect_init() {
     // Initialize MQTT client with test.mosquitto.org public broker
     // Using direct IP address (91.121.93.94) to avoid DNS resolution issues
-    mqtt_setup("pico_w_sensor", "91.121.93.94", &conct_status_mqtt);
+    snprintf(client_id, sizeof(client_id), "pico_w_%s", fleet_board_id());
+#if MQTT_SN_ENABLED
+    // Dense racks: one UDP socket per node, the gateway holds the broker session
+    mqtt_sn_init(client_id, MQTT_SN_GATEWAY_IP, MQTT_SN_GATEWAY_PORT, &conct_status_mqtt);
+#else
+    mqtt_setup(client_id, "91.121.93.94", &conct_status_mqtt);
+#endif
+}
+
+/**
+ * @brief Format sensor readings as the standard JSON payload
+ *
+ * Readings from sensors that are not operational are written as NaN.
+ * Shared by mqtt_get_and_publish() and the MQTT 5 fan-out.
+ *
+ * @param sensors Readings of one acquisition
+ * @param buf Output buffer
+ * @param size Size of @p buf
+ * @return Payload length (truncated to @p size - 1 if it does not fit)
+ */
+size_t mqtt_format_sensor_json(const SensorData *sensors, char *buf, size_t size) {
+    // Use sensor readings if available, otherwise set to NaN for JSON compatibility
+    float temp = sensors->aht_ok ? sensors->temperature : NAN;
+    float hum = sensors->aht_ok ? sensors->humidity : NAN;
+    float lux = sensors->lux_ok ? sensors->lux : NAN;
+    float ph = sensors->probes_ok ? sensors->ph : NAN;
+    float ec = sensors->probes_ok ? sensors->ec : NAN;
+    float level = sensors->probes_ok ? sensors->water_level : NAN;
+    float flow = sensors->pulses_ok ? sensors->flow_lpm : NAN;
+    float pump = sensors->pulses_ok ? sensors->pump_rpm : NAN;
+    float co2 = sensors->co2_ok ? sensors->co2_ppm : NAN;
+    PowerStatus power;
+    power_manager_get_status(&power);
+
+    int len = snprintf(buf, size,
+            "{\"temperatura\":%.2f, \"umidade\":%.2f, \"pressao\":%.2f, \"luminosidade\":%.1f, "
+            "\"ph\":%.2f, \"ec\":%.2f, \"nivel\":%.1f, \"temperatura_agua\":%.2f, "
+            "\"vazao\":%.2f, \"volume\":%.1f, \"bomba_rpm\":%.0f, \"co2\":%.0f, "
+            "\"energia\":{\"fonte\":\"%s\", \"vsys\":%.2f, \"bateria\":%u, \"autonomia_min\":%ld, \"modo\":\"%s\"}, "
+            "\"prateleiras\":[",
+            temp,
+            hum,
+            NAN,  // No barometer fitted (field kept for existing consumers)
+            lux,
+            ph,
+            ec,
+            level,
+            sensors->water_temperature,  // NaN without a fresh probe reading
+            flow,
+            sensors->flow_total_l,
+            pump,
+            co2,
+            power_source_name(power.source),
+            power.vsys_mv / 1000.0f,
+            power.battery_pct,
+            (long)power.runtime_min,  // -1 on external power
+            power_level_name(power.level));
+
+    // Extra shelves on the PIO I2C buses (NaN for sensors that did not answer)
+    for (int i = 0; i < SHELF_COUNT && (size_t)len < size; i++) {
+        const ShelfReading *shelf = &sensors->shelves[i];
+        len += snprintf(buf + len, size - len,
+                        "%s{\"temperatura\":%.2f, \"umidade\":%.2f, \"luminosidade\":%.1f}",
+                        i > 0 ? ", " : "",
+                        shelf->aht_ok ? shelf->temperature : NAN,
+                        shelf->aht_ok ? shelf->humidity : NAN,
+                        shelf->lux_ok ? shelf->lux : NAN);
+    }
+    if ((size_t)len < size) {
+        len += snprintf(buf + len, size - len, "]}");
+    }
+    return (size_t)len < size ? (size_t)len : size - 1;
 }
 
 /**
  * @brief Publish environmental sensor data to MQTT broker
  * 
  * Formats sensor readings into standardized JSON payload and publishes
- * to designated data topic. Handles sensor availability and provides
- * fallback values for missing measurements.
+ * to designated data topic.
  * 
  * @param wifi_connected Current WiFi connection status
  * @param mqtt_connected Current MQTT broker connection status
- * @param aht_ok AHT10 temperature/humidity sensor operational status
- * @param bmp_ok BMP280 pressure sensor operational status (unused in this system)
- * @param lux_ok BH1750 light intensity sensor operational status
- * @param aht_temp Temperature reading from AHT10 (°C)
- * @param bmp_temp Temperature reading from BMP280 (°C, unused)
- * @param humidity Relative humidity reading (%)
- * @param pressure Atmospheric pressure reading (Pa, unused)
- * @param lux_val Light intensity reading (lux)
- */
-void mqtt_get_and_publish(bool wifi_connected, bool mqtt_connected, bool aht_ok, bool bmp_ok, bool lux_ok,
-    float aht_temp, float bmp_temp, float humidity, float pressure, float lux_val) {
-    
-    // Select best available temperature source (prioritize AHT10 over BMP280)
-    float temp = aht_ok ? aht_temp : (bmp_ok ? bmp_temp : NAN);
-    
-    // Use sensor readings if available, otherwise set to NaN for JSON compatibility
-    float hum = aht_ok ? humidity : NAN;
-    float pres = bmp_ok ? pressure : NAN;
-    float lux = lux_ok ? lux_val : NAN;
-    
+ * @param sensors Readings of one acquisition
+ */
+void mqtt_get_and_publish(bool wifi_connected, bool mqtt_connected, const SensorData *sensors) {
     // Create standardized JSON payload for sensor data publication
-    char json_payload[256];
-    sprintf(json_payload,
-            "{\"temperatura\":%.2f, \"umidade\":%.2f, \"pressao\":%.2f, \"luminosidade\":%.1f}",
-            temp,
-            hum,
-            pres / 100.0f, // Convert Pascal to hectoPascal (hPa) for standard meteorological units
-            lux);
+    // (buffer taken from the message pool - no heap, no large stack frame)
+    char *json_payload = mem_pool_alloc(&msg_pool);
+    if (json_payload == NULL) {
+        printf("Pool de mensagens esgotado - publicação descartada\n");
+        return;
+    }
+    size_t len = mqtt_format_sensor_json(sensors, json_payload, MSG_BUF_SIZE);
     
     // Publish sensor data only if both WiFi and MQTT connections are active
     if (wifi_connected && mqtt_connected) {
-        mqtt_comm_publish("pico_w/sensors/data", (const uint8_t *)json_payload, strlen(json_payload));
+        mqtt_comm_publish("pico_w/sensors/data", (const uint8_t *)json_payload, len);
     }
+
+    mem_pool_free(&msg_pool, json_payload);
 }
 
 /**
@@ -95,6 +163,248 @@ void mqtt_get_and_publish2(bool wifi_connected, bool mqtt_connected, char *str)
     }
 }
 
+/**
+ * @brief Publish climate control telemetry to MQTT broker
+ * 
+ * Transmits pre-formatted loop timing and actuator duty statistics to the
+ * control status topic.
+ * 
+ * @param wifi_connected Current WiFi connection status
+ * @param mqtt_connected Current MQTT broker connection status
+ * @param str Pre-formatted JSON telemetry string
+ */
+void mqtt_get_and_publish_control(bool wifi_connected, bool mqtt_connected, const char *str) {
+    if (wifi_connected && mqtt_connected) {
+        mqtt_comm_publish("pico_w/control/status", (const uint8_t *)str, strlen(str));
+    }
+}
+
+/* ========== DOSING COMMAND CHANNEL ========== */
+
+/**
+ * @brief Locate the value of @p key in a flat JSON object
+ *
+ * @return Pointer to the first character of the value, NULL if absent
+ */
+static const char *json_value(const char *json, const char *key) {
+    char pattern[24];
+    snprintf(pattern, sizeof(pattern), "\"%s\"", key);
+    const char *p = strstr(json, pattern);
+    if (p == NULL) {
+        return NULL;
+    }
+    p += strlen(pattern);
+    while (*p == ' ' || *p == ':') {
+        p++;
+    }
+    return p;
+}
+
+// Ids of the last doses taken: a QoS 1 redelivery, or the same command
+// arriving on two sessions, must not dose twice
+static uint32_t dose_ids[DOSING_CMD_ID_HISTORY];
+static uint8_t dose_id_next;
+static uint8_t dose_id_count;
+
+/**
+ * @brief Record a dose command id
+ *
+ * @return false if the id was already seen among the last DOSING_CMD_ID_HISTORY
+ */
+static bool dose_id_take(uint32_t id) {
+    for (uint8_t i = 0; i < dose_id_count; i++) {
+        if (dose_ids[i] == id) {
+            return false;
+        }
+    }
+    dose_ids[dose_id_next] = id;
+    dose_id_next = (uint8_t)((dose_id_next + 1) % DOSING_CMD_ID_HISTORY);
+    if (dose_id_count < DOSING_CMD_ID_HISTORY) {
+        dose_id_count++;
+    }
+    return true;
+}
+
+/**
+ * @brief Handle a message on pico_w/<board id>/dosing/cmd (lwIP context)
+ *
+ * {"bomba":"nutriente","ml":5.0,"id":12} queues a dose (negative ml runs
+ * the pump backwards); the id is required and a repeated id is dropped.
+ * {"bomba":"ph","cancelar":true} stops the pump and drops its queue. The
+ * outcome arrives later on pico_w/dosing/events.
+ */
+static void dosing_command_handler(const char *topic, const char *data, size_t len) {
+    const char *pump_name = json_value(data, "bomba");
+    DosingPumpId pump = DOSING_PUMP_COUNT;
+    for (int i = 0; pump_name != NULL && i < DOSING_PUMP_COUNT; i++) {
+        const char *name = dosing_pump_name((DosingPumpId)i);
+        size_t name_len = strlen(name);
+        if (pump_name[0] == '"' && strncmp(pump_name + 1, name, name_len) == 0 && pump_name[1 + name_len] == '"') {
+            pump = (DosingPumpId)i;
+        }
+    }
+    if (pump == DOSING_PUMP_COUNT) {
+        printf("Comando de dosagem ignorado (bomba desconhecida): %s\n", data);
+        return;
+    }
+
+    const char *cancel = json_value(data, "cancelar");
+    if (cancel != NULL && strncmp(cancel, "true", 4) == 0) {
+        dosing_pump_cancel(pump);
+        printf("Dosagem cancelada via MQTT: bomba %s\n", dosing_pump_name(pump));
+        return;
+    }
+
+    const char *ml = json_value(data, "ml");
+    const char *id = json_value(data, "id");
+    if (ml == NULL) {
+        printf("Comando de dosagem ignorado (sem volume): %s\n", data);
+        return;
+    }
+    uint32_t request_id = id != NULL ? (uint32_t)strtoul(id, NULL, 10) : 0;
+    if (request_id == 0) {
+        printf("Comando de dosagem ignorado (sem id): %s\n", data);
+        return;
+    }
+    if (!dose_id_take(request_id)) {
+        printf("Comando de dosagem repetido ignorado: id %lu\n", (unsigned long)request_id);
+        return;
+    }
+    float volume = strtof(ml, NULL);
+    if (!dosing_pump_request(pump, volume, DOSE_SOURCE_MQTT, request_id)) {
+        printf("Dosagem recusada: bomba %s, %.2f mL (fora do limite ou fila cheia)\n",
+               dosing_pump_name(pump), volume);
+    }
+}
+
+/**
+ * @brief Subscribe to this board's dosing command topic
+ *
+ * May be called before the broker connection: the subscription is sent
+ * on every (re)connection. Only sessions that take commands subscribe
+ * (MQTT_CLOUD_COMMANDS for the cloud broker).
+ */
+void mqtt_dosing_init(void) {
+    mqtt_comm_subscribe(fleet_dosing_topic(), dosing_command_handler);
+}
+
+/**
+ * @brief Publish a dose completion event
+ *
+ * @param wifi_connected Current WiFi connection status
+ * @param mqtt_connected Current MQTT broker connection status
+ * @param ev Finished or cancelled dose
+ */
+void mqtt_publish_dosing_event(bool wifi_connected, bool mqtt_connected, const DoseEvent *ev) {
+    if (!wifi_connected || !mqtt_connected) {
+        return;
+    }
+
+    char json[192];
+    int len = snprintf(json, sizeof(json),
+        "{\"bomba\":\"%s\",\"id\":%lu,\"origem\":\"%s\",\"solicitado_ml\":%.2f,"
+        "\"entregue_ml\":%.3f,\"passos\":%ld,\"duracao_ms\":%lu,\"cancelado\":%s}",
+        dosing_pump_name(ev->pump), (unsigned long)ev->id, dosing_source_name(ev->source),
+        ev->requested_ml, ev->delivered_ml, (long)ev->delivered_steps,
+        (unsigned long)ev->duration_ms, ev->cancelled ? "true" : "false");
+    mqtt_comm_publish("pico_w/dosing/events", (const uint8_t *)json, (size_t)len);
+}
+
+/* ========== BATCHED UPLINK ========== */
+
+static bool mqtt_batch_ready(void) {
+    return wifi_check() && mqtt_check();
+}
+
+/**
+ * @brief Publish one line-protocol batch (for a Telegraf/bridge consumer)
+ */
+static bool mqtt_batch_send(const uint8_t *data, size_t len) {
+    return mqtt_comm_publish("pico_w/sensors/batch", data, len);
+}
+
+const UplinkTransport mqtt_batch_transport = {
+    .name = "mqtt",
+#if MQTT_SN_ENABLED
+    .max_payload = MQTT_SN_MAX_PAYLOAD,
+#else
+    .max_payload = BATCH_BUF_SIZE,
+#endif
+    .ready = mqtt_batch_ready,
+    .send = mqtt_batch_send,
+    .compress = UPLINK_MQTT_COMPRESS,
+};
+
+/**
+ * @brief Handle a message on pico_w/<board id>/uplink/cmd (lwIP context)
+ *
+ * {"influx":"192.168.1.20","porta":8089} moves the UDP line-protocol
+ * uplink to another database (port optional, INFLUX_UDP_PORT by default).
+ */
+static void uplink_command_handler(const char *topic, const char *data, size_t len) {
+    const char *host = json_value(data, "influx");
+    if (host == NULL || *host != '"') {
+        printf("Comando de uplink ignorado: %s\n", data);
+        return;
+    }
+
+    char ip[16];
+    size_t n = 0;
+    for (host++; *host != '"' && *host != '\0' && n < sizeof(ip) - 1; host++) {
+        ip[n++] = *host;
+    }
+    ip[n] = '\0';
+
+    const char *port = json_value(data, "porta");
+    uint16_t udp_port = port != NULL ? (uint16_t)strtoul(port, NULL, 10) : INFLUX_UDP_PORT;
+    if (!influx_udp_set_destination(ip, udp_port)) {
+        printf("Destino InfluxDB inválido: %s:%u\n", ip, udp_port);
+    }
+}
+
+/**
+ * @brief Subscribe to this board's uplink configuration topic
+ *
+ * Redirects all telemetry: like the dosing commands, only subscribed on
+ * sessions that take commands.
+ */
+void mqtt_uplink_init(void) {
+    mqtt_comm_subscribe(fleet_uplink_topic(), uplink_command_handler);
+}
+
+/* ========== FLEET SLOT ========== */
+
+/**
+ * @brief Handle a message on pico_w/fleet/<board id>/slot (lwIP context)
+ *
+ * {"slot":3,"slots":20} publishes at 3/20 of every period; {"slots":0}
+ * goes back to the phase derived from the board ID.
+ */
+static void fleet_slot_handler(const char *topic, const char *data, size_t len) {
+    const char *slot = json_value(data, "slot");
+    const char *slots = json_value(data, "slots");
+    if (slots == NULL) {
+        printf("Slot da frota ignorado: %s\n", data);
+        return;
+    }
+    uint32_t n = (uint32_t)strtoul(slots, NULL, 10);
+    uint32_t s = slot != NULL ? (uint32_t)strtoul(slot, NULL, 10) : 0;
+    if (!fleet_stagger_set_slot(s, n)) {
+        printf("Slot da frota inválido: %lu/%lu\n", (unsigned long)s, (unsigned long)n);
+    } else if (n > 0) {
+        printf("Slot de publicação atribuído: %lu/%lu\n", (unsigned long)s, (unsigned long)n);
+    } else {
+        printf("Slot de publicação liberado: fase pelo ID da placa\n");
+    }
+}
+
+/**
+ * @brief Subscribe to this board's slot assignment topic
+ */
+void mqtt_fleet_init(void) {
+    mqtt_comm_subscribe(fleet_slot_topic(), fleet_slot_handler);
+}
+
 /* ========== CONNECTION STATUS FUNCTIONS ========== */
 
 /**
@@ -0,0 +1,695 @@
+/**
+ * @file mqtt_sn_client.c
+ * @brief MQTT-SN 1.2 client on lwIP raw UDP (sleeping client)
+ *
+ * Talks to a local MQTT-SN gateway (e.g. Eclipse Paho MQTT-SN Gateway)
+ * that holds the TCP session to the broker, so a dense rack keeps one
+ * broker connection per gateway instead of one per node.
+ *
+ * Topics are pre-defined IDs (topic ID type 1): the table below must match
+ * the gateway's predefined topic file, and no REGISTER round trip is ever
+ * needed. Command topics are per board (pico_w/<board id>/...): the
+ * gateway maps their IDs per client ID. Each topic has a fixed QoS:
+ *
+ *   -1  sent at once in any state, even asleep or without a session
+ *       (routine telemetry: the next sample replaces a lost one)
+ *    0  queued in the outbox and sent while the client is active
+ *    1  queued, sent one at a time, retransmitted until PUBACK
+ *
+ * Sleeping client: once the outbox is empty and nothing happened for
+ * MQTT_SN_AWAKE_MS, the client sends DISCONNECT with a sleep duration
+ * derived from the current publish period (see power_manager.h) and the
+ * gateway buffers messages for it. Every sleep period it wakes with a
+ * PINGREQ carrying its client ID; the gateway delivers what it buffered
+ * (dosing and uplink commands) and answers PINGRESP, and the client goes
+ * back to sleep. A QoS 0/1 message reconnects (CONNECT without clean
+ * session, subscriptions kept) and sleep resumes after it is delivered.
+ *
+ * The receive path runs in lwIP context; the public functions take the
+ * lwIP lock themselves.
+ */
+
+#include "mqtt_sn_client.h"
+#include "app_config.h"
+#include "fleet_stagger.h"
+#include "pico/cyw43_arch.h"
+#include "lwip/ip_addr.h"
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+#include <stdio.h>
+#include <string.h>
+
+/* ========== PROTOCOL CONSTANTS ========== */
+
+#define SN_CONNECT 0x04
+#define SN_CONNACK 0x05
+#define SN_REGISTER 0x0A
+#define SN_REGACK 0x0B
+#define SN_PUBLISH 0x0C
+#define SN_PUBACK 0x0D
+#define SN_SUBSCRIBE 0x12
+#define SN_SUBACK 0x13
+#define SN_PINGREQ 0x16
+#define SN_PINGRESP 0x17
+#define SN_DISCONNECT 0x18
+
+#define SN_FLAG_DUP 0x80
+#define SN_FLAG_QOS0 0x00
+#define SN_FLAG_QOS1 0x20
+#define SN_FLAG_QOS_MINUS1 0x60
+#define SN_FLAG_QOS_MASK 0x60
+#define SN_FLAG_CLEAN_SESSION 0x04
+#define SN_TOPIC_PREDEFINED 0x01
+#define SN_TOPIC_TYPE_MASK 0x03
+
+#define SN_PROTOCOL_ID 0x01
+
+#define SN_RC_ACCEPTED 0x00
+#define SN_RC_INVALID_TOPIC 0x02
+#define SN_RC_NOT_SUPPORTED 0x03
+
+#define SN_PUBLISH_FIXED 5             // Flags, topic ID, message ID
+#define SN_RX_BUF_SIZE 256             // Largest message accepted from the gateway
+#define SN_MAX_SUBSCRIPTIONS 4
+#define IP_UDP_HEADERS 28              // Counted in the wire byte statistics
+
+/* ========== TYPES ========== */
+
+/**
+ * @brief A pre-defined topic and the QoS it is published with
+ */
+typedef struct {
+    const char *name;                  // NULL: per-board topic from board_name()
+    const char *(*board_name)(void);
+    uint16_t id;
+    int8_t qos;                        // -1, 0 or 1
+} SnTopic;
+
+/**
+ * @brief Client states (MQTT-SN 1.2, section 6.14)
+ */
+typedef enum {
+    SN_STATE_DISCONNECTED = 0,         // No session: CONNECT after the back-off
+    SN_STATE_CONNECTING,               // CONNECT sent, waiting for CONNACK
+    SN_STATE_ACTIVE,                   // Session up: outbox drains, keep-alive runs
+    SN_STATE_ASLEEP,                   // Gateway buffers for us until the wake-up
+    SN_STATE_AWAKE,                    // PINGREQ sent: receiving buffered messages
+} SnState;
+
+/**
+ * @brief QoS 0/1 message waiting for the active state (or a PUBACK)
+ */
+typedef struct {
+    const SnTopic *topic;
+    uint16_t msg_id;
+    uint16_t len;
+    uint8_t data[MQTT_SN_MAX_PAYLOAD];
+} SnMessage;
+
+typedef struct {
+    const SnTopic *topic;
+    mqtt_message_handler_t handler;
+} SnSubscription;
+
+typedef struct {
+    uint32_t published[3];             // By QoS: -1, 0, 1
+    uint32_t retransmissions;
+    uint32_t refused;                  // Outbox full, unknown topic or too large
+    uint32_t received;
+    uint32_t sleeps;
+    uint32_t wakeups;
+    uint32_t connects;
+    uint64_t bytes_out;                // Including IP/UDP headers
+    uint64_t bytes_in;
+} SnStats;
+
+/* ========== TOPIC TABLE ========== */
+
+// Must match the gateway's predefined topic file (same IDs, same names)
+static const SnTopic topics[] = {
+    { "pico_w/sensors/data", NULL, 1, -1 },
+    { "pico_w/sensors/alerts", NULL, 2, 1 },
+    { "pico_w/control/status", NULL, 3, -1 },
+    { "pico_w/sensors/batch", NULL, 4, 0 },
+    { "pico_w/dosing/events", NULL, 5, 1 },
+    { NULL, fleet_dosing_topic, 6, 1 },
+    { NULL, fleet_uplink_topic, 7, 1 },
+};
+
+#define TOPIC_COUNT (sizeof(topics) / sizeof(topics[0]))
+
+/* ========== PRIVATE VARIABLES ========== */
+
+static struct udp_pcb *pcb;
+static ip_addr_t gateway_addr;
+static uint16_t gateway_port;
+static const char *client_id;
+static bool *status_flag;              // Mirrors "session alive" for mqtt_check()
+
+static SnState state;
+static bool session_ready;             // Subscriptions made: later CONNECTs keep the session
+static absolute_time_t deadline;       // Retry, idle or wake-up timer of the current state
+static absolute_time_t keepalive_at;   // Next PINGREQ while active
+static uint8_t retries;
+static uint32_t sleep_period_ms;       // Last period passed to mqtt_sn_poll()
+
+static SnMessage outbox[MQTT_SN_OUTBOX];
+static uint8_t outbox_head;
+static uint8_t outbox_count;
+static bool in_flight;                 // outbox[outbox_head] sent with QoS 1, no PUBACK yet
+static uint16_t next_msg_id = 1;
+
+static SnSubscription subscriptions[SN_MAX_SUBSCRIPTIONS];
+static int subscription_count;
+
+static uint8_t rx_buf[SN_RX_BUF_SIZE + 1];   // +1: NUL for the handlers
+static SnStats stats;
+
+/* ========== PRIVATE FUNCTIONS ========== */
+
+static const char *topic_name(const SnTopic *topic) {
+    return topic->name != NULL ? topic->name : topic->board_name();
+}
+
+static const SnTopic *find_topic_by_name(const char *name) {
+    for (size_t i = 0; i < TOPIC_COUNT; i++) {
+        if (strcmp(topic_name(&topics[i]), name) == 0) {
+            return &topics[i];
+        }
+    }
+    return NULL;
+}
+
+static const SnTopic *find_topic_by_id(uint16_t id) {
+    for (size_t i = 0; i < TOPIC_COUNT; i++) {
+        if (topics[i].id == id) {
+            return &topics[i];
+        }
+    }
+    return NULL;
+}
+
+static uint16_t new_msg_id(void) {
+    uint16_t id = next_msg_id++;
+    if (next_msg_id == 0) {
+        next_msg_id = 1;
+    }
+    return id;
+}
+
+static void put_u16(uint8_t *p, uint16_t value) {
+    p[0] = (uint8_t)(value >> 8);
+    p[1] = (uint8_t)value;
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+/**
+ * @brief Send one message: header, fixed part and optional payload
+ */
+static bool send_message(uint8_t type, const uint8_t *body, size_t body_len, const uint8_t *payload,
+                         size_t payload_len) {
+    if (pcb == NULL) {
+        return false;
+    }
+    size_t len = 2 + body_len + payload_len;
+    size_t header = 2;
+    if (len > 255) {
+        len += 2;                      // 0x01 + 16-bit length
+        header = 4;
+    }
+
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)len, PBUF_RAM);
+    if (p == NULL) {
+        return false;
+    }
+    uint8_t *out = p->payload;
+    if (header == 4) {
+        out[0] = 0x01;
+        put_u16(&out[1], (uint16_t)len);
+        out[3] = type;
+    } else {
+        out[0] = (uint8_t)len;
+        out[1] = type;
+    }
+    if (body_len > 0) {
+        memcpy(out + header, body, body_len);
+    }
+    if (payload_len > 0) {
+        memcpy(out + header + body_len, payload, payload_len);
+    }
+
+    err_t err = udp_sendto(pcb, p, &gateway_addr, gateway_port);
+    pbuf_free(p);
+    if (err == ERR_OK) {
+        stats.bytes_out += len + IP_UDP_HEADERS;
+    }
+    return err == ERR_OK;
+}
+
+static bool send_publish(const SnTopic *topic, uint8_t flags, uint16_t msg_id, const uint8_t *data, size_t len) {
+    uint8_t body[SN_PUBLISH_FIXED];
+    body[0] = flags | SN_TOPIC_PREDEFINED;
+    put_u16(&body[1], topic->id);
+    put_u16(&body[3], msg_id);
+    return send_message(SN_PUBLISH, body, sizeof(body), data, len);
+}
+
+static void send_puback(uint16_t topic_id, uint16_t msg_id, uint8_t rc) {
+    uint8_t body[5];
+    put_u16(&body[0], topic_id);
+    put_u16(&body[2], msg_id);
+    body[4] = rc;
+    send_message(SN_PUBACK, body, sizeof(body), NULL, 0);
+}
+
+static void send_connect(bool clean) {
+    uint8_t body[4];
+    body[0] = clean ? SN_FLAG_CLEAN_SESSION : 0;
+    body[1] = SN_PROTOCOL_ID;
+    put_u16(&body[2], MQTT_SN_KEEPALIVE_S);
+    send_message(SN_CONNECT, body, sizeof(body), (const uint8_t *)client_id, strlen(client_id));
+    stats.connects++;
+}
+
+static void send_subscribe(const SnTopic *topic) {
+    uint8_t body[5];
+    body[0] = SN_FLAG_QOS1 | SN_TOPIC_PREDEFINED;
+    put_u16(&body[1], new_msg_id());
+    put_u16(&body[3], topic->id);
+    send_message(SN_SUBSCRIBE, body, sizeof(body), NULL, 0);
+}
+
+/**
+ * @brief Sleep duration announced to the gateway (seconds)
+ *
+ * Half a period of margin, so a wake-up that is a little late (long sensor
+ * cycle, Wi-Fi reconnection) does not make the gateway drop the session.
+ */
+static uint16_t sleep_duration_s(void) {
+    uint32_t s = sleep_period_ms / 1000;
+    s += s / 2 + 1;
+    return s > UINT16_MAX ? UINT16_MAX : (uint16_t)s;
+}
+
+static void enter_disconnected(const char *reason) {
+    if (state != SN_STATE_DISCONNECTED) {
+        printf("MQTT-SN: sessão perdida (%s)\n", reason);
+    }
+    state = SN_STATE_DISCONNECTED;
+    session_ready = false;             // Next CONNECT starts clean and subscribes again
+    in_flight = false;
+    retries = 0;
+    deadline = make_timeout_time_ms(fleet_stagger_backoff_ms(MQTT_SN_RECONNECT_MS)); // Randomized: no rack-wide burst
+    *status_flag = false;
+}
+
+static void enter_active(void) {
+    state = SN_STATE_ACTIVE;
+    retries = 0;
+    deadline = make_timeout_time_ms(MQTT_SN_AWAKE_MS);
+    keepalive_at = make_timeout_time_ms(MQTT_SN_KEEPALIVE_S * 1000u / 2);
+}
+
+static void enter_asleep(void) {
+    state = SN_STATE_ASLEEP;
+    retries = 0;
+    deadline = make_timeout_time_ms(sleep_period_ms);
+}
+
+static void pop_outbox(void) {
+    outbox_head = (outbox_head + 1) % MQTT_SN_OUTBOX;
+    outbox_count--;
+    in_flight = false;
+    retries = 0;
+}
+
+/**
+ * @brief Send the oldest queued message (active state only)
+ */
+static void send_next(void) {
+    SnMessage *msg = &outbox[outbox_head];
+    if (msg->topic->qos == 0) {
+        if (send_publish(msg->topic, SN_FLAG_QOS0, 0, msg->data, msg->len)) {
+            stats.published[1]++;
+        }
+        pop_outbox();                  // QoS 0: one attempt
+    } else {
+        uint8_t flags = SN_FLAG_QOS1 | (retries > 0 ? SN_FLAG_DUP : 0);
+        send_publish(msg->topic, flags, msg->msg_id, msg->data, msg->len);
+        in_flight = true;
+        deadline = make_timeout_time_ms(MQTT_SN_RETRY_MS);
+    }
+}
+
+static void handle_publish(const uint8_t *body, size_t len) {
+    if (len < SN_PUBLISH_FIXED) {
+        return;
+    }
+    uint8_t flags = body[0];
+    uint16_t topic_id = get_u16(&body[1]);
+    uint16_t msg_id = get_u16(&body[3]);
+    const SnTopic *topic = (flags & SN_TOPIC_TYPE_MASK) == SN_TOPIC_PREDEFINED ? find_topic_by_id(topic_id) : NULL;
+
+    if ((flags & SN_FLAG_QOS_MASK) == SN_FLAG_QOS1) {
+        send_puback(topic_id, msg_id, topic != NULL ? SN_RC_ACCEPTED : SN_RC_INVALID_TOPIC);
+    }
+    if (topic == NULL) {
+        return;
+    }
+
+    // Payload moved to the start of the buffer and terminated for the handler
+    size_t data_len = len - SN_PUBLISH_FIXED;
+    memmove(rx_buf, body + SN_PUBLISH_FIXED, data_len);
+    rx_buf[data_len] = '\0';
+    stats.received++;
+    for (int i = 0; i < subscription_count; i++) {
+        if (subscriptions[i].topic == topic) {
+            subscriptions[i].handler(topic_name(topic), (const char *)rx_buf, data_len);
+        }
+    }
+    if (state == SN_STATE_ACTIVE && !in_flight) {
+        deadline = make_timeout_time_ms(MQTT_SN_AWAKE_MS); // Commands may bring replies
+    }
+}
+
+static void handle_message(uint8_t type, const uint8_t *body, size_t len) {
+    switch (type) {
+    case SN_CONNACK:
+        if (state != SN_STATE_CONNECTING || len < 1) {
+            break;
+        }
+        if (body[0] != SN_RC_ACCEPTED) {
+            printf("MQTT-SN: CONNECT recusado (%u)\n", body[0]);
+            enter_disconnected("recusado");
+            break;
+        }
+        if (!session_ready) {
+            printf("MQTT-SN: conectado ao gateway\n");
+            for (int i = 0; i < subscription_count; i++) {
+                send_subscribe(subscriptions[i].topic);
+            }
+            session_ready = true;
+        }
+        *status_flag = true;
+        enter_active();
+        break;
+
+    case SN_PUBACK:
+        if (len < 5 || !in_flight || get_u16(&body[2]) != outbox[outbox_head].msg_id) {
+            break;
+        }
+        if (body[4] == SN_RC_ACCEPTED) {
+            stats.published[2]++;
+        } else {
+            printf("MQTT-SN: %s rejeitado pelo gateway (%u)\n", topic_name(outbox[outbox_head].topic), body[4]);
+        }
+        pop_outbox();
+        deadline = make_timeout_time_ms(MQTT_SN_AWAKE_MS);
+        break;
+
+    case SN_SUBACK:
+        if (len >= 6 && body[5] != SN_RC_ACCEPTED) {
+            printf("MQTT-SN: inscrição no tópico %u recusada (%u)\n", get_u16(&body[1]), body[5]);
+        }
+        break;
+
+    case SN_PUBLISH:
+        handle_publish(body, len);
+        break;
+
+    case SN_REGISTER:
+        // Only pre-defined topics are used: refuse normal topic IDs
+        if (len >= 4) {
+            uint8_t ack[5];
+            put_u16(&ack[0], 0);
+            put_u16(&ack[2], get_u16(&body[2]));
+            ack[4] = SN_RC_NOT_SUPPORTED;
+            send_message(SN_REGACK, ack, sizeof(ack), NULL, 0);
+        }
+        break;
+
+    case SN_PINGRESP:
+        if (state == SN_STATE_AWAKE) {
+            enter_asleep();            // Buffered messages delivered
+        }
+        break;
+
+    case SN_DISCONNECT:
+        // Answer to our sleep request, or the gateway ending the session
+        if (state != SN_STATE_ASLEEP) {
+            enter_disconnected("DISCONNECT do gateway");
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void sn_recv(void *arg, struct udp_pcb *upcb, struct pbuf *p, const ip_addr_t *addr, u16_t port) {
+    size_t len = pbuf_copy_partial(p, rx_buf, SN_RX_BUF_SIZE, 0);
+    bool truncated = p->tot_len > SN_RX_BUF_SIZE;
+    stats.bytes_in += p->tot_len + IP_UDP_HEADERS;
+    pbuf_free(p);
+
+    if (truncated || len < 2 || !ip_addr_cmp(addr, &gateway_addr) || port != gateway_port) {
+        return;
+    }
+    size_t msg_len = rx_buf[0];
+    size_t header = 2;
+    if (msg_len == 0x01) {
+        if (len < 4) {
+            return;
+        }
+        msg_len = get_u16(&rx_buf[1]);
+        header = 4;
+    }
+    if (msg_len < header || msg_len > len) {
+        return;
+    }
+    handle_message(rx_buf[header - 1], rx_buf + header, msg_len - header);
+}
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Point the client at the gateway and start connecting
+ *
+ * Safe to call again after a Wi-Fi reconnection: the session restarts.
+ *
+ * @param id Client ID (string with static lifetime)
+ * @param gateway_ip Dotted IPv4 address of the gateway
+ * @param port UDP port of the gateway
+ * @param status Set while a session exists (active or asleep)
+ * @return false if the address is invalid or the socket could not be opened
+ */
+bool mqtt_sn_init(const char *id, const char *gateway_ip, uint16_t port, bool *status) {
+    ip_addr_t addr;
+    if (!ipaddr_aton(gateway_ip, &addr)) {
+        printf("MQTT-SN: endereço do gateway inválido %s\n", gateway_ip);
+        *status = false;
+        return false;
+    }
+
+    cyw43_arch_lwip_begin();
+    if (pcb == NULL) {
+        pcb = udp_new_ip_type(IPADDR_TYPE_ANY);
+        if (pcb != NULL) {
+            udp_recv(pcb, sn_recv, NULL);
+        }
+    }
+    gateway_addr = addr;
+    gateway_port = port;
+    client_id = id;
+    status_flag = status;
+    state = SN_STATE_DISCONNECTED;
+    session_ready = false;
+    in_flight = false;
+    retries = 0;
+    deadline = get_absolute_time();    // Connect at the next poll
+    *status = false;
+    cyw43_arch_lwip_end();
+
+    if (pcb == NULL) {
+        printf("MQTT-SN: sem memória para o socket UDP\n");
+        return false;
+    }
+    printf("MQTT-SN: gateway %s:%u\n", gateway_ip, port);
+    return true;
+}
+
+/**
+ * @brief Publish on a pre-defined topic with the topic's QoS
+ *
+ * @return false if the topic is not in the table, the payload exceeds
+ *         MQTT_SN_MAX_PAYLOAD, or the message could not be sent/queued
+ */
+bool mqtt_sn_publish(const char *topic, const uint8_t *data, size_t len) {
+    const SnTopic *t = find_topic_by_name(topic);
+    if (t == NULL || len > MQTT_SN_MAX_PAYLOAD || status_flag == NULL) {
+        if (t == NULL) {
+            printf("MQTT-SN: tópico sem ID pré-definido: %s\n", topic);
+        }
+        stats.refused++;
+        return false;
+    }
+
+    bool ok;
+    cyw43_arch_lwip_begin();
+    if (t->qos < 0) {
+        ok = send_publish(t, SN_FLAG_QOS_MINUS1, 0, data, len);
+        if (ok) {
+            stats.published[0]++;
+        }
+    } else if (outbox_count < MQTT_SN_OUTBOX) {
+        SnMessage *msg = &outbox[(outbox_head + outbox_count) % MQTT_SN_OUTBOX];
+        msg->topic = t;
+        msg->msg_id = t->qos > 0 ? new_msg_id() : 0;
+        msg->len = (uint16_t)len;
+        memcpy(msg->data, data, len);
+        outbox_count++;
+        ok = true;                     // Sent by mqtt_sn_poll() (waking the session if asleep)
+    } else {
+        ok = false;
+    }
+    cyw43_arch_lwip_end();
+
+    if (!ok) {
+        stats.refused++;
+    }
+    return ok;
+}
+
+/**
+ * @brief Subscribe to a pre-defined topic (QoS 1, kept across sleeps)
+ *
+ * @return false if the topic is not in the table or the table is full
+ */
+bool mqtt_sn_subscribe(const char *topic, mqtt_message_handler_t handler) {
+    const SnTopic *t = find_topic_by_name(topic);
+    if (t == NULL) {
+        printf("MQTT-SN: tópico sem ID pré-definido: %s\n", topic);
+        return false;
+    }
+
+    cyw43_arch_lwip_begin();
+    bool ok = subscription_count < SN_MAX_SUBSCRIPTIONS;
+    if (ok) {
+        subscriptions[subscription_count++] = (SnSubscription){ t, handler };
+        // Session up: subscribe now; otherwise it goes out with the next clean CONNECT
+        if (session_ready && state == SN_STATE_ACTIVE) {
+            send_subscribe(t);
+        }
+    }
+    cyw43_arch_lwip_end();
+    return ok;
+}
+
+/**
+ * @brief Drive the state machine (network context, every loop pass)
+ *
+ * @param period_ms Current publish period; the client sleeps that long
+ *        between wake-ups (MQTT_SN_SLEEP_ENABLED)
+ * @return Time of the next timer, to size the caller's wait
+ */
+absolute_time_t mqtt_sn_poll(uint32_t period_ms) {
+    if (status_flag == NULL) {
+        return at_the_end_of_time;     // mqtt_sn_init() not called yet
+    }
+
+    cyw43_arch_lwip_begin();
+    sleep_period_ms = period_ms;
+
+    switch (state) {
+    case SN_STATE_DISCONNECTED:
+        if (time_reached(deadline)) {
+            send_connect(true);
+            state = SN_STATE_CONNECTING;
+            retries = 0;
+            deadline = make_timeout_time_ms(MQTT_SN_RETRY_MS);
+        }
+        break;
+
+    case SN_STATE_CONNECTING:
+        if (time_reached(deadline)) {
+            if (++retries > MQTT_SN_MAX_RETRIES) {
+                enter_disconnected("sem CONNACK");
+            } else {
+                send_connect(!session_ready);
+                deadline = make_timeout_time_ms(MQTT_SN_RETRY_MS);
+            }
+        }
+        break;
+
+    case SN_STATE_ACTIVE:
+        if (in_flight && time_reached(deadline)) {
+            if (++retries > MQTT_SN_MAX_RETRIES) {
+                enter_disconnected("sem PUBACK");
+                break;
+            }
+            stats.retransmissions++;
+            send_next();               // Same message, DUP set
+        }
+        while (!in_flight && outbox_count > 0) {
+            send_next();
+        }
+        if (time_reached(keepalive_at)) {
+            send_message(SN_PINGREQ, NULL, 0, NULL, 0);
+            keepalive_at = make_timeout_time_ms(MQTT_SN_KEEPALIVE_S * 1000u / 2);
+        }
+        if (MQTT_SN_SLEEP_ENABLED && !in_flight && outbox_count == 0 && time_reached(deadline)) {
+            uint8_t body[2];
+            put_u16(body, sleep_duration_s());
+            send_message(SN_DISCONNECT, body, sizeof(body), NULL, 0);
+            stats.sleeps++;
+            enter_asleep();
+        }
+        break;
+
+    case SN_STATE_ASLEEP:
+        if (outbox_count > 0) {
+            send_connect(false);       // Session kept by the gateway
+            state = SN_STATE_CONNECTING;
+            retries = 0;
+            deadline = make_timeout_time_ms(MQTT_SN_RETRY_MS);
+        } else if (time_reached(deadline)) {
+            send_message(SN_PINGREQ, NULL, 0, (const uint8_t *)client_id, strlen(client_id));
+            stats.wakeups++;
+            state = SN_STATE_AWAKE;
+            deadline = make_timeout_time_ms(MQTT_SN_RETRY_MS);
+        }
+        break;
+
+    case SN_STATE_AWAKE:
+        if (time_reached(deadline)) {
+            if (++retries > MQTT_SN_MAX_RETRIES) {
+                enter_disconnected("sem PINGRESP");
+            } else {
+                send_message(SN_PINGREQ, NULL, 0, (const uint8_t *)client_id, strlen(client_id));
+                deadline = make_timeout_time_ms(MQTT_SN_RETRY_MS);
+            }
+        }
+        break;
+    }
+
+    absolute_time_t next = deadline;
+    if (state == SN_STATE_ACTIVE && absolute_time_diff_us(keepalive_at, next) > 0) {
+        next = keepalive_at;
+    }
+    cyw43_arch_lwip_end();
+    return next;
+}
+
+void mqtt_sn_print_stats(void) {
+    static const char *const state_names[] = { "desconectado", "conectando", "ativo", "dormindo", "acordado" };
+    printf("[mqtt-sn] %s: publicados QoS-1/0/1 %lu/%lu/%lu, %lu retransmissões, %lu recusados, %lu recebidos\n",
+           state_names[state], (unsigned long)stats.published[0], (unsigned long)stats.published[1],
+           (unsigned long)stats.published[2], (unsigned long)stats.retransmissions, (unsigned long)stats.refused,
+           (unsigned long)stats.received);
+    printf("[mqtt-sn] %lu conexões, %lu sonos, %lu despertares, %llu bytes enviados, %llu recebidos\n",
+           (unsigned long)stats.connects, (unsigned long)stats.sleeps, (unsigned long)stats.wakeups,
+           (unsigned long long)stats.bytes_out, (unsigned long long)stats.bytes_in);
+}
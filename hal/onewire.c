@@ -0,0 +1,193 @@
+/**
+ * @file onewire.c
+ * @brief PIO 1-Wire master: blocking setup operations and DMA command batches
+ *
+ * The state machine executes command words (reset, or 1..8 bit slots) and
+ * answers each with one result word, so a whole transaction can be handed
+ * to two DMA channels: one feeds the prepared commands into the TX FIFO,
+ * the other stores every result. A 20-byte scratchpad read then costs the
+ * CPU a DMA setup and a completion check instead of ~12ms of bit-banging
+ * with interrupts off.
+ */
+
+#include "onewire.h"
+#include "app_config.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "onewire.pio.h"
+
+_Static_assert(sizeof(onewire_program_instructions) / sizeof(uint16_t) == ONEWIRE_PIO_INSTRUCTIONS,
+               "update ONEWIRE_PIO_INSTRUCTIONS (PIO budget)");
+
+/* ========== PRIVATE FUNCTIONS ========== */
+
+/**
+ * @brief Run one command word and wait for its result (~0.5ms max)
+ */
+static uint32_t transfer(OneWireBus *bus, uint32_t command) {
+    pio_sm_put_blocking(bus->pio, bus->sm, command);
+    return pio_sm_get_blocking(bus->pio, bus->sm);
+}
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Claim a state machine in ONEWIRE_PIO and DMA channels and start the bus on @p pin
+ *
+ * @return false if no PIO or DMA resources are left
+ */
+bool onewire_init(OneWireBus *bus, uint pin) {
+    bus->pin = pin;
+    bus->pio = pio_get_instance(ONEWIRE_PIO);
+    if (!pio_can_add_program(bus->pio, &onewire_program)) {
+        return false;
+    }
+    int sm = pio_claim_unused_sm(bus->pio, false);
+    if (sm < 0) {
+        return false;
+    }
+    bus->sm = (uint)sm;
+    uint offset = pio_add_program(bus->pio, &onewire_program);
+
+    bus->dma_tx = dma_claim_unused_channel(false);
+    bus->dma_rx = dma_claim_unused_channel(false);
+    if (bus->dma_tx < 0 || bus->dma_rx < 0) {
+        // Give back whichever channel was claimed
+        if (bus->dma_tx >= 0) {
+            dma_channel_unclaim((uint)bus->dma_tx);
+        }
+        if (bus->dma_rx >= 0) {
+            dma_channel_unclaim((uint)bus->dma_rx);
+        }
+        pio_remove_program_and_unclaim_sm(&onewire_program, bus->pio, bus->sm, offset);
+        return false;
+    }
+
+    onewire_program_init(bus->pio, bus->sm, offset, pin);
+    return true;
+}
+
+/**
+ * @brief Reset pulse (blocking, ~1ms)
+ *
+ * @return true if at least one device answered with a presence pulse
+ */
+bool onewire_reset(OneWireBus *bus) {
+    return (transfer(bus, onewire_cmd_reset()) >> 31) == 0;
+}
+
+/**
+ * @brief Enumerate the devices on the bus (blocking, ~15ms per device)
+ *
+ * Standard ROM search: every step reads a bit and its complement, and
+ * writes the chosen branch back. Discrepancies are replayed in order, so
+ * each pass finds the next ROM. ROMs with a bad CRC are dropped.
+ *
+ * @param roms Found ROM codes (family code in the low byte)
+ * @param max_roms Capacity of @p roms
+ * @param family Keep only this family code (0 = all)
+ * @return Number of ROMs stored
+ */
+int onewire_search(OneWireBus *bus, uint64_t *roms, int max_roms, uint8_t family) {
+    int found = 0;
+    int last_discrepancy = 0;   // 1-based bit of the last branch taken as 0
+    uint64_t rom = 0;
+
+    do {
+        if (!onewire_reset(bus)) {
+            break;
+        }
+        transfer(bus, onewire_cmd_byte(ONEWIRE_CMD_SEARCH_ROM));
+
+        int last_zero = 0;
+        for (int bit = 1; bit <= 64; bit++) {
+            uint8_t pair = onewire_result_bits(transfer(bus, onewire_cmd_bits(0x03, 2)), 2);
+            bool id_bit = pair & 1;
+            bool complement = pair & 2;
+            bool direction;
+
+            if (id_bit && complement) {
+                return found; // Nobody answered this step
+            } else if (id_bit != complement) {
+                direction = id_bit; // All remaining devices agree
+            } else {
+                // Both values present: replay earlier choices, then take the new branch
+                if (bit < last_discrepancy) {
+                    direction = (rom >> (bit - 1)) & 1;
+                } else {
+                    direction = (bit == last_discrepancy);
+                }
+                if (!direction) {
+                    last_zero = bit;
+                }
+            }
+
+            if (direction) {
+                rom |= 1ull << (bit - 1);
+            } else {
+                rom &= ~(1ull << (bit - 1));
+            }
+            transfer(bus, onewire_cmd_bits(direction, 1));
+        }
+        last_discrepancy = last_zero;
+
+        uint8_t bytes[8];
+        for (int i = 0; i < 8; i++) {
+            bytes[i] = (uint8_t)(rom >> (8 * i));
+        }
+        if (onewire_crc8(bytes, 7) == bytes[7] && (family == 0 || bytes[0] == family)) {
+            roms[found++] = rom;
+        }
+    } while (last_discrepancy != 0 && found < max_roms);
+
+    return found;
+}
+
+/**
+ * @brief Start a command batch in the background
+ *
+ * @param commands Command words (must stay valid until completion)
+ * @param results One result word per command
+ * @return false if a batch is still running
+ */
+bool onewire_start(OneWireBus *bus, const uint32_t *commands, uint32_t *results, uint count) {
+    if (onewire_busy(bus)) {
+        return false;
+    }
+
+    dma_channel_config rx = dma_channel_get_default_config(bus->dma_rx);
+    channel_config_set_transfer_data_size(&rx, DMA_SIZE_32);
+    channel_config_set_read_increment(&rx, false);
+    channel_config_set_write_increment(&rx, true);
+    channel_config_set_dreq(&rx, pio_get_dreq(bus->pio, bus->sm, false));
+    dma_channel_configure(bus->dma_rx, &rx, results, &bus->pio->rxf[bus->sm], count, true);
+
+    dma_channel_config tx = dma_channel_get_default_config(bus->dma_tx);
+    channel_config_set_transfer_data_size(&tx, DMA_SIZE_32);
+    channel_config_set_read_increment(&tx, true);
+    channel_config_set_write_increment(&tx, false);
+    channel_config_set_dreq(&tx, pio_get_dreq(bus->pio, bus->sm, true));
+    dma_channel_configure(bus->dma_tx, &tx, &bus->pio->txf[bus->sm], commands, count, true);
+    return true;
+}
+
+/**
+ * @brief true while a batch started by onewire_start() is still on the wire
+ */
+bool onewire_busy(const OneWireBus *bus) {
+    return dma_channel_is_busy(bus->dma_rx);
+}
+
+/**
+ * @brief Dallas/Maxim CRC-8 (poly x^8+x^5+x^4+1, reflected)
+ */
+uint8_t onewire_crc8(const uint8_t *data, size_t len) {
+    uint8_t crc = 0;
+    while (len--) {
+        crc ^= *data++;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (uint8_t)((crc >> 1) ^ 0x8C) : (uint8_t)(crc >> 1);
+        }
+    }
+    return crc;
+}
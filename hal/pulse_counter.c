@@ -0,0 +1,179 @@
+/**
+ * @file pulse_counter.c
+ * @brief PIO pulse counting and period measurement with DMA draining
+ *
+ * Each input has its own PIO state machine (drivers/pulse_counter.pio) that
+ * measures the period between rising edges and pushes it at every edge. A
+ * DMA channel paced by the RX FIFO copies each period into one word of RAM,
+ * always overwriting the previous one, and its decrementing transfer count
+ * is the running pulse total. Nothing interrupts the CPU, however fast the
+ * pulses come: lwIP and the sample loop keep their timing at several kHz.
+ *
+ * Once per acquisition pulse_counter_read() turns the counts into a rate.
+ * With enough pulses in the window it is the average over the window, which
+ * suits volume totals. Slow signals use the last measured period, which
+ * gives resolution that the count alone cannot. A channel with no pulse for
+ * PULSE_STALL_MS reads 0 and is flagged stalled for the alert engine. An
+ * input that never saw a pulse reads the same as an unconnected one, so
+ * readings also say whether any pulse arrived since boot.
+ */
+
+#include "pulse_counter.h"
+#include "app_config.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/pio.h"
+#include "hardware/timer.h"
+#include "pulse_counter.pio.h"
+#include <stdio.h>
+
+_Static_assert(sizeof(pulse_counter_program_instructions) / sizeof(uint16_t) == PULSE_COUNTER_PIO_INSTRUCTIONS,
+               "update PULSE_COUNTER_PIO_INSTRUCTIONS (PIO budget)");
+
+/* ========== PRIVATE TYPES ========== */
+
+#define DMA_COUNT_START 0xFFFFFFFFu
+#define PERIOD_OVERHEAD_CYCLES 6u      // Cycles per period not spent in the 2-cycle loops
+
+/**
+ * @brief Hardware and window state of one input
+ */
+typedef struct {
+    uint pin;                          // Input GPIO
+    PIO pio;                           // Owning PIO block
+    uint sm;                           // State machine measuring the pin
+    int dma;                           // Channel draining the RX FIFO
+    volatile uint32_t last_period;     // DMA target: latest period (loop iterations)
+    uint32_t window_count;             // Pulse total at the previous read
+    uint64_t window_start_us;          // Time of the previous read
+    uint64_t last_pulse_us;            // Read at which the total last moved
+    bool seen;                         // Total moved at least once since boot
+    bool running;
+} PulseInput;
+
+/* ========== PRIVATE VARIABLES ========== */
+
+static PulseInput inputs[PULSE_CHANNEL_COUNT] = {
+    [PULSE_FLOW] = { .pin = FLOW_METER_PIN },
+    [PULSE_PUMP] = { .pin = PUMP_TACH_PIN },
+};
+
+static PIO program_pio;                // PULSE_COUNTER_PIO once the program is loaded (shared by all inputs)
+static uint program_offset;
+
+/* ========== PRIVATE FUNCTIONS ========== */
+
+/**
+ * @brief Claim a state machine in PULSE_COUNTER_PIO, loading the program on first use
+ */
+static bool claim_state_machine(PulseInput *in) {
+    PIO pio = pio_get_instance(PULSE_COUNTER_PIO);
+    if (program_pio == NULL && !pio_can_add_program(pio, &pulse_counter_program)) {
+        return false;
+    }
+    int sm = pio_claim_unused_sm(pio, false);
+    if (sm < 0) {
+        return false;
+    }
+    if (program_pio == NULL) {
+        program_offset = pio_add_program(pio, &pulse_counter_program);
+        program_pio = pio;
+    }
+    in->pio = pio;
+    in->sm = (uint)sm;
+    return true;
+}
+
+static bool start_input(PulseInput *in) {
+    if (!claim_state_machine(in)) {
+        return false;
+    }
+    in->dma = dma_claim_unused_channel(false);
+    if (in->dma < 0) {
+        pio_sm_unclaim(in->pio, in->sm);
+        return false;
+    }
+
+    // RX FIFO -> one RAM word; transfer count decrements once per pulse
+    dma_channel_config cfg = dma_channel_get_default_config(in->dma);
+    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_32);
+    channel_config_set_read_increment(&cfg, false);
+    channel_config_set_write_increment(&cfg, false);
+    channel_config_set_dreq(&cfg, pio_get_dreq(in->pio, in->sm, false));
+    dma_channel_configure(in->dma, &cfg, &in->last_period, &in->pio->rxf[in->sm], DMA_COUNT_START, true);
+
+    pulse_counter_program_init(in->pio, in->sm, program_offset, in->pin);
+
+    in->window_start_us = in->last_pulse_us = time_us_64();
+    in->running = true;
+    return true;
+}
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Start counting on every pulse input
+ *
+ * @return true if all inputs got a state machine and a DMA channel
+ */
+bool pulse_counter_init(void) {
+    bool ok = true;
+    for (int ch = 0; ch < PULSE_CHANNEL_COUNT; ch++) {
+        if (!start_input(&inputs[ch])) {
+            printf("Contador de pulsos: sem recursos para GPIO %u\n", inputs[ch].pin);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+/**
+ * @brief Read the pulse total and the rate since the previous read
+ *
+ * Closes the rate window: call once per acquisition.
+ *
+ * @param channel Input to read
+ * @param out Pulse total, rate and stall state
+ * @return false if the input could not be started
+ */
+bool pulse_counter_read(PulseChannel channel, PulseReading *out) {
+    PulseInput *in = &inputs[channel];
+    if (!in->running) {
+        return false;
+    }
+
+    uint64_t now = time_us_64();
+    uint32_t count = DMA_COUNT_START - dma_channel_hw_addr(in->dma)->transfer_count;
+    uint32_t period = in->last_period;
+    uint32_t delta = count - in->window_count;
+    uint64_t window_us = now - in->window_start_us;
+
+    if (delta > 0) {
+        in->last_pulse_us = now;
+        in->seen = true;
+    }
+    in->window_count = count;
+    in->window_start_us = now;
+
+    out->count = count;
+    out->seen = in->seen;
+    out->stalled = (now - in->last_pulse_us) > (uint64_t)PULSE_STALL_MS * 1000;
+    out->rate_hz = 0.0f;
+    if (out->stalled) {
+        return true;
+    }
+
+    if (delta >= PULSE_RATE_MIN_COUNT || count < 2) {
+        // Fast signal (or no complete period yet): average over the window
+        out->rate_hz = window_us > 0 ? delta * 1e6f / window_us : 0.0f;
+    } else {
+        // Slow signal: last complete period, bounded by the silence since the last pulse
+        float cycles = 2.0f * period + PERIOD_OVERHEAD_CYCLES;
+        out->rate_hz = clock_get_hz(clk_sys) / cycles;
+        uint64_t silence_us = now - in->last_pulse_us;
+        if (silence_us > 0 && out->rate_hz > 1e6f / silence_us) {
+            out->rate_hz = 1e6f / silence_us;
+        }
+    }
+    return true;
+}
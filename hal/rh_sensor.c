@@ -0,0 +1,122 @@
+/**
+ * @file rh_sensor.c
+ * @brief Boot-time detection and dispatch of the temperature/humidity sensors
+ *
+ * Detection order matters: the SHT4x sits at its own address and is probed
+ * first; the AHT20 and AHT10 share 0x38 and are told apart by the CRC byte
+ * only the AHT20 sends, so the AHT10 is the fallback for whatever answers
+ * there.
+ */
+
+#include "rh_sensor.h"
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Detect and initialize the sensor of a group
+ *
+ * Blocks up to ~0.5s (AHT detection and initialization); call during
+ * initialization.
+ *
+ * @param dev Sensor handle to initialize
+ * @param bus Bus of the group
+ * @param repeatability Measurement mode if an SHT4x is found
+ * @return false if no known sensor answered (dev->type is RH_SENSOR_NONE)
+ */
+bool rh_sensor_init(RhSensor *dev, I2cBus *bus, Sht4xRepeatability repeatability) {
+    if (sht4x_init(&dev->sht4x, bus, repeatability)) {
+        dev->type = RH_SENSOR_SHT4X;
+    } else if (aht20_init(&dev->aht20, bus)) {
+        dev->type = RH_SENSOR_AHT20;
+    } else if (aht10_init(&dev->aht10, bus)) {
+        dev->type = RH_SENSOR_AHT10;
+    } else {
+        dev->type = RH_SENSOR_NONE;
+    }
+    return dev->type != RH_SENSOR_NONE;
+}
+
+const char *rh_sensor_name(const RhSensor *dev) {
+    switch (dev->type) {
+        case RH_SENSOR_AHT10: return "AHT10";
+        case RH_SENSOR_AHT20: return "AHT20";
+        case RH_SENSOR_SHT4X: return "SHT4x";
+        default: return "ausente";
+    }
+}
+
+/**
+ * @brief Time to wait between rh_sensor_trigger() and rh_sensor_fetch_raw()
+ */
+uint32_t rh_sensor_conversion_us(const RhSensor *dev) {
+    switch (dev->type) {
+        case RH_SENSOR_AHT10: return AHT10_MEASUREMENT_MS * 1000u;
+        case RH_SENSOR_AHT20: return AHT20_MEASUREMENT_MS * 1000u;
+        case RH_SENSOR_SHT4X: return sht4x_conversion_us(&dev->sht4x);
+        default: return 0;
+    }
+}
+
+/**
+ * @brief Start a measurement without waiting for it
+ *
+ * @return false if no sensor was detected or it did not acknowledge
+ */
+bool rh_sensor_trigger(RhSensor *dev) {
+    switch (dev->type) {
+        case RH_SENSOR_AHT10: return aht10_trigger(&dev->aht10);
+        case RH_SENSOR_AHT20: return aht20_trigger(&dev->aht20);
+        case RH_SENSOR_SHT4X: return sht4x_trigger(&dev->sht4x);
+        default: return false;
+    }
+}
+
+/**
+ * @brief Collect the sensor-native codes of the triggered measurement
+ *
+ * AHT10/AHT20: 20-bit codes. SHT4x: 16-bit ticks.
+ */
+bool rh_sensor_fetch_raw(RhSensor *dev, uint32_t *raw_temp, uint32_t *raw_humidity) {
+    switch (dev->type) {
+        case RH_SENSOR_AHT10: return aht10_fetch_raw(&dev->aht10, raw_temp, raw_humidity);
+        case RH_SENSOR_AHT20: return aht20_fetch_raw(&dev->aht20, raw_temp, raw_humidity);
+        case RH_SENSOR_SHT4X: {
+            uint16_t t, h;
+            if (!sht4x_fetch_raw(&dev->sht4x, &t, &h)) {
+                return false;
+            }
+            *raw_temp = t;
+            *raw_humidity = h;
+            return true;
+        }
+        default: return false;
+    }
+}
+
+/**
+ * @brief Convert codes from rh_sensor_fetch_raw() to °C and %RH
+ */
+void rh_sensor_convert(const RhSensor *dev, uint32_t raw_temp, uint32_t raw_humidity, float *temp, float *humidity) {
+    if (dev->type == RH_SENSOR_SHT4X) {
+        sht4x_convert((uint16_t)raw_temp, (uint16_t)raw_humidity, temp, humidity);
+    } else {
+        aht10_convert(raw_temp, raw_humidity, temp, humidity); // AHT20 shares the AHT10 format
+    }
+}
+
+/**
+ * @brief Trigger, wait and read one measurement (same contract as aht10_read_data())
+ */
+bool rh_sensor_read_data(RhSensor *dev, float *temp, float *humidity) {
+    uint32_t raw_temp, raw_humidity;
+    if (!rh_sensor_trigger(dev)) {
+        return false;
+    }
+    sleep_us(rh_sensor_conversion_us(dev));
+    if (!rh_sensor_fetch_raw(dev, &raw_temp, &raw_humidity)) {
+        return false;
+    }
+
+    rh_sensor_convert(dev, raw_temp, raw_humidity, temp, humidity);
+    return true;
+}
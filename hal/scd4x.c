@@ -0,0 +1,223 @@
+/**
+ * @file scd4x.c
+ * @brief Sensirion SCD40/SCD41 CO2 sensor driver (periodic measurement)
+ *
+ * A single-shot measurement blocks for 5s; in periodic mode the sensor
+ * converts on its own and each acquisition only costs a data-ready query
+ * plus, when a result is waiting, a 9-byte read. The query is split in two
+ * (scd4x_begin_poll() before the RH sensor conversion wait, scd4x_end_poll()
+ * after it) so its 1ms execution time overlaps a wait the cycle has anyway.
+ *
+ * Every word from the sensor carries a CRC-8 that is checked. The SCD4x
+ * compensates CO2 with its own temperature/RH sensor, whose reading is
+ * raised by self-heating; the only external input it accepts while running
+ * is ambient pressure. So the co-located RH sensor's temperature is the
+ * reference for the temperature offset register: once the filtered
+ * difference exceeds SCD4X_OFFSET_TOLERANCE_C the measurement is stopped,
+ * the offset reprogrammed (idle-only command) and measurement restarted.
+ * The offset also corrects the sensor's RH, and with it the compensation.
+ */
+
+#include "scd4x.h"
+#include "app_config.h"
+#include "pico/stdlib.h"
+#include <math.h>
+#include <stdio.h>
+
+/* ========== SENSOR CONFIGURATION CONSTANTS ========== */
+
+static const uint8_t SENSOR_ADDR = 0x62;      // Fixed I2C address for SCD4x
+
+#define CMD_START_PERIODIC 0x21B1
+#define CMD_START_LOW_POWER_PERIODIC 0x21AC
+#define CMD_READ_MEASUREMENT 0xEC05
+#define CMD_STOP_PERIODIC 0x3F86
+#define CMD_GET_DATA_READY 0xE4B8
+#define CMD_SET_TEMPERATURE_OFFSET 0x241D
+#define CMD_SET_SENSOR_ALTITUDE 0x2427
+#define CMD_GET_SERIAL_NUMBER 0x3682
+
+#define COMMAND_DELAY_MS 1            // Execution time of the read/configuration commands
+#define STOP_DELAY_MS 500             // Stop periodic measurement
+#define TEMP_OFFSET_MAX_C 20.0f       // Valid offset range: 0-20°C
+
+#if SCD4X_LOW_POWER
+#define MEASUREMENT_INTERVAL_MS 30000
+#else
+#define MEASUREMENT_INTERVAL_MS 5000
+#endif
+
+/* ========== PRIVATE FUNCTIONS ========== */
+
+static bool send_command(Scd4x *dev, uint16_t cmd) {
+    uint8_t buf[2] = { (uint8_t)(cmd >> 8), (uint8_t)cmd };
+    return i2c_bus_write_blocking(dev->bus, SENSOR_ADDR, buf, 2, false) == 2;
+}
+
+static bool send_command_arg(Scd4x *dev, uint16_t cmd, uint16_t arg) {
+    uint8_t buf[5] = { (uint8_t)(cmd >> 8), (uint8_t)cmd, (uint8_t)(arg >> 8), (uint8_t)arg, 0 };
+    buf[4] = i2c_bus_crc8(&buf[2], 2);
+    return i2c_bus_write_blocking(dev->bus, SENSOR_ADDR, buf, 5, false) == 5;
+}
+
+/**
+ * @brief Read @p count response words, checking the CRC of each
+ */
+static bool read_words(Scd4x *dev, uint16_t *words, int count) {
+    uint8_t buf[9];
+    int len = count * 3;
+    if (i2c_bus_read_blocking(dev->bus, SENSOR_ADDR, buf, (size_t)len, false) != len) {
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        if (i2c_bus_crc8(&buf[3 * i], 2) != buf[3 * i + 2]) {
+            return false;
+        }
+        words[i] = (uint16_t)((buf[3 * i] << 8) | buf[3 * i + 1]);
+    }
+    return true;
+}
+
+static bool start_measurement(Scd4x *dev) {
+    dev->running = send_command(dev, SCD4X_LOW_POWER ? CMD_START_LOW_POWER_PERIODIC : CMD_START_PERIODIC);
+    dev->offset_error_c = 0.0f;
+    dev->offset_samples = 0;
+    return dev->running;
+}
+
+/**
+ * @brief Program the temperature offset (sensor must be idle)
+ */
+static void write_temp_offset(Scd4x *dev) {
+    send_command_arg(dev, CMD_SET_TEMPERATURE_OFFSET, (uint16_t)(dev->temp_offset_c * 65535.0f / 175.0f));
+    sleep_ms(COMMAND_DELAY_MS);
+}
+
+/**
+ * @brief Follow the sensor/reference temperature difference, reprogram when it drifts
+ */
+static void track_offset(Scd4x *dev, float reference_temp) {
+    if (isnan(reference_temp)) {
+        return;
+    }
+
+    float error = dev->reading.temperature - reference_temp;
+    dev->offset_samples++;
+    dev->offset_error_c += (error - dev->offset_error_c) / dev->offset_samples; // Mean since the last update
+    if (dev->offset_samples < SCD4X_OFFSET_MIN_SAMPLES || fabsf(dev->offset_error_c) < SCD4X_OFFSET_TOLERANCE_C) {
+        return;
+    }
+
+    // A warmer sensor needs a larger offset
+    float offset = dev->temp_offset_c + dev->offset_error_c;
+    dev->temp_offset_c = offset < 0.0f ? 0.0f : (offset > TEMP_OFFSET_MAX_C ? TEMP_OFFSET_MAX_C : offset);
+    printf("SCD4x: offset de temperatura -> %.2f C\n", dev->temp_offset_c);
+
+    send_command(dev, CMD_STOP_PERIODIC);
+    dev->running = false;
+    dev->restart_at = make_timeout_time_ms(STOP_DELAY_MS);
+}
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Detect the sensor, configure it and start periodic measurement
+ *
+ * Blocks ~0.5s (the sensor may still be measuring after a warm reboot and
+ * only accepts configuration once stopped); call during initialization.
+ *
+ * @param dev Sensor handle to initialize
+ * @param bus Bus the sensor is wired to
+ * @return true if the sensor answered and measurement started
+ */
+bool scd4x_init(Scd4x *dev, I2cBus *bus) {
+    *dev = (Scd4x){ .bus = bus, .temp_offset_c = SCD4X_TEMP_OFFSET_C,
+                    .restart_at = nil_time, .last_update = nil_time };
+
+    send_command(dev, CMD_STOP_PERIODIC);
+    sleep_ms(STOP_DELAY_MS);
+
+    uint16_t serial[3];
+    if (!send_command(dev, CMD_GET_SERIAL_NUMBER)) {
+        return false;
+    }
+    sleep_ms(COMMAND_DELAY_MS);
+    if (!read_words(dev, serial, 3)) {
+        return false;
+    }
+    dev->present = true;
+    printf("SCD4x: serie %04x%04x%04x\n", serial[0], serial[1], serial[2]);
+
+    send_command_arg(dev, CMD_SET_SENSOR_ALTITUDE, SCD4X_ALTITUDE_M);
+    sleep_ms(COMMAND_DELAY_MS);
+    write_temp_offset(dev);
+    return start_measurement(dev);
+}
+
+/**
+ * @brief Send the data-ready query; its answer is read by scd4x_end_poll()
+ *
+ * Call at least 1ms before scd4x_end_poll(), with no other command to the
+ * sensor in between (the answer stays available until the next command).
+ */
+void scd4x_begin_poll(Scd4x *dev) {
+    dev->query_pending = dev->running && send_command(dev, CMD_GET_DATA_READY);
+}
+
+/**
+ * @brief Read the data-ready answer and, if a result is waiting, the measurement
+ *
+ * @param dev Sensor handle
+ * @param reference_temp Co-located air temperature (°C) for the offset, NaN if unknown
+ * @return true if a new measurement was read
+ */
+bool scd4x_end_poll(Scd4x *dev, float reference_temp) {
+    if (!dev->running) {
+        // Stopped to reprogram the offset: resume once the stop has completed
+        if (!is_nil_time(dev->restart_at) && time_reached(dev->restart_at)) {
+            dev->restart_at = nil_time;
+            write_temp_offset(dev);
+            start_measurement(dev);
+        }
+        return false;
+    }
+    if (!dev->query_pending) {
+        return false;
+    }
+    dev->query_pending = false;
+
+    uint16_t status;
+    if (!read_words(dev, &status, 1) || (status & 0x07FF) == 0) {
+        return false; // No new result yet
+    }
+
+    uint16_t words[3];
+    if (!send_command(dev, CMD_READ_MEASUREMENT)) {
+        return false;
+    }
+    sleep_ms(COMMAND_DELAY_MS);
+    if (!read_words(dev, words, 3)) {
+        return false;
+    }
+
+    dev->reading.co2_ppm = words[0];
+    dev->reading.temperature = -45.0f + 175.0f * words[1] / 65535.0f;
+    dev->reading.humidity = 100.0f * words[2] / 65535.0f;
+    dev->last_update = get_absolute_time();
+
+    track_offset(dev, reference_temp);
+    return true;
+}
+
+/**
+ * @brief Copy the latest measurement
+ *
+ * Invalid if none arrived within 3 measurement intervals (sensor missing,
+ * bus errors, or still warming up after start).
+ */
+void scd4x_get(const Scd4x *dev, Scd4xReading *out) {
+    *out = dev->reading;
+    out->valid = !is_nil_time(dev->last_update) &&
+                 absolute_time_diff_us(dev->last_update, get_absolute_time()) <
+                     (int64_t)3 * MEASUREMENT_INTERVAL_MS * 1000;
+}
@@ -0,0 +1,135 @@
+/**
+ * @file sht4x.c
+ * @brief Sensirion SHT40/SHT41 Temperature and Humidity Sensor Driver
+ * 
+ * ±1.8% RH (SHT41) / ±0.2°C with conversions of 1.7ms to 8.3ms depending on
+ * the selected repeatability, against 80ms for the AHT10/AHT20. Both words
+ * of every measurement are CRC-checked.
+ */
+
+#include "sht4x.h"
+
+/* ========== SENSOR CONFIGURATION CONSTANTS ========== */
+
+static const uint8_t SENSOR_ADDRS[] = {0x44, 0x45};   // SHT4x-A (default) and SHT4x-B variants
+static const uint8_t CMD_MEASURE[] = {0xFD, 0xF6, 0xE0}; // High, medium, low repeatability (no heater)
+static const uint32_t CONVERSION_US[] = {8300, 4500, 1700}; // Max conversion time per repeatability
+static const uint8_t CMD_READ_SERIAL = 0x89;
+static const uint8_t CMD_SOFT_RESET = 0x94;
+
+/* ========== PRIVATE FUNCTIONS ========== */
+
+/**
+ * @brief Read two CRC-protected words (measurement or serial number)
+ */
+static bool read_words(Sht4x *dev, uint16_t *first, uint16_t *second) {
+    uint8_t data[6];
+    if (i2c_bus_read_blocking(dev->bus, dev->addr, data, 6, false) != 6) {
+        return false;
+    }
+    if (i2c_bus_crc8(&data[0], 2) != data[2] || i2c_bus_crc8(&data[3], 2) != data[5]) {
+        return false;
+    }
+    *first = (uint16_t)((data[0] << 8) | data[1]);
+    *second = (uint16_t)((data[3] << 8) | data[4]);
+    return true;
+}
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Detect an SHT4x at either address and reset it
+ * 
+ * The sensor is accepted when its serial number reads back with a valid CRC.
+ * 
+ * @param dev Sensor handle to initialize
+ * @param bus Bus the sensor is wired to (hardware or PIO)
+ * @param repeatability Noise/conversion time trade-off for every measurement
+ * @return true if an SHT4x answered
+ */
+bool sht4x_init(Sht4x *dev, I2cBus *bus, Sht4xRepeatability repeatability) {
+    dev->bus = bus;
+    dev->repeatability = repeatability;
+
+    for (size_t i = 0; i < sizeof(SENSOR_ADDRS); i++) {
+        dev->addr = SENSOR_ADDRS[i];
+        if (i2c_bus_write_blocking(dev->bus, dev->addr, &CMD_SOFT_RESET, 1, false) != 1) {
+            continue;
+        }
+        sleep_ms(1); // Soft reset time
+
+        uint16_t serial_hi, serial_lo;
+        if (i2c_bus_write_blocking(dev->bus, dev->addr, &CMD_READ_SERIAL, 1, false) == 1) {
+            sleep_ms(1);
+            if (read_words(dev, &serial_hi, &serial_lo)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Conversion time of a measurement with the configured repeatability
+ */
+uint32_t sht4x_conversion_us(const Sht4x *dev) {
+    return CONVERSION_US[dev->repeatability];
+}
+
+/**
+ * @brief Start a measurement without waiting for it
+ * 
+ * @param dev Sensor handle
+ * @return true if the sensor acknowledged the command
+ */
+bool sht4x_trigger(Sht4x *dev) {
+    return i2c_bus_write_blocking(dev->bus, dev->addr, &CMD_MEASURE[dev->repeatability], 1, false) == 1;
+}
+
+/**
+ * @brief Collect the result of a measurement started by sht4x_trigger()
+ * 
+ * @param dev Sensor handle
+ * @param raw_temp Pointer to store the 16-bit temperature ticks
+ * @param raw_humidity Pointer to store the 16-bit humidity ticks
+ * @return true if successful, false on communication/CRC error or unfinished conversion (NAK)
+ */
+bool sht4x_fetch_raw(Sht4x *dev, uint16_t *raw_temp, uint16_t *raw_humidity) {
+    return read_words(dev, raw_temp, raw_humidity);
+}
+
+/**
+ * @brief Convert raw SHT4x ticks to engineering units
+ * 
+ * @param raw_temp 16-bit temperature ticks
+ * @param raw_humidity 16-bit humidity ticks
+ * @param temp Pointer to store temperature (°C)
+ * @param humidity Pointer to store relative humidity (%, clipped to 0-100)
+ */
+void sht4x_convert(uint16_t raw_temp, uint16_t raw_humidity, float *temp, float *humidity) {
+    *temp = -45.0f + 175.0f * raw_temp / 65535.0f;
+    float rh = -6.0f + 125.0f * raw_humidity / 65535.0f;
+    *humidity = rh < 0.0f ? 0.0f : (rh > 100.0f ? 100.0f : rh);
+}
+
+/**
+ * @brief Read calibrated temperature and humidity values
+ * 
+ * @param dev Sensor handle
+ * @param temp Pointer to store temperature reading (°C)
+ * @param humidity Pointer to store humidity reading (%)
+ * @return true if measurement successful
+ */
+bool sht4x_read_data(Sht4x *dev, float *temp, float *humidity) {
+    uint16_t raw_temp, raw_humidity;
+    if (!sht4x_trigger(dev)) {
+        return false;
+    }
+    sleep_us(sht4x_conversion_us(dev));
+    if (!sht4x_fetch_raw(dev, &raw_temp, &raw_humidity)) {
+        return false;
+    }
+    
+    sht4x_convert(raw_temp, raw_humidity, temp, humidity);
+    return true;
+}
@@ -0,0 +1,370 @@
+/**
+ * @file wifi_roam.c
+ * @brief Roaming between access points that share WIFI_SSID
+ *
+ * The CYW43 keeps the access point it first joined until the association
+ * is lost, however weak it gets. This module scans for the other access
+ * points of the same SSID in the background and moves to a better one
+ * while the current association still carries traffic.
+ *
+ * Scans are asynchronous (results arrive in a driver callback) and
+ * filtered on WIFI_SSID. While associated, the firmware returns to the
+ * home channel between scanned channels, so publishing goes on during a
+ * scan, with some added latency. They run every ROAM_SCAN_INTERVAL_MS,
+ * or every ROAM_FAST_SCAN_INTERVAL_MS once the current access point falls
+ * below ROAM_RSSI_THRESHOLD_DBM.
+ *
+ * Handover, make-before-break as far as one radio allows:
+ * - the target is chosen from the scan that just finished, so it was
+ *   heard moments before leaving, and must beat the current access point
+ *   (as measured in that same scan) by ROAM_MIN_GAIN_DB;
+ * - the join is directed (BSSID + channel), so it does not scan again
+ *   while the link is down;
+ * - messages published during the gap wait in the MQTT outbox and are
+ *   drained as soon as the address is back;
+ * - a failed directed join falls back to an ordinary join of the SSID.
+ *
+ * Duration is measured from the join request to the address being up on
+ * the new access point; the data gap from the last MQTT message accepted
+ * before the handover to the first one after it.
+ *
+ * Network context only (main loop or network task).
+ */
+
+#include "wifi_roam.h"
+#include "app_config.h"
+#include "link_monitor.h"
+#include "mqtt_outbox.h"
+#include "pico/cyw43_arch.h"
+#include <stdio.h>
+#include <string.h>
+
+/* ========== PRIVATE TYPES ========== */
+
+#define ROAM_POLL_MS 100                       // Poll period while scanning, joining or timing a gap
+#define ROAM_GAP_WATCH_MS 300000               // Give up timing a data gap after this long
+
+typedef enum {
+    ROAM_IDLE = 0,
+    ROAM_SCANNING,
+    ROAM_JOINING,                              // Directed join to the chosen access point
+    ROAM_FALLBACK                              // Ordinary join after a failed directed one
+} RoamState;
+
+/**
+ * @brief Access point of WIFI_SSID heard in a scan
+ */
+typedef struct {
+    uint8_t bssid[6];
+    uint16_t channel;
+    int16_t rssi;                              // Strongest report of the last scan that heard it
+    absolute_time_t seen;
+    bool used;
+} RoamCandidate;
+
+/* ========== PRIVATE VARIABLES ========== */
+
+static RoamState state;
+static RoamCandidate candidates[ROAM_MAX_CANDIDATES];
+static absolute_time_t next_scan;
+static absolute_time_t scan_started;
+static absolute_time_t holddown_until;
+
+static uint8_t current_bssid[6];               // Association the handover leaves
+static RoamCandidate target;
+static absolute_time_t join_started;           // Handover start (duration, data gap)
+static absolute_time_t attempt_started;        // Current join request (timeout)
+static absolute_time_t gap_from;               // Last message accepted before the handover
+static bool gap_pending;
+
+static uint32_t scans;
+static uint32_t handovers;
+static uint32_t failures;                      // Directed joins that fell back
+static uint32_t lost;                          // Fallback joins that failed too
+static uint32_t joins;                         // Associations completed (directed or fallback)
+static uint32_t duration_sum_ms, duration_max_ms, duration_last_ms;
+static uint32_t gaps;
+static uint32_t gap_sum_ms, gap_max_ms, gap_last_ms;
+
+/* ========== PRIVATE FUNCTIONS ========== */
+
+static const char *bssid_str(const uint8_t *bssid) {
+    static char buf[2][18]; // Two per printf
+    static int next;
+    char *s = buf[next++ & 1];
+    snprintf(s, sizeof(buf[0]), "%02x:%02x:%02x:%02x:%02x:%02x", bssid[0], bssid[1], bssid[2], bssid[3],
+             bssid[4], bssid[5]);
+    return s;
+}
+
+static bool link_up(void) {
+    cyw43_arch_lwip_begin();
+    bool up = cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA) == CYW43_LINK_UP;
+    cyw43_arch_lwip_end();
+    return up;
+}
+
+/**
+ * @brief Scan result (driver context): remember access points of our SSID
+ */
+static int scan_result_cb(void *env, const cyw43_ev_scan_result_t *result) {
+    size_t ssid_len = strlen(WIFI_SSID);
+    if (result->ssid_len != ssid_len || memcmp(result->ssid, WIFI_SSID, ssid_len) != 0) {
+        return 0;
+    }
+
+    RoamCandidate *slot = NULL;
+    for (size_t i = 0; i < ROAM_MAX_CANDIDATES; i++) {
+        RoamCandidate *c = &candidates[i];
+        if (c->used && memcmp(c->bssid, result->bssid, sizeof(c->bssid)) == 0) {
+            slot = c;
+            break;
+        }
+        // Otherwise a free entry, else the weakest one
+        if (slot == NULL || (slot->used && (!c->used || c->rssi < slot->rssi))) {
+            slot = c;
+        }
+    }
+
+    bool fresh = !slot->used || memcmp(slot->bssid, result->bssid, sizeof(slot->bssid)) != 0 ||
+                 absolute_time_diff_us(scan_started, slot->seen) < 0;
+    if (fresh || result->rssi > slot->rssi) {
+        memcpy(slot->bssid, result->bssid, sizeof(slot->bssid));
+        slot->channel = result->channel;
+        slot->rssi = result->rssi;
+    }
+    slot->seen = get_absolute_time();
+    slot->used = true;
+    return 0;
+}
+
+static void start_scan(absolute_time_t now) {
+    for (size_t i = 0; i < ROAM_MAX_CANDIDATES; i++) {
+        RoamCandidate *c = &candidates[i];
+        if (c->used && absolute_time_diff_us(c->seen, now) > ROAM_CANDIDATE_MAX_AGE_MS * 1000LL) {
+            c->used = false;
+        }
+    }
+
+    cyw43_wifi_scan_options_t opts = {0};
+    opts.ssid_len = strlen(WIFI_SSID);
+    memcpy(opts.ssid, WIFI_SSID, opts.ssid_len);
+
+    scan_started = now; // Reports from before this are from older scans
+    cyw43_arch_lwip_begin();
+    int err = cyw43_wifi_scan(&cyw43_state, &opts, NULL, scan_result_cb);
+    cyw43_arch_lwip_end();
+
+    if (err != 0) {
+        next_scan = make_timeout_time_ms(ROAM_FAST_SCAN_INTERVAL_MS);
+        return;
+    }
+    state = ROAM_SCANNING;
+    scans++;
+}
+
+static bool join(const uint8_t *bssid, uint32_t channel) {
+    attempt_started = get_absolute_time();
+    cyw43_arch_lwip_begin();
+    int err = cyw43_wifi_join(&cyw43_state, strlen(WIFI_SSID), (const uint8_t *)WIFI_SSID, strlen(WIFI_PASSWORD),
+                              (const uint8_t *)WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK, bssid, channel);
+    cyw43_arch_lwip_end();
+    return err == 0;
+}
+
+/**
+ * @brief Scan finished: pick a target, if the current access point is weak
+ */
+static void scan_done(absolute_time_t now) {
+    state = ROAM_IDLE;
+
+    int32_t rssi;
+    cyw43_arch_lwip_begin();
+    bool ok = cyw43_wifi_get_bssid(&cyw43_state, current_bssid) == 0 &&
+              cyw43_wifi_get_rssi(&cyw43_state, &rssi) == 0;
+    cyw43_arch_lwip_end();
+    if (!ok) {
+        next_scan = make_timeout_time_ms(ROAM_FAST_SCAN_INTERVAL_MS);
+        return;
+    }
+
+    // Compare like with like: the current access point as this scan heard it
+    const RoamCandidate *best = NULL;
+    for (size_t i = 0; i < ROAM_MAX_CANDIDATES; i++) {
+        const RoamCandidate *c = &candidates[i];
+        if (!c->used || absolute_time_diff_us(scan_started, c->seen) < 0) {
+            continue; // Not heard in this scan
+        }
+        if (memcmp(c->bssid, current_bssid, sizeof(current_bssid)) == 0) {
+            rssi = c->rssi;
+        } else if (best == NULL || c->rssi > best->rssi) {
+            best = c;
+        }
+    }
+
+    bool weak = rssi < ROAM_RSSI_THRESHOLD_DBM;
+    next_scan = make_timeout_time_ms(weak ? ROAM_FAST_SCAN_INTERVAL_MS : ROAM_SCAN_INTERVAL_MS);
+    if (!weak || best == NULL || best->rssi < rssi + ROAM_MIN_GAIN_DB || !time_reached(holddown_until)) {
+        return;
+    }
+
+    target = *best;
+    printf("Roaming: %s (%ld dBm) -> %s (%d dBm, canal %u)\n", bssid_str(current_bssid), (long)rssi,
+           bssid_str(target.bssid), target.rssi, target.channel);
+    gap_from = mqtt_outbox_last_sent();
+    gap_pending = false;
+    join_started = now;
+    if (join(target.bssid, target.channel)) {
+        state = ROAM_JOINING;
+    } else {
+        printf("Roaming: pedido de associação recusado pelo driver\n");
+    }
+}
+
+/**
+ * @brief Join in progress: done when the address is up on the new access point
+ */
+static void poll_join(absolute_time_t now) {
+    uint8_t bssid[6];
+    cyw43_arch_lwip_begin();
+    int status = cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA);
+    // Until the firmware drops the old association, the link still reads up
+    bool arrived = status == CYW43_LINK_UP &&
+                   (state == ROAM_FALLBACK || (cyw43_wifi_get_bssid(&cyw43_state, bssid) == 0 &&
+                                               memcmp(bssid, target.bssid, sizeof(bssid)) == 0));
+    cyw43_arch_lwip_end();
+
+    if (arrived) {
+        uint32_t elapsed_ms = (uint32_t)(absolute_time_diff_us(join_started, now) / 1000);
+        if (state == ROAM_JOINING) {
+            handovers++;
+        }
+        joins++;
+        duration_last_ms = elapsed_ms;
+        duration_sum_ms += elapsed_ms;
+        if (elapsed_ms > duration_max_ms) {
+            duration_max_ms = elapsed_ms;
+        }
+        printf("Roaming concluído em %lu ms%s\n", (unsigned long)elapsed_ms,
+               state == ROAM_FALLBACK ? " (associação comum)" : "");
+        state = ROAM_IDLE;
+        holddown_until = make_timeout_time_ms(ROAM_HOLDDOWN_MS);
+        next_scan = make_timeout_time_ms(ROAM_FAST_SCAN_INTERVAL_MS);
+        gap_pending = true;
+        link_monitor_restart();
+        mqtt_outbox_drain(); // What waited during the handover goes now
+        return;
+    }
+
+    // The fallback only times out: a failure of the directed join may still read back
+    bool failed = state == ROAM_JOINING && status < 0;
+    if (!failed && absolute_time_diff_us(attempt_started, now) < ROAM_JOIN_TIMEOUT_MS * 1000LL) {
+        return;
+    }
+    if (state == ROAM_JOINING) {
+        failures++;
+        printf("Roaming: associação a %s falhou (%d), voltando a '%s'\n", bssid_str(target.bssid), status,
+               WIFI_SSID);
+        if (join(NULL, CYW43_CHANNEL_NONE)) {
+            state = ROAM_FALLBACK;
+            return;
+        }
+    }
+    lost++;
+    printf("Roaming: sem associação, aguardando reconexão\n");
+    state = ROAM_IDLE;
+    next_scan = make_timeout_time_ms(ROAM_FAST_SCAN_INTERVAL_MS);
+}
+
+/**
+ * @brief First MQTT message after the handover closes the data gap
+ */
+static void poll_gap(absolute_time_t now) {
+    absolute_time_t sent = mqtt_outbox_last_sent();
+    if (absolute_time_diff_us(join_started, sent) > 0) {
+        uint32_t gap_ms = (uint32_t)(absolute_time_diff_us(is_nil_time(gap_from) ? join_started : gap_from, sent) /
+                                     1000);
+        gaps++;
+        gap_last_ms = gap_ms;
+        gap_sum_ms += gap_ms;
+        if (gap_ms > gap_max_ms) {
+            gap_max_ms = gap_ms;
+        }
+        printf("Roaming: %lu ms sem dados MQTT\n", (unsigned long)gap_ms);
+        gap_pending = false;
+    } else if (absolute_time_diff_us(join_started, now) > ROAM_GAP_WATCH_MS * 1000LL) {
+        gap_pending = false;
+    }
+}
+
+/* ========== PUBLIC INTERFACE FUNCTIONS ========== */
+
+/**
+ * @brief Scan, hand over and time gaps when due (network context, every loop pass)
+ *
+ * @return When to call again, to size the caller's wait
+ */
+absolute_time_t wifi_roam_poll(void) {
+    if (!ROAM_ENABLED) {
+        return at_the_end_of_time;
+    }
+    absolute_time_t now = get_absolute_time();
+    if (gap_pending) {
+        poll_gap(now);
+    }
+
+    switch (state) {
+    case ROAM_IDLE:
+        if (time_reached(next_scan)) {
+            if (link_up()) {
+                start_scan(now);
+            } else {
+                next_scan = make_timeout_time_ms(ROAM_FAST_SCAN_INTERVAL_MS);
+            }
+        }
+        break;
+    case ROAM_SCANNING: {
+        cyw43_arch_lwip_begin();
+        bool active = cyw43_wifi_scan_active(&cyw43_state);
+        cyw43_arch_lwip_end();
+        if (!active) {
+            scan_done(now);
+        }
+        break;
+    }
+    case ROAM_JOINING:
+    case ROAM_FALLBACK:
+        poll_join(now);
+        break;
+    }
+
+    if (state == ROAM_IDLE && !gap_pending) {
+        return next_scan;
+    }
+    return make_timeout_time_ms(ROAM_POLL_MS);
+}
+
+void wifi_roam_print_stats(void) {
+    if (!ROAM_ENABLED) {
+        return;
+    }
+    printf("[roam] %lu varreduras, %lu trocas de AP (%lu falhas, %lu sem associação)\n", (unsigned long)scans,
+           (unsigned long)handovers, (unsigned long)failures, (unsigned long)lost);
+    if (joins > 0) {
+        printf("[roam] troca: última %lu ms, média %lu ms, máx %lu ms\n", (unsigned long)duration_last_ms,
+               (unsigned long)(duration_sum_ms / joins), (unsigned long)duration_max_ms);
+    }
+    if (gaps > 0) {
+        printf("[roam] sem dados MQTT: última %lu ms, média %lu ms, máx %lu ms\n", (unsigned long)gap_last_ms,
+               (unsigned long)(gap_sum_ms / gaps), (unsigned long)gap_max_ms);
+    }
+    absolute_time_t now = get_absolute_time();
+    for (size_t i = 0; i < ROAM_MAX_CANDIDATES; i++) {
+        const RoamCandidate *c = &candidates[i];
+        if (c->used) {
+            printf("[roam] AP %s canal %u: %d dBm, visto há %lu s%s\n", bssid_str(c->bssid), c->channel, c->rssi,
+                   (unsigned long)(absolute_time_diff_us(c->seen, now) / 1000000),
+                   memcmp(c->bssid, current_bssid, sizeof(current_bssid)) == 0 ? " (atual)" : "");
+        }
+    }
+}
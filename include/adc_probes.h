@@ -0,0 +1,37 @@
+#ifndef ADC_PROBES_H
+#define ADC_PROBES_H
+
+/**
+ * @file adc_probes.h
+ * @brief DMA-oversampled analog probes (pH, EC, reservoir level)
+ *
+ * The ADC runs free in round-robin mode; readings are averaged in fixed point
+ * in the background and converted with a per-probe two-point calibration.
+ * VSYS is measured on demand between two round-robin conversions.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Sampled analog inputs, in round-robin order
+ */
+typedef enum {
+    ADC_PROBE_PH = 0,       // ADC0
+    ADC_PROBE_EC,           // ADC1
+    ADC_PROBE_LEVEL,        // ADC2
+    ADC_PROBE_CHIP_TEMP,    // ADC4: RP2040 internal temperature sensor
+    ADC_PROBE_COUNT
+} AdcProbe;
+
+bool adc_probes_init(void);
+
+bool adc_probes_read_raw(uint16_t codes[ADC_PROBE_COUNT]);
+
+float adc_probes_convert(AdcProbe probe, uint16_t code);
+
+bool adc_probes_plausible(AdcProbe probe, uint16_t code);
+
+uint32_t adc_probes_read_vsys_mv(void);
+
+#endif
@@ -2,11 +2,28 @@
 #define AHT10_H
 
 #include "pico/stdlib.h"
-#include "hardware/i2c.h"
+#include "i2c_bus.h"
 #include <stdbool.h>
 
-void aht10_init(i2c_inst_t *i2c);
+#define AHT10_MEASUREMENT_MS 80    // Conversion time (typical: 75ms, max: 80ms)
 
-bool aht10_read_data(float *temp, float *humidity);
+/**
+ * @brief One AHT10 on a bus (the address is fixed: one sensor per bus)
+ */
+typedef struct {
+    I2cBus *bus;
+} Aht10;
+
+bool aht10_init(Aht10 *dev, I2cBus *bus);
+
+bool aht10_trigger(Aht10 *dev);
+
+bool aht10_fetch_raw(Aht10 *dev, uint32_t *raw_temp, uint32_t *raw_humidity);
+
+bool aht10_read_data(Aht10 *dev, float *temp, float *humidity);
+
+bool aht10_read_raw(Aht10 *dev, uint32_t *raw_temp, uint32_t *raw_humidity);
+
+void aht10_convert(uint32_t raw_temp, uint32_t raw_humidity, float *temp, float *humidity);
 
 #endif
\ No newline at end of file
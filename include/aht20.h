@@ -0,0 +1,25 @@
+#ifndef AHT20_H
+#define AHT20_H
+
+#include "pico/stdlib.h"
+#include "i2c_bus.h"
+#include <stdbool.h>
+
+#define AHT20_MEASUREMENT_MS 80    // Conversion time (max 80ms)
+
+/**
+ * @brief One AHT20/AHT21 on a bus (fixed address 0x38, shared with the AHT10)
+ */
+typedef struct {
+    I2cBus *bus;
+} Aht20;
+
+bool aht20_init(Aht20 *dev, I2cBus *bus);
+
+bool aht20_trigger(Aht20 *dev);
+
+bool aht20_fetch_raw(Aht20 *dev, uint32_t *raw_temp, uint32_t *raw_humidity);
+
+bool aht20_read_data(Aht20 *dev, float *temp, float *humidity);
+
+#endif
@@ -0,0 +1,171 @@
+#ifndef APP_H
+#define APP_H
+
+/**
+ * @file app.h
+ * @brief Application state and shared monitoring logic
+ *
+ * Data structures and processing steps (acquisition, alert evaluation,
+ * display, publication) used by both entry points: the bare-metal super-loop
+ * in main.c and the FreeRTOS SMP task set in main_freertos.c.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pico/stdlib.h"
+#include "app_config.h"
+
+/* ========== DATA STRUCTURES ========== */
+
+/**
+ * @brief Menu system enumeration
+ * Defines available display screens for user navigation
+ */
+typedef enum {
+    MENU_MEASUREMENTS = 0,  // Real-time sensor readings display
+    MENU_WIFI,             // Network connectivity status
+    MENU_ALERTS,           // Critical value alerts summary
+    MENU_MQTT,             // MQTT broker connection status
+    MENU_NUTRIENTS,        // Nutrient solution probes (pH, EC, level)
+    MENU_COUNT             // Total number of menus (for navigation bounds)
+} MenuId;
+
+/**
+ * @brief Readings of one extra shelf (RH sensor + BH1750 on a PIO I2C bus)
+ */
+typedef struct {
+    float temperature;     // °C
+    float humidity;        // %
+    float lux;             // lux
+    bool aht_ok;           // RH sensor answered this acquisition
+    bool lux_ok;           // BH1750 answered this acquisition
+} ShelfReading;
+
+/**
+ * @brief Environmental sensor data container
+ * Stores current readings and operational status of all sensors
+ */
+typedef struct {
+    float temperature;      // Current temperature reading (°C)
+    float humidity;        // Current relative humidity reading (%)
+    float lux;             // Current light intensity reading (lux)
+    float ph;              // Nutrient solution pH
+    float ec;              // Nutrient solution conductivity (mS/cm, at 25°C when water_temp_ok)
+    float water_level;     // Reservoir level (% of full)
+    float water_temperature; // Nutrient solution temperature (°C, mean of the DS18B20 probes)
+    float chip_temperature; // RP2040 die temperature (°C, diagnostic)
+    float flow_lpm;        // Nutrient line flow (L/min)
+    float flow_total_l;    // Volume pumped since boot (L)
+    float pump_rpm;        // Circulation pump speed (RPM)
+    float co2_ppm;         // CO2 concentration (ppm)
+    bool aht_ok;           // Temperature/humidity sensor (AHT10/AHT20/SHT4x) status
+    bool lux_ok;           // BH1750 sensor communication status
+    bool probes_ok;        // pH/EC/level probes fitted, sampled and reading plausibly
+    bool pulses_ok;        // Pulse counters running, both inputs pulsed since boot
+    bool water_temp_ok;    // At least one DS18B20 probe with a fresh reading
+    bool co2_ok;           // SCD4x measurement within 3 intervals
+    ShelfReading shelves[SHELF_COUNT]; // Extra shelves (same thresholds as the primary group)
+} SensorData;
+
+/**
+ * @brief Uncalibrated sensor codes of one acquisition
+ * Streamed as-is over USB so the host can re-apply or audit the conversion
+ */
+typedef struct {
+    uint32_t temperature;  // RH sensor temperature code (AHT10/AHT20: 20-bit, SHT4x: 16-bit)
+    uint32_t humidity;     // RH sensor humidity code (same widths)
+    uint16_t lux;          // BH1750 16-bit measurement register
+    uint16_t ph;           // Oversampled 16-bit ADC codes (65536 = ADC_VREF_MV)
+    uint16_t ec;
+    uint16_t water_level;
+} SensorRaw;
+
+/**
+ * @brief WiFi network connection status
+ * Maintains current network connectivity information
+ */
+typedef struct {
+    char ssid[33];         // Connected network name (max 32 chars + null terminator)
+    bool connected;        // Current connection state
+    char ip_address[16];   // Assigned IP address in dotted decimal notation
+} WifiStatus;
+
+/**
+ * @brief Environmental alert monitoring system
+ * Tracks which sensors have exceeded their configured thresholds
+ */
+typedef struct {
+    bool temp_critical;    // Temperature outside acceptable range
+    bool humidity_critical; // Humidity above maximum threshold
+    bool lux_critical;     // Light intensity below minimum threshold
+    bool ph_critical;      // Solution pH outside acceptable range
+    bool ec_critical;      // Solution conductivity outside acceptable range
+    bool level_critical;   // Reservoir below minimum level
+    bool water_temp_critical; // Solution temperature outside acceptable range
+    bool flow_critical;    // Nutrient flow below minimum (or stalled)
+    bool pump_critical;    // Pump speed below minimum (or stalled)
+    bool co2_critical;     // CO2 outside the enrichment range
+    bool any_critical;     // Consolidated alert status (OR of all above)
+} AlertStatus;
+
+/**
+ * @brief Complete application state container
+ * Central data structure maintaining all system operational data
+ */
+typedef struct {
+    MenuId current_menu;           // Currently displayed menu screen
+    SensorData sensors;            // Latest environmental sensor readings
+    WifiStatus wifi;               // Network connectivity information
+    AlertStatus alerts;            // Environmental threshold monitoring
+    uint32_t last_mqtt_publish;    // Timestamp of last MQTT data publication
+    uint32_t last_mqtt_alert_check; // Timestamp of last alert verification
+    absolute_time_t last_sensor_read;   // High-precision sensor reading timestamp
+    absolute_time_t last_display_update; // High-precision display refresh timestamp
+} AppState;
+
+/* ========== GLOBAL STATE ========== */
+
+// Primary application state - contains all system operational data
+extern AppState app_state;
+
+/* ========== SHARED APPLICATION STEPS ========== */
+
+void app_hardware_init(void);
+
+void app_print_banner(void);
+
+bool app_process_buttons(void);
+
+bool wifi_connect(void);
+
+void read_sensors(SensorData *sensors);
+
+void read_sensors_raw(SensorData *sensors, SensorRaw *raw);
+
+void print_sensor_readings(const SensorData *sensors);
+
+void check_critical_values(const SensorData *sensors, AlertStatus *alerts);
+
+void print_critical_alerts(const AlertStatus *alerts);
+
+void apply_dosing_rules(const SensorData *sensors);
+
+void publish_dosing_events(void);
+
+void update_display(const SensorData *sensors, const AlertStatus *alerts);
+
+void send_data_to_phone(const SensorData *sensors, const AlertStatus *alerts);
+
+void mqtt_publish_sensor_data_func(const SensorData *sensors);
+
+void mqtt_publish_alerts_func(const AlertStatus *alerts);
+
+void mqtt_publish_control_func(void);
+
+void print_control_stats(void);
+
+void print_bus_stats(void);
+
+void log_history(const SensorData *sensors, const AlertStatus *alerts, absolute_time_t timestamp);
+
+#endif // APP_H
@@ -0,0 +1,444 @@
+#ifndef APP_CONFIG_H
+#define APP_CONFIG_H
+
+/**
+ * @file app_config.h
+ * @brief Build-time configuration shared by the bare-metal and FreeRTOS builds
+ *
+ * Hardware pinout, network credentials, publishing intervals and environmental
+ * thresholds. Every application entry point includes this file so both build
+ * variants always run with identical settings.
+ */
+
+/* ========== HARDWARE CONFIGURATION ========== */
+
+// I2C Bus A: Environmental sensors (temperature/humidity + BH1750 + SCD4x)
+#define I2C_PORT_A i2c0            // Primary I2C interface for sensors
+#define I2C_SDA_PIN_A 0            // GPIO 0: I2C SDA line for sensors
+#define I2C_SCL_PIN_A 1            // GPIO 1: I2C SCL line for sensors
+#define I2C_BAUD_A (100 * 1000)    // Sensor bus clock (100kHz)
+
+// I2C Bus B: OLED Display (SSD1306)
+#define I2C_PORT_B i2c1            // Secondary I2C interface for display
+#define I2C_OLED_ADDR 0x3C         // Standard I2C address for SSD1306 OLED
+#define I2C_SDA_PIN_B 14           // GPIO 14: I2C SDA line for display
+#define I2C_SCL_PIN_B 15           // GPIO 15: I2C SCL line for display
+
+// User interface buttons with pull-up configuration
+#define BTN_A_PIN 5                // GPIO 5: Previous menu navigation
+#define BTN_B_PIN 6                // GPIO 6: Next menu navigation
+#define BTN_C_PIN 22               // GPIO 22: WiFi reconnection trigger
+
+/* ========== NETWORK CONFIGURATION ========== */
+
+// WiFi access point credentials (modify for your network)
+#define WIFI_SSID "JOAO_2.4G"      // Target WiFi network name (2.4GHz required)
+#define WIFI_PASSWORD "30226280!"  // WiFi network password
+#define TCP_PORT 4242              // Reserved TCP port for future expansions
+
+// Wall clock (SNTP) for the photoperiod and history timestamps
+#define NTP_SERVER "pool.ntp.org"      // Resolved through DNS
+#define TIMEZONE_OFFSET_S (-3 * 3600)  // Local time offset from UTC (Brasília, UTC-3)
+
+/* ========== TASK INTERVALS ========== */
+
+#define SENSOR_READ_INTERVAL_MS 2000    // Sensor acquisition period (2s)
+#define DISPLAY_UPDATE_INTERVAL_MS 200  // OLED refresh period (200ms)
+#define PHONE_SEND_INTERVAL_MS 5000     // JSON dump to the phone/console (5s)
+
+#define MQTT_PUBLISH_INTERVAL_MS 10000  // Sensor data publication frequency (10s)
+#define MQTT_ALERT_INTERVAL_MS 30000    // Alert checking and publication frequency (30s)
+
+// Acquisition period while the host is streaming binary samples over USB.
+// Bounded by the sensors: AHT conversion 80ms (SHT4x: <9ms), BH1750 H-res update ~120ms.
+#define STREAM_INTERVAL_MS 100
+
+/* ========== BATCHED UPLINK ========== */
+
+// Samples kept in RAM and sent as InfluxDB line protocol (see app/uplink.c)
+#define UPLINK_RECORD_INTERVAL_MS 15000  // At most one record per 15s
+#define UPLINK_FLUSH_INTERVAL_MS 60000   // Batches sent once a minute (stretched on battery)
+#define UPLINK_RING_RECORDS 128          // Store-and-forward depth (32 min at 15s)
+#define UPLINK_MAX_TRANSPORTS 2
+#define UPLINK_MAX_BATCHES_PER_FLUSH 4   // Catch-up after an outage spread over several flushes
+#define UPLINK_MEASUREMENT "smavhiot"    // Line-protocol measurement name
+#define UPLINK_DEVICE_TAG "pico_w"       // Value of the device= tag
+
+// Transports (both may be enabled; each keeps its own backlog)
+#define UPLINK_MQTT_ENABLED 1            // Line-protocol batches on pico_w/sensors/batch
+// LZSS on MQTT batches: 0 never, 1 always, 2 on fair/poor links. Off by default: plain
+// line-protocol consumers cannot read compressed batches; opt in (2) only where the
+// decoding bridge (tools/lzss_decode.py) sits between the broker and the database
+#define UPLINK_MQTT_COMPRESS 0
+#define LZSS_WINDOW_BITS 9               // 512-byte window: the previous line is always in reach
+#define LZSS_LOOKAHEAD_BITS 5            // Matches up to 32 bytes (encoder RAM: 1.5 KB)
+#define LZSS_MAX_CHAIN 16                // Candidates tried per position (speed vs. ratio)
+// Straight to the database's UDP listener at a fixed LAN address: opt in (1) where it exists
+#define INFLUX_UDP_ENABLED 0
+#define INFLUX_UDP_HOST "192.168.1.10"   // Changeable at runtime via pico_w/<board id>/uplink/cmd
+#define INFLUX_UDP_PORT 8089             // InfluxDB [[udp]] / Telegraf socket_listener
+#define INFLUX_UDP_MAX_PAYLOAD 1472      // 1500 MTU - IP - UDP headers: never fragmented
+
+/* ========== COAP SERVER ========== */
+
+// Observable telemetry over UDP for constrained consumers (see hal/coap_server.c)
+#define COAP_PORT 5683                   // IANA default
+#define COAP_MAX_OBSERVERS 4             // Registrations across /sensores and /alertas
+#define COAP_CON_EVERY 20                // Every 20th /sensores notification confirmable (liveness)
+#define COAP_MAX_RETRANSMIT 4            // Unanswered CON attempts before an observer is dropped
+#define COAP_BLOCK_SZX 5                 // /historico block size 16 << 5 = 512 bytes (32 records)
+#define COAP_NOTIFY_BUF_SIZE 256         // One notification (header + JSON)
+#define COAP_RX_BUF_SIZE 128             // Largest request accepted
+
+/* ========== MQTT 5 ========== */
+
+// MQTT 5 session (hal/mqtt5_client.c) instead of lwIP's 3.1.1-only client; needs Mosquitto 2.x or similar
+#define MQTT_V5_ENABLED 1
+#define MQTT5_KEEPALIVE_S 60
+#define MQTT5_TOPIC_ALIASES 8            // Outgoing aliases used (capped by the broker's Topic Alias Maximum)
+#define MQTT5_TELEMETRY_EXPIRY_S 60      // Sensor data and control status: dropped by the broker after 1 min
+#define MQTT5_ALERT_EXPIRY_S 600
+#define MQTT5_BATCH_EXPIRY_S 3600        // Line-protocol batches carry their own timestamps
+#define MQTT5_SCHEMA_EVERY 30            // "enc"/"schema" user properties every Nth publish per topic (0 = all)
+#define MQTT5_RX_BUF_SIZE 512            // Largest incoming packet (sent as Maximum Packet Size)
+#define MQTT5_INFLIGHT 8                 // Payloads per session waiting for TCP ACK or PUBACK
+
+/* ========== MQTT FAN-OUT ========== */
+
+// Parallel MQTT 5 sessions (hal/mqtt_fanout.c): the cloud broker given to mqtt_setup() plus an edge broker.
+// Each sample is encoded once per encoding and the same buffer is sent to every session that wants it.
+#define MQTT_CLOUD_QOS 1                 // Cloud session: PUBACK per sample, at MQTT_PUBLISH_INTERVAL_MS
+// Command topics (dosing, uplink, fleet slot) are subscribed on the edge broker only: the default
+// cloud broker is public and unauthenticated. Set to 1 only for an authenticated (TLS) broker
+#define MQTT_CLOUD_COMMANDS 0
+// Edge broker at a fixed LAN address: off by default so a stock build does not keep reconnecting
+// to a host that is not there; opt in (1) where the broker exists. Without it no commands are taken
+#define MQTT_EDGE_ENABLED 0
+#define MQTT_EDGE_BROKER_IP "192.168.1.10"
+#define MQTT_EDGE_BROKER_PORT 1883
+#define MQTT_EDGE_QOS 0
+#define MQTT_EDGE_LINE_PROTOCOL 0        // Edge encoding: 0 = JSON (pico_w/sensors/data), 1 = line protocol (pico_w/sensors/line)
+#define MQTT_EDGE_SAMPLE_INTERVAL_MS 0   // 0 = every acquisition (SENSOR_READ_INTERVAL_MS)
+#define MQTT_FANOUT_RECONNECT_MS 15000   // Retry period of a session that is down
+#define MQTT_FANOUT_MSG_BLOCKS 8         // Shared sample/event buffers (MSG_BUF_SIZE each)
+#define MQTT_FANOUT_BATCH_BLOCKS 2       // Shared line-protocol batches (BATCH_BUF_SIZE each)
+
+/* ========== MQTT-SN ========== */
+
+// MQTT-SN over UDP to a local gateway instead of MQTT/TCP to the broker (see hal/mqtt_sn_client.c)
+#define MQTT_SN_ENABLED 0
+#define MQTT_SN_GATEWAY_IP "192.168.1.10"
+#define MQTT_SN_GATEWAY_PORT 10000       // Eclipse Paho MQTT-SN gateway default
+#define MQTT_SN_KEEPALIVE_S 60           // While active (PINGREQ every half)
+#define MQTT_SN_SLEEP_ENABLED 1          // Sleep between wake-ups, one publish period long
+#define MQTT_SN_AWAKE_MS 2000            // Idle time in the active state before sleeping again
+#define MQTT_SN_RETRY_MS 5000            // Tretry (CONNECT, PUBLISH QoS 1, wake-up PINGREQ)
+#define MQTT_SN_MAX_RETRIES 3            // Nretry before the session counts as lost
+#define MQTT_SN_RECONNECT_MS 10000       // Back-off after a lost session
+#define MQTT_SN_OUTBOX 4                 // QoS 0/1 messages held while the session wakes up
+#define MQTT_SN_MAX_PAYLOAD 512          // Largest QoS 0/1 message (bytes)
+
+/* ========== FLEET STAGGERING ========== */
+
+// Per-board phase for the periodic publishes and randomized (re)connect delays (app/fleet_stagger.c),
+// so a rack restored from a power cut does not hit the broker and the AP in lockstep
+#define FLEET_STAGGER_ENABLED 1          // 0 = every board starts its timers one period after boot
+#define FLEET_CONNECT_SPREAD_MS 3000     // Random wait before connecting to the broker after Wi-Fi
+#define FLEET_SLOT_ASSIGNMENT 1          // Accept an exact slot on pico_w/fleet/<board id>/slot
+
+/* ========== OUTBOUND QUEUE ========== */
+
+// Priority queue in front of every MQTT transport (hal/mqtt_outbox.c): messages the transport
+// pushes back on wait here, alerts first, instead of being dropped
+#define MQTT_OUTBOX_ENTRIES 8            // Queued messages (MSG_BUF_SIZE each)
+#define MQTT_OUTBOX_MAX_AGE_MS 60000     // Telemetry/diagnostics older than this are dropped (alerts never)
+#define MQTT_OUTBOX_RETRY_MS 500         // Polled retry while messages wait (MQTT 5 / MQTT-SN)
+
+/* ========== LINK ADAPTATION ========== */
+
+// Wi-Fi link classes from RSSI, TCP retransmissions and dropped connections (hal/link_monitor.c).
+// Fair/poor links stretch the telemetry interval and send smaller (compressed) uplink batches.
+#define LINK_SAMPLE_INTERVAL_MS 10000    // Observation window
+#define LINK_RSSI_FAIR_DBM -70           // Below: fair
+#define LINK_RSSI_POOR_DBM -78           // Below: poor
+#define LINK_RETRANS_FAIR_PCT 3          // Retransmitted TCP segments (%) at or above: fair
+#define LINK_RETRANS_POOR_PCT 10         // At or above: poor
+#define LINK_MIN_SEGMENTS 20             // Segments needed before the retransmission rate counts
+#define LINK_HYSTERESIS_DB 3             // RSSI margin needed to move to a better class
+#define LINK_RECOVER_WINDOWS 3           // Consecutive better windows before moving up one class
+#define LINK_FAIR_INTERVAL_FACTOR 2      // Telemetry period multiplier (on top of the power policy)
+#define LINK_POOR_INTERVAL_FACTOR 4
+#define LINK_FAIR_BATCH_BYTES 730        // Uplink payload cap (good link: BATCH_BUF_SIZE)
+#define LINK_POOR_BATCH_BYTES 365
+
+/* ========== ROAMING ========== */
+
+// Several access points share WIFI_SSID (hal/wifi_roam.c): background scans keep a candidate
+// list, and a weak association moves to a clearly stronger access point
+#define ROAM_ENABLED 1
+#define ROAM_SCAN_INTERVAL_MS 120000     // Background scan period on a good signal
+#define ROAM_FAST_SCAN_INTERVAL_MS 20000 // Scan period below ROAM_RSSI_THRESHOLD_DBM
+#define ROAM_RSSI_THRESHOLD_DBM -72      // Below: look for a better access point
+#define ROAM_MIN_GAIN_DB 8               // Candidate must beat the current access point by this much
+#define ROAM_MAX_CANDIDATES 6            // Access points remembered from the scans
+#define ROAM_CANDIDATE_MAX_AGE_MS 600000 // Not seen for this long: forgotten
+#define ROAM_JOIN_TIMEOUT_MS 8000        // Directed join (BSSID + channel) until address up
+#define ROAM_HOLDDOWN_MS 60000           // No new handover this soon after the last one
+
+/* ========== ENVIRONMENTAL THRESHOLDS ========== */
+
+// Temperature monitoring range (Celsius)
+#define TEMP_MIN 15.0f             // Minimum acceptable temperature threshold
+#define TEMP_MAX 35.0f             // Maximum acceptable temperature threshold
+
+// Humidity monitoring (Relative Humidity %)
+#define HUMIDITY_MAX 80.0f         // Maximum acceptable humidity threshold
+
+// Light intensity monitoring (Lux)
+#define LUX_MIN 50.0f              // Minimum acceptable light intensity threshold
+
+// CO2 (SCD4x, ppm)
+#define CO2_MIN 400.0f             // Below outdoor air: enrichment exhausted by the plants
+#define CO2_MAX 1500.0f            // Enrichment above this is wasted gas
+
+// Nutrient solution (hydroponics)
+#define PH_MIN 5.5f                // Minimum acceptable solution pH
+#define PH_MAX 6.5f                // Maximum acceptable solution pH
+#define EC_MIN 1.2f                // Minimum solution conductivity (mS/cm)
+#define EC_MAX 2.4f                // Maximum solution conductivity (mS/cm)
+#define WATER_LEVEL_MIN 20.0f      // Minimum reservoir level (% of full)
+
+// Nutrient solution temperature (DS18B20)
+#define WATER_TEMP_MIN 18.0f       // Minimum solution temperature (°C)
+#define WATER_TEMP_MAX 26.0f       // Maximum solution temperature (°C, dissolved O2 drops above)
+
+// Nutrient circulation
+#define FLOW_MIN_LPM 0.5f          // Minimum nutrient line flow (L/min)
+#define PUMP_MIN_RPM 600.0f        // Minimum circulation pump speed (RPM)
+
+/* ========== NUTRIENT PROBES (ADC) ========== */
+
+// Analog probe front ends, sampled round-robin together with the internal
+// temperature sensor by DMA (see hal/adc_probes.c)
+#define ADC_PROBES_ENABLED 1       // 0 = no pH/EC/level front ends fitted: no readings, alerts or rule doses
+#define ADC_PROBE_RAIL_MV 20       // Within this of 0V or ADC_VREF_MV = probe missing or shorted
+#define PH_ADC_PIN 26              // GPIO 26 (ADC0): pH probe amplifier (0-3V)
+#define EC_ADC_PIN 27              // GPIO 27 (ADC1): EC probe transmitter
+#define LEVEL_ADC_PIN 28           // GPIO 28 (ADC2): reservoir level (pressure/resistive)
+
+#define ADC_VREF_MV 3300           // ADC reference (ADC_VREF pin)
+#define ADC_SAMPLE_RATE_HZ 4000    // Per channel (4 channels = 16 kS/s)
+#define ADC_FILTER_SHIFT 4         // Low-pass after decimation: 1/16 per 16ms block (~256ms)
+
+// Two-point calibration per probe: probe output (mV) measured at two known
+// values. Defaults are nominal for 3.3V-supplied modules; measure your own.
+#define PH_CAL_MV_1 1500           // Output in pH 7.00 buffer
+#define PH_CAL_VALUE_1 7.0f
+#define PH_CAL_MV_2 2032           // Output in pH 4.00 buffer
+#define PH_CAL_VALUE_2 4.0f
+#define EC_CAL_MV_1 113            // Output in 1.413 mS/cm standard
+#define EC_CAL_VALUE_1 1.413f
+#define EC_CAL_MV_2 1030           // Output in 12.88 mS/cm standard
+#define EC_CAL_VALUE_2 12.88f
+#define LEVEL_CAL_MV_1 400         // Output with the reservoir empty
+#define LEVEL_CAL_VALUE_1 0.0f
+#define LEVEL_CAL_MV_2 2900        // Output with the reservoir full
+#define LEVEL_CAL_VALUE_2 100.0f
+
+// EC is reported at 25°C when the solution temperature is known
+#define EC_TEMP_COEFF 0.02f        // Conductivity change per °C (typical nutrient solution)
+
+/* ========== POWER SUPPLY ========== */
+
+// VSYS is read on ADC3 (GPIO 29, shared with the CYW43) and VBUS through the CYW43
+// (see app/power_manager.c). A single Li-ion cell (or a power bank's cell) on VSYS.
+#define BATTERY_PATH_DROP_MV 0        // Cell-to-VSYS drop (add the diode drop if the cell feeds VSYS through one)
+#define BATTERY_CAPACITY_MAH 2600     // Runtime estimate before the discharge rate is measured
+#define POWER_NOMINAL_DRAW_MA 90      // Average board draw with WiFi (estimate)
+#define POWER_EXTERNAL_ABOVE_MV 4400  // No VBUS but VSYS above this: DC supply, not the battery
+#define POWER_SAVE_BELOW_PCT 60       // Intervals x2/x3, OLED dimmed
+#define POWER_LOW_BELOW_PCT 30        // Intervals x5/x6, OLED off
+#define POWER_CRITICAL_BELOW_PCT 10   // Intervals x15/x30, OLED off
+#define POWER_HYSTERESIS_PCT 3        // Extra charge needed to go back up a level
+#define POWER_DISPLAY_WAKE_MS 30000   // OLED lit after a button press in the saving levels
+#define POWER_DISPLAY_DIM_CONTRAST 0x10 // OLED contrast in the saving level (full = 0xFF)
+#define POWER_RUNTIME_WINDOW_MS (10 * 60 * 1000) // Discharge rate measurement window
+
+/* ========== WATER TEMPERATURE (1-WIRE) ========== */
+
+// DS18B20 probes on one PIO-driven 1-Wire bus (see hal/ds18b20.c)
+#define ONEWIRE_PIN 21             // GPIO 21: 1-Wire data (4.7k pull-up to 3V3)
+#define DS18B20_MAX_PROBES 4       // Probes kept from the ROM search
+#define DS18B20_INTERVAL_MS 2000   // Broadcast conversion period
+#define DS18B20_TICK_MS 10         // Background bus state machine period
+#define DS18B20_CONVERT_TIMEOUT_MS 1000 // 12-bit conversion takes up to 750ms
+
+/* ========== TEMPERATURE / HUMIDITY SENSORS ========== */
+
+// Each group (primary and shelves) detects its sensor at boot: SHT40/41, AHT20/21 or AHT10
+#define SHT4X_REPEATABILITY SHT4X_REPEATABILITY_HIGH // HIGH 8.3ms, MEDIUM 4.5ms, LOW 1.7ms conversion
+
+/* ========== CO2 (SCD4x) ========== */
+
+// SCD40/41 on the primary sensor bus (i2c0, 0x62), next to the primary RH sensor (see hal/scd4x.c)
+#define SCD4X_LOW_POWER 0             // 1 = low-power periodic mode (30s instead of 5s)
+#define SCD4X_ALTITUDE_M 0            // Installation altitude, pressure compensation (no barometer)
+#define SCD4X_TEMP_OFFSET_C 4.0f      // Initial self-heating offset (sensor default)
+#define SCD4X_OFFSET_TOLERANCE_C 0.5f // Reprogram the offset when the RH sensor disagrees by more
+#define SCD4X_OFFSET_MIN_SAMPLES 12   // Measurements averaged before an offset update
+
+/* ========== SHELF SENSOR BUSES (PIO I2C) ========== */
+
+// Extra temperature/humidity + BH1750 groups, each on its own PIO I2C bus (see hal/i2c_bus.c)
+// so their transfers and conversions run side by side instead of queuing on i2c0.
+// SCL is always SDA + 1.
+#define SHELF_COUNT 2              // Shelves besides the primary group on i2c0
+#define SHELF_1_SDA_PIN 2          // GPIO 2/3: shelf 1 SDA/SCL
+#define SHELF_2_SDA_PIN 10         // GPIO 10/11: shelf 2 SDA/SCL
+#define SHELF_I2C_BAUD (100 * 1000)
+
+/* ========== PULSE INPUTS (PIO) ========== */
+
+// Counted by PIO state machines, drained by DMA (see hal/pulse_counter.c)
+#define PULSE_COUNTER_ENABLED 1    // 0 = no flow meter / tachometer fitted: no readings or flow alerts
+#define FLOW_METER_PIN 19          // GPIO 19: nutrient line flow meter (hall, open collector)
+#define PUMP_TACH_PIN 20           // GPIO 20: circulation pump tachometer (open collector)
+
+#define FLOW_PULSES_PER_LITER 450.0f  // YF-S201 style meter: 7.5 Hz per L/min
+#define PUMP_PULSES_PER_REV 2.0f      // Tachometer pulses per pump revolution
+#define PULSE_STALL_MS 5000           // No pulse for this long = stalled (rate 0)
+#define PULSE_RATE_MIN_COUNT 8        // Fewer pulses per window: rate from the last period
+
+/* ========== DOSING PUMPS (PIO STEPPERS) ========== */
+
+// Peristaltic pumps on STEP/DIR stepper drivers (A4988, DRV8825, TMC2209...).
+// Steps and ramps are generated by PIO fed by DMA (see hal/dosing_pump.c).
+#define DOSING_ENABLE_PIN 4              // GPIO 4: ENABLE of both drivers (active low)
+#define DOSING_NUTRIENT_STEP_PIN 7       // GPIO 7: nutrient pump STEP
+#define DOSING_NUTRIENT_DIR_PIN 8        // GPIO 8: nutrient pump DIR
+#define DOSING_PH_STEP_PIN 9             // GPIO 9: pH down pump STEP
+#define DOSING_PH_DIR_PIN 12             // GPIO 12: pH down pump DIR
+
+// 200 steps/rev x 8 microsteps, ~1 mL per revolution: calibrate by weighing a 100 mL run
+#define DOSING_NUTRIENT_STEPS_PER_ML 1600.0f
+#define DOSING_PH_STEPS_PER_ML 1600.0f
+
+#define DOSING_START_SPS 200             // Start/stop speed (steps/s)
+#define DOSING_MAX_SPS 2000              // Cruise speed (steps/s)
+#define DOSING_ACCEL_SPS2 4000           // Acceleration (steps/s², ~0.5s ramp)
+#define DOSING_MAX_DOSE_ML 50.0f         // Larger requests are rejected
+#define DOSING_QUEUE_LEN 4               // Doses waiting per pump
+#define DOSING_CMD_ID_HISTORY 16         // Last MQTT dose ids kept to drop redeliveries
+
+// Local rules on the probe readings (skipped while the reservoir level is critical)
+#define DOSING_NUTRIENT_DOSE_ML 5.0f     // Dose when EC < EC_MIN
+#define DOSING_PH_DOSE_ML 1.0f           // Dose when pH > PH_MAX
+#define DOSING_MIX_MS (10 * 60 * 1000)   // Wait after a rule dose for the solution to mix
+
+/* ========== PIO BUDGET ========== */
+
+// The RP2040 has two PIO blocks of 4 state machines and 32 instruction slots.
+// Each subsystem claims its state machines in a fixed block, so the layout
+// does not depend on init order. The CYW43 SPI program takes the first block
+// with room: pio0 when it starts first (bare-metal), and under FreeRTOS pio0
+// is the only block left with a free state machine.
+#define PIO_CYW43_BLOCK 0
+#define PIO_CYW43_SMS 1
+#define PIO_CYW43_INSTRUCTIONS 6         // SDK cyw43_bus_pio_spi program
+
+#define ONEWIRE_PIO 0                    // 1 state machine
+#define ONEWIRE_PIO_INSTRUCTIONS 18      // drivers/onewire.pio
+#define DOSING_PIO 0                     // 1 state machine per pump
+#define DOSING_PIO_SMS 2
+#define DOSING_PIO_INSTRUCTIONS 7        // drivers/stepper.pio
+#define SHELF_I2C_PIO 1                  // 1 state machine per shelf
+#define SHELF_I2C_PIO_INSTRUCTIONS 15    // drivers/i2c_master.pio
+#define PULSE_COUNTER_PIO 1              // Flow meter + pump tachometer
+#define PULSE_COUNTER_PIO_SMS 2
+#define PULSE_COUNTER_PIO_INSTRUCTIONS 8 // drivers/pulse_counter.pio
+
+#define PIO_BLOCK_SMS(n) \
+    ((PIO_CYW43_BLOCK == (n)) * PIO_CYW43_SMS + (ONEWIRE_PIO == (n)) * 1 + \
+     (DOSING_PIO == (n)) * DOSING_PIO_SMS + (SHELF_I2C_PIO == (n)) * SHELF_COUNT + \
+     (PULSE_COUNTER_PIO == (n)) * PULSE_COUNTER_PIO_SMS)
+#define PIO_BLOCK_INSTRUCTIONS(n) \
+    ((PIO_CYW43_BLOCK == (n)) * PIO_CYW43_INSTRUCTIONS + (ONEWIRE_PIO == (n)) * ONEWIRE_PIO_INSTRUCTIONS + \
+     (DOSING_PIO == (n)) * DOSING_PIO_INSTRUCTIONS + \
+     (SHELF_I2C_PIO == (n) && SHELF_COUNT > 0) * SHELF_I2C_PIO_INSTRUCTIONS + \
+     (PULSE_COUNTER_PIO == (n)) * PULSE_COUNTER_PIO_INSTRUCTIONS)
+
+#if PIO_BLOCK_SMS(0) > 4 || PIO_BLOCK_SMS(1) > 4
+#error "PIO budget: more than 4 state machines in one block (see PIO BUDGET)"
+#endif
+#if PIO_BLOCK_INSTRUCTIONS(0) > 32 || PIO_BLOCK_INSTRUCTIONS(1) > 32
+#error "PIO budget: more than 32 instructions in one block (see PIO BUDGET)"
+#endif
+
+/* ========== CLIMATE CONTROL ========== */
+
+// Actuator outputs (driven from core 1, see app/climate_control.c)
+#define FAN_PWM_PIN 16             // GPIO 16: exhaust fan PWM (25kHz, 4-wire fan or MOSFET)
+#define MISTER_PIN 17              // GPIO 17: mister relay/solenoid (on/off)
+#define GROW_LIGHT_PWM_PIN 18      // GPIO 18: LED grow light driver dimming input (1kHz)
+
+#define CONTROL_PERIOD_MS 250      // Fixed control loop period (hardware alarm)
+#define CONTROL_STALE_MS 10000     // Readings older than this force failsafe outputs
+
+// Fan: PI on temperature (cooling) plus a dehumidification floor
+#define TEMP_SETPOINT 28.0f              // Target temperature (°C)
+#define FAN_KP 1.0f                      // ‰ duty per 0.01°C above setpoint
+#define FAN_KI 0.01f                     // ‰ duty per 0.01°C per control period
+#define FAN_DEHUMIDIFY_DUTY 600          // Minimum duty (‰) while humidity > HUMIDITY_MAX
+#define HUMIDITY_HYSTERESIS 5.0f         // Dehumidify until HUMIDITY_MAX - this (%)
+
+// Mister: on/off with hysteresis and duty-cycle protection
+#define MIST_ON_BELOW 60.0f              // Start misting below this humidity (%)
+#define MIST_OFF_ABOVE 70.0f             // Stop misting above this humidity (%)
+#define MIST_MAX_ON_MS 20000             // Longest continuous misting burst
+#define MIST_MIN_OFF_MS 60000            // Rest time between bursts
+
+// Grow light: photoperiod + daily light integral (see app/light_scheduler.c)
+#define PHOTOPERIOD_START_H 6            // Lights-on window start (local hour)
+#define PHOTOPERIOD_END_H 22             // Lights-on window end (local hour, 16h photoperiod)
+#define DLI_TARGET 14.0f                 // Daily light integral target (mol/m²/day, leafy greens)
+#define LUX_TO_PPFD 0.0185f              // µmol/m²/s per lux (daylight / white LED)
+#define LIGHT_PPFD_FULL 250.0f           // PPFD the LEDs add at the shelf at 100% (measure once)
+
+// Grow light fallback before the wall clock is known: PI on measured light level
+#define LIGHT_LUX_SETPOINT 300.0f        // Target light level (lux)
+#define LIGHT_KP 0.2f                    // ‰ duty per 0.01 lux below setpoint
+#define LIGHT_KI 0.005f                  // ‰ duty per 0.01 lux per control period
+
+/* ========== STATIC MEMORY ========== */
+
+// No runtime heap: everything below is reserved at build time (see mem_pool.c)
+#define MEM_ARENA_SIZE 2048        // Init-time allocations (OLED framebuffer + control byte)
+#define MSG_BUF_SIZE 512           // One JSON message payload
+#define MSG_POOL_BLOCKS 4          // Message buffers in flight at once
+#define BATCH_BUF_SIZE 1460        // One batched uplink payload (TCP MSS)
+#define BATCH_POOL_BLOCKS 2        // Batches in flight at once
+
+/* ========== FLASH HISTORY LOG ========== */
+
+// Ring of 16-byte records at the end of the 2MB flash: 768KB = 49152 records,
+// about 34 days at one record per minute (see hal/flash_log.c)
+#define FLASH_LOG_SIZE (768 * 1024)
+#define FLASH_LOG_INTERVAL_MS 60000     // History record period (1 min)
+#define FLASH_LOG_TIMEOUT_MS 100        // Max wait for the other core to park
+
+/* ========== USB DEVICE ========== */
+
+// CDC (console / binary stream) + MSC (read-only history volume) composite.
+// 0x2E8A is the Raspberry Pi VID; request an own PID before shipping in volume.
+#define USB_VID 0x2E8A
+#define USB_PID 0x4001
+
+/* ========== BENCHMARK ========== */
+
+// Periodic loop latency / CPU load report (enable with -DSMAVHIOT_BENCH=ON)
+#ifndef SMAVHIOT_BENCH
+#define SMAVHIOT_BENCH 0
+#endif
+#define BENCH_REPORT_INTERVAL_MS 30000  // Benchmark report period (30s)
+
+#endif // APP_CONFIG_H
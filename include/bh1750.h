@@ -2,11 +2,22 @@
 #define BH1750_H
 
 #include "pico/stdlib.h"
-#include "hardware/i2c.h"
+#include "i2c_bus.h"
 #include <stdbool.h>
 
-void bh1750_init(i2c_inst_t *i2c);
+/**
+ * @brief One BH1750 on a bus (ADDR pin low: 0x23)
+ */
+typedef struct {
+    I2cBus *bus;
+} Bh1750;
 
-bool bh1750_read_lux(float *lux);
+bool bh1750_init(Bh1750 *dev, I2cBus *bus);
+
+bool bh1750_read_lux(Bh1750 *dev, float *lux);
+
+bool bh1750_read_raw(Bh1750 *dev, uint16_t *raw);
+
+float bh1750_convert(uint16_t raw);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef CLIMATE_CONTROL_H
+#define CLIMATE_CONTROL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pico/stdlib.h"
+
+/**
+ * @brief Actuators driven by the control loop
+ */
+typedef enum {
+    ACTUATOR_FAN = 0,      // Exhaust fan (PWM)
+    ACTUATOR_MISTER,       // Mister relay (on/off)
+    ACTUATOR_GROW_LIGHT,   // LED grow light (PWM)
+    ACTUATOR_COUNT
+} ActuatorId;
+
+/**
+ * @brief Loop timing and actuator duty over the current telemetry window
+ */
+typedef struct {
+    uint32_t ticks;                       // Control periods executed
+    uint32_t overruns;                    // Periods skipped because the loop fell behind
+    uint32_t jitter_avg_us;               // Mean activation delay after the deadline
+    uint32_t jitter_max_us;               // Worst activation delay
+    uint32_t exec_max_us;                 // Longest control computation
+    uint16_t duty[ACTUATOR_COUNT];        // Current outputs (‰)
+    uint16_t duty_avg[ACTUATOR_COUNT];    // Mean outputs over the window (‰)
+    bool failsafe;                        // Outputs held at failsafe values right now
+} ControlStats;
+
+void climate_control_init(void);
+
+void climate_control_start(void);
+
+void climate_control_core1_entry(void);
+
+void climate_control_get_stats(ControlStats *out, bool reset_window);
+
+const char *climate_control_actuator_name(ActuatorId id);
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef COAP_SERVER_H
+#define COAP_SERVER_H
+
+/**
+ * @file coap_server.h
+ * @brief CoAP telemetry server (RFC 7252) with Observe (RFC 7641)
+ *
+ * Resources on UDP port COAP_PORT:
+ *   /sensores   latest readings, observable (non-confirmable notifications)
+ *   /alertas    alert flags, observable (confirmable notifications on change)
+ *   /historico  flash history records, block-wise (RFC 7959)
+ */
+
+#include <stdbool.h>
+#include "pico/stdlib.h"
+#include "app.h"
+
+void coap_server_start(void);
+
+void coap_server_notify(const SensorData *sensors, const AlertStatus *alerts, absolute_time_t timestamp);
+
+absolute_time_t coap_server_poll(void);
+
+void coap_server_print_stats(void);
+
+#endif
@@ -5,16 +5,23 @@
 
 void display_init(i2c_inst_t *i2c_port, uint8_t i2c_address);
 
-void display_update(float aht_temp, float humidity, float pressure, bool bmp_ok, float lux, bool bh1750_ok);
+void display_update(float aht_temp, float humidity, float co2_ppm, bool co2_ok, float lux, bool bh1750_ok);
 
 void display_render_sensor_data(float temperature, float humidity, float lux);
 
 void display_render_wifi_status(const char* text, bool status, bool is_alert);
 
+void display_render_mqtt_status(bool connected, const char *link_class, int32_t rssi_dbm, uint32_t interval_s);
+
 void display_render_alerts(bool temp_critical, bool humidity_critical, bool lux_critical);
 
+void display_render_nutrients(float ph, float ec, float level, bool probes_ok, float flow_lpm, bool pulses_ok,
+                              float water_temp);
+
 void display_clear(void);
 
 void display_show(void);
 
+void display_set_power(bool on, uint8_t contrast);
+
 #endif
\ No newline at end of file
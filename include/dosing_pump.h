@@ -0,0 +1,61 @@
+#ifndef DOSING_PUMP_H
+#define DOSING_PUMP_H
+
+/**
+ * @file dosing_pump.h
+ * @brief Peristaltic dosing pumps on stepper drivers (PIO step generation)
+ *
+ * A dose is queued as a volume; its steps, acceleration and deceleration
+ * are generated by PIO and DMA without the CPU. Every finished (or
+ * cancelled) dose leaves a completion event with the volume delivered.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Pumps
+ */
+typedef enum {
+    DOSING_PUMP_NUTRIENT = 0,   // Nutrient concentrate (raises EC)
+    DOSING_PUMP_PH_DOWN,        // pH down solution
+    DOSING_PUMP_COUNT
+} DosingPumpId;
+
+/**
+ * @brief Who asked for a dose
+ */
+typedef enum {
+    DOSE_SOURCE_RULE = 0,       // Local rule on the probe readings
+    DOSE_SOURCE_MQTT            // MQTT command channel
+} DoseSource;
+
+/**
+ * @brief Completion of one dose
+ */
+typedef struct {
+    DosingPumpId pump;
+    DoseSource source;
+    uint32_t id;                // Identifier given with the request
+    float requested_ml;         // Negative: pumped backwards (line purge)
+    float delivered_ml;         // Steps actually generated, converted to volume
+    int32_t delivered_steps;
+    uint32_t duration_ms;       // Start of the dose to its last step
+    bool cancelled;             // Stopped by dosing_pump_cancel() (possibly before starting)
+} DoseEvent;
+
+bool dosing_pump_init(void);
+
+bool dosing_pump_request(DosingPumpId pump, float volume_ml, DoseSource source, uint32_t id);
+
+void dosing_pump_cancel(DosingPumpId pump);
+
+bool dosing_pump_busy(DosingPumpId pump);
+
+bool dosing_pump_get_event(DoseEvent *out);
+
+const char *dosing_pump_name(DosingPumpId pump);
+
+const char *dosing_source_name(DoseSource source);
+
+#endif
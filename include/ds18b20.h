@@ -0,0 +1,29 @@
+#ifndef DS18B20_H
+#define DS18B20_H
+
+/**
+ * @file ds18b20.h
+ * @brief DS18B20 water-temperature probes on one 1-Wire bus
+ *
+ * Probes are found by ROM search at start-up; conversions and scratchpad
+ * reads then run in the background and the application only copies the
+ * latest results.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Latest result of one probe
+ */
+typedef struct {
+    uint64_t rom;            // ROM code (family code 0x28 in the low byte)
+    float temperature;       // °C
+    bool valid;              // Fresh reading with a good scratchpad CRC
+} Ds18b20Probe;
+
+int ds18b20_init(void);
+
+int ds18b20_read(Ds18b20Probe *probes, int max_probes);
+
+#endif
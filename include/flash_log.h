@@ -0,0 +1,42 @@
+#ifndef FLASH_LOG_H
+#define FLASH_LOG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "app.h"
+
+/**
+ * @brief One persisted history record (16 bytes, one flash write each)
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t seq;              // Monotonic record number (slot = seq % capacity)
+    uint32_t time_s;           // Seconds since boot (see FLASH_LOG_FLAG_WALL_CLOCK)
+    int16_t temperature_c100;  // °C x 100
+    uint16_t humidity_c100;    // %RH x 100
+    uint16_t lux;              // lux (saturates at 65535)
+    uint8_t flags;             // FLASH_LOG_FLAG_*
+    uint8_t crc;               // CRC-8 over the preceding 15 bytes
+} FlashLogRecord;
+
+_Static_assert(sizeof(FlashLogRecord) == 16, "flash log record must stay 16 bytes");
+
+#define FLASH_LOG_FLAG_AHT_OK     (1u << 0)
+#define FLASH_LOG_FLAG_LUX_OK     (1u << 1)
+#define FLASH_LOG_FLAG_TEMP_CRIT  (1u << 2)
+#define FLASH_LOG_FLAG_HUM_CRIT   (1u << 3)
+#define FLASH_LOG_FLAG_LUX_CRIT   (1u << 4)
+#define FLASH_LOG_FLAG_WALL_CLOCK (1u << 7)  // time_s is a Unix timestamp
+
+bool flash_log_init(void);
+
+bool flash_log_append(const SensorData *sensors, const AlertStatus *alerts, uint32_t time_s, bool wall_clock);
+
+uint32_t flash_log_first_seq(void);
+
+uint32_t flash_log_next_seq(void);
+
+uint32_t flash_log_capacity(void);
+
+bool flash_log_read(uint32_t seq, FlashLogRecord *record);
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef FLEET_STAGGER_H
+#define FLEET_STAGGER_H
+
+/**
+ * @file fleet_stagger.h
+ * @brief Per-board publish phase and randomized (re)connect delays
+ *
+ * Keeps a rack of boards that power up together from publishing and
+ * reconnecting in lockstep: every periodic publish runs at a phase derived
+ * from the board ID (or a slot assigned by the broker), and connection
+ * attempts wait a random delay. Fleet-level effect: tools/fleet_sim.py.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pico/stdlib.h"
+
+void fleet_stagger_init(void);
+
+const char *fleet_board_id(void);
+
+const char *fleet_slot_topic(void);
+
+const char *fleet_dosing_topic(void);
+
+const char *fleet_uplink_topic(void);
+
+absolute_time_t fleet_stagger_deadline(uint32_t period_ms);
+
+uint32_t fleet_stagger_random_ms(uint32_t max_ms);
+
+uint32_t fleet_stagger_backoff_ms(uint32_t base_ms);
+
+bool fleet_stagger_set_slot(uint32_t slot, uint32_t slots);
+
+bool fleet_stagger_take_change(void);
+
+void fleet_stagger_print_stats(void);
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+/**
+ * @file i2c_bus.h
+ * @brief One transaction interface for hardware and PIO I2C buses
+ *
+ * Sensor drivers talk to an I2cBus instead of an i2c_inst_t, so a sensor
+ * group can sit on one of the two I2C controllers or on a PIO state machine
+ * (drivers/i2c_master.pio) without any change. Every bus keeps traffic
+ * counters for the benchmark report.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "hardware/i2c.h"
+#include "hardware/pio.h"
+
+/**
+ * @brief Bus implementation
+ */
+typedef enum {
+    I2C_BUS_HW = 0,         // RP2040 I2C controller (i2c0/i2c1)
+    I2C_BUS_PIO             // PIO state machine, SCL = SDA + 1
+} I2cBusType;
+
+/**
+ * @brief Cumulative traffic counters (wrap; compare snapshots)
+ */
+typedef struct {
+    uint32_t transactions;  // Reads and writes started
+    uint32_t bytes;         // Bytes on the wire, address bytes included
+    uint32_t errors;        // NAKs and timeouts
+    uint32_t busy_us;       // Time spent inside transactions
+} I2cBusStats;
+
+/**
+ * @brief One bus
+ */
+typedef struct {
+    const char *name;
+    I2cBusType type;
+    i2c_inst_t *hw;         // I2C_BUS_HW: controller
+    PIO pio;                // I2C_BUS_PIO: state machine and program offset
+    uint sm;
+    uint offset;
+    uint sda_pin;
+    I2cBusStats stats;
+} I2cBus;
+
+bool i2c_bus_init_hw(I2cBus *bus, const char *name, i2c_inst_t *i2c, uint sda_pin, uint scl_pin, uint baudrate);
+
+bool i2c_bus_init_pio(I2cBus *bus, const char *name, uint sda_pin, uint baudrate);
+
+int i2c_bus_write_blocking(I2cBus *bus, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+
+int i2c_bus_read_blocking(I2cBus *bus, uint8_t addr, uint8_t *dst, size_t len, bool nostop);
+
+void i2c_bus_get_stats(const I2cBus *bus, I2cBusStats *stats);
+
+uint8_t i2c_bus_crc8(const uint8_t *data, size_t len);
+
+#endif
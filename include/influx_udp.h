@@ -0,0 +1,21 @@
+#ifndef INFLUX_UDP_H
+#define INFLUX_UDP_H
+
+/**
+ * @file influx_udp.h
+ * @brief InfluxDB line-protocol uplink straight to the database over UDP
+ *
+ * Uplink transport: one batch per datagram, no broker or bridge in between.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "uplink.h"
+
+extern const UplinkTransport influx_udp_transport;
+
+void influx_udp_init(void);
+
+bool influx_udp_set_destination(const char *ip, uint16_t port);
+
+#endif
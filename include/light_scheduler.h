@@ -0,0 +1,27 @@
+#ifndef LIGHT_SCHEDULER_H
+#define LIGHT_SCHEDULER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "app.h"
+
+/**
+ * @brief Daily light integral progress, for telemetry
+ */
+typedef struct {
+    bool clock_valid;          // Wall clock synchronized (scheduler active)
+    bool photoperiod;          // Inside the lights-on window
+    uint32_t dli_mmol;         // Light received today (mmol/m²)
+    uint32_t target_mmol;      // Daily target (mmol/m²)
+    uint32_t ambient_ppfd_c100; // Estimated non-LED PPFD (0.01 µmol/m²/s)
+} LightStatus;
+
+void light_scheduler_init(void);
+
+int32_t light_scheduler_update(const SensorData *sensors, uint16_t led_duty, uint32_t period_ms);
+
+int light_scheduler_photoperiod(void);
+
+void light_scheduler_get_status(LightStatus *out);
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef LINK_MONITOR_H
+#define LINK_MONITOR_H
+
+/**
+ * @file link_monitor.h
+ * @brief Wi-Fi link quality classes and the telemetry policy for each
+ *
+ * Samples RSSI and TCP retransmission/error counters, classifies the link
+ * and, on fair or poor links, stretches the telemetry interval and shrinks
+ * (and compresses) uplink batches until the link recovers.
+ */
+
+#include <stdint.h>
+#include "pico/stdlib.h"
+
+/**
+ * @brief Link quality, from RSSI, retransmissions and TCP errors
+ */
+typedef enum {
+    LINK_CLASS_GOOD = 0,
+    LINK_CLASS_FAIR,
+    LINK_CLASS_POOR,
+    LINK_CLASS_COUNT
+} LinkClass;
+
+absolute_time_t link_monitor_poll(void);
+
+void link_monitor_restart(void);
+
+LinkClass link_monitor_class(void);
+
+const char *link_class_name(LinkClass link);
+
+int32_t link_monitor_rssi(void);
+
+uint32_t link_publish_interval_ms(uint32_t base_ms);
+
+void link_monitor_print_stats(void);
+
+#endif
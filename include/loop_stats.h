@@ -0,0 +1,17 @@
+#ifndef LOOP_STATS_H
+#define LOOP_STATS_H
+
+#include <stdint.h>
+#include "pico/stdlib.h"
+
+void loop_stats_init(void);
+
+void loop_stats_record_lateness(int64_t lateness_us);
+
+void loop_stats_add_busy_us(uint64_t busy_us);
+
+bool loop_stats_report_due(void);
+
+void loop_stats_report(const char *build_name, uint num_cores);
+
+#endif
@@ -2,7 +2,13 @@
 #define LWIPOPTS_H
 
 // Configurações básicas do LWIP para Pico W
+// O build FreeRTOS (pico_cyw43_arch_lwip_sys_freertos) define PICO_CYW43_ARCH_FREERTOS
+// e roda o lwIP em uma thread própria (NO_SYS 0)
+#if PICO_CYW43_ARCH_FREERTOS
+#define NO_SYS                      0
+#else
 #define NO_SYS                      1
+#endif
 #define LWIP_SOCKET                 0
 #define LWIP_NETCONN                0
 #define MEM_ALIGNMENT               4
@@ -11,19 +17,57 @@
 #define DEFAULT_UDP_RECVMBOX_SIZE   8
 #define DEFAULT_TCP_RECVMBOX_SIZE   8
 #define MEM_SIZE                    16000  // Aumente a memória
+// Sem malloc da libc no lwIP: heap próprio (MEM_SIZE) e pools memp estáticos
+#define MEM_LIBC_MALLOC             0
+#define MEMP_MEM_MALLOC             0
+// Conexões HTTP (pico_lwip_http) vêm de pools memp de tamanho fixo
+#define HTTPD_USE_MEM_POOL          1
+#define MEMP_NUM_PARALLEL_HTTPD_CONNS     2
+#define MEMP_NUM_PARALLEL_HTTPD_SS_STATE  2
+// PCBs UDP (padrão 4): DHCP, DNS, SNTP, CoAP, Influx line protocol e MQTT-SN
+#define MEMP_NUM_UDP_PCB            6
+// PCBs TCP (padrão 5): as duas sessões MQTT 5 (ou o cliente MQTT 3.1.1), a
+// conexão anterior de cada sessão ainda fechando depois de uma reconexão e
+// duas conexões HTTP
+#define MEMP_NUM_TCP_PCB            6
 #define LWIP_DHCP                   1      // Habilite DHCP
 #define LWIP_NETIF_STATUS_CALLBACK  1      // Habilite callbacks de status
 // Define o número máximo de timeouts do sistema que podem estar ativos simultaneamente
 // LWIP_NUM_SYS_TIMEOUT_INTERNAL é o número de timeouts usados internamente pelo LWIP
 // O + 1 está adicionando um timeout extra para ser usado pela aplicação
 // Timeouts são usados para várias operações como retransmissões TCP, tempo de espera de conexão, etc.
-#define MEMP_NUM_SYS_TIMEOUT (LWIP_NUM_SYS_TIMEOUT_INTERNAL + 1)
+// O + 2 reserva um timeout para o MQTT e outro para o SNTP
+#define MEMP_NUM_SYS_TIMEOUT (LWIP_NUM_SYS_TIMEOUT_INTERNAL + 2)
 // Define o número máximo de requisições MQTT que podem estar "em voo" (não confirmadas) simultaneamente
 // Especificamente para operações de subscribe (inscrição em tópicos MQTT)
 // O valor 5 significa que até 5 requisições simultâneas (como PUBLISH, SUBSCRIBE etc) podem ser enviadas antes de precisar receber as confirmações correspondentes
 // Isso ajuda a controlar o fluxo de mensagens no protocolo MQTT
 #define MQTT_REQ_MAX_IN_FLIGHT (5)
 #define LWIP_MQTT 1
+// Buffer de saída do cliente MQTT (padrão 256): precisa comportar um lote do
+// uplink (BATCH_BUF_SIZE) mais cabeçalho e tópico
+#define MQTT_OUTPUT_RINGBUF_SIZE    2048
 #define LWIP_COMPAT_SOCKETS 0
 
+// Contadores MIB-II (segmentos TCP enviados/retransmitidos, conexões
+// derrubadas): usados pelo hal/link_monitor.c para classificar o link
+#define MIB2_STATS                  1
+
+// Relógio de parede via SNTP (fotoperíodo e carimbo de tempo do histórico)
+#define LWIP_DNS                    1
+#define SNTP_SERVER_DNS             1
+#define SNTP_UPDATE_DELAY           3600000  // Ressincroniza a cada hora
+#include <stdint.h>
+void wall_clock_set_unix(uint32_t unix_s, uint32_t us);  // app/wall_clock.c
+#define SNTP_SET_SYSTEM_TIME_US(sec, us) wall_clock_set_unix((sec), (us))
+
+#if !NO_SYS
+// Thread tcpip do lwIP e mailboxes usadas pelo build FreeRTOS
+#define TCPIP_THREAD_STACKSIZE      2048
+#define TCPIP_THREAD_PRIO           5      // Acima de todas as tarefas da aplicação (máx. 4)
+#define DEFAULT_THREAD_STACKSIZE    1024
+#define LWIP_TIMEVAL_PRIVATE        0
+#define LWIP_TCPIP_CORE_LOCKING_INPUT 1
+#endif
+
 #endif
\ No newline at end of file
@@ -0,0 +1,28 @@
+#ifndef LZSS_H
+#define LZSS_H
+
+/**
+ * @file lzss.h
+ * @brief Low-RAM LZSS compression of uplink batches (heatshrink-style bitstream)
+ *
+ * A compressed payload is a 6-byte header followed by a heatshrink-style
+ * bitstream (window LZSS_WINDOW_BITS, lookahead LZSS_LOOKAHEAD_BITS):
+ *
+ *   0x1F 'Z' window_bits lookahead_bits raw_len (uint16, big-endian)
+ *
+ * 0x1F never starts a line-protocol payload, so consumers can tell
+ * compressed and plain batches apart. Decoder: tools/lzss_decode.py.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LZSS_MAGIC_0 0x1F
+#define LZSS_MAGIC_1 'Z'
+#define LZSS_HEADER_SIZE 6
+
+size_t lzss_compress(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_cap);
+
+size_t lzss_working_memory(void);
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef MEM_POOL_H
+#define MEM_POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "pico/critical_section.h"
+
+// Round block sizes up so every block can hold the free-list link and stays word aligned
+#define MEM_POOL_ALIGN_UP(size) ((((size) < sizeof(void *) ? sizeof(void *) : (size)) + 7u) & ~7u)
+
+/**
+ * @brief Fixed-size block pool backed by static storage
+ */
+typedef struct {
+    const char *name;          // Name shown in the statistics report
+    uint8_t *storage;          // block_count * block_size bytes
+    uint16_t block_size;       // Size of each block (bytes, aligned)
+    uint16_t block_count;      // Number of blocks
+    void *free_list;           // Singly linked list of free blocks
+    uint16_t in_use;           // Blocks currently allocated
+    uint16_t high_water;       // Maximum blocks ever allocated at once
+    uint32_t exhausted;        // Allocations refused because the pool was empty
+    critical_section_t lock;   // Allocation may happen on both cores
+} MemPool;
+
+/**
+ * @brief Define a pool with build-time sized static storage
+ *
+ * Must be initialized with mem_pool_init() before use.
+ */
+#define MEM_POOL_DEFINE(var, size, count)                                                   \
+    static uint8_t var##_storage[(count) * MEM_POOL_ALIGN_UP(size)] __attribute__((aligned(8))); \
+    MemPool var = { .name = #var, .storage = var##_storage,                                  \
+                    .block_size = MEM_POOL_ALIGN_UP(size), .block_count = (count) }
+
+/* ========== SHARED POOLS ========== */
+
+extern MemPool msg_pool;     // Message payload buffers (MSG_BUF_SIZE)
+extern MemPool batch_pool;   // Batched uplink payloads (BATCH_BUF_SIZE)
+
+void mem_pools_init(void);
+
+/* ========== POOL API ========== */
+
+void mem_pool_init(MemPool *pool);
+
+void *mem_pool_alloc(MemPool *pool);
+
+void mem_pool_free(MemPool *pool, void *block);
+
+/* ========== SHARED BUFFERS ========== */
+
+/**
+ * @brief Reference-counted pool block: one payload read by several owners
+ *
+ * The block returns to its pool when the last reference is released.
+ * Define the pool with SHARED_BUF_BLOCK_SIZE() so data[] holds the payload.
+ */
+typedef struct {
+    MemPool *pool;             // Owner pool, for the last release
+    uint16_t refs;             // Changed under pool->lock
+    uint16_t len;              // Bytes used in data[]
+    uint8_t data[];
+} SharedBuf;
+
+#define SHARED_BUF_BLOCK_SIZE(payload) (sizeof(SharedBuf) + (payload))
+
+SharedBuf *shared_buf_alloc(MemPool *pool);
+
+size_t shared_buf_capacity(const SharedBuf *buf);
+
+void shared_buf_ref(SharedBuf *buf);
+
+void shared_buf_release(SharedBuf *buf);
+
+/* ========== STATIC ARENA (INIT-TIME ALLOCATIONS) ========== */
+
+void *mem_arena_alloc(size_t size);
+
+void mem_seal(void);
+
+bool mem_is_sealed(void);
+
+void mem_print_stats(void);
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef MQTT5_CLIENT_H
+#define MQTT5_CLIENT_H
+
+/**
+ * @file mqtt5_client.h
+ * @brief MQTT 5.0 sessions on lwIP raw TCP
+ *
+ * Each Mqtt5Session is one broker connection with its own aliases,
+ * subscriptions and health counters; several can run at once (see
+ * mqtt_fanout.h). Payloads are SharedBuf references: lwIP sends them in
+ * place and the session holds its reference until TCP has acknowledged
+ * them (QoS 0) or the broker has sent PUBACK (QoS 1).
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "pico/stdlib.h"
+#include "lwip/ip_addr.h"
+#include "mem_pool.h"
+#include "mqtt_client.h"
+#include "app_config.h"
+
+#define MQTT5_TOPIC_MAX 48                     // Longest topic that can get an alias
+#define MQTT5_HEADER_BUF 160                   // Fixed + variable header and properties
+#define MQTT5_MAX_SUBSCRIPTIONS 4
+#define MQTT5_REASON_SLOTS 12
+#define MQTT5_POLICY_SLOTS 8                   // Per-topic user property countdowns
+
+typedef struct Mqtt5Session Mqtt5Session;
+
+/**
+ * @brief Called in lwIP context when the session comes up or goes down
+ */
+typedef void (*mqtt5_status_cb_t)(Mqtt5Session *session, bool up);
+
+typedef enum {
+    MQTT5_IDLE = 0,
+    MQTT5_TCP_CONNECTING,
+    MQTT5_WAIT_CONNACK,
+    MQTT5_CONNECTED,
+} Mqtt5State;
+
+/**
+ * @brief Payload still referenced by lwIP or waiting for PUBACK
+ */
+typedef struct {
+    SharedBuf *buf;
+    uint32_t end;                              // Stream offset just past the packet
+    uint16_t packet_id;                        // QoS 1 waiting for PUBACK (0 = none)
+    absolute_time_t sent_at;                   // For the PUBACK round trip
+} Mqtt5InFlight;
+
+/**
+ * @brief Stream parser for incoming packets
+ */
+typedef struct {
+    uint8_t header;                            // Fixed header byte (0 = waiting for one)
+    uint32_t remaining;                        // Remaining Length
+    uint32_t multiplier;                       // Variable byte integer decoding (0 = done)
+    uint32_t received;                         // Body bytes seen so far
+} Mqtt5Rx;
+
+typedef struct {
+    const char *topic;
+    mqtt_message_handler_t handler;
+} Mqtt5Subscription;
+
+typedef struct {
+    uint8_t packet;                            // Packet type (upper nibble)
+    uint8_t code;
+    uint32_t count;
+} Mqtt5ReasonCount;
+
+/**
+ * @brief Health counters of one session
+ */
+typedef struct {
+    uint32_t published;
+    uint32_t acknowledged;                     // QoS 1 with a successful PUBACK
+    uint32_t aliased;                          // Sent with an empty topic name
+    uint32_t refused;                          // Not connected, send buffer or in-flight table full
+    uint32_t lost;                             // QoS 1 without PUBACK when the connection dropped
+    uint32_t received;
+    uint32_t oversized;                        // Incoming packets skipped
+    uint32_t connects;
+    uint32_t disconnects;
+    uint16_t inflight_high;
+    uint32_t puback_rtt_max_us;
+    uint64_t puback_rtt_sum_us;
+    uint64_t topic_bytes_saved;
+    uint64_t bytes_out;                        // Including TCP/IP headers (one segment per packet)
+    uint64_t bytes_in;                         // TCP payload
+    absolute_time_t up_since;
+} Mqtt5Stats;
+
+/**
+ * @brief One broker connection (static storage; see mqtt5_session_init())
+ */
+struct Mqtt5Session {
+    const char *name;                          // Shown in the statistics report
+    const char *client_id;
+    mqtt5_status_cb_t on_status;
+
+    struct tcp_pcb *pcb;
+    Mqtt5State state;
+    bool pcb_aborted;                          // Set by a close: callbacks return ERR_ABRT
+    uint16_t keepalive_s;
+    uint16_t alias_max;                        // min(broker's Topic Alias Maximum, MQTT5_TOPIC_ALIASES)
+    uint32_t broker_max_packet;                // 0 = no limit announced
+    absolute_time_t last_tx;
+    absolute_time_t connect_started;
+    absolute_time_t ping_sent;
+    bool ping_pending;
+    uint16_t next_packet_id;
+
+    uint32_t queued;                           // Bytes handed to tcp_write() on this connection
+    uint32_t acked;                            // Bytes acknowledged by TCP
+    Mqtt5InFlight inflight[MQTT5_INFLIGHT];
+    uint8_t inflight_head;
+    uint8_t inflight_count;
+
+    char aliases[MQTT5_TOPIC_ALIASES][MQTT5_TOPIC_MAX];   // Alias N is aliases[N - 1]
+    uint16_t alias_count;
+    uint16_t schema_countdown[MQTT5_POLICY_SLOTS];       // 0 = user properties due
+
+    Mqtt5Subscription subscriptions[MQTT5_MAX_SUBSCRIPTIONS];
+    int subscription_count;
+
+    uint8_t tx_buf[MQTT5_HEADER_BUF];
+    uint8_t rx_buf[MQTT5_RX_BUF_SIZE + 1];    // +1: NUL for the handlers
+    Mqtt5Rx rx;
+
+    Mqtt5ReasonCount reasons[MQTT5_REASON_SLOTS];
+    Mqtt5Stats stats;
+};
+
+void mqtt5_session_init(Mqtt5Session *session, const char *name, const char *client_id,
+                        mqtt5_status_cb_t on_status);
+
+bool mqtt5_session_connect(Mqtt5Session *session, const ip_addr_t *broker, uint16_t port);
+
+bool mqtt5_session_is_up(const Mqtt5Session *session);
+
+bool mqtt5_session_is_busy(const Mqtt5Session *session);
+
+bool mqtt5_session_publish(Mqtt5Session *session, const char *topic, SharedBuf *payload, uint8_t qos);
+
+bool mqtt5_session_subscribe(Mqtt5Session *session, const char *topic, mqtt_message_handler_t handler);
+
+void mqtt5_session_print_stats(const Mqtt5Session *session);
+
+#endif
@@ -17,11 +17,43 @@ void mqtt_setup(const char *client_id, const char *broker_ip, bool *status_mqtt)
 
 /**
  * @brief Publishes data to an MQTT topic
- * 
- * @param topic Topic name (e.g., "sensor/temperature")
+ *
+ * Goes through the outbound queue (mqtt_outbox.h): a message the transport
+ * cannot take right now is kept and retried by priority.
+ *
+ * @param topic Topic name (e.g., "sensor/temperature"; must stay valid, string literal)
  * @param data Message payload (bytes)
  * @param len Payload length
+ * @return false if the message was neither sent nor queued
+ */
+bool mqtt_comm_publish(const char *topic, const uint8_t *data, size_t len);
+
+/**
+ * @brief Sends directly on the active transport, bypassing the outbound queue
+ *
+ * @return false if the transport pushed back (not connected, output buffer
+ *         or request slots full)
+ */
+bool mqtt_comm_send(const char *topic, const uint8_t *data, size_t len);
+
+/**
+ * @brief Handler for messages received on a subscribed topic
+ *
+ * Runs in the lwIP context: keep it short and do not block.
+ *
+ * @param topic Topic the message arrived on
+ * @param data Payload, NUL-terminated
+ * @param len Payload length
+ */
+typedef void (*mqtt_message_handler_t)(const char *topic, const char *data, size_t len);
+
+/**
+ * @brief Subscribes to a topic (now and after every reconnection)
+ *
+ * @param topic Topic filter (must stay valid; string literal)
+ * @param handler Called for every message received on it
+ * @return false if the subscription table is full
  */
-void mqtt_comm_publish(const char *topic, const uint8_t *data, size_t len);
+bool mqtt_comm_subscribe(const char *topic, mqtt_message_handler_t handler);
 
 #endif // MQTT_CLIENT_H
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef MQTT_FANOUT_H
+#define MQTT_FANOUT_H
+
+/**
+ * @file mqtt_fanout.h
+ * @brief Parallel MQTT 5 sessions fed from one encoding per sample
+ *
+ * Used when MQTT_V5_ENABLED: mqtt_setup() starts the sessions and
+ * mqtt_comm_publish()/mqtt_comm_subscribe() go through here. Each session
+ * has its own broker, QoS, encoding, sample interval and topic classes;
+ * see the policy table in mqtt_fanout.c.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "pico/stdlib.h"
+#include "lwip/ip_addr.h"
+#include "app.h"
+#include "mqtt_client.h"
+
+typedef enum {
+    MQTT_ENCODING_JSON = 0,                    // pico_w/sensors/data
+    MQTT_ENCODING_LINE,                        // pico_w/sensors/line (InfluxDB line protocol)
+    MQTT_ENCODING_COUNT
+} MqttEncoding;
+
+void mqtt_fanout_start(const char *client_id, const ip_addr_t *cloud_broker, bool *status);
+
+void mqtt_fanout_sample(const SensorData *sensors, absolute_time_t timestamp);
+
+absolute_time_t mqtt_fanout_poll(const SensorData *sensors, absolute_time_t timestamp);
+
+void mqtt_fanout_restagger(void);
+
+bool mqtt_fanout_publish(const char *topic, const uint8_t *data, size_t len);
+
+bool mqtt_fanout_subscribe(const char *topic, mqtt_message_handler_t handler);
+
+void mqtt_fanout_print_stats(void);
+
+#endif
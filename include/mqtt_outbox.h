@@ -0,0 +1,35 @@
+#ifndef MQTT_OUTBOX_H
+#define MQTT_OUTBOX_H
+
+/**
+ * @file mqtt_outbox.h
+ * @brief Bounded priority queue in front of every MQTT transport
+ *
+ * mqtt_comm_publish() goes through here: a message the transport pushes
+ * back on (send buffer or request slots full, not connected) is kept and
+ * retried, alerts first, instead of being dropped.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "pico/stdlib.h"
+
+typedef enum {
+    MQTT_CLASS_ALERT = 0,                      // Highest priority, never expires
+    MQTT_CLASS_TELEMETRY,
+    MQTT_CLASS_DIAGNOSTIC,                     // Lowest priority, evicted first
+    MQTT_CLASS_COUNT
+} MqttClass;
+
+bool mqtt_outbox_publish(const char *topic, const uint8_t *data, size_t len);
+
+void mqtt_outbox_drain(void);
+
+absolute_time_t mqtt_outbox_poll(void);
+
+absolute_time_t mqtt_outbox_last_sent(void);
+
+void mqtt_outbox_print_stats(void);
+
+#endif
@@ -3,6 +3,9 @@
 
 #include <math.h>
 #include <stdbool.h>
+#include "app.h"
+#include "dosing_pump.h"
+#include "uplink.h"
 
 // #define SSID "JOAO_2.4G"
 // #define PASSWD "30226280!"
@@ -12,11 +15,24 @@
 
 void mqtt_conect_init();
 
-void mqtt_get_and_publish(bool wifi_connected,bool mqtt_connected, bool aht_ok,bool bmp_ok,bool lux_ok,
-    float aht_temp, float bmp_temp,float humidity,float pressure,float lux_val);
+size_t mqtt_format_sensor_json(const SensorData *sensors, char *buf, size_t size);
+
+void mqtt_get_and_publish(bool wifi_connected,bool mqtt_connected,const SensorData *sensors);
 
 void mqtt_get_and_publish2(bool wifi_connected,bool mqtt_connected,char *str);
 
+void mqtt_get_and_publish_control(bool wifi_connected,bool mqtt_connected,const char *str);
+
+void mqtt_dosing_init(void);
+
+void mqtt_publish_dosing_event(bool wifi_connected, bool mqtt_connected, const DoseEvent *ev);
+
+extern const UplinkTransport mqtt_batch_transport;
+
+void mqtt_uplink_init(void);
+
+void mqtt_fleet_init(void);
+
 bool wifi_check();
 bool mqtt_check();
 
@@ -0,0 +1,29 @@
+#ifndef MQTT_SN_CLIENT_H
+#define MQTT_SN_CLIENT_H
+
+/**
+ * @file mqtt_sn_client.h
+ * @brief MQTT-SN 1.2 client over UDP for a local gateway
+ *
+ * Selected with MQTT_SN_ENABLED: mqtt_comm_publish() and
+ * mqtt_comm_subscribe() then go through this client instead of MQTT/TCP.
+ * Topics are pre-defined 2-byte IDs that must match the gateway's table.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "pico/stdlib.h"
+#include "mqtt_client.h"
+
+bool mqtt_sn_init(const char *client_id, const char *gateway_ip, uint16_t port, bool *status);
+
+bool mqtt_sn_publish(const char *topic, const uint8_t *data, size_t len);
+
+bool mqtt_sn_subscribe(const char *topic, mqtt_message_handler_t handler);
+
+absolute_time_t mqtt_sn_poll(uint32_t sleep_ms);
+
+void mqtt_sn_print_stats(void);
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef ONEWIRE_H
+#define ONEWIRE_H
+
+/**
+ * @file onewire.h
+ * @brief 1-Wire bus master on a PIO state machine
+ *
+ * Slot timing is generated by the PIO (drivers/onewire.pio). Short blocking
+ * operations (reset, ROM search) are meant for initialization; run-time
+ * traffic goes through DMA-fed command batches polled for completion.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "hardware/pio.h"
+
+#define ONEWIRE_CMD_SKIP_ROM 0xCC
+#define ONEWIRE_CMD_MATCH_ROM 0x55
+#define ONEWIRE_CMD_SEARCH_ROM 0xF0
+
+/**
+ * @brief One bus (one pin, one state machine, two DMA channels)
+ */
+typedef struct {
+    uint pin;
+    PIO pio;
+    uint sm;
+    int dma_tx;              // Command words -> TX FIFO
+    int dma_rx;              // RX FIFO -> result words
+} OneWireBus;
+
+/**
+ * @brief Command word: reset pulse and presence detect
+ * Result bit 31 is 0 when at least one device answered.
+ */
+static inline uint32_t onewire_cmd_reset(void) {
+    return (14u << 1) | 1u; // 15 x 32us low after the first 32us: 512us
+}
+
+/**
+ * @brief Command word: 1..8 bit slots, LSB first
+ * Send 1s to read: the result holds the slots in its top @p bits bits.
+ */
+static inline uint32_t onewire_cmd_bits(uint8_t value, uint bits) {
+    return ((uint32_t)(uint8_t)~value << 5) | ((bits - 1u) << 1);
+}
+
+static inline uint32_t onewire_cmd_byte(uint8_t value) {
+    return onewire_cmd_bits(value, 8);
+}
+
+static inline uint8_t onewire_result_bits(uint32_t result, uint bits) {
+    return (uint8_t)(result >> (32u - bits));
+}
+
+bool onewire_init(OneWireBus *bus, uint pin);
+
+bool onewire_reset(OneWireBus *bus);
+
+int onewire_search(OneWireBus *bus, uint64_t *roms, int max_roms, uint8_t family);
+
+bool onewire_start(OneWireBus *bus, const uint32_t *commands, uint32_t *results, uint count);
+
+bool onewire_busy(const OneWireBus *bus);
+
+uint8_t onewire_crc8(const uint8_t *data, size_t len);
+
+#endif
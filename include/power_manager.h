@@ -0,0 +1,74 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+/**
+ * @file power_manager.h
+ * @brief Supply monitoring (VSYS, VBUS) and battery-driven duty cycling
+ *
+ * Tells the application what it runs from and how much battery is left,
+ * and scales the sampling/publishing intervals and the OLED accordingly.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Where the board takes its power from
+ */
+typedef enum {
+    POWER_SOURCE_USB = 0,       // VBUS present
+    POWER_SOURCE_EXTERNAL,      // No VBUS, VSYS above any battery voltage (DC supply)
+    POWER_SOURCE_BATTERY
+} PowerSource;
+
+/**
+ * @brief Duty-cycling level, from the battery state of charge
+ */
+typedef enum {
+    POWER_LEVEL_NORMAL = 0,     // External power or battery above POWER_SAVE_BELOW_PCT
+    POWER_LEVEL_SAVE,
+    POWER_LEVEL_LOW,
+    POWER_LEVEL_CRITICAL,
+    POWER_LEVEL_COUNT
+} PowerLevel;
+
+/**
+ * @brief OLED state requested by the policy
+ */
+typedef enum {
+    DISPLAY_POWER_NORMAL = 0,
+    DISPLAY_POWER_DIM,
+    DISPLAY_POWER_OFF
+} DisplayPower;
+
+/**
+ * @brief Latest supply measurement and projection
+ */
+typedef struct {
+    PowerSource source;
+    PowerLevel level;
+    uint32_t vsys_mv;           // Filtered VSYS
+    uint8_t battery_pct;        // State of charge (100 on external power)
+    int32_t runtime_min;        // Projected battery runtime, -1 on external power
+    bool runtime_measured;      // From the observed discharge rate (else nominal draw)
+} PowerStatus;
+
+void power_manager_init(void);
+
+void power_manager_update(void);
+
+void power_manager_get_status(PowerStatus *out);
+
+void power_manager_note_activity(void);
+
+uint32_t power_sample_interval_ms(uint32_t base_ms);
+
+uint32_t power_publish_interval_ms(uint32_t base_ms);
+
+DisplayPower power_display_mode(void);
+
+const char *power_source_name(PowerSource source);
+
+const char *power_level_name(PowerLevel level);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef PULSE_COUNTER_H
+#define PULSE_COUNTER_H
+
+/**
+ * @file pulse_counter.h
+ * @brief Hardware pulse counting (PIO + DMA) for flow meters and tachometers
+ *
+ * Edges are counted and periods measured without any CPU interrupt; the
+ * application reads the totals and rate once per acquisition.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Pulse inputs
+ */
+typedef enum {
+    PULSE_FLOW = 0,         // Nutrient line flow meter
+    PULSE_PUMP,             // Circulation pump tachometer
+    PULSE_CHANNEL_COUNT
+} PulseChannel;
+
+/**
+ * @brief One channel as seen by an acquisition
+ */
+typedef struct {
+    uint32_t count;         // Pulses since boot (wraps at 2^32)
+    float rate_hz;          // Pulse rate over the window since the previous read
+    bool stalled;           // No pulse for PULSE_STALL_MS (rate forced to 0)
+    bool seen;              // At least one pulse since boot (otherwise maybe no sensor fitted)
+} PulseReading;
+
+bool pulse_counter_init(void);
+
+bool pulse_counter_read(PulseChannel channel, PulseReading *out);
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef RH_SENSOR_H
+#define RH_SENSOR_H
+
+/**
+ * @file rh_sensor.h
+ * @brief Temperature/humidity sensor of a sensor group, detected at boot
+ *
+ * One interface over the AHT10, AHT20/AHT21 and SHT40/SHT41 drivers, so each
+ * shelf can be fitted with whichever sensor suits it: the SHT4x for speed
+ * and accuracy, the AHTs for cost.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "i2c_bus.h"
+#include "aht10.h"
+#include "aht20.h"
+#include "sht4x.h"
+
+/**
+ * @brief Detected sensor model
+ */
+typedef enum {
+    RH_SENSOR_NONE = 0,
+    RH_SENSOR_AHT10,
+    RH_SENSOR_AHT20,        // AHT20 or AHT21
+    RH_SENSOR_SHT4X         // SHT40 or SHT41
+} RhSensorType;
+
+/**
+ * @brief One sensor; the handle of the detected model is active
+ */
+typedef struct {
+    RhSensorType type;
+    union {
+        Aht10 aht10;
+        Aht20 aht20;
+        Sht4x sht4x;
+    };
+} RhSensor;
+
+bool rh_sensor_init(RhSensor *dev, I2cBus *bus, Sht4xRepeatability repeatability);
+
+const char *rh_sensor_name(const RhSensor *dev);
+
+uint32_t rh_sensor_conversion_us(const RhSensor *dev);
+
+bool rh_sensor_trigger(RhSensor *dev);
+
+bool rh_sensor_fetch_raw(RhSensor *dev, uint32_t *raw_temp, uint32_t *raw_humidity);
+
+void rh_sensor_convert(const RhSensor *dev, uint32_t raw_temp, uint32_t raw_humidity, float *temp, float *humidity);
+
+bool rh_sensor_read_data(RhSensor *dev, float *temp, float *humidity);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef SAMPLE_POOL_H
+#define SAMPLE_POOL_H
+
+#include <stdint.h>
+#include "app.h"
+
+// Number of samples that can be in flight between pipeline stages at once
+#define SAMPLE_POOL_SIZE 8
+
+/**
+ * @brief One acquisition cycle, shared by reference between consumers
+ *
+ * Queues carry pointers to these objects (never copies). The producer sets
+ * the reference count to the number of consumers before fanning a sample out
+ * and every consumer calls sample_pool_release() when done.
+ */
+typedef struct {
+    SensorData sensors;          // Readings of this cycle
+    SensorRaw raw;               // Uncalibrated codes (USB binary stream)
+    AlertStatus alerts;          // Threshold evaluation of this cycle
+    absolute_time_t timestamp;   // Acquisition time
+    uint32_t seq;                // Monotonic sample number
+    uint8_t refs;                // Outstanding references (0 = free)
+} SensorSample;
+
+void sample_pool_init(void);
+
+SensorSample *sample_pool_acquire(void);
+
+void sample_pool_retain(SensorSample *sample, uint8_t count);
+
+void sample_pool_release(SensorSample *sample);
+
+uint32_t sample_pool_exhausted_count(void);
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef SCD4X_H
+#define SCD4X_H
+
+/**
+ * @file scd4x.h
+ * @brief Sensirion SCD40/SCD41 CO2 sensor in periodic measurement mode
+ *
+ * The sensor measures on its own every 5s (30s in low-power mode); the
+ * application only asks whether a new result is ready, so the sampling
+ * cycle never waits for a conversion.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pico/time.h"
+#include "i2c_bus.h"
+
+#define SCD4X_QUERY_MIN_US 1000   // Minimum time between scd4x_begin_poll() and scd4x_end_poll()
+
+/**
+ * @brief Latest measurement
+ */
+typedef struct {
+    uint16_t co2_ppm;       // CO2 concentration (ppm)
+    float temperature;      // Sensor temperature after the offset (°C)
+    float humidity;         // Sensor RH (%)
+    bool valid;             // A measurement arrived within 3 measurement intervals
+} Scd4xReading;
+
+/**
+ * @brief One sensor (fixed address 0x62)
+ */
+typedef struct {
+    I2cBus *bus;
+    bool present;               // Answered at init (serial number with valid CRC)
+    bool running;               // Periodic measurement started
+    bool query_pending;         // Data-ready command sent, answer not read yet
+    float temp_offset_c;        // Offset currently programmed in the sensor
+    float offset_error_c;       // Filtered (sensor - reference) temperature
+    uint16_t offset_samples;    // Samples in the filter since the last update
+    absolute_time_t restart_at; // Stopped for reconfiguration until this time
+    absolute_time_t last_update;
+    Scd4xReading reading;
+} Scd4x;
+
+bool scd4x_init(Scd4x *dev, I2cBus *bus);
+
+void scd4x_begin_poll(Scd4x *dev);
+
+bool scd4x_end_poll(Scd4x *dev, float reference_temp);
+
+void scd4x_get(const Scd4x *dev, Scd4xReading *out);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef SHT4X_H
+#define SHT4X_H
+
+#include "pico/stdlib.h"
+#include "i2c_bus.h"
+#include <stdbool.h>
+
+/**
+ * @brief Measurement repeatability (noise vs conversion time)
+ */
+typedef enum {
+    SHT4X_REPEATABILITY_HIGH = 0,   // 8.3ms, 0.04% RH / 0.04°C noise
+    SHT4X_REPEATABILITY_MEDIUM,     // 4.5ms
+    SHT4X_REPEATABILITY_LOW         // 1.7ms
+} Sht4xRepeatability;
+
+/**
+ * @brief One SHT40/SHT41 on a bus (0x44 or 0x45)
+ */
+typedef struct {
+    I2cBus *bus;
+    uint8_t addr;
+    Sht4xRepeatability repeatability;
+} Sht4x;
+
+bool sht4x_init(Sht4x *dev, I2cBus *bus, Sht4xRepeatability repeatability);
+
+uint32_t sht4x_conversion_us(const Sht4x *dev);
+
+bool sht4x_trigger(Sht4x *dev);
+
+bool sht4x_fetch_raw(Sht4x *dev, uint16_t *raw_temp, uint16_t *raw_humidity);
+
+void sht4x_convert(uint16_t raw_temp, uint16_t raw_humidity, float *temp, float *humidity);
+
+bool sht4x_read_data(Sht4x *dev, float *temp, float *humidity);
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef STATE_SNAPSHOT_H
+#define STATE_SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "app.h"
+
+/**
+ * @brief Consistent copy of the latest sampled state
+ */
+typedef struct {
+    SensorData sensors;          // Readings of the published cycle
+    AlertStatus alerts;          // Alert evaluation of the published cycle
+    absolute_time_t timestamp;   // Acquisition time of the published cycle
+    uint32_t generation;         // Publication counter (0 = nothing published yet)
+} StateSnapshot;
+
+void state_snapshot_init(void);
+
+void state_snapshot_publish(const SensorData *sensors, const AlertStatus *alerts, absolute_time_t timestamp);
+
+bool state_snapshot_read(StateSnapshot *out);
+
+uint32_t state_snapshot_generation(void);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef TUSB_CONFIG_H
+#define TUSB_CONFIG_H
+
+/**
+ * @file tusb_config.h
+ * @brief TinyUSB configuration of the CDC + MSC composite device
+ *
+ * Replaces the configuration bundled with pico_stdio_usb. stdio still runs
+ * on the CDC interface and keeps servicing the device from its background
+ * IRQ (see PICO_STDIO_USB_* definitions in CMakeLists.txt); descriptors are
+ * in drivers/usb_descriptors.c and the MSC callbacks in app/usb_disk.c.
+ */
+
+/* ========== COMMON ========== */
+
+#ifndef CFG_TUSB_RHPORT0_MODE
+#define CFG_TUSB_RHPORT0_MODE OPT_MODE_DEVICE
+#endif
+
+#define CFG_TUD_ENABLED 1
+#define CFG_TUD_ENDPOINT0_SIZE 64
+
+/* ========== DEVICE CLASSES ========== */
+
+#define CFG_TUD_CDC 1
+#define CFG_TUD_MSC 1
+#define CFG_TUD_HID 0
+#define CFG_TUD_MIDI 0
+#define CFG_TUD_VENDOR 0
+
+// CDC FIFOs: the TX side also absorbs binary stream bursts (usb_stream.c)
+#define CFG_TUD_CDC_RX_BUFSIZE 256
+#define CFG_TUD_CDC_TX_BUFSIZE 1024
+#define CFG_TUD_CDC_EP_BUFSIZE 64
+
+// One sector per MSC transfer chunk
+#define CFG_TUD_MSC_EP_BUFSIZE 512
+
+#endif // TUSB_CONFIG_H
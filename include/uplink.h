@@ -0,0 +1,54 @@
+#ifndef UPLINK_H
+#define UPLINK_H
+
+/**
+ * @file uplink.h
+ * @brief Batched, store-and-forward sample uplink over pluggable transports
+ *
+ * Samples are kept in a RAM ring as compact records and sent as InfluxDB
+ * line protocol, several per payload. Each transport only has to say
+ * whether it can send right now and push one payload; records it could
+ * not send stay queued for it until the link comes back.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "pico/stdlib.h"
+#include "app.h"
+
+/**
+ * @brief When a transport gets LZSS-compressed batches
+ */
+typedef enum {
+    UPLINK_COMPRESS_NEVER = 0,
+    UPLINK_COMPRESS_ALWAYS,
+    UPLINK_COMPRESS_DEGRADED_LINK                   // While uplink_set_link_policy() asks for it
+} UplinkCompress;
+
+/**
+ * @brief One way out of the device for batched samples
+ */
+typedef struct {
+    const char *name;                               // Shown in the statistics report
+    size_t max_payload;                             // Largest payload it accepts (bytes)
+    bool (*ready)(void);                            // Link up and able to send now
+    bool (*send)(const uint8_t *data, size_t len);  // One batch; false keeps it for a retry
+    UplinkCompress compress;                        // LZSS payloads (lzss.h) for a decoding consumer
+} UplinkTransport;
+
+void uplink_init(void);
+
+bool uplink_add_transport(const UplinkTransport *transport);
+
+void uplink_record(const SensorData *sensors, absolute_time_t timestamp);
+
+void uplink_flush(void);
+
+void uplink_set_link_policy(size_t max_payload, bool compress);
+
+size_t uplink_format_sample(const SensorData *sensors, absolute_time_t timestamp, char *buf, size_t size);
+
+void uplink_print_stats(void);
+
+#endif
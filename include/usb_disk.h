@@ -0,0 +1,16 @@
+#ifndef USB_DISK_H
+#define USB_DISK_H
+
+/**
+ * @file usb_disk.h
+ * @brief Read-only virtual FAT12 volume exposing the flash history over USB MSC
+ *
+ * The volume contents are generated sector by sector inside the TinyUSB MSC
+ * callbacks (see usb_disk.c); there is no public API beyond the callbacks.
+ * The file list is frozen when the host mounts the volume: unplug and plug
+ * the cable again to see records logged since.
+ */
+
+#define USB_DISK_LABEL "SMAVHIOT   "   // FAT volume label (11 chars, space padded)
+
+#endif // USB_DISK_H
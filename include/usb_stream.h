@@ -0,0 +1,95 @@
+#ifndef USB_STREAM_H
+#define USB_STREAM_H
+
+/**
+ * @file usb_stream.h
+ * @brief Binary sample streaming over USB CDC (commissioning mode)
+ *
+ * The host switches the CDC port from console text to binary frames by
+ * sending USB_STREAM_CMD_START and back with USB_STREAM_CMD_STOP (closing
+ * the port also stops the stream). Decoder: tools/stream_decode.py.
+ *
+ * Frame layout (little-endian, 60 bytes):
+ *
+ *   off  size  field
+ *    0    2    sync         0xAA 0x55
+ *    2    1    type         USB_STREAM_TYPE_SAMPLE
+ *    3    1    length       payload bytes after this field (54)
+ *    4    4    seq          frame number, also incremented for dropped frames
+ *    8    8    timestamp    microseconds since boot
+ *   16    4    raw_temp     RH sensor temperature code (AHT: 20-bit, SHT4x: 16-bit)
+ *   20    4    raw_hum      RH sensor humidity code (AHT: 20-bit, SHT4x: 16-bit)
+ *   24    2    raw_lux      BH1750 16-bit register
+ *   26    1    flags        bit 0 = RH sensor ok, bit 1 = BH1750 ok, bit 2 = probes ok
+ *   27    1    reserved
+ *   28    4    temperature  float, °C
+ *   32    4    humidity     float, %RH
+ *   36    4    lux          float, lux
+ *   40    2    raw_ph       oversampled 16-bit ADC code (65536 = ADC_VREF_MV)
+ *   42    2    raw_ec       same
+ *   44    2    raw_level    same
+ *   46    4    ph           float
+ *   50    4    ec           float, mS/cm
+ *   54    4    level        float, % of full
+ *   58    2    crc          CRC-16/CCITT-FALSE over bytes 2..57
+ *
+ * Type USB_STREAM_TYPE_SAMPLE_V1 (earlier firmware) is the same frame cut
+ * after lux: 42 bytes, length 36, CRC at offset 40 over bytes 2..39.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pico/stdlib.h"
+#include "app.h"
+
+/* ========== PROTOCOL CONSTANTS ========== */
+
+#define USB_STREAM_SYNC0 0xAA
+#define USB_STREAM_SYNC1 0x55
+#define USB_STREAM_TYPE_SAMPLE_V1 0x01  // 42 bytes, without the nutrient probes
+#define USB_STREAM_TYPE_SAMPLE 0x02
+
+#define USB_STREAM_CMD_START 'S'   // Host -> device: enter binary mode
+#define USB_STREAM_CMD_STOP 'X'    // Host -> device: back to console text
+
+#define USB_STREAM_FLAG_AHT_OK (1u << 0)
+#define USB_STREAM_FLAG_LUX_OK (1u << 1)
+#define USB_STREAM_FLAG_PROBES_OK (1u << 2)
+
+/**
+ * @brief One binary sample frame as sent on the wire
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t sync[2];
+    uint8_t type;
+    uint8_t length;
+    uint32_t seq;
+    uint64_t timestamp_us;
+    uint32_t raw_temp;
+    uint32_t raw_humidity;
+    uint16_t raw_lux;
+    uint8_t flags;
+    uint8_t reserved;
+    float temperature;
+    float humidity;
+    float lux;
+    uint16_t raw_ph;
+    uint16_t raw_ec;
+    uint16_t raw_level;
+    float ph;
+    float ec;
+    float level;
+    uint16_t crc;
+} UsbStreamFrame;
+
+_Static_assert(sizeof(UsbStreamFrame) == 60, "USB stream frame layout changed");
+
+/* ========== PUBLIC INTERFACE ========== */
+
+void usb_stream_poll(void);
+
+bool usb_stream_active(void);
+
+void usb_stream_send_sample(const SensorData *sensors, const SensorRaw *raw, absolute_time_t timestamp);
+
+#endif // USB_STREAM_H
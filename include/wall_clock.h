@@ -0,0 +1,22 @@
+#ifndef WALL_CLOCK_H
+#define WALL_CLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pico/stdlib.h"
+
+void wall_clock_init(void);
+
+void wall_clock_start_sntp(void);
+
+void wall_clock_set_unix(uint32_t unix_s, uint32_t us);
+
+bool wall_clock_now(uint32_t *unix_s);
+
+bool wall_clock_at(absolute_time_t t, uint32_t *unix_s);
+
+bool wall_clock_at_us(absolute_time_t t, int64_t *unix_us);
+
+bool wall_clock_local(uint32_t *day, uint32_t *second_of_day);
+
+#endif
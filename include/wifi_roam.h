@@ -0,0 +1,21 @@
+#ifndef WIFI_ROAM_H
+#define WIFI_ROAM_H
+
+/**
+ * @file wifi_roam.h
+ * @brief Roaming between access points that share WIFI_SSID
+ *
+ * Background scans keep a list of candidate access points without holding
+ * up publishing; a weak association moves to a clearly stronger candidate
+ * with a directed join, and each handover's duration and MQTT data gap are
+ * reported.
+ */
+
+#include <stdint.h>
+#include "pico/stdlib.h"
+
+absolute_time_t wifi_roam_poll(void);
+
+void wifi_roam_print_stats(void);
+
+#endif
@@ -0,0 +1,16 @@
+/**
+ * @file sync.h
+ * @brief Host stand-in for hardware/sync.h
+ *
+ * __dmb() becomes a full fence, so the host checks the same ordering the
+ * Cortex-M0+ barrier gives on target.
+ */
+
+#ifndef TEST_STUB_HARDWARE_SYNC_H
+#define TEST_STUB_HARDWARE_SYNC_H
+
+static inline void __dmb(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+#endif
@@ -0,0 +1,21 @@
+/**
+ * @file err.h
+ * @brief Host stand-in for the lwIP error codes
+ */
+
+#ifndef TEST_STUB_LWIP_ERR_H
+#define TEST_STUB_LWIP_ERR_H
+
+#include <stdint.h>
+
+typedef uint8_t u8_t;
+typedef uint16_t u16_t;
+typedef int8_t err_t;
+
+#define ERR_OK 0
+#define ERR_MEM -1
+#define ERR_CONN -11
+#define ERR_ABRT -13
+#define ERR_RST -14
+
+#endif
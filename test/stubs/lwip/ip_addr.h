@@ -0,0 +1,19 @@
+/**
+ * @file ip_addr.h
+ * @brief Host stand-in for the lwIP IPv4 address type
+ */
+
+#ifndef TEST_STUB_LWIP_IP_ADDR_H
+#define TEST_STUB_LWIP_IP_ADDR_H
+
+#include <stdint.h>
+
+typedef struct {
+    uint32_t addr;
+} ip_addr_t;
+
+#define IPADDR_TYPE_ANY 46
+
+char *ipaddr_ntoa(const ip_addr_t *addr);
+
+#endif
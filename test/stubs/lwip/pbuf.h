@@ -0,0 +1,20 @@
+/**
+ * @file pbuf.h
+ * @brief Host stand-in for the lwIP packet buffer
+ */
+
+#ifndef TEST_STUB_LWIP_PBUF_H
+#define TEST_STUB_LWIP_PBUF_H
+
+#include "lwip/err.h"
+
+struct pbuf {
+    struct pbuf *next;
+    void *payload;
+    u16_t tot_len;
+    u16_t len;
+};
+
+u8_t pbuf_free(struct pbuf *p);
+
+#endif
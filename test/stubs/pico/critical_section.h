@@ -0,0 +1,25 @@
+/**
+ * @file critical_section.h
+ * @brief Host stand-in for the SDK critical section (single-threaded tests)
+ */
+
+#ifndef TEST_STUB_PICO_CRITICAL_SECTION_H
+#define TEST_STUB_PICO_CRITICAL_SECTION_H
+
+typedef struct {
+    int unused;
+} critical_section_t;
+
+static inline void critical_section_init(critical_section_t *cs) {
+    (void)cs;
+}
+
+static inline void critical_section_enter_blocking(critical_section_t *cs) {
+    (void)cs;
+}
+
+static inline void critical_section_exit(critical_section_t *cs) {
+    (void)cs;
+}
+
+#endif
@@ -0,0 +1,15 @@
+/**
+ * @file cyw43_arch.h
+ * @brief Host stand-in for the lwIP lock of the CYW43 driver (single-threaded tests)
+ */
+
+#ifndef TEST_STUB_PICO_CYW43_ARCH_H
+#define TEST_STUB_PICO_CYW43_ARCH_H
+
+static inline void cyw43_arch_lwip_begin(void) {
+}
+
+static inline void cyw43_arch_lwip_end(void) {
+}
+
+#endif
@@ -0,0 +1,20 @@
+/**
+ * @file stdlib.h
+ * @brief Host stand-in for the Pico SDK types the tested modules use
+ */
+
+#ifndef TEST_STUB_PICO_STDLIB_H
+#define TEST_STUB_PICO_STDLIB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+// Provided by the tests that need a clock
+absolute_time_t get_absolute_time(void);
+int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to);
+
+#endif
@@ -0,0 +1,11 @@
+/**
+ * @file reent.h
+ * @brief Host stand-in for newlib's reentrancy structure (app/mem_pool.c heap guard)
+ */
+
+#ifndef TEST_STUB_REENT_H
+#define TEST_STUB_REENT_H
+
+struct _reent;
+
+#endif
@@ -0,0 +1,508 @@
+/**
+ * @file test_mqtt5_shared_buf.c
+ * @brief Host test of shared payload lifetimes across MQTT 5 sessions (hal/mqtt5_client.c)
+ *
+ * The fake lwIP below keeps the payload pointers given to tcp_write()
+ * without copying them, as lwIP does, until the test acknowledges those
+ * bytes or the connection goes away. Every payload is filled from its
+ * publication number, so a block released early and handed out again is
+ * caught whenever lwIP could still (re)transmit it; no pointer lwIP holds
+ * may lie in a block on the pool's free list either. Once everything is
+ * acknowledged, every block must be back in the pool.
+ *
+ * Fixed scenarios walk each release path (TCP ACK, PUBACK, broker close,
+ * TCP reset, failed payload write, reconnection); a random walk then
+ * interleaves them on a QoS 1 and a QoS 0 session sharing the buffers.
+ */
+
+#include "mqtt5_client.c" // The lwIP callbacks are static
+#include <stdlib.h>
+
+#define STEPS 100000u
+#define POOL_BLOCKS 6
+#define PAYLOAD_MAX 48
+#define PCB_COUNT 6
+#define PCB_SEGMENTS 64
+#define TOPIC "pico_w/sensors/data"
+
+/* ========== FAKE LWIP ========== */
+
+/**
+ * @brief Payload bytes lwIP references (written without TCP_WRITE_FLAG_COPY)
+ */
+typedef struct {
+    const uint8_t *data;
+    uint16_t len;
+    uint32_t end;                  // Stream offset just past the bytes
+    uint32_t tag;                  // Publication the bytes must still hold
+} Segment;
+
+struct tcp_pcb {
+    bool in_use;
+    bool closed;                   // tcp_close(): lwIP still sends what is queued
+    void *arg;
+    tcp_recv_fn recv;
+    tcp_sent_fn sent;
+    tcp_err_fn err;
+    tcp_connected_fn connected;
+    uint32_t written;              // Stream bytes queued
+    uint32_t acked;
+    Segment segments[PCB_SEGMENTS];
+    int segment_count;
+};
+
+MEM_POOL_DEFINE(test_pool, SHARED_BUF_BLOCK_SIZE(PAYLOAD_MAX), POOL_BLOCKS);
+
+static struct tcp_pcb pcbs[PCB_COUNT];
+static uint64_t now_us = 1000000;
+static bool fail_payload_write;    // Next referenced write fails after its header
+static uint32_t rng = 0x2545F491u;
+
+static uint32_t failures;
+static uint32_t stale_reads;       // lwIP would have sent bytes of another publication
+static uint32_t freed_in_use;      // lwIP holds a pointer into a free block
+
+absolute_time_t get_absolute_time(void) {
+    return now_us;
+}
+
+int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) {
+    return (int64_t)(to - from);
+}
+
+char *ipaddr_ntoa(const ip_addr_t *addr) {
+    static char text[] = "192.0.2.1";
+    (void)addr;
+    return text;
+}
+
+u8_t pbuf_free(struct pbuf *p) {
+    (void)p; // Test pbufs live on the stack
+    return 1;
+}
+
+struct tcp_pcb *tcp_new_ip_type(u8_t type) {
+    (void)type;
+    for (int i = 0; i < PCB_COUNT; i++) {
+        if (!pcbs[i].in_use) {
+            pcbs[i] = (struct tcp_pcb){ .in_use = true };
+            return &pcbs[i];
+        }
+    }
+    return NULL;
+}
+
+void tcp_arg(struct tcp_pcb *pcb, void *arg) {
+    pcb->arg = arg;
+}
+
+void tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv) {
+    pcb->recv = recv;
+}
+
+void tcp_sent(struct tcp_pcb *pcb, tcp_sent_fn sent) {
+    pcb->sent = sent;
+}
+
+void tcp_poll(struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interval) {
+    (void)pcb;
+    (void)poll;
+    (void)interval;
+}
+
+void tcp_err(struct tcp_pcb *pcb, tcp_err_fn err) {
+    pcb->err = err;
+}
+
+void tcp_recved(struct tcp_pcb *pcb, u16_t len) {
+    (void)pcb;
+    (void)len;
+}
+
+err_t tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port, tcp_connected_fn connected) {
+    (void)ipaddr;
+    (void)port;
+    pcb->connected = connected;
+    return ERR_OK;
+}
+
+static uint32_t tag_of(const uint8_t *data) {
+    uint32_t tag;
+    memcpy(&tag, data, sizeof(tag));
+    return tag;
+}
+
+err_t tcp_write(struct tcp_pcb *pcb, const void *dataptr, u16_t len, u8_t apiflags) {
+    if (!(apiflags & TCP_WRITE_FLAG_COPY)) {
+        if (fail_payload_write) {
+            fail_payload_write = false;
+            return ERR_MEM;
+        }
+        if (pcb->segment_count == PCB_SEGMENTS) {
+            printf("segmentos esgotados no lwIP falso\n");
+            exit(EXIT_FAILURE);
+        }
+        pcb->segments[pcb->segment_count++] =
+            (Segment){ .data = dataptr, .len = len, .end = pcb->written + len, .tag = tag_of(dataptr) };
+    }
+    pcb->written += len;
+    return ERR_OK;
+}
+
+err_t tcp_output(struct tcp_pcb *pcb) {
+    (void)pcb;
+    return ERR_OK;
+}
+
+err_t tcp_close(struct tcp_pcb *pcb) {
+    pcb->closed = true;
+    pcb->in_use = pcb->acked != pcb->written;
+    return ERR_OK;
+}
+
+/**
+ * @brief Like lwIP: segments and pcb freed, then the error callback (if still set)
+ */
+static void drop_pcb(struct tcp_pcb *pcb, err_t reason) {
+    tcp_err_fn err = pcb->err;
+    void *arg = pcb->arg;
+    pcb->in_use = false;
+    pcb->segment_count = 0;
+    if (err != NULL) {
+        err(arg, reason);
+    }
+}
+
+void tcp_abort(struct tcp_pcb *pcb) {
+    drop_pcb(pcb, ERR_ABRT);
+}
+
+u16_t tcp_sndbuf(const struct tcp_pcb *pcb) {
+    uint32_t used = pcb->written - pcb->acked;
+    return used < 4096 ? (u16_t)(4096 - used) : 0;
+}
+
+u16_t tcp_sndqueuelen(const struct tcp_pcb *pcb) {
+    return (u16_t)pcb->segment_count;
+}
+
+/* ========== CHECKS ========== */
+
+#define CHECK(cond)                                                                 \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            printf("%s:%d: falhou: %s\n", __FILE__, __LINE__, #cond);               \
+            failures++;                                                             \
+        }                                                                           \
+    } while (0)
+
+static uint32_t random_below(uint32_t n) {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng % n;
+}
+
+static void fill(SharedBuf *buf, uint32_t tag, uint16_t len) {
+    memcpy(buf->data, &tag, sizeof(tag));
+    for (uint16_t i = sizeof(tag); i < len; i++) {
+        buf->data[i] = (uint8_t)(tag + i);
+    }
+    buf->len = len;
+}
+
+static bool intact(const Segment *seg) {
+    if (tag_of(seg->data) != seg->tag) {
+        return false;
+    }
+    for (uint16_t i = sizeof(seg->tag); i < seg->len; i++) {
+        if (seg->data[i] != (uint8_t)(seg->tag + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool in_free_block(const uint8_t *p) {
+    for (void *block = test_pool.free_list; block != NULL; block = *(void **)block) {
+        if (p >= (uint8_t *)block && p < (uint8_t *)block + test_pool.block_size) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Everything lwIP may still (re)transmit must be owned and unchanged
+ */
+static void check_segments(void) {
+    for (int i = 0; i < PCB_COUNT; i++) {
+        struct tcp_pcb *pcb = &pcbs[i];
+        for (int k = 0; pcb->in_use && k < pcb->segment_count; k++) {
+            const Segment *seg = &pcb->segments[k];
+            if (in_free_block(seg->data)) {
+                freed_in_use++;
+            } else if (!intact(seg)) {
+                stale_reads++;
+            }
+        }
+    }
+}
+
+/* ========== DRIVING THE SESSIONS ========== */
+
+/**
+ * @brief The peer acknowledges up to @p bytes; lwIP frees those segments
+ */
+static void ack(struct tcp_pcb *pcb, uint32_t bytes) {
+    uint32_t outstanding = pcb->written - pcb->acked;
+    if (!pcb->in_use || outstanding == 0) {
+        return;
+    }
+    bytes = bytes < outstanding ? bytes : outstanding;
+    pcb->acked += bytes;
+
+    int kept = 0;
+    for (int k = 0; k < pcb->segment_count; k++) {
+        const Segment *seg = &pcb->segments[k];
+        if ((int32_t)(seg->end - pcb->acked) > 0) {
+            pcb->segments[kept++] = *seg;
+        }
+    }
+    pcb->segment_count = kept;
+
+    if (pcb->closed) {
+        pcb->in_use = pcb->acked != pcb->written;
+    } else if (pcb->sent != NULL) {
+        pcb->sent(pcb->arg, pcb, (u16_t)bytes);
+    }
+}
+
+static void ack_all(Mqtt5Session *s) {
+    if (s->pcb != NULL) {
+        ack(s->pcb, s->pcb->written - s->pcb->acked);
+    }
+}
+
+static void feed(Mqtt5Session *s, const uint8_t *bytes, size_t len) {
+    struct pbuf p = { .payload = (void *)bytes, .tot_len = (u16_t)len, .len = (u16_t)len };
+    s->pcb->recv(s->pcb->arg, s->pcb, &p, ERR_OK);
+}
+
+static bool bring_up(Mqtt5Session *s) {
+    static const uint8_t connack[] = { 0x20, 0x06, 0x00, 0x00, 0x03, 0x22, 0x00, 0x0a }; // Topic Alias Max 10
+    ip_addr_t broker = { 0 };
+    if (!mqtt5_session_connect(s, &broker, 0)) {
+        return false;
+    }
+    s->pcb->connected(s->pcb->arg, s->pcb, ERR_OK);
+    feed(s, connack, sizeof(connack));
+    ack_all(s); // CONNECT
+    return mqtt5_session_is_up(s);
+}
+
+static void puback(Mqtt5Session *s, uint16_t packet_id) {
+    const uint8_t packet[] = { 0x40, 0x02, (uint8_t)(packet_id >> 8), (uint8_t)packet_id };
+    feed(s, packet, sizeof(packet));
+}
+
+/**
+ * @brief Packet ID of a QoS 1 payload still waiting for PUBACK (0 = none)
+ */
+static uint16_t pending_packet_id(const Mqtt5Session *s, bool random) {
+    uint16_t found = 0;
+    for (uint8_t i = 0; i < s->inflight_count; i++) {
+        uint16_t id = s->inflight[(s->inflight_head + i) % MQTT5_INFLIGHT].packet_id;
+        if (id != 0) {
+            found = id;
+            if (!random || random_below(2) == 0) {
+                break;
+            }
+        }
+    }
+    return found;
+}
+
+static void broker_close(Mqtt5Session *s) {
+    s->pcb->recv(s->pcb->arg, s->pcb, NULL, ERR_OK);
+}
+
+static void connection_reset(Mqtt5Session *s) {
+    drop_pcb(s->pcb, ERR_RST);
+}
+
+/**
+ * @brief Encode once, hand the buffer to every session, drop the producer's reference
+ */
+static SharedBuf *publish(Mqtt5Session *const *sessions, const uint8_t *qos, int count, bool *sent) {
+    static uint32_t tag;
+    SharedBuf *buf = shared_buf_alloc(&test_pool);
+    if (buf == NULL) {
+        return NULL;
+    }
+    fill(buf, ++tag, (uint16_t)(sizeof(tag) + random_below(PAYLOAD_MAX - sizeof(tag) + 1)));
+    for (int i = 0; i < count; i++) {
+        sent[i] = mqtt5_session_is_up(sessions[i]) && mqtt5_session_publish(sessions[i], TOPIC, buf, qos[i]);
+    }
+    shared_buf_release(buf);
+    return buf;
+}
+
+/* ========== SCENARIOS ========== */
+
+static Mqtt5Session cloud;         // QoS 1
+static Mqtt5Session edge;          // QoS 0
+static Mqtt5Session *const sessions[] = { &cloud, &edge };
+static const uint8_t qos[] = { 1, 0 };
+
+static void start_sessions(void) {
+    CHECK(bring_up(&cloud));
+    CHECK(bring_up(&edge));
+}
+
+/**
+ * @brief Every release path, one at a time
+ */
+static void fixed_scenarios(void) {
+    bool sent[2];
+
+    // Held until the last owner is done: edge TCP ACK, cloud TCP ACK, then PUBACK
+    start_sessions();
+    SharedBuf *buf = publish(sessions, qos, 2, sent);
+    CHECK(sent[0] && sent[1]);
+    CHECK(buf->refs == 2);
+    ack_all(&edge);
+    CHECK(buf->refs == 1);
+    ack_all(&cloud);
+    CHECK(buf->refs == 1);                         // Still waiting for PUBACK
+    check_segments();
+    now_us += 40000;
+    puback(&cloud, pending_packet_id(&cloud, false));
+    CHECK(test_pool.in_use == 0);
+    CHECK(cloud.stats.acknowledged == 1 && cloud.stats.puback_rtt_max_us == 40000);
+
+    // Broker closes with both payloads unacknowledged: aborted, released, QoS 1 counted lost
+    publish(sessions, qos, 2, sent);
+    broker_close(&cloud);
+    broker_close(&edge);
+    CHECK(test_pool.in_use == 0);
+    CHECK(cloud.stats.lost == 1);
+
+    // TCP reset: lwIP already dropped the segments, the session drops its references
+    start_sessions();
+    publish(sessions, qos, 2, sent);
+    connection_reset(&cloud);
+    CHECK(test_pool.in_use == 1);                  // Edge still sending it
+    check_segments();
+    ack_all(&edge);
+    CHECK(test_pool.in_use == 0);
+
+    // Payload write fails after its header: the stream is aborted, nothing kept
+    CHECK(bring_up(&cloud));
+    fail_payload_write = true;
+    publish(sessions, qos, 1, sent);
+    CHECK(!sent[0] && !mqtt5_session_is_up(&cloud));
+    CHECK(test_pool.in_use == 0);
+
+    // Reconnecting with a payload in flight aborts the old connection
+    CHECK(bring_up(&cloud));
+    publish(sessions, qos, 2, sent);
+    CHECK(bring_up(&cloud));
+    CHECK(test_pool.in_use == 1);
+    check_segments();
+    ack_all(&edge);
+    CHECK(test_pool.in_use == 0);
+
+    // Nothing in flight: a graceful close, lwIP keeps sending the DISCONNECT
+    publish(sessions, qos, 2, sent);
+    ack_all(&cloud);
+    ack_all(&edge);
+    puback(&cloud, pending_packet_id(&cloud, false));
+    CHECK(test_pool.in_use == 0);
+    CHECK(bring_up(&edge));
+    CHECK(stale_reads == 0 && freed_in_use == 0);
+}
+
+/**
+ * @brief Random interleaving of publications, ACKs, PUBACKs and connection losses
+ */
+static void random_walk(void) {
+    uint32_t published = 0;
+    for (uint32_t step = 0; step < STEPS; step++) {
+        Mqtt5Session *s = sessions[random_below(2)];
+        uint32_t op = random_below(100);
+        now_us += random_below(20000);
+
+        if (!mqtt5_session_is_up(s)) {
+            if (random_below(10) == 0) {
+                bring_up(s);
+            }
+        } else if (op < 35) {
+            bool sent[2];
+            published += publish(sessions, qos, 2, sent) != NULL;
+        } else if (op < 70) {
+            ack(s->pcb, 1 + random_below(160));
+        } else if (op < 88) {
+            uint16_t id = pending_packet_id(s, true);
+            if (id != 0) {
+                puback(s, id);
+            }
+        } else if (op < 91) {
+            broker_close(s);
+        } else if (op < 94) {
+            connection_reset(s);
+        } else if (op < 97) {
+            fail_payload_write = true;
+        } else {
+            bring_up(s);
+        }
+
+        // Closed connections drain in the background
+        for (int i = 0; i < PCB_COUNT; i++) {
+            if (pcbs[i].in_use && pcbs[i].closed) {
+                ack(&pcbs[i], random_below(80));
+            }
+        }
+        check_segments();
+    }
+    fail_payload_write = false;
+
+    // Drain: everything acknowledged, every QoS 1 payload PUBACKed
+    for (int round = 0; round < MQTT5_INFLIGHT + 1; round++) {
+        for (int i = 0; i < 2; i++) {
+            ack_all(sessions[i]);
+            uint16_t id = pending_packet_id(sessions[i], false);
+            if (id != 0) {
+                puback(sessions[i], id);
+            }
+        }
+        for (int i = 0; i < PCB_COUNT; i++) {
+            if (pcbs[i].in_use && pcbs[i].closed) {
+                ack(&pcbs[i], pcbs[i].written - pcbs[i].acked);
+            }
+        }
+    }
+    check_segments();
+    CHECK(test_pool.in_use == 0);
+    CHECK(published > STEPS / 10);
+    printf("%lu passos, %lu publicações, pool no pico %u/%u, %lu esgotamentos, %lu perdidas (QoS 1)\n",
+           (unsigned long)STEPS, (unsigned long)published, test_pool.high_water, test_pool.block_count,
+           (unsigned long)test_pool.exhausted, (unsigned long)cloud.stats.lost);
+}
+
+/* ========== MAIN ========== */
+
+int main(void) {
+    mem_pool_init(&test_pool);
+    mqtt5_session_init(&cloud, "nuvem", "test", NULL);
+    mqtt5_session_init(&edge, "local", "test", NULL);
+
+    fixed_scenarios();
+    random_walk();
+
+    printf("%lu verificações falharam, %lu leituras de payload alterado, %lu ponteiros em bloco livre\n",
+           (unsigned long)failures, (unsigned long)stale_reads, (unsigned long)freed_in_use);
+    bool ok = failures == 0 && stale_reads == 0 && freed_in_use == 0;
+    printf("%s\n", ok ? "OK" : "FALHOU");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,161 @@
+/**
+ * @file test_state_snapshot.c
+ * @brief Host stress test of the seqlock snapshot (app/state_snapshot.c)
+ *
+ * One writer publishes generations in which every field encodes the
+ * generation number; readers check that each copy they get is whole:
+ * - reader threads stand in for the other core;
+ * - a periodic SIGALRM handled on the writer thread stands in for an
+ *   interrupt that preempts the writer mid-publication. It must complete
+ *   without spinning (a single-copy seqlock would hang there).
+ */
+
+#include "state_snapshot.h"
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#define GENERATIONS 2000000u
+#define READERS 3
+
+/* ========== PRIVATE VARIABLES ========== */
+
+static volatile bool done;
+static volatile uint32_t torn;                 // Inconsistent copies seen
+static volatile uint32_t backwards;            // Generation went back for one reader
+static volatile uint32_t irq_reads;
+static volatile uint32_t irq_stale;            // Handler copies older than the latest generation
+
+/* ========== PRIVATE FUNCTIONS ========== */
+
+static void fill(uint32_t gen, SensorData *sensors, AlertStatus *alerts) {
+    float v = (float)gen;
+    *sensors = (SensorData){
+        .temperature = v, .humidity = v, .lux = v, .ph = v, .ec = v, .water_level = v,
+        .water_temperature = v, .chip_temperature = v, .flow_lpm = v, .flow_total_l = v,
+        .pump_rpm = v, .co2_ppm = v, .aht_ok = gen & 1, .co2_ok = gen & 1,
+    };
+    for (int i = 0; i < SHELF_COUNT; i++) {
+        sensors->shelves[i].temperature = v;
+        sensors->shelves[i].lux = v;
+    }
+    *alerts = (AlertStatus){ .temp_critical = gen & 1, .any_critical = gen & 1 };
+}
+
+/**
+ * @brief Whether @p s is one whole publication
+ */
+static bool consistent(const StateSnapshot *s) {
+    uint32_t gen = s->generation;
+    if (gen == 0) {
+        return true;
+    }
+    SensorData sensors;
+    AlertStatus alerts;
+    fill(gen, &sensors, &alerts);
+    const float *want = &sensors.temperature;
+    const float *got = &s->sensors.temperature;
+    for (int i = 0; i < 12; i++) { // temperature .. co2_ppm
+        if (got[i] != want[i]) {
+            return false;
+        }
+    }
+    for (int i = 0; i < SHELF_COUNT; i++) {
+        if (s->sensors.shelves[i].temperature != sensors.shelves[i].temperature ||
+            s->sensors.shelves[i].lux != sensors.shelves[i].lux) {
+            return false;
+        }
+    }
+    return s->sensors.aht_ok == sensors.aht_ok && s->sensors.co2_ok == sensors.co2_ok &&
+           s->alerts.temp_critical == alerts.temp_critical && s->alerts.any_critical == alerts.any_critical &&
+           s->timestamp == (absolute_time_t)gen * 1000;
+}
+
+static void *reader(void *arg) {
+    uint32_t last = 0;
+    uint64_t reads = 0;
+    while (!done) {
+        StateSnapshot s;
+        state_snapshot_read(&s);
+        if (!consistent(&s)) {
+            __atomic_fetch_add(&torn, 1, __ATOMIC_RELAXED);
+        }
+        if (s.generation < last) {
+            __atomic_fetch_add(&backwards, 1, __ATOMIC_RELAXED);
+        }
+        last = s.generation;
+        reads++;
+    }
+    *(uint64_t *)arg = reads;
+    return NULL;
+}
+
+/**
+ * @brief "Interrupt" on the writer's own thread, possibly mid-publication
+ */
+static void irq_handler(int sig) {
+    (void)sig;
+    uint32_t before = state_snapshot_generation();
+    StateSnapshot s;
+    state_snapshot_read(&s);
+    if (!consistent(&s)) {
+        torn++;
+    }
+    if (s.generation != before) {
+        irq_stale++; // The writer is stopped while we run: nothing newer can exist
+    }
+    irq_reads++;
+}
+
+/* ========== MAIN ========== */
+
+int main(void) {
+    state_snapshot_init();
+
+    // Readers never take the signal, so it always lands on the writer
+    sigset_t alarm;
+    sigemptyset(&alarm);
+    sigaddset(&alarm, SIGALRM);
+    pthread_sigmask(SIG_BLOCK, &alarm, NULL);
+    pthread_t threads[READERS];
+    uint64_t reads[READERS];
+    for (int i = 0; i < READERS; i++) {
+        pthread_create(&threads[i], NULL, reader, &reads[i]);
+    }
+    pthread_sigmask(SIG_UNBLOCK, &alarm, NULL);
+
+    struct sigaction sa = { .sa_handler = irq_handler };
+    sigaction(SIGALRM, &sa, NULL);
+    struct itimerval every = { .it_interval = { 0, 50 }, .it_value = { 0, 50 } };
+    setitimer(ITIMER_REAL, &every, NULL);
+
+    for (uint32_t gen = 1; gen <= GENERATIONS; gen++) {
+        SensorData sensors;
+        AlertStatus alerts;
+        fill(gen, &sensors, &alerts);
+        state_snapshot_publish(&sensors, &alerts, (absolute_time_t)gen * 1000);
+    }
+
+    struct itimerval off = { 0 };
+    setitimer(ITIMER_REAL, &off, NULL);
+    done = true;
+    uint64_t total = 0;
+    for (int i = 0; i < READERS; i++) {
+        pthread_join(threads[i], NULL);
+        total += reads[i];
+    }
+
+    StateSnapshot last;
+    bool published = state_snapshot_read(&last);
+    printf("%u generations, %llu thread reads, %lu interrupt reads: %lu torn, %lu backwards, "
+           "%lu stale interrupt reads\n",
+           GENERATIONS, (unsigned long long)total, (unsigned long)irq_reads, (unsigned long)torn,
+           (unsigned long)backwards, (unsigned long)irq_stale);
+
+    bool ok = published && last.generation == GENERATIONS && consistent(&last) && torn == 0 && backwards == 0 &&
+              irq_stale == 0 && irq_reads > 0;
+    printf("%s\n", ok ? "OK" : "FALHOU");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,381 @@
+#!/usr/bin/env python3
+"""
+coap_compare.py - CoAP client for the SMAVHIoT telemetry server and
+comparison with the MQTT path
+
+Subcommands:
+    observe    register on /sensores and /alertas and print notifications
+    historico  fetch the flash history block-wise and write it as CSV
+    compare    observe /sensores over CoAP while subscribed to
+               pico_w/sensors/data over MQTT, then report the bytes on the
+               wire per reading and how much later the same reading arrives
+               over MQTT; CoAP request round-trip times are sampled too
+
+Usage:
+    python3 tools/coap_compare.py observe 192.168.1.50
+    python3 tools/coap_compare.py historico 192.168.1.50 -o historico.csv --desde 1200
+    python3 tools/coap_compare.py compare 192.168.1.50 --broker 192.168.1.10 --duration 600
+
+The CoAP side uses only the standard library; compare needs paho-mqtt.
+Run it on the same local network as the board for meaningful numbers.
+"""
+
+import argparse
+import csv
+import os
+import random
+import re
+import socket
+import statistics
+import struct
+import sys
+import threading
+import time
+
+COAP_PORT = 5683
+CON, NON, ACK, RST = 0, 1, 2, 3
+GET = 0x01
+CONTENT = 0x45
+
+OPT_ETAG, OPT_OBSERVE, OPT_URI_PATH, OPT_CONTENT_FORMAT = 4, 6, 11, 12
+OPT_URI_QUERY, OPT_BLOCK2, OPT_SIZE2 = 15, 23, 28
+
+IP_UDP_HEADERS = 28
+IP_TCP_HEADERS = 40
+
+# FlashLogRecord (include/flash_log.h): 16 bytes, little-endian
+RECORD = struct.Struct("<IIhHHBB")
+RECORD_FIELDS = ["seq", "time_s", "temperature", "humidity", "lux", "flags", "crc"]
+FLAG_WALL_CLOCK = 0x80
+
+
+def crc8(data):
+    """CRC-8 (poly 0x07), as used by the flash log."""
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+# ---------------------------------------------------------------- CoAP codec
+
+def encode_option_part(value):
+    if value < 13:
+        return value, b""
+    if value < 269:
+        return 13, bytes([value - 13])
+    return 14, struct.pack(">H", value - 269)
+
+
+def encode_uint(value):
+    out = b""
+    while value:
+        out = bytes([value & 0xFF]) + out
+        value >>= 8
+    return out
+
+
+def encode(mtype, code, mid, token=b"", options=(), payload=b""):
+    """Build a CoAP message; options are (number, bytes) pairs."""
+    msg = bytearray([(1 << 6) | (mtype << 4) | len(token), code]) + struct.pack(">H", mid) + token
+    last = 0
+    for number, value in sorted(options, key=lambda o: o[0]):
+        delta, delta_ext = encode_option_part(number - last)
+        length, length_ext = encode_option_part(len(value))
+        msg += bytes([(delta << 4) | length]) + delta_ext + length_ext + value
+        last = number
+    if payload:
+        msg += b"\xff" + payload
+    return bytes(msg)
+
+
+def decode(data):
+    """Return (type, code, mid, token, {option: [values]}, payload)."""
+    if len(data) < 4 or data[0] >> 6 != 1:
+        raise ValueError("not a CoAP message")
+    mtype = (data[0] >> 4) & 3
+    tkl = data[0] & 0x0F
+    code = data[1]
+    mid = struct.unpack(">H", data[2:4])[0]
+    token = data[4:4 + tkl]
+    pos = 4 + tkl
+    options = {}
+    number = 0
+    while pos < len(data) and data[pos] != 0xFF:
+        first = data[pos]
+        pos += 1
+        parts = []
+        for nibble in (first >> 4, first & 0x0F):
+            if nibble == 13:
+                parts.append(13 + data[pos])
+                pos += 1
+            elif nibble == 14:
+                parts.append(269 + struct.unpack(">H", data[pos:pos + 2])[0])
+                pos += 2
+            else:
+                parts.append(nibble)
+        number += parts[0]
+        options.setdefault(number, []).append(data[pos:pos + parts[1]])
+        pos += parts[1]
+    payload = data[pos + 1:] if pos < len(data) else b""
+    return mtype, code, mid, token, options, payload
+
+
+def uint_option(options, number, default=None):
+    values = options.get(number)
+    return int.from_bytes(values[0], "big") if values else default
+
+
+def path_options(path):
+    return [(OPT_URI_PATH, seg.encode()) for seg in path.strip("/").split("/") if seg]
+
+
+# ---------------------------------------------------------------- CoAP client
+
+class CoapClient:
+    """Minimal CoAP endpoint: confirmable requests, Observe, block-wise GET."""
+
+    def __init__(self, host, port=COAP_PORT, timeout=2.0):
+        self.addr = (socket.gethostbyname(host), port)
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.settimeout(timeout)
+        self.mid = random.randrange(0x10000)
+        self.bytes_out = 0
+        self.bytes_in = 0
+
+    def next_mid(self):
+        self.mid = (self.mid + 1) & 0xFFFF
+        return self.mid
+
+    def send(self, msg):
+        self.sock.sendto(msg, self.addr)
+        self.bytes_out += len(msg) + IP_UDP_HEADERS
+
+    def receive(self):
+        data, _ = self.sock.recvfrom(2048)
+        self.bytes_in += len(data) + IP_UDP_HEADERS
+        return data
+
+    def request(self, path, options=(), retries=4):
+        """Confirmable GET; returns (code, options, payload, rtt_s)."""
+        token = os.urandom(4)
+        mid = self.next_mid()
+        msg = encode(CON, GET, mid, token, list(options) + path_options(path))
+        for attempt in range(retries + 1):
+            start = time.monotonic()
+            self.send(msg)
+            try:
+                while True:
+                    mtype, code, rmid, rtoken, ropts, payload = decode(self.receive())
+                    if mtype == ACK and rmid == mid and rtoken == token:
+                        return code, ropts, payload, time.monotonic() - start
+                    if mtype == CON:
+                        self.send(encode(ACK, 0, rmid))  # Stray notification
+            except socket.timeout:
+                continue
+        raise TimeoutError(f"no answer from {self.addr[0]} for /{path}")
+
+    def get_blockwise(self, path, query=(), szx=5):
+        """Fetch a whole Block2 resource; returns (payload, etag)."""
+        body = bytearray()
+        etag = None
+        num = 0
+        while True:
+            opts = [(OPT_URI_QUERY, q.encode()) for q in query]
+            opts.append((OPT_BLOCK2, encode_uint((num << 4) | szx)))
+            code, ropts, payload, _ = self.request(path, opts)
+            if code != CONTENT:
+                raise RuntimeError(f"/{path}: code {code >> 5}.{code & 31:02d}")
+            tag = ropts.get(OPT_ETAG, [None])[0]
+            if etag is not None and tag != etag:
+                raise RuntimeError("history wrapped during the transfer (ETag changed), retry")
+            etag = tag
+            body += payload
+            block = uint_option(ropts, OPT_BLOCK2, 0)
+            if not block & 0x08:
+                return bytes(body), etag
+            szx = block & 0x07
+            num = (block >> 4) + 1
+
+    def observe(self, path, token):
+        self.send(encode(CON, GET, self.next_mid(), token,
+                         [(OPT_OBSERVE, b"")] + path_options(path)))
+
+    def cancel(self, path, token):
+        self.send(encode(NON, GET, self.next_mid(), token,
+                         [(OPT_OBSERVE, b"\x01")] + path_options(path)))
+
+    def notifications(self):
+        """Yield (token, observe_seq, confirmable, payload, wire_bytes); ACKs CONs."""
+        while True:
+            try:
+                data = self.receive()
+            except socket.timeout:
+                yield None
+                continue
+            mtype, code, mid, token, options, payload = decode(data)
+            if mtype == CON:
+                self.send(encode(ACK, 0, mid))
+            if code == CONTENT:
+                yield (token, uint_option(options, OPT_OBSERVE), mtype == CON, payload,
+                       len(data) + IP_UDP_HEADERS)
+
+
+# ---------------------------------------------------------------- subcommands
+
+def cmd_observe(args):
+    client = CoapClient(args.host)
+    tokens = {os.urandom(4): "sensores", os.urandom(4): "alertas"}
+    for token, path in tokens.items():
+        client.observe(path, token)
+    try:
+        for note in client.notifications():
+            if note is None:
+                continue
+            token, seq, confirmable, payload, size = note
+            print(f"{time.strftime('%H:%M:%S')} /{tokens.get(token, '?')} #{seq} "
+                  f"{'CON' if confirmable else 'NON'} {size} B: {payload.decode(errors='replace')}")
+    except KeyboardInterrupt:
+        for token, path in tokens.items():
+            client.cancel(path, token)
+
+
+def cmd_historico(args):
+    client = CoapClient(args.host)
+    query = [f"desde={args.desde}"] if args.desde is not None else []
+    start = time.monotonic()
+    body, etag = client.get_blockwise("historico", query, args.szx)
+    elapsed = time.monotonic() - start
+
+    bad = 0
+    with open(args.output, "w", newline="") as f:
+        writer = csv.writer(f)
+        writer.writerow(["seq", "time_s", "wall_clock", "temperature", "humidity", "lux", "flags"])
+        for off in range(0, len(body) - len(body) % RECORD.size, RECORD.size):
+            raw = body[off:off + RECORD.size]
+            seq, time_s, temp, hum, lux, flags, crc = RECORD.unpack(raw)
+            if crc8(raw[:-1]) != crc:
+                bad += 1
+                continue
+            writer.writerow([seq, time_s, int(bool(flags & FLAG_WALL_CLOCK)),
+                             temp / 100, hum / 100, lux, flags])
+
+    records = len(body) // RECORD.size
+    print(f"{records} registros ({bad} com CRC inválido) em {elapsed:.1f} s, "
+          f"{client.bytes_in + client.bytes_out} B no fio -> {args.output}")
+
+
+READING_KEYS = ("temperatura", "umidade", "luminosidade", "ph", "ec")
+
+
+def reading_key(payload):
+    """Values identifying one acquisition, from either JSON (MQTT prints nan)."""
+    text = payload.decode(errors="replace")
+    values = []
+    for key in READING_KEYS:
+        m = re.search(rf'"{key}"\s*:\s*(-?[0-9.]+|nan|null)', text)
+        values.append(float(m.group(1)) if m and m.group(1) not in ("nan", "null") else None)
+    return tuple(values)
+
+
+def summary(values, unit, scale=1.0):
+    if not values:
+        return "sem dados"
+    values = sorted(v * scale for v in values)
+    p95 = values[min(len(values) - 1, int(len(values) * 0.95))]
+    return f"mediana {statistics.median(values):.1f} {unit}, p95 {p95:.1f} {unit}, n={len(values)}"
+
+
+def cmd_compare(args):
+    import paho.mqtt.client as mqtt
+
+    client = CoapClient(args.host)
+    token = os.urandom(4)
+    coap_seen = {}      # reading key -> arrival time
+    coap_sizes = []
+    mqtt_sizes = []
+    delays = []
+    lock = threading.Lock()
+
+    def on_message(_client, _userdata, msg):
+        now = time.monotonic()
+        # PUBLISH QoS 0: fixed header (2-5 B) + topic length (2) + topic + payload
+        remaining = 2 + len(msg.topic) + len(msg.payload)
+        header = 2 if remaining < 128 else 3 if remaining < 16384 else 4
+        with lock:
+            mqtt_sizes.append(header + remaining + IP_TCP_HEADERS)
+            seen = coap_seen.get(reading_key(msg.payload))
+            if seen is not None:
+                delays.append(now - seen)
+
+    sub = mqtt.Client()
+    sub.on_message = on_message
+    sub.connect(args.broker, args.broker_port)
+    sub.subscribe("pico_w/sensors/data")
+    sub.loop_start()
+
+    rtts = []
+    client.observe("sensores", token)
+    deadline = time.monotonic() + args.duration
+    next_ping = time.monotonic()
+    notes = client.notifications()
+    try:
+        while time.monotonic() < deadline:
+            note = next(notes)
+            if note is not None and note[0] == token:
+                with lock:
+                    coap_seen.setdefault(reading_key(note[3]), time.monotonic())
+                    coap_sizes.append(note[4])
+            if time.monotonic() >= next_ping:
+                next_ping += args.rtt_interval
+                try:
+                    rtts.append(client.request("sensores")[3])
+                except TimeoutError:
+                    pass
+    except KeyboardInterrupt:
+        pass
+    client.cancel("sensores", token)
+    sub.loop_stop()
+
+    print(f"CoAP: {len(coap_sizes)} notificações, {summary(coap_sizes, 'B')} por leitura no fio")
+    print(f"MQTT: {len(mqtt_sizes)} mensagens, {summary(mqtt_sizes, 'B')} por leitura no fio "
+          f"(sem ACKs TCP nem PINGREQ)")
+    print(f"RTT CoAP GET /sensores: {summary(rtts, 'ms', 1000)}")
+    print(f"Mesma leitura via MQTT depois da CoAP: {summary(delays, 'ms', 1000)}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("observe", help="acompanhar /sensores e /alertas")
+    p.add_argument("host")
+    p.set_defaults(func=cmd_observe)
+
+    p = sub.add_parser("historico", help="baixar o histórico (block-wise) para CSV")
+    p.add_argument("host")
+    p.add_argument("-o", "--output", default="historico.csv")
+    p.add_argument("--desde", type=int, help="primeiro número de sequência")
+    p.add_argument("--szx", type=int, default=5, choices=range(7), help="bloco = 16 << szx bytes")
+    p.set_defaults(func=cmd_historico)
+
+    p = sub.add_parser("compare", help="comparar bytes e latência com o MQTT")
+    p.add_argument("host")
+    p.add_argument("--broker", required=True)
+    p.add_argument("--broker-port", type=int, default=1883)
+    p.add_argument("--duration", type=float, default=300, help="segundos")
+    p.add_argument("--rtt-interval", type=float, default=5, help="segundos entre GETs de RTT")
+    p.set_defaults(func=cmd_compare)
+
+    args = parser.parse_args()
+    try:
+        args.func(args)
+    except (OSError, RuntimeError, TimeoutError) as e:
+        print(f"erro: {e}", file=sys.stderr)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,236 @@
+#!/usr/bin/env python3
+"""
+fleet_sim.py - Broker load of a SMAVHIoT rack after a site-wide power restore
+
+Simulates N boards that power up at the same moment and reports the burst
+seen by the broker (messages per 100 ms bin, CONNECTs per second) for the
+three publish schedules of app/fleet_stagger.c:
+
+    lockstep  FLEET_STAGGER_ENABLED 0: timers one period after boot
+    id        FLEET_STAGGER_ENABLED 1: phase hashed from the board ID
+    slot      FLEET_SLOT_ASSIGNMENT: slot i of N assigned by the broker
+
+Each board runs the MQTT 5 build (mqtt_fanout.c) with the edge broker opted in
+(MQTT_EDGE_ENABLED 1):
+
+    cloud broker  sensor data from mqtt_fanout_poll() every MQTT_PUBLISH_INTERVAL_MS,
+                  control status every MQTT_PUBLISH_INTERVAL_MS, alerts every
+                  MQTT_ALERT_INTERVAL_MS and one batch every UPLINK_FLUSH_INTERVAL_MS
+    edge broker   sensor data at every acquisition (MQTT_EDGE_SAMPLE_INTERVAL_MS 0),
+                  control status and alerts
+
+The cloud session seeds its sample deadline with fleet_stagger_deadline() when
+mqtt_setup() starts it, before the wall clock is known, and skips the
+deadlines that fall due while the session is down. The other jobs are timers
+of the main loop, seeded once it starts.
+Boot and Wi-Fi association times vary a little per board, crystals drift by
+up to --ppm, and the cloud broker restarts at --restart-s (every session drops
+and reconnects after MQTT_FANOUT_RECONNECT_MS, fixed or randomized, checked at
+each 2 s acquisition like mqtt_fanout_sample()).
+
+Usage:
+    python3 tools/fleet_sim.py                      # 40 boards, 10 minutes
+    python3 tools/fleet_sim.py --boards 200 --duration-s 3600
+    python3 tools/fleet_sim.py --csv carga.csv      # Per-bin load of every mode and broker
+
+No dependencies beyond the standard library.
+"""
+
+import argparse
+import random
+
+# Defaults from include/app_config.h
+PUBLISH_MS = 10000
+ALERT_MS = 30000
+UPLINK_MS = 60000
+SENSOR_MS = 2000
+RECONNECT_MS = 15000
+CONNECT_SPREAD_MS = 3000
+BOOT_MS = 3000  # sleep_ms(3000) in setup
+SNTP_MS = 1000  # First SNTP answer after mqtt_conect_init()
+
+
+def hash_id(board_id):
+    """Same as hash_id() in app/fleet_stagger.c: FNV-1a + murmur3 finalizer."""
+    h = 2166136261
+    for b in board_id:
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    h ^= h >> 16
+    h = (h * 0x85EBCA6B) & 0xFFFFFFFF
+    h ^= h >> 13
+    h = (h * 0xC2B2AE35) & 0xFFFFFFFF
+    h ^= h >> 16
+    return h
+
+
+class Board:
+    def __init__(self, index, rng, args):
+        # Unique IDs of one flash batch share most bytes
+        self.board_id = bytes([0xE6, 0x61, 0x41, 0x04, 0x03]) + rng.randbytes(3)
+        self.drift = 1 + rng.uniform(-args.ppm, args.ppm) * 1e-6
+        self.boot = rng.uniform(0, args.boot_jitter_ms)
+        self.ready = self.boot + BOOT_MS + args.wifi_ms + rng.uniform(0, args.wifi_jitter_ms)
+        self.index = index
+
+    def phase(self, mode, boards):
+        """Fraction of the period, as fleet_stagger_deadline() uses it."""
+        if mode == "id":
+            return hash_id(self.board_id) / 2**32
+        if mode == "slot":
+            return self.index / boards
+        return None
+
+
+def first_deadline(board, mode, period, boards):
+    phase = board.phase(mode, boards)
+    if phase is None:
+        return board.ready + period
+    if mode == "slot":
+        # Slots are counted from the wall clock (SNTP), common to the rack
+        offset = phase * period
+        return board.ready + (offset - board.ready) % period
+    return board.ready + phase * period
+
+
+def periodic(start, period, drift, until):
+    t = start
+    while t < until:
+        yield t
+        t += period * drift
+
+
+def stagger_deadline(board, mode, period, boards, now, wall_clock):
+    """fleet_stagger_deadline(period) called at @now."""
+    phase = board.phase(mode, boards)
+    if phase is None:
+        return now + period
+    offset = phase * period
+    if wall_clock or mode == "slot":
+        # Counted from the epoch (simulation time is common to the rack);
+        # the slot arrives right after the connection and re-arms the job
+        return now + (offset - now) % period
+    return now + offset
+
+
+def fanout_samples(board, mode, boards, connect, restart, reconnect, until):
+    """Deadlines of the cloud session in mqtt_fanout_poll()."""
+    t = stagger_deadline(board, mode, PUBLISH_MS, boards, connect, False)
+    for t in periodic(t, PUBLISH_MS, board.drift, until):
+        if not restart <= t < reconnect:
+            yield t  # Skipped while the session is down
+
+
+def simulate(mode, args, rng):
+    boards = [Board(i, rng, args) for i in range(args.boards)]
+    stagger = mode != "lockstep"
+    until = args.duration_s * 1000
+    restart = args.restart_s * 1000
+    cloud = []
+    edge = []
+    connects = []
+
+    for b in boards:
+        connect = b.ready + (rng.uniform(0, CONNECT_SPREAD_MS) if stagger else 0)
+        connects.append(connect)
+
+        # Broker restart: reconnect at the first acquisition after the back-off
+        back_off = RECONNECT_MS * (rng.uniform(0.5, 1.5) if stagger else 1)
+        due = restart + back_off
+        ticks = (due - b.ready) / (SENSOR_MS * b.drift)
+        reconnect = b.ready + max(0, -(-ticks // 1)) * SENSOR_MS * b.drift
+        if restart < until:
+            connects.append(reconnect)
+
+        cloud.extend(fanout_samples(b, mode, args.boards, connect, restart, reconnect, until))
+        for t in periodic(b.ready + SENSOR_MS * b.drift, SENSOR_MS, b.drift, until):
+            if t >= connect:
+                edge.append(t)
+
+        for period, to_edge in ((PUBLISH_MS, True), (ALERT_MS, True), (UPLINK_MS, False)):
+            start = first_deadline(b, mode, period, args.boards)
+            for t in periodic(start, period, b.drift, until):
+                if t < connect:
+                    continue
+                if to_edge:
+                    edge.append(t)
+                if not restart <= t < reconnect:
+                    cloud.append(t)  # Outbox retries are not modelled
+
+    return cloud, edge, connects
+
+
+def bins(times, width_ms, duration_ms):
+    counts = [0] * (int(duration_ms // width_ms) + 1)
+    for t in times:
+        if 0 <= t < duration_ms:
+            counts[int(t // width_ms)] += 1
+    return counts
+
+
+def summarize(mode, messages, connects, args):
+    duration = args.duration_s * 1000
+    load = bins(messages, args.bin_ms, duration)
+    settled = load[int(60000 // args.bin_ms):]  # After the boot transient
+    mean = sum(settled) / len(settled) if settled else 0
+    peak = max(settled) if settled else 0
+    ordered = sorted(settled)
+    p99 = ordered[int(len(ordered) * 0.99)] if ordered else 0
+    idle = sum(1 for c in settled if c == 0) / len(settled) if settled else 0
+    conn = bins(connects, 1000, duration)
+    return {
+        "mode": mode,
+        "mean": mean,
+        "peak": peak,
+        "p99": p99,
+        "ratio": peak / mean if mean else 0,
+        "idle": idle,
+        "conn_peak": max(conn),
+        "load": load,
+    }
+
+
+def print_table(title, results, connects=True):
+    print(title)
+    print(f"{'modo':<10}{'média':>8}{'pico':>7}{'p99':>6}{'pico/média':>12}{'ociosos':>9}"
+          + (f"{'CONNECT/s':>11}" if connects else ""))
+    for r in results:
+        print(f"{r['mode']:<10}{r['mean']:>8.2f}{r['peak']:>7}{r['p99']:>6}{r['ratio']:>12.1f}"
+              f"{r['idle']:>8.0%}" + (f"{r['conn_peak']:>11}" if connects else ""))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--boards", type=int, default=40)
+    parser.add_argument("--duration-s", type=int, default=600)
+    parser.add_argument("--restart-s", type=int, default=300, help="Reinício do broker")
+    parser.add_argument("--bin-ms", type=int, default=100)
+    parser.add_argument("--boot-jitter-ms", type=float, default=50)
+    parser.add_argument("--wifi-ms", type=float, default=2500, help="Associação + DHCP")
+    parser.add_argument("--wifi-jitter-ms", type=float, default=400)
+    parser.add_argument("--ppm", type=float, default=20, help="Desvio máximo do cristal")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--csv", metavar="ARQUIVO", help="Carga por intervalo de cada modo")
+    args = parser.parse_args()
+
+    cloud_results = []
+    edge_results = []
+    for mode in ("lockstep", "id", "slot"):
+        cloud, edge, connects = simulate(mode, args, random.Random(args.seed))
+        cloud_results.append(summarize(mode, cloud, connects, args))
+        edge_results.append(summarize(mode, edge, connects, args))
+
+    print(f"{args.boards} placas, {args.duration_s} s, intervalos de {args.bin_ms} ms "
+          f"(broker reiniciado em {args.restart_s} s)")
+    print_table("broker da nuvem", cloud_results)
+    print_table("broker local (toda aquisição)", edge_results, connects=False)
+
+    if args.csv:
+        with open(args.csv, "w") as f:
+            f.write("t_ms," + ",".join(r["mode"] for r in cloud_results)
+                    + "," + ",".join(r["mode"] + "_local" for r in edge_results) + "\n")
+            loads = [r["load"] for r in cloud_results + edge_results]
+            for i, row in enumerate(zip(*loads)):
+                f.write(f"{i * args.bin_ms}," + ",".join(map(str, row)) + "\n")
+
+if __name__ == "__main__":
+    main()
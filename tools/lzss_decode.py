@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""
+lzss_decode.py - Host decoder for LZSS-compressed SMAVHIoT uplink batches
+
+Batches sent with UPLINK_MQTT_COMPRESS start with a 6-byte header
+(0x1F 'Z' window_bits lookahead_bits raw_len_be16, see include/lzss.h)
+followed by a heatshrink bitstream. Plain batches pass through unchanged,
+so the output is always InfluxDB line protocol.
+
+Usage:
+    python3 tools/lzss_decode.py lote.bin                 # file(s) to stdout
+    python3 tools/lzss_decode.py --mqtt 192.168.1.10      # live, from pico_w/sensors/batch
+    python3 tools/lzss_decode.py --mqtt 192.168.1.10 | telegraf --config bridge.conf
+
+Requires paho-mqtt for --mqtt.
+"""
+
+import argparse
+import sys
+
+MAGIC = b"\x1fZ"
+HEADER_SIZE = 6
+TOPIC = "pico_w/sensors/batch"
+
+
+class BitReader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0  # In bits
+
+    def remaining(self):
+        return len(self.data) * 8 - self.pos
+
+    def read(self, count):
+        value = 0
+        for _ in range(count):
+            byte = self.data[self.pos >> 3]
+            value = (value << 1) | ((byte >> (7 - (self.pos & 7))) & 1)
+            self.pos += 1
+        return value
+
+
+def decompress(payload):
+    """Decode one batch; plain (uncompressed) batches are returned as-is."""
+    if not payload.startswith(MAGIC):
+        return payload
+    if len(payload) < HEADER_SIZE:
+        raise ValueError("cabeçalho truncado")
+    window_bits, lookahead_bits = payload[2], payload[3]
+    raw_len = int.from_bytes(payload[4:6], "big")
+    bits = BitReader(payload[HEADER_SIZE:])
+    out = bytearray()
+
+    while len(out) < raw_len:
+        if bits.remaining() < 1:
+            break
+        if bits.read(1):
+            if bits.remaining() < 8:
+                break
+            out.append(bits.read(8))
+        else:
+            if bits.remaining() < window_bits + lookahead_bits:
+                break  # Zero padding at the end
+            distance = bits.read(window_bits) + 1
+            length = bits.read(lookahead_bits) + 1
+            if distance > len(out):
+                raise ValueError("referência antes do início do lote")
+            for _ in range(length):
+                out.append(out[-distance])
+
+    if len(out) != raw_len:
+        raise ValueError(f"tamanho {len(out)} != {raw_len} do cabeçalho")
+    return bytes(out)
+
+
+def decode_files(paths):
+    for path in paths:
+        with open(path, "rb") as f:
+            sys.stdout.buffer.write(decompress(f.read()))
+    sys.stdout.flush()
+
+
+def decode_mqtt(host, port, topic):
+    import paho.mqtt.client as mqtt
+
+    stats = {"batches": 0, "wire": 0, "raw": 0}
+
+    def on_message(client, userdata, msg):
+        try:
+            lines = decompress(msg.payload)
+        except ValueError as e:
+            print(f"lote inválido: {e}", file=sys.stderr)
+            return
+        stats["batches"] += 1
+        stats["wire"] += len(msg.payload)
+        stats["raw"] += len(lines)
+        sys.stdout.buffer.write(lines)
+        sys.stdout.flush()
+        print(f"lote {stats['batches']}: {len(msg.payload)} -> {len(lines)} bytes "
+              f"(total {stats['raw'] / stats['wire']:.2f}:1)", file=sys.stderr)
+
+    client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION2, protocol=mqtt.MQTTv5)
+    client.on_connect = lambda c, u, f, rc, p=None: c.subscribe(topic, qos=1)
+    client.on_message = on_message
+    client.connect(host, port)
+    client.loop_forever()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("files", nargs="*", help="Lotes salvos (um por arquivo)")
+    parser.add_argument("--mqtt", metavar="BROKER", help="Assinar o tópico de lotes neste broker")
+    parser.add_argument("--port", type=int, default=1883)
+    parser.add_argument("--topic", default=TOPIC)
+    args = parser.parse_args()
+
+    if args.mqtt:
+        decode_mqtt(args.mqtt, args.port, args.topic)
+    elif args.files:
+        decode_files(args.files)
+    else:
+        sys.stdout.buffer.write(decompress(sys.stdin.buffer.read()))
+
+
+if __name__ == "__main__":
+    main()
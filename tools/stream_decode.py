@@ -0,0 +1,231 @@
+#!/usr/bin/env python3
+"""
+stream_decode.py - Host decoder for the SMAVHIoT binary USB stream
+
+Puts the Pico W in binary streaming mode, decodes the CRC-checked sample
+frames (layout in include/usb_stream.h) and writes them to CSV or Parquet.
+Dropped frames are detected from gaps in the sequence number. Both frame
+types are accepted: 60-byte frames with the nutrient probes (type 2) and
+the 42-byte frames of earlier firmware (type 1, probe columns left empty).
+
+Usage:
+    python3 tools/stream_decode.py /dev/ttyACM0 -o amostras.csv
+    python3 tools/stream_decode.py COM3 -o amostras.parquet --duration 600
+    python3 tools/stream_decode.py captura.bin -o amostras.csv   # raw capture file
+
+Requires pyserial for live ports and pyarrow for Parquet output.
+"""
+
+import argparse
+import csv
+import os
+import struct
+import sys
+import time
+
+SYNC = b"\xAA\x55"
+TYPE_SAMPLE_V1 = 0x01
+TYPE_SAMPLE = 0x02
+CMD_START = b"S"
+CMD_STOP = b"X"
+
+# Frame after the sync bytes: type, length, seq, timestamp, raw codes, flags,
+# reserved, converted values, [probe codes, probe values,] crc
+# (little-endian, see include/usb_stream.h)
+FRAMES = {
+    TYPE_SAMPLE_V1: struct.Struct("<BBIQIIHBBfffH"),
+    TYPE_SAMPLE: struct.Struct("<BBIQIIHBBfffHHHfffH"),
+}
+
+FIELDS = ["seq", "timestamp_us", "raw_temp", "raw_humidity", "raw_lux",
+          "aht_ok", "lux_ok", "temperature", "humidity", "lux",
+          "raw_ph", "raw_ec", "raw_level", "probes_ok", "ph", "ec", "level"]
+
+
+def crc16_ccitt(data, crc=0xFFFF):
+    """CRC-16/CCITT-FALSE, same as the firmware."""
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+class Decoder:
+    """Incremental frame decoder with resynchronisation and loss accounting."""
+
+    def __init__(self):
+        self.buffer = bytearray()
+        self.frames = 0
+        self.crc_errors = 0
+        self.dropped = 0
+        self.last_seq = None
+
+    def feed(self, data):
+        """Consume received bytes and return the decoded sample rows."""
+        self.buffer += data
+        rows = []
+
+        while True:
+            start = self.buffer.find(SYNC)
+            if start < 0:
+                # Keep a trailing 0xAA: it may be the first half of the next sync
+                del self.buffer[:max(0, len(self.buffer) - 1)]
+                break
+            if len(self.buffer) - start < len(SYNC) + 1:
+                del self.buffer[:start]
+                break
+            frame = FRAMES.get(self.buffer[start + len(SYNC)])
+            end = start + len(SYNC) + (frame.size if frame else 0)
+            if frame is not None and len(self.buffer) < end:
+                del self.buffer[:start]
+                break
+
+            fields = None
+            if frame is not None:
+                body = bytes(self.buffer[start + len(SYNC):end])
+                fields = frame.unpack(body)
+            if fields is None or crc16_ccitt(body[:-2]) != fields[-1]:
+                # Console text or a corrupted frame: skip this sync and rescan
+                self.crc_errors += 1
+                del self.buffer[:start + 1]
+                continue
+            del self.buffer[:end]
+
+            (_, _, seq, timestamp, raw_temp, raw_hum, raw_lux, flags, _,
+             temperature, humidity, lux) = fields[:12]
+            if fields[0] == TYPE_SAMPLE:
+                probes = fields[12:15] + (int(bool(flags & 4)),) + fields[15:18]
+            else:
+                probes = (None,) * 7
+
+            if self.last_seq is not None and seq > self.last_seq + 1:
+                self.dropped += seq - self.last_seq - 1
+            self.last_seq = seq
+            self.frames += 1
+
+            rows.append((seq, timestamp, raw_temp, raw_hum, raw_lux,
+                         int(bool(flags & 1)), int(bool(flags & 2)),
+                         temperature, humidity, lux) + probes)
+        return rows
+
+
+class CsvWriter:
+    def __init__(self, path):
+        self.file = open(path, "w", newline="")
+        self.writer = csv.writer(self.file)
+        self.writer.writerow(FIELDS)
+
+    def write(self, rows):
+        self.writer.writerows(rows)
+
+    def close(self):
+        self.file.close()
+
+
+class ParquetWriter:
+    """Buffers rows and writes one Parquet row group per batch."""
+
+    BATCH_ROWS = 10000
+
+    def __init__(self, path):
+        import pyarrow as pa
+        import pyarrow.parquet as pq
+        self.pa = pa
+        self.schema = pa.schema([
+            ("seq", pa.uint32()), ("timestamp_us", pa.uint64()),
+            ("raw_temp", pa.uint32()), ("raw_humidity", pa.uint32()),
+            ("raw_lux", pa.uint16()), ("aht_ok", pa.uint8()), ("lux_ok", pa.uint8()),
+            ("temperature", pa.float32()), ("humidity", pa.float32()),
+            ("lux", pa.float32()),
+            ("raw_ph", pa.uint16()), ("raw_ec", pa.uint16()), ("raw_level", pa.uint16()),
+            ("probes_ok", pa.uint8()), ("ph", pa.float32()), ("ec", pa.float32()),
+            ("level", pa.float32()),
+        ])
+        self.writer = pq.ParquetWriter(path, self.schema)
+        self.pending = []
+
+    def write(self, rows):
+        self.pending.extend(rows)
+        if len(self.pending) >= self.BATCH_ROWS:
+            self.flush()
+
+    def flush(self):
+        if not self.pending:
+            return
+        columns = list(zip(*self.pending))
+        table = self.pa.Table.from_arrays(
+            [self.pa.array(col, type=field.type) for col, field in zip(columns, self.schema)],
+            schema=self.schema)
+        self.writer.write_table(table)
+        self.pending = []
+
+    def close(self):
+        self.flush()
+        self.writer.close()
+
+
+def open_writer(path):
+    if path.endswith(".parquet"):
+        return ParquetWriter(path)
+    return CsvWriter(path)
+
+
+def open_source(path):
+    """Return (read_fn, close_fn) for a serial port or a raw capture file."""
+    if os.path.isfile(path):
+        f = open(path, "rb")
+        return (lambda: f.read(65536)), f.close
+
+    import serial
+    port = serial.Serial(path, timeout=0.1)
+    port.dtr = True
+    port.reset_input_buffer()
+    port.write(CMD_START)
+
+    def close():
+        port.write(CMD_STOP)
+        port.flush()
+        port.close()
+
+    return (lambda: port.read(max(1, port.in_waiting))), close
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decodifica o stream binario USB do SMAVHIoT")
+    parser.add_argument("source", help="Porta serial (/dev/ttyACM0, COM3) ou arquivo de captura")
+    parser.add_argument("-o", "--output", required=True, help="Arquivo de saida (.csv ou .parquet)")
+    parser.add_argument("--duration", type=float, default=0, help="Segundos de captura (0 = ate Ctrl+C)")
+    args = parser.parse_args()
+
+    read, close = open_source(args.source)
+    writer = open_writer(args.output)
+    decoder = Decoder()
+    started = time.monotonic()
+    is_file = os.path.isfile(args.source)
+
+    try:
+        while not args.duration or time.monotonic() - started < args.duration:
+            data = read()
+            if not data:
+                if is_file:
+                    break
+                continue
+            writer.write(decoder.feed(data))
+    except KeyboardInterrupt:
+        pass
+    finally:
+        close()
+        writer.close()
+
+    elapsed = time.monotonic() - started
+    expected = decoder.frames + decoder.dropped
+    loss = 100.0 * decoder.dropped / expected if expected else 0.0
+    print(f"Quadros: {decoder.frames} ({decoder.frames / elapsed:.1f}/s)", file=sys.stderr)
+    print(f"Descartados (lacunas de seq): {decoder.dropped} ({loss:.2f}%)", file=sys.stderr)
+    print(f"Erros de CRC / ressincronizacoes: {decoder.crc_errors}", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()